@@ -0,0 +1,103 @@
+#include "IOThreadPool.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GM
+{
+	namespace
+	{
+		// a few reads in flight keep the disk queue busy, more threads only add contention
+		constexpr uint32_t s_defaultThreadCount = 2;
+
+		class IOPool
+		{
+		public:
+			IOPool(uint32_t threadCount)
+			{
+				for (uint32_t i = 0; i < threadCount; i++)
+					m_threads.emplace_back([this]() { ThreadLoop(); });
+			}
+
+			~IOPool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+
+				m_cv.notify_all();
+				for (std::thread& t : m_threads)
+					t.join();
+			}
+
+			void Push(const std::function<void()>& task)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_tasks.push_back(task);
+				}
+
+				m_cv.notify_one();
+			}
+
+			uint32_t GetThreadCount() const
+			{
+				return static_cast<uint32_t>(m_threads.size());
+			}
+
+		private:
+			void ThreadLoop()
+			{
+				while (true)
+				{
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+						if (m_stop && m_tasks.empty())
+							return;
+
+						task = std::move(m_tasks.front());
+						m_tasks.pop_front();
+					}
+
+					task();
+				}
+			}
+
+			std::vector<std::thread> m_threads;
+			std::deque<std::function<void()>> m_tasks;
+			std::mutex m_mutex;
+			std::condition_variable m_cv;
+			bool m_stop = false;
+		};
+
+		uint32_t s_requestedThreadCount = 0;
+
+		IOPool& GetPool()
+		{
+			static IOPool pool(s_requestedThreadCount > 0 ? s_requestedThreadCount : s_defaultThreadCount);
+			return pool;
+		}
+	}
+
+	void IOThreadPool::Init(uint32_t threadCount)
+	{
+		s_requestedThreadCount = threadCount;
+		GetPool();
+	}
+
+	uint32_t IOThreadPool::GetThreadCount()
+	{
+		return GetPool().GetThreadCount();
+	}
+
+	void IOThreadPool::Submit(const std::function<void()>& task)
+	{
+		GetPool().Push(task);
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+
+namespace GM
+{
+	/// <summary>
+	/// Threads for blocking file access, apart from the JobSystem workers so tasks waiting on the disk never
+	/// hold up computation. Created on first use, tasks start in the order they were submitted.
+	/// </summary>
+	class IOThreadPool
+	{
+	public:
+		/// <param name="threadCount">0 for 2 threads. Only has an effect before the first task is submitted</param>
+		static void Init(uint32_t threadCount = 0);
+
+		static uint32_t GetThreadCount();
+
+		static void Submit(const std::function<void()>& task);
+
+	private:
+		IOThreadPool() = default;
+	};
+}
@@ -0,0 +1,228 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace GM
+{
+	namespace
+	{
+		thread_local uint32_t s_threadIndex = 0;
+
+		class WorkerPool
+		{
+		public:
+			WorkerPool(uint32_t workerCount)
+			{
+				for (uint32_t i = 0; i < workerCount; i++)
+				{
+					m_workers.emplace_back([this, i]()
+						{
+							s_threadIndex = i + 1;
+							WorkerLoop();
+						});
+				}
+			}
+
+			~WorkerPool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+
+				m_cv.notify_all();
+				for (std::thread& t : m_workers)
+					t.join();
+			}
+
+			void Push(const std::function<void()>& task)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_tasks.push_back(task);
+				}
+
+				m_cv.notify_one();
+			}
+
+			bool TryRunOne()
+			{
+				std::function<void()> task;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_tasks.empty())
+						return false;
+
+					// newest first, keeps nested tasks of the waiting thread hot in cache
+					task = std::move(m_tasks.back());
+					m_tasks.pop_back();
+				}
+
+				task();
+				return true;
+			}
+
+			uint32_t GetWorkerCount() const
+			{
+				return static_cast<uint32_t>(m_workers.size());
+			}
+
+		private:
+			void WorkerLoop()
+			{
+				while (true)
+				{
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+						if (m_stop && m_tasks.empty())
+							return;
+
+						task = std::move(m_tasks.front());
+						m_tasks.pop_front();
+					}
+
+					task();
+				}
+			}
+
+			std::vector<std::thread> m_workers;
+			std::deque<std::function<void()>> m_tasks;
+			std::mutex m_mutex;
+			std::condition_variable m_cv;
+			bool m_stop = false;
+		};
+
+		uint32_t s_requestedWorkerCount = 0;
+
+		WorkerPool& GetPool()
+		{
+			static WorkerPool pool(s_requestedWorkerCount > 0 ? s_requestedWorkerCount :
+				std::max(1u, std::thread::hardware_concurrency()) - 1);
+			return pool;
+		}
+	}
+
+	TaskGroup::~TaskGroup()
+	{
+		WaitPending();
+	}
+
+	void TaskGroup::Run(const std::function<void()>& task)
+	{
+		m_pending++;
+		JobSystem::Submit([this, task]()
+			{
+				// the task must count as done even when it throws, or Wait() would never return
+				try
+				{
+					task();
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(m_exceptionMutex);
+					if (!m_exception)
+						m_exception = std::current_exception();
+				}
+
+				m_pending--;
+			});
+	}
+
+	void TaskGroup::Wait()
+	{
+		WaitPending();
+
+		std::exception_ptr exception;
+		{
+			std::lock_guard<std::mutex> lock(m_exceptionMutex);
+			std::swap(exception, m_exception);
+		}
+
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	void TaskGroup::WaitPending()
+	{
+		while (m_pending > 0)
+		{
+			if (!JobSystem::RunPendingTask())
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::Init(uint32_t workerCount)
+	{
+		s_requestedWorkerCount = workerCount;
+		GetPool();
+	}
+
+	uint32_t JobSystem::GetThreadCount()
+	{
+		return GetPool().GetWorkerCount() + 1;
+	}
+
+	uint32_t JobSystem::GetThreadIndex()
+	{
+		return s_threadIndex;
+	}
+
+	void JobSystem::ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const std::function<void(uint32_t first, uint32_t last)>& fn)
+	{
+		if (begin >= end)
+			return;
+
+		uint32_t count = end - begin;
+		uint32_t chunkCount = ComputeChunkCount(count, grainSize);
+		ParallelForChunks(count, chunkCount, [&](uint32_t, uint32_t first, uint32_t last) { fn(begin + first, begin + last); });
+	}
+
+	void JobSystem::ParallelForChunks(uint32_t count, uint32_t chunkCount, const std::function<void(uint32_t chunk, uint32_t first, uint32_t last)>& fn)
+	{
+		if (count == 0 || chunkCount == 0)
+			return;
+
+		auto range = [count, chunkCount](uint32_t chunk)
+		{
+			return static_cast<uint32_t>(static_cast<uint64_t>(count) * chunk / chunkCount);
+		};
+
+		if (chunkCount == 1)
+		{
+			fn(0, 0, count);
+			return;
+		}
+
+		TaskGroup group;
+		for (uint32_t c = 1; c < chunkCount; c++)
+		{
+			group.Run([&fn, &range, c]() { fn(c, range(c), range(c + 1)); });
+		}
+
+		fn(0, 0, range(1));
+		group.Wait();
+	}
+
+	uint32_t JobSystem::ComputeChunkCount(uint32_t count, uint32_t grainSize)
+	{
+		uint32_t maxChunks = (count + std::max(grainSize, 1u) - 1) / std::max(grainSize, 1u);
+		return std::max(1u, std::min(maxChunks, GetThreadCount() * 4));
+	}
+
+	void JobSystem::Submit(const std::function<void()>& task)
+	{
+		GetPool().Push(task);
+	}
+
+	bool JobSystem::RunPendingTask()
+	{
+		return GetPool().TryRunOne();
+	}
+}
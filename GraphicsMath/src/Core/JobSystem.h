@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+
+namespace GM
+{
+	/// <summary>
+	/// Set of tasks that can be waited on together. Tasks may spawn more tasks into the same
+	/// or another group, Wait() executes pending tasks instead of blocking so nesting can't deadlock.
+	/// An exception thrown by a task is rethrown by Wait() once every task of the group has finished,
+	/// the first one when several throw. The destructor waits and drops it.
+	/// </summary>
+	class TaskGroup
+	{
+	public:
+		TaskGroup() = default;
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		void Run(const std::function<void()>& task);
+		void Wait();
+
+	private:
+		void WaitPending();
+
+		std::atomic<uint32_t> m_pending = 0;
+		std::mutex m_exceptionMutex;
+		std::exception_ptr m_exception;
+	};
+
+	/// <summary>
+	/// Fixed pool of worker threads, created on first use with (hardware threads - 1) workers.
+	/// </summary>
+	class JobSystem
+	{
+	public:
+		/// <param name="workerCount">0 to use hardware threads - 1. Only has an effect before the first task is submitted</param>
+		static void Init(uint32_t workerCount = 0);
+
+		// worker threads + the calling thread
+		static uint32_t GetThreadCount();
+
+		/// <summary>
+		/// 0 for any thread that is not a worker, [1, GetThreadCount()) for workers.
+		/// Can be used to index per thread scratch memory as long as only one outside thread drives the jobs.
+		/// </summary>
+		static uint32_t GetThreadIndex();
+
+		/// <summary>
+		/// Splits [begin, end) into ranges of at least grainSize elements and calls fn(first, last) on them in parallel.
+		/// Returns once every range has been processed.
+		/// </summary>
+		static void ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const std::function<void(uint32_t first, uint32_t last)>& fn);
+
+		/// <summary>
+		/// Splits [0, count) into exactly chunkCount contiguous ranges and calls fn(chunk, first, last) on them in parallel.
+		/// The ranges only depend on count and chunkCount so per chunk results can be merged deterministically.
+		/// </summary>
+		static void ParallelForChunks(uint32_t count, uint32_t chunkCount, const std::function<void(uint32_t chunk, uint32_t first, uint32_t last)>& fn);
+
+		// a chunk count that keeps every thread busy without making chunks smaller than grainSize
+		static uint32_t ComputeChunkCount(uint32_t count, uint32_t grainSize);
+
+	private:
+		friend class TaskGroup;
+
+		static void Submit(const std::function<void()>& task);
+		static bool RunPendingTask();
+
+		JobSystem() = default;
+	};
+}
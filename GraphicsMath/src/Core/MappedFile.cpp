@@ -0,0 +1,242 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GM
+{
+	namespace
+	{
+		// pages are at least this large on every target, touching one byte every s_pageSize faults them all in
+		constexpr size_t s_pageSize = 4096;
+
+#ifdef _WIN32
+		std::string GetSystemError()
+		{
+			char* msgBuffer = nullptr;
+			DWORD msgLen = FormatMessageA(
+				FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+				nullptr, GetLastError(), MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+				reinterpret_cast<LPSTR>(&msgBuffer), 0, nullptr
+			);
+
+			if (msgLen == 0)
+				return "Unidentified Error";
+
+			std::string errorString = msgBuffer;
+			LocalFree(msgBuffer);
+
+			// FormatMessage ends the message with a line break
+			while (!errorString.empty() && (errorString.back() == '\n' || errorString.back() == '\r'))
+				errorString.pop_back();
+
+			return errorString;
+		}
+#else
+		std::string GetSystemError()
+		{
+			return strerror(errno);
+		}
+#endif
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			std::swap(m_data, other.m_data);
+			std::swap(m_size, other.m_size);
+			std::swap(m_open, other.m_open);
+			std::swap(m_error, other.m_error);
+			std::swap(m_file, other.m_file);
+#ifdef _WIN32
+			std::swap(m_mapping, other.m_mapping);
+#endif
+		}
+
+		return *this;
+	}
+
+#ifdef _WIN32
+	bool MappedFile::Open(const std::string& filename)
+	{
+		Close();
+		m_error.clear();
+
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return Fail("CreateFile");
+
+		m_file = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+			return Fail("GetFileSizeEx");
+
+		m_size = static_cast<size_t>(size.QuadPart);
+		m_open = true;
+
+		// a mapping of an empty file fails, there is nothing to map anyway
+		if (m_size == 0)
+			return true;
+
+		m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+			return Fail("CreateFileMapping");
+
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_data)
+			return Fail("MapViewOfFile");
+
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+
+		if (m_mapping)
+			CloseHandle(m_mapping);
+
+		if (m_file)
+			CloseHandle(m_file);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_open = false;
+		m_file = nullptr;
+		m_mapping = nullptr;
+	}
+#else
+	bool MappedFile::Open(const std::string& filename)
+	{
+		Close();
+		m_error.clear();
+
+		int file = open(filename.c_str(), O_RDONLY);
+		if (file < 0)
+			return Fail("open");
+
+		m_file = file;
+
+		struct stat info;
+		if (fstat(file, &info) != 0)
+			return Fail("fstat");
+
+		m_size = static_cast<size_t>(info.st_size);
+		m_open = true;
+
+		if (m_size == 0)
+			return true;
+
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED)
+			return Fail("mmap");
+
+		m_data = static_cast<const uint8_t*>(data);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data)
+			munmap(const_cast<uint8_t*>(m_data), m_size);
+
+		if (m_file >= 0)
+			close(m_file);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_open = false;
+		m_file = -1;
+	}
+#endif
+
+	bool MappedFile::Fail(const char* call)
+	{
+		std::string error = std::string(call) + ": " + GetSystemError();
+		Close();
+		m_error = error;
+		return false;
+	}
+
+	void MappedFile::Prefetch(size_t offset, size_t size, bool wait) const
+	{
+		if (!m_data || offset >= m_size)
+			return;
+
+		size = std::min(size, m_size - offset);
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+		WIN32_MEMORY_RANGE_ENTRY range = { const_cast<uint8_t*>(m_data + offset), size };
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+		// madvise wants a page aligned start, the view is page aligned
+		size_t start = offset & ~(static_cast<size_t>(sysconf(_SC_PAGESIZE)) - 1);
+		madvise(const_cast<uint8_t*>(m_data) + start, offset + size - start, MADV_WILLNEED);
+#endif
+
+		if (wait)
+		{
+			uint8_t sum = 0;
+			for (size_t i = offset; i < offset + size; i += s_pageSize)
+				sum += m_data[i];
+
+			// so the reads aren't optimized out
+			volatile uint8_t sink = sum;
+			(void)sink;
+		}
+	}
+
+	bool MappedFile::IsOpen() const
+	{
+		return m_open;
+	}
+
+	const uint8_t* MappedFile::GetData() const
+	{
+		return m_data;
+	}
+
+	size_t MappedFile::GetSize() const
+	{
+		return m_size;
+	}
+
+	std::string_view MappedFile::GetView() const
+	{
+		return std::string_view(reinterpret_cast<const char*>(m_data), m_size);
+	}
+
+	const std::string& MappedFile::GetError() const
+	{
+		return m_error;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+namespace GM
+{
+	/// <summary>
+	/// Read only view of a whole file mapped into the address space, pages are read from disk on first access.
+	/// The view is page aligned. Empty files open with a null view.
+	/// </summary>
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		// closes the current file first. False when the file can't be opened or mapped, GetError tells why
+		bool Open(const std::string& filename);
+		void Close();
+
+		bool IsOpen() const;
+		const uint8_t* GetData() const;
+		size_t GetSize() const;
+		// the bytes as text, no copy
+		std::string_view GetView() const;
+
+		/// <summary>
+		/// Asks the OS to start reading the pages of [offset, offset + size) in the background (madvise WILLNEED,
+		/// PrefetchVirtualMemory) so the first accesses don't wait on the disk. With wait, also touches every page
+		/// on the calling thread and returns once they are all in memory.
+		/// </summary>
+		void Prefetch(size_t offset = 0, size_t size = SIZE_MAX, bool wait = false) const;
+
+		// the OS description of the last Open failure, empty after a success
+		const std::string& GetError() const;
+
+	private:
+		// closes, keeps the error of call and returns false
+		bool Fail(const char* call);
+
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		bool m_open = false;
+		std::string m_error;
+
+#ifdef _WIN32
+		void* m_file = nullptr;    // HANDLE
+		void* m_mapping = nullptr; // HANDLE
+#else
+		int m_file = -1;
+#endif
+	};
+}
@@ -0,0 +1,1376 @@
+#include "BVH.h"
+
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_maxBins = 64;
+		constexpr uint32_t s_grainSize = 4096;
+		constexpr float s_floatMax = 3.402823466e+38f;
+
+		struct Bounds3
+		{
+			float min[3] = { s_floatMax, s_floatMax, s_floatMax };
+			float max[3] = { -s_floatMax, -s_floatMax, -s_floatMax };
+
+			void Grow(const float* pmin, const float* pmax)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					min[i] = std::min(min[i], pmin[i]);
+					max[i] = std::max(max[i], pmax[i]);
+				}
+			}
+
+			void Grow(const Bounds3& b)
+			{
+				Grow(b.min, b.max);
+			}
+
+			float Area() const
+			{
+				float e[3] = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+				if (e[0] < 0.0f || e[1] < 0.0f || e[2] < 0.0f)
+					return 0.0f;
+
+				return 2.0f * (e[0] * e[1] + e[1] * e[2] + e[2] * e[0]);
+			}
+		};
+
+		struct Bin
+		{
+			Bounds3 bounds;
+			uint32_t count = 0;
+		};
+
+		struct BinSet
+		{
+			Bin bins[3][s_maxBins];
+		};
+
+		float NodeArea(const BVHNode& node)
+		{
+			float e[3] = { node.max[0] - node.min[0], node.max[1] - node.min[1], node.max[2] - node.min[2] };
+			return 2.0f * (e[0] * e[1] + e[1] * e[2] + e[2] * e[0]);
+		}
+
+		float UnionArea(const BVHNode& a, const BVHNode& b)
+		{
+			float e[3];
+			for (int i = 0; i < 3; i++)
+				e[i] = std::max(a.max[i], b.max[i]) - std::min(a.min[i], b.min[i]);
+
+			return 2.0f * (e[0] * e[1] + e[1] * e[2] + e[2] * e[0]);
+		}
+
+		void CombineChildren(std::vector<BVHNode>& nodes, uint32_t index)
+		{
+			BVHNode& node = nodes[index];
+			const BVHNode& l = nodes[node.leftFirst];
+			const BVHNode& r = nodes[node.leftFirst + 1];
+			for (int i = 0; i < 3; i++)
+			{
+				node.min[i] = std::min(l.min[i], r.min[i]);
+				node.max[i] = std::max(l.max[i], r.max[i]);
+			}
+		}
+
+		uint32_t BinIndex(float centroid, float cmin, float scale, uint32_t binCount)
+		{
+			return std::min(binCount - 1, static_cast<uint32_t>((centroid - cmin) * scale));
+		}
+
+		// spreads the lower 10 bits of v so there are 2 zero bits between each of them
+		uint32_t ExpandBits(uint32_t v)
+		{
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		}
+
+		// x, y, z: [0, 1]
+		uint32_t MortonCode(float x, float y, float z)
+		{
+			auto quantize = [](float f) { return static_cast<uint32_t>(std::min(std::max(f * 1024.0f, 0.0f), 1023.0f)); };
+			return (ExpandBits(quantize(x)) << 2) | (ExpandBits(quantize(y)) << 1) | ExpandBits(quantize(z));
+		}
+	}
+
+	BVH::BVH()
+		: BVH(BVHDesc())
+	{
+	}
+
+	BVH::BVH(const BVHDesc& desc)
+		: m_desc(desc)
+	{
+	}
+
+	void BVH::Build(const TriangleMeshView& mesh)
+	{
+		assert(m_desc.binCount >= 2 && m_desc.binCount <= s_maxBins && "binCount not supported");
+		assert(m_desc.maxLeafSize > 0 && "maxLeafSize must be at least 1");
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		Clear();
+
+		uint32_t triCount = mesh.GetTriangleCount();
+		if (triCount == 0)
+			return;
+
+		m_primIndices.resize(triCount);
+		m_primBounds.resize(static_cast<size_t>(triCount) * 6);
+		m_primCentroids.resize(static_cast<size_t>(triCount) * 3);
+		for (uint32_t t = 0; t < triCount; t++)
+			m_primIndices[t] = t;
+
+		ComputePrimitiveData(mesh, m_primIndices.data(), triCount);
+
+		if (m_desc.buildMode == BVHBuildMode::LBVH)
+			BuildLBVH();
+		else
+			BuildBinnedSAH();
+
+		// build data is only needed while splitting
+		std::vector<float>().swap(m_primBounds);
+		std::vector<float>().swap(m_primCentroids);
+		std::vector<uint32_t>().swap(m_scratch);
+
+		auto end = std::chrono::high_resolution_clock::now();
+		UpdateStats(std::chrono::duration<double, std::milli>(end - start).count());
+
+		m_buildSAHCost = m_stats.sahCost;
+		m_sahSum = m_stats.sahCost * NodeArea(m_nodes[0]);
+		ResetSubtreeBaselines();
+		UpdateRefitStats(0.0);
+	}
+
+	void BVH::Clear()
+	{
+		m_nodes.clear();
+		m_primIndices.clear();
+		m_parents.clear();
+		m_primLeaves.clear();
+		m_subtreeBaselines.clear();
+		m_marks.clear();
+		m_stats = BVHStats();
+		m_refitStats = BVHRefitStats();
+		m_sahSum = 0.0f;
+		m_buildSAHCost = 0.0f;
+	}
+
+	void BVH::Refit(const TriangleMeshView& mesh)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		if (m_nodes.empty())
+			return;
+
+		assert(mesh.GetTriangleCount() == m_primIndices.size() && "mesh doesn't match the bvh");
+
+		RefitNodes(mesh, nullptr);
+		m_sahSum = ComputeSAHCost() * NodeArea(m_nodes[0]);
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_refitStats.refittedNodes = static_cast<uint32_t>(m_nodes.size());
+		m_refitStats.rotations = 0;
+		m_refitStats.rebuiltSubtrees = 0;
+		UpdateRefitStats(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	void BVH::Refit(const TriangleMeshView& mesh, const Matrix& transform)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		if (m_nodes.empty())
+			return;
+
+		assert(mesh.GetTriangleCount() == m_primIndices.size() && "mesh doesn't match the bvh");
+
+		RefitNodes(mesh, &transform);
+		m_sahSum = ComputeSAHCost() * NodeArea(m_nodes[0]);
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_refitStats.refittedNodes = static_cast<uint32_t>(m_nodes.size());
+		m_refitStats.rotations = 0;
+		m_refitStats.rebuiltSubtrees = 0;
+		UpdateRefitStats(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	void BVH::Refit(const TriangleMeshView& mesh, const uint32_t* changedTriangles, uint32_t changedCount)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		if (m_nodes.empty())
+			return;
+
+		assert(mesh.GetTriangleCount() == m_primIndices.size() && "mesh doesn't match the bvh");
+
+		EnsureLinks();
+
+		// every changed leaf and its ancestors, each node once
+		m_dirty.clear();
+		for (uint32_t i = 0; i < changedCount; i++)
+		{
+			uint32_t node = m_primLeaves[changedTriangles[i]];
+			while (node != UINT32_MAX && !m_marks[node])
+			{
+				m_marks[node] = 1;
+				m_dirty.push_back(node);
+				node = m_parents[node];
+			}
+		}
+
+		// children are always stored after their parent, so descending order is bottom-up
+		std::sort(m_dirty.begin(), m_dirty.end(), std::greater<uint32_t>());
+
+		for (uint32_t index : m_dirty)
+		{
+			BVHNode& node = m_nodes[index];
+			float oldArea = NodeArea(node);
+
+			if (node.IsLeaf())
+				LeafBounds(node, mesh, nullptr);
+			else
+				CombineChildren(m_nodes, index);
+
+			float cost = node.IsLeaf() ? node.count * m_desc.intersectionCost : m_desc.traversalCost;
+			m_sahSum += (NodeArea(node) - oldArea) * cost;
+			m_marks[index] = 0;
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_refitStats.refittedNodes = static_cast<uint32_t>(m_dirty.size());
+		m_refitStats.rotations = 0;
+		m_refitStats.rebuiltSubtrees = 0;
+		UpdateRefitStats(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	void BVH::Optimize(const TriangleMeshView& mesh)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		if (m_nodes.empty())
+			return;
+
+		assert(mesh.GetTriangleCount() == m_primIndices.size() && "mesh doesn't match the bvh");
+
+		uint32_t rotations = Rotate();
+
+		// rotations break the depth-first order and the contiguous primitive ranges of subtrees, restore both
+		std::vector<uint32_t> origin;
+		std::vector<float> baselines = m_subtreeBaselines;
+		Compact(m_nodes, {}, {}, true, &origin);
+		for (size_t i = 0; i < origin.size(); i++)
+			m_subtreeBaselines[i] = baselines[origin[i]];
+
+		uint32_t rebuilt = RebuildDegradedSubtrees(mesh);
+		m_sahSum = ComputeSAHCost() * NodeArea(m_nodes[0]);
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_refitStats.refittedNodes = 0;
+		m_refitStats.rotations = rotations;
+		m_refitStats.rebuiltSubtrees = rebuilt;
+		UpdateRefitStats(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	void BVH::SetDesc(const BVHDesc& desc)
+	{
+		m_desc = desc;
+	}
+
+	const BVHDesc& BVH::GetDesc() const
+	{
+		return m_desc;
+	}
+
+	const BVHStats& BVH::GetStats() const
+	{
+		return m_stats;
+	}
+
+	const BVHRefitStats& BVH::GetRefitStats() const
+	{
+		return m_refitStats;
+	}
+
+	const std::vector<BVHNode>& BVH::GetNodes() const
+	{
+		return m_nodes;
+	}
+
+	const std::vector<uint32_t>& BVH::GetPrimitiveIndices() const
+	{
+		return m_primIndices;
+	}
+
+	AABB BVH::GetBounds() const
+	{
+		if (m_nodes.empty())
+			return AABB();
+
+		const BVHNode& root = m_nodes[0];
+		return AABB(Vector(root.min[0], root.min[1], root.min[2], 0.0f), Vector(root.max[0], root.max[1], root.max[2], 0.0f));
+	}
+
+	bool BVH::IsEmpty() const
+	{
+		return m_nodes.empty();
+	}
+
+	float BVH::ComputeSAHCost() const
+	{
+		if (m_nodes.empty())
+			return 0.0f;
+
+		float rootArea = NodeArea(m_nodes[0]);
+		if (rootArea <= 0.0f)
+			return m_desc.intersectionCost * m_nodes[0].count;
+
+		float cost = 0.0f;
+		for (const BVHNode& node : m_nodes)
+		{
+			float area = NodeArea(node);
+			cost += node.IsLeaf() ? area * node.count * m_desc.intersectionCost : area * m_desc.traversalCost;
+		}
+
+		return cost / rootArea;
+	}
+
+	uint32_t BVH::ComputeDepth() const
+	{
+		if (m_nodes.empty())
+			return 0;
+
+		uint32_t maxDepth = 0;
+		std::vector<std::pair<uint32_t, uint32_t>> stack;
+		stack.emplace_back(0, 1);
+		while (!stack.empty())
+		{
+			auto [index, depth] = stack.back();
+			stack.pop_back();
+
+			maxDepth = std::max(maxDepth, depth);
+			const BVHNode& node = m_nodes[index];
+			if (!node.IsLeaf())
+			{
+				stack.emplace_back(node.leftFirst, depth + 1);
+				stack.emplace_back(node.leftFirst + 1, depth + 1);
+			}
+		}
+
+		return maxDepth;
+	}
+
+	void BVH::BuildBinnedSAH()
+	{
+		uint32_t triCount = static_cast<uint32_t>(m_primIndices.size());
+		bool parallel = m_desc.multithreaded && JobSystem::GetThreadCount() > 1 && triCount >= m_desc.parallelThreshold;
+
+		BVHNode root = {};
+		root.leftFirst = 0;
+		root.count = triCount;
+		UpdateNodeBounds(root, parallel);
+
+		if (!parallel)
+		{
+			// pairs of children: at most 2 * triCount - 1 nodes
+			m_nodes.reserve(static_cast<size_t>(triCount) * 2);
+			m_nodes.push_back(root);
+			Subdivide(m_nodes, 0);
+			return;
+		}
+
+		m_scratch.resize(triCount);
+
+		// the top of the tree is split on this thread with parallel binning and partitioning,
+		// once a node is small enough its whole subtree is built by a task into its own node array
+		std::deque<std::vector<BVHNode>> subtrees;
+		std::vector<BVHNode> top;
+		std::vector<int32_t> topSubtree;
+		top.push_back(root);
+		topSubtree.push_back(-1);
+
+		TaskGroup group;
+		std::vector<uint32_t> stack;
+		stack.push_back(0);
+		while (!stack.empty())
+		{
+			uint32_t index = stack.back();
+			stack.pop_back();
+
+			BVHNode node = top[index];
+			if (node.count < m_desc.parallelThreshold)
+			{
+				topSubtree[index] = static_cast<int32_t>(subtrees.size());
+				subtrees.emplace_back();
+
+				std::vector<BVHNode>& subtree = subtrees.back();
+				subtree.push_back(node);
+				group.Run([this, &subtree]() { Subdivide(subtree, 0); });
+				continue;
+			}
+
+			uint32_t leftCount = 0;
+			if (!SplitNode(node, leftCount, true))
+				continue;
+
+			uint32_t left = static_cast<uint32_t>(top.size());
+			for (uint32_t i = 0; i < 2; i++)
+			{
+				BVHNode child = {};
+				child.leftFirst = i == 0 ? node.leftFirst : node.leftFirst + leftCount;
+				child.count = i == 0 ? leftCount : node.count - leftCount;
+				UpdateNodeBounds(child, child.count >= m_desc.parallelThreshold);
+
+				top.push_back(child);
+				topSubtree.push_back(-1);
+			}
+
+			top[index].leftFirst = left;
+			top[index].count = 0;
+
+			stack.push_back(left + 1);
+			stack.push_back(left);
+		}
+
+		group.Wait();
+
+		Compact(top, topSubtree, subtrees, false, nullptr);
+	}
+
+	void BVH::BuildLBVH()
+	{
+		uint32_t triCount = static_cast<uint32_t>(m_primIndices.size());
+		bool parallel = m_desc.multithreaded && JobSystem::GetThreadCount() > 1 && triCount >= m_desc.parallelThreshold;
+		uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(triCount, s_grainSize) : 1;
+
+		// centroid bounds
+		std::vector<Bounds3> chunkBounds(chunkCount);
+		JobSystem::ParallelForChunks(triCount, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				for (uint32_t t = first; t < last; t++)
+				{
+					const float* c = &m_primCentroids[static_cast<size_t>(t) * 3];
+					chunkBounds[chunk].Grow(c, c);
+				}
+			});
+
+		Bounds3 centroidBounds;
+		for (const Bounds3& b : chunkBounds)
+			centroidBounds.Grow(b);
+
+		float scale[3];
+		for (int i = 0; i < 3; i++)
+		{
+			float extent = centroidBounds.max[i] - centroidBounds.min[i];
+			scale[i] = extent > 0.0f ? 1.0f / extent : 0.0f;
+		}
+
+		std::vector<uint32_t> codes(triCount);
+		std::vector<uint32_t> tempCodes(triCount);
+		m_scratch.resize(triCount);
+
+		JobSystem::ParallelForChunks(triCount, chunkCount, [&](uint32_t, uint32_t first, uint32_t last)
+			{
+				for (uint32_t t = first; t < last; t++)
+				{
+					const float* c = &m_primCentroids[static_cast<size_t>(t) * 3];
+					codes[t] = MortonCode(
+						(c[0] - centroidBounds.min[0]) * scale[0],
+						(c[1] - centroidBounds.min[1]) * scale[1],
+						(c[2] - centroidBounds.min[2]) * scale[2]);
+				}
+			});
+
+		// LSD radix sort of (code, primitive) pairs, 8 bits per pass. Every chunk scatters into its own
+		// slice of each bucket so the sort stays stable and needs no atomics
+		std::vector<uint32_t> histograms(static_cast<size_t>(chunkCount) * 256);
+		for (uint32_t shift = 0; shift < 32; shift += 8)
+		{
+			std::fill(histograms.begin(), histograms.end(), 0u);
+			JobSystem::ParallelForChunks(triCount, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+				{
+					uint32_t* h = &histograms[static_cast<size_t>(chunk) * 256];
+					for (uint32_t i = first; i < last; i++)
+						h[(codes[i] >> shift) & 0xFF]++;
+				});
+
+			uint32_t offset = 0;
+			for (uint32_t digit = 0; digit < 256; digit++)
+			{
+				for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+				{
+					uint32_t& h = histograms[static_cast<size_t>(chunk) * 256 + digit];
+					uint32_t count = h;
+					h = offset;
+					offset += count;
+				}
+			}
+
+			JobSystem::ParallelForChunks(triCount, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+				{
+					uint32_t* h = &histograms[static_cast<size_t>(chunk) * 256];
+					for (uint32_t i = first; i < last; i++)
+					{
+						uint32_t dest = h[(codes[i] >> shift) & 0xFF]++;
+						tempCodes[dest] = codes[i];
+						m_scratch[dest] = m_primIndices[i];
+					}
+				});
+
+			codes.swap(tempCodes);
+			m_primIndices.swap(m_scratch);
+		}
+
+		// top-down emission: split where the highest differing morton bit flips
+		m_nodes.reserve(static_cast<size_t>(triCount) * 2);
+
+		BVHNode root = {};
+		root.leftFirst = 0;
+		root.count = triCount;
+		m_nodes.push_back(root);
+
+		std::vector<uint32_t> stack;
+		stack.push_back(0);
+		while (!stack.empty())
+		{
+			uint32_t index = stack.back();
+			stack.pop_back();
+
+			BVHNode node = m_nodes[index];
+			if (node.count <= m_desc.maxLeafSize)
+				continue;
+
+			uint32_t first = node.leftFirst;
+			uint32_t last = first + node.count - 1;
+			uint32_t leftCount = node.count / 2;
+
+			uint32_t diff = codes[first] ^ codes[last];
+			if (diff != 0)
+			{
+				uint32_t bit = 31;
+				while (!(diff & (1u << bit)))
+					bit--;
+
+				// codes are sorted, so the first code with the bit set starts the right child
+				auto split = std::partition_point(codes.begin() + first, codes.begin() + last + 1,
+					[bit](uint32_t code) { return !(code & (1u << bit)); });
+				leftCount = static_cast<uint32_t>(split - (codes.begin() + first));
+			}
+
+			uint32_t left = static_cast<uint32_t>(m_nodes.size());
+
+			BVHNode leftNode = {};
+			leftNode.leftFirst = first;
+			leftNode.count = leftCount;
+
+			BVHNode rightNode = {};
+			rightNode.leftFirst = first + leftCount;
+			rightNode.count = node.count - leftCount;
+
+			m_nodes.push_back(leftNode);
+			m_nodes.push_back(rightNode);
+
+			m_nodes[index].leftFirst = left;
+			m_nodes[index].count = 0;
+
+			stack.push_back(left + 1);
+			stack.push_back(left);
+		}
+
+		// bounds: leaves in parallel, then inner nodes bottom-up. Children are always stored after their parent
+		uint32_t nodeCount = static_cast<uint32_t>(m_nodes.size());
+		auto leafBounds = [&](uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; i++)
+			{
+				if (m_nodes[i].IsLeaf())
+					UpdateNodeBounds(m_nodes[i], false);
+			}
+		};
+
+		if (parallel)
+			JobSystem::ParallelFor(0, nodeCount, s_grainSize, leafBounds);
+		else
+			leafBounds(0, nodeCount);
+
+		for (uint32_t i = nodeCount; i-- > 0;)
+		{
+			if (!m_nodes[i].IsLeaf())
+				CombineChildren(m_nodes, i);
+		}
+	}
+
+	bool BVH::SplitNode(const BVHNode& node, uint32_t& leftCount, bool parallel)
+	{
+		if (node.count <= 1)
+			return false;
+
+		Split split = FindBestSplit(node, parallel);
+		float leafCost = node.count * m_desc.intersectionCost;
+
+		leftCount = 0;
+		if (split.binScale > 0.0f && split.cost < s_floatMax)
+		{
+			if (node.count <= m_desc.maxLeafSize && split.cost >= leafCost)
+				return false;
+
+			leftCount = Partition(node, split, parallel) - node.leftFirst;
+		}
+
+		if (leftCount == 0 || leftCount == node.count)
+		{
+			// all centroids fall in the same bin, the only way to respect maxLeafSize is an object median split
+			if (node.count <= m_desc.maxLeafSize)
+				return false;
+
+			leftCount = node.count / 2;
+		}
+
+		return true;
+	}
+
+	void BVH::Subdivide(std::vector<BVHNode>& nodes, uint32_t nodeIndex)
+	{
+		std::vector<uint32_t> stack;
+		stack.push_back(nodeIndex);
+
+		while (!stack.empty())
+		{
+			uint32_t index = stack.back();
+			stack.pop_back();
+
+			BVHNode node = nodes[index];
+			uint32_t leftCount = 0;
+			if (!SplitNode(node, leftCount, false))
+				continue;
+
+			uint32_t left = static_cast<uint32_t>(nodes.size());
+
+			BVHNode leftNode = {};
+			leftNode.leftFirst = node.leftFirst;
+			leftNode.count = leftCount;
+			UpdateNodeBounds(leftNode, false);
+
+			BVHNode rightNode = {};
+			rightNode.leftFirst = node.leftFirst + leftCount;
+			rightNode.count = node.count - leftCount;
+			UpdateNodeBounds(rightNode, false);
+
+			nodes.push_back(leftNode);
+			nodes.push_back(rightNode);
+
+			nodes[index].leftFirst = left;
+			nodes[index].count = 0;
+
+			// right first so the left subtree is laid out right after its parent pair
+			stack.push_back(left + 1);
+			stack.push_back(left);
+		}
+	}
+
+	BVH::Split BVH::FindBestSplit(const BVHNode& node, bool parallel) const
+	{
+		const uint32_t* prims = &m_primIndices[node.leftFirst];
+		const uint32_t binCount = m_desc.binCount;
+		const uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(node.count, s_grainSize) : 1;
+
+		std::vector<Bounds3> chunkBounds(chunkCount);
+		auto centroidBounds = [&](uint32_t chunk, uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; i++)
+			{
+				const float* c = &m_primCentroids[static_cast<size_t>(prims[i]) * 3];
+				chunkBounds[chunk].Grow(c, c);
+			}
+		};
+
+		if (parallel)
+			JobSystem::ParallelForChunks(node.count, chunkCount, centroidBounds);
+		else
+			centroidBounds(0, 0, node.count);
+
+		Bounds3 cb;
+		for (const Bounds3& b : chunkBounds)
+			cb.Grow(b);
+
+		float scale[3];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			float extent = cb.max[axis] - cb.min[axis];
+			scale[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+		}
+
+		std::vector<BinSet> chunkBins(chunkCount);
+		auto binPrimitives = [&](uint32_t chunk, uint32_t first, uint32_t last)
+		{
+			BinSet& set = chunkBins[chunk];
+			for (uint32_t i = first; i < last; i++)
+			{
+				size_t prim = prims[i];
+				const float* c = &m_primCentroids[prim * 3];
+				const float* b = &m_primBounds[prim * 6];
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					if (scale[axis] == 0.0f)
+						continue;
+
+					Bin& bin = set.bins[axis][BinIndex(c[axis], cb.min[axis], scale[axis], binCount)];
+					bin.count++;
+					bin.bounds.Grow(b, b + 3);
+				}
+			}
+		};
+
+		if (parallel)
+			JobSystem::ParallelForChunks(node.count, chunkCount, binPrimitives);
+		else
+			binPrimitives(0, 0, node.count);
+
+		BinSet& bins = chunkBins[0];
+		for (uint32_t chunk = 1; chunk < chunkCount; chunk++)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				for (uint32_t b = 0; b < binCount; b++)
+				{
+					bins.bins[axis][b].count += chunkBins[chunk].bins[axis][b].count;
+					bins.bins[axis][b].bounds.Grow(chunkBins[chunk].bins[axis][b].bounds);
+				}
+			}
+		}
+
+		const float nodeArea = NodeArea(node);
+
+		Split best;
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			if (scale[axis] == 0.0f)
+				continue;
+
+			const Bin* axisBins = bins.bins[axis];
+
+			// sweep from both sides, plane i separates bins [0, i] from [i + 1, binCount)
+			float leftArea[s_maxBins - 1];
+			uint32_t leftCount[s_maxBins - 1];
+			Bounds3 leftBox;
+			uint32_t leftSum = 0;
+			for (uint32_t i = 0; i < binCount - 1; i++)
+			{
+				leftSum += axisBins[i].count;
+				leftBox.Grow(axisBins[i].bounds);
+				leftCount[i] = leftSum;
+				leftArea[i] = leftBox.Area();
+			}
+
+			Bounds3 rightBox;
+			uint32_t rightSum = 0;
+			for (uint32_t i = binCount - 1; i > 0; i--)
+			{
+				rightSum += axisBins[i].count;
+				rightBox.Grow(axisBins[i].bounds);
+
+				uint32_t plane = i - 1;
+				if (leftCount[plane] == 0 || rightSum == 0)
+					continue;
+
+				float cost = m_desc.traversalCost + m_desc.intersectionCost *
+					(leftCount[plane] * leftArea[plane] + rightSum * rightBox.Area()) / nodeArea;
+
+				if (cost < best.cost)
+				{
+					best.axis = axis;
+					best.bin = plane + 1;
+					best.cost = cost;
+					best.centroidMin = cb.min[axis];
+					best.binScale = scale[axis];
+				}
+			}
+		}
+
+		return best;
+	}
+
+	uint32_t BVH::Partition(const BVHNode& node, const Split& split, bool parallel)
+	{
+		const uint32_t binCount = m_desc.binCount;
+		auto isLeft = [&](uint32_t prim)
+		{
+			return BinIndex(m_primCentroids[static_cast<size_t>(prim) * 3 + split.axis], split.centroidMin, split.binScale, binCount) < split.bin;
+		};
+
+		if (!parallel)
+		{
+			auto first = m_primIndices.begin() + node.leftFirst;
+			auto mid = std::partition(first, first + node.count, isLeft);
+			return static_cast<uint32_t>(mid - m_primIndices.begin());
+		}
+
+		// count, prefix sum and scatter into the scratch buffer, then copy back
+		uint32_t* prims = &m_primIndices[node.leftFirst];
+		uint32_t* scratch = &m_scratch[node.leftFirst];
+		uint32_t chunkCount = JobSystem::ComputeChunkCount(node.count, s_grainSize);
+
+		std::vector<uint32_t> leftCounts(chunkCount);
+		JobSystem::ParallelForChunks(node.count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				uint32_t count = 0;
+				for (uint32_t i = first; i < last; i++)
+					count += isLeft(prims[i]) ? 1 : 0;
+
+				leftCounts[chunk] = count;
+			});
+
+		uint32_t totalLeft = 0;
+		for (uint32_t c : leftCounts)
+			totalLeft += c;
+
+		JobSystem::ParallelForChunks(node.count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				uint32_t leftOffset = 0;
+				for (uint32_t c = 0; c < chunk; c++)
+					leftOffset += leftCounts[c];
+
+				// elements before this chunk that went right
+				uint32_t rightOffset = totalLeft + (first - leftOffset);
+				for (uint32_t i = first; i < last; i++)
+				{
+					if (isLeft(prims[i]))
+						scratch[leftOffset++] = prims[i];
+					else
+						scratch[rightOffset++] = prims[i];
+				}
+			});
+
+		JobSystem::ParallelFor(0, node.count, s_grainSize * 4, [&](uint32_t first, uint32_t last)
+			{
+				std::copy(scratch + first, scratch + last, prims + first);
+			});
+
+		return node.leftFirst + totalLeft;
+	}
+
+	void BVH::UpdateNodeBounds(BVHNode& node, bool parallel) const
+	{
+		const uint32_t* prims = &m_primIndices[node.leftFirst];
+		uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(node.count, s_grainSize) : 1;
+
+		std::vector<Bounds3> chunkBounds(chunkCount);
+		auto grow = [&](uint32_t chunk, uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; i++)
+			{
+				const float* b = &m_primBounds[static_cast<size_t>(prims[i]) * 6];
+				chunkBounds[chunk].Grow(b, b + 3);
+			}
+		};
+
+		if (parallel)
+			JobSystem::ParallelForChunks(node.count, chunkCount, grow);
+		else
+			grow(0, 0, node.count);
+
+		Bounds3 bounds;
+		for (const Bounds3& b : chunkBounds)
+			bounds.Grow(b);
+
+		for (int i = 0; i < 3; i++)
+		{
+			node.min[i] = bounds.min[i];
+			node.max[i] = bounds.max[i];
+		}
+	}
+
+	void BVH::UpdateStats(double buildTimeMs)
+	{
+		m_stats.buildTimeMs = buildTimeMs;
+		m_stats.sahCost = ComputeSAHCost();
+		m_stats.depth = ComputeDepth();
+		m_stats.nodeCount = static_cast<uint32_t>(m_nodes.size());
+		m_stats.leafCount = static_cast<uint32_t>(std::count_if(m_nodes.begin(), m_nodes.end(), [](const BVHNode& n) { return n.IsLeaf(); }));
+		m_stats.primitiveCount = static_cast<uint32_t>(m_primIndices.size());
+	}
+
+	void BVH::ComputePrimitiveData(const TriangleMeshView& mesh, const uint32_t* triangles, uint32_t count)
+	{
+		auto compute = [&](uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; i++)
+			{
+				uint32_t t = triangles[i];
+				const float* p0 = mesh.GetTrianglePosition(t, 0);
+				const float* p1 = mesh.GetTrianglePosition(t, 1);
+				const float* p2 = mesh.GetTrianglePosition(t, 2);
+
+				float* b = &m_primBounds[static_cast<size_t>(t) * 6];
+				float* c = &m_primCentroids[static_cast<size_t>(t) * 3];
+				for (int a = 0; a < 3; a++)
+				{
+					b[a] = std::min(p0[a], std::min(p1[a], p2[a]));
+					b[a + 3] = std::max(p0[a], std::max(p1[a], p2[a]));
+					c[a] = 0.5f * (b[a] + b[a + 3]);
+				}
+			}
+		};
+
+		if (m_desc.multithreaded)
+			JobSystem::ParallelFor(0, count, s_grainSize, compute);
+		else
+			compute(0, count);
+	}
+
+	void BVH::Compact(const std::vector<BVHNode>& source, const std::vector<int32_t>& substitute,
+		const std::deque<std::vector<BVHNode>>& subtrees, bool renumberPrimitives, std::vector<uint32_t>* origin)
+	{
+		size_t nodeCount = source.size();
+		for (const std::vector<BVHNode>& subtree : subtrees)
+			nodeCount += subtree.size() - 1;
+
+		std::vector<BVHNode> nodes;
+		nodes.reserve(nodeCount);
+		nodes.resize(1);
+
+		std::vector<uint32_t> prims;
+		uint32_t primCursor = 0;
+		if (renumberPrimitives)
+			prims.resize(m_primIndices.size());
+
+		if (origin)
+			origin->assign(1, 0);
+
+		struct Entry
+		{
+			const std::vector<BVHNode>* source;
+			uint32_t sourceIndex;
+			uint32_t destIndex;
+			bool isTop;
+		};
+
+		std::vector<Entry> entries;
+		entries.push_back({ &source, 0, 0, true });
+		while (!entries.empty())
+		{
+			Entry e = entries.back();
+			entries.pop_back();
+
+			if (origin)
+				(*origin)[e.destIndex] = e.isTop ? e.sourceIndex : UINT32_MAX;
+
+			if (e.isTop && e.sourceIndex < substitute.size() && substitute[e.sourceIndex] >= 0)
+			{
+				e.source = &subtrees[substitute[e.sourceIndex]];
+				e.sourceIndex = 0;
+				e.isTop = false;
+			}
+
+			const BVHNode& node = (*e.source)[e.sourceIndex];
+			nodes[e.destIndex] = node;
+
+			if (node.IsLeaf())
+			{
+				if (renumberPrimitives)
+				{
+					std::copy(m_primIndices.begin() + node.leftFirst, m_primIndices.begin() + node.leftFirst + node.count, prims.begin() + primCursor);
+					nodes[e.destIndex].leftFirst = primCursor;
+					primCursor += node.count;
+				}
+
+				continue;
+			}
+
+			uint32_t left = static_cast<uint32_t>(nodes.size());
+			nodes.resize(nodes.size() + 2);
+			nodes[e.destIndex].leftFirst = left;
+
+			if (origin)
+				origin->resize(nodes.size());
+
+			entries.push_back({ e.source, node.leftFirst + 1, left + 1, e.isTop });
+			entries.push_back({ e.source, node.leftFirst, left, e.isTop });
+		}
+
+		m_nodes.swap(nodes);
+		if (renumberPrimitives)
+			m_primIndices.swap(prims);
+
+		m_parents.clear();
+		m_primLeaves.clear();
+	}
+
+	void BVH::RefitNodes(const TriangleMeshView& mesh, const Matrix* transform)
+	{
+		auto refitSubtree = [&](uint32_t root)
+		{
+			std::vector<std::pair<uint32_t, bool>> stack;
+			stack.emplace_back(root, false);
+			while (!stack.empty())
+			{
+				auto [index, childrenDone] = stack.back();
+				stack.pop_back();
+
+				BVHNode& node = m_nodes[index];
+				if (node.IsLeaf())
+				{
+					LeafBounds(node, mesh, transform);
+				}
+				else if (childrenDone)
+				{
+					CombineChildren(m_nodes, index);
+				}
+				else
+				{
+					stack.emplace_back(index, true);
+					stack.emplace_back(node.leftFirst + 1, false);
+					stack.emplace_back(node.leftFirst, false);
+				}
+			}
+		};
+
+		uint32_t threadCount = JobSystem::GetThreadCount();
+		if (!m_desc.multithreaded || threadCount == 1 || m_primIndices.size() < m_desc.parallelThreshold)
+		{
+			refitSubtree(0);
+			return;
+		}
+
+		// split the top of the tree into independent subtrees, refit those in parallel and combine the top afterwards
+		std::vector<uint32_t> top;
+		std::vector<uint32_t> frontier;
+		frontier.push_back(0);
+		while (frontier.size() < threadCount * 4)
+		{
+			std::vector<uint32_t> next;
+			for (uint32_t index : frontier)
+			{
+				const BVHNode& node = m_nodes[index];
+				if (node.IsLeaf())
+				{
+					next.push_back(index);
+					continue;
+				}
+
+				top.push_back(index);
+				next.push_back(node.leftFirst);
+				next.push_back(node.leftFirst + 1);
+			}
+
+			if (next.size() == frontier.size())
+				break;
+
+			frontier.swap(next);
+		}
+
+		JobSystem::ParallelFor(0, static_cast<uint32_t>(frontier.size()), 1, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+					refitSubtree(frontier[i]);
+			});
+
+		for (size_t i = top.size(); i-- > 0;)
+			CombineChildren(m_nodes, top[i]);
+	}
+
+	void BVH::LeafBounds(BVHNode& node, const TriangleMeshView& mesh, const Matrix* transform) const
+	{
+		Bounds3 bounds;
+		for (uint32_t i = 0; i < node.count; i++)
+		{
+			uint32_t t = m_primIndices[node.leftFirst + i];
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				const float* p = mesh.GetTrianglePosition(t, corner);
+				if (!transform)
+				{
+					bounds.Grow(p, p);
+					continue;
+				}
+
+				// row vector * matrix with w = 1
+				const Matrix& m = *transform;
+				float q[3];
+				for (int a = 0; a < 3; a++)
+					q[a] = p[0] * m.f[0][a] + p[1] * m.f[1][a] + p[2] * m.f[2][a] + m.f[3][a];
+
+				bounds.Grow(q, q);
+			}
+		}
+
+		for (int a = 0; a < 3; a++)
+		{
+			node.min[a] = bounds.min[a];
+			node.max[a] = bounds.max[a];
+		}
+	}
+
+	void BVH::EnsureLinks()
+	{
+		if (m_parents.size() == m_nodes.size())
+			return;
+
+		m_parents.assign(m_nodes.size(), UINT32_MAX);
+		m_primLeaves.assign(m_primIndices.size(), UINT32_MAX);
+		m_marks.assign(m_nodes.size(), 0);
+
+		for (uint32_t i = 0; i < m_nodes.size(); i++)
+		{
+			const BVHNode& node = m_nodes[i];
+			if (node.IsLeaf())
+			{
+				for (uint32_t p = 0; p < node.count; p++)
+					m_primLeaves[m_primIndices[node.leftFirst + p]] = i;
+			}
+			else
+			{
+				m_parents[node.leftFirst] = i;
+				m_parents[node.leftFirst + 1] = i;
+			}
+		}
+	}
+
+	uint32_t BVH::Rotate()
+	{
+		// post-order over node positions. A rotation swaps whole subtrees between positions below the
+		// rotated node, so positions that are still to be visited stay valid
+		std::vector<uint32_t> order;
+		order.reserve(m_nodes.size());
+		std::vector<std::pair<uint32_t, bool>> stack;
+		stack.emplace_back(0, false);
+		while (!stack.empty())
+		{
+			auto [index, childrenDone] = stack.back();
+			stack.pop_back();
+
+			const BVHNode& node = m_nodes[index];
+			if (node.IsLeaf() || childrenDone)
+			{
+				order.push_back(index);
+				continue;
+			}
+
+			stack.emplace_back(index, true);
+			stack.emplace_back(node.leftFirst + 1, false);
+			stack.emplace_back(node.leftFirst, false);
+		}
+
+		uint32_t rotations = 0;
+		for (uint32_t index : order)
+		{
+			const BVHNode& node = m_nodes[index];
+			if (node.IsLeaf())
+				continue;
+
+			// swapping child c with a grandchild g under the sibling s only changes the area of s,
+			// which becomes union(c, other grandchild)
+			float bestGain = 0.0f;
+			uint32_t bestChild = 0;
+			uint32_t bestGrandchild = 0;
+			for (uint32_t c = 0; c < 2; c++)
+			{
+				uint32_t child = node.leftFirst + c;
+				uint32_t sibling = node.leftFirst + (1 - c);
+				const BVHNode& s = m_nodes[sibling];
+				if (s.IsLeaf())
+					continue;
+
+				for (uint32_t g = 0; g < 2; g++)
+				{
+					uint32_t grandchild = s.leftFirst + g;
+					uint32_t other = s.leftFirst + (1 - g);
+					float gain = NodeArea(s) - UnionArea(m_nodes[child], m_nodes[other]);
+					if (gain > bestGain)
+					{
+						bestGain = gain;
+						bestChild = child;
+						bestGrandchild = grandchild;
+					}
+				}
+			}
+
+			if (bestGain <= 0.0f)
+				continue;
+
+			uint32_t sibling = bestChild == node.leftFirst ? node.leftFirst + 1 : node.leftFirst;
+			std::swap(m_nodes[bestChild], m_nodes[bestGrandchild]);
+			std::swap(m_subtreeBaselines[bestChild], m_subtreeBaselines[bestGrandchild]);
+			CombineChildren(m_nodes, sibling);
+			rotations++;
+		}
+
+		return rotations;
+	}
+
+	uint32_t BVH::RebuildDegradedSubtrees(const TriangleMeshView& mesh)
+	{
+		std::vector<uint32_t> primCounts;
+		std::vector<float> costs;
+		ComputeSubtreeCosts(primCounts, costs);
+
+		// rotations above the rebuild roots can move them around, keep baselines only on current roots
+		std::vector<uint32_t> roots = FindRebuildRoots(primCounts);
+		std::vector<float> baselines(m_nodes.size(), -1.0f);
+		std::vector<uint32_t> degraded;
+		for (uint32_t root : roots)
+		{
+			float area = NodeArea(m_nodes[root]);
+			float cost = area > 0.0f ? costs[root] / area : 0.0f;
+			float baseline = m_subtreeBaselines[root];
+			baselines[root] = baseline > 0.0f ? baseline : cost;
+
+			if (baseline > 0.0f && cost > baseline * m_desc.rebuildThreshold)
+				degraded.push_back(root);
+		}
+
+		m_subtreeBaselines.swap(baselines);
+		if (degraded.empty())
+			return 0;
+
+		m_primBounds.resize(static_cast<size_t>(m_primIndices.size()) * 6);
+		m_primCentroids.resize(static_cast<size_t>(m_primIndices.size()) * 3);
+
+		// primitives of a subtree are contiguous after Compact, starting at its leftmost leaf
+		std::deque<std::vector<BVHNode>> subtrees(degraded.size());
+		std::vector<int32_t> substitute(m_nodes.size(), -1);
+		TaskGroup group;
+		for (uint32_t i = 0; i < degraded.size(); i++)
+		{
+			uint32_t root = degraded[i];
+			uint32_t leftmost = root;
+			while (!m_nodes[leftmost].IsLeaf())
+				leftmost = m_nodes[leftmost].leftFirst;
+
+			BVHNode node = {};
+			node.leftFirst = m_nodes[leftmost].leftFirst;
+			node.count = primCounts[root];
+			substitute[root] = static_cast<int32_t>(i);
+
+			std::vector<BVHNode>& subtree = subtrees[i];
+			auto rebuild = [this, &mesh, &subtree, node]()
+			{
+				BVHNode r = node;
+				ComputePrimitiveData(mesh, &m_primIndices[r.leftFirst], r.count);
+				UpdateNodeBounds(r, false);
+				subtree.push_back(r);
+				Subdivide(subtree, 0);
+			};
+
+			if (m_desc.multithreaded)
+				group.Run(rebuild);
+			else
+				rebuild();
+		}
+
+		group.Wait();
+
+		std::vector<uint32_t> origin;
+		Compact(m_nodes, substitute, subtrees, false, &origin);
+
+		std::vector<float> oldBaselines;
+		oldBaselines.swap(m_subtreeBaselines);
+		m_subtreeBaselines.assign(m_nodes.size(), -1.0f);
+		for (size_t i = 0; i < origin.size(); i++)
+		{
+			if (origin[i] != UINT32_MAX)
+				m_subtreeBaselines[i] = oldBaselines[origin[i]];
+		}
+
+		// fresh baselines for the rebuilt roots
+		ComputeSubtreeCosts(primCounts, costs);
+		for (size_t i = 0; i < origin.size(); i++)
+		{
+			if (origin[i] != UINT32_MAX && substitute[origin[i]] >= 0)
+			{
+				float area = NodeArea(m_nodes[i]);
+				m_subtreeBaselines[i] = area > 0.0f ? costs[i] / area : 0.0f;
+			}
+		}
+
+		std::vector<float>().swap(m_primBounds);
+		std::vector<float>().swap(m_primCentroids);
+
+		return static_cast<uint32_t>(degraded.size());
+	}
+
+	void BVH::ComputeSubtreeCosts(std::vector<uint32_t>& primCounts, std::vector<float>& costs) const
+	{
+		primCounts.resize(m_nodes.size());
+		costs.resize(m_nodes.size());
+
+		// children are always stored after their parent
+		for (size_t i = m_nodes.size(); i-- > 0;)
+		{
+			const BVHNode& node = m_nodes[i];
+			float area = NodeArea(node);
+			if (node.IsLeaf())
+			{
+				primCounts[i] = node.count;
+				costs[i] = area * node.count * m_desc.intersectionCost;
+			}
+			else
+			{
+				primCounts[i] = primCounts[node.leftFirst] + primCounts[node.leftFirst + 1];
+				costs[i] = area * m_desc.traversalCost + costs[node.leftFirst] + costs[node.leftFirst + 1];
+			}
+		}
+	}
+
+	std::vector<uint32_t> BVH::FindRebuildRoots(const std::vector<uint32_t>& primCounts) const
+	{
+		// largest subtrees with at most partialRebuildSize primitives
+		std::vector<uint32_t> roots;
+		if (primCounts[0] <= m_desc.partialRebuildSize)
+		{
+			roots.push_back(0);
+			return roots;
+		}
+
+		for (uint32_t i = 0; i < m_nodes.size(); i++)
+		{
+			const BVHNode& node = m_nodes[i];
+			if (node.IsLeaf() || primCounts[i] <= m_desc.partialRebuildSize)
+				continue;
+
+			for (uint32_t c = 0; c < 2; c++)
+			{
+				if (primCounts[node.leftFirst + c] <= m_desc.partialRebuildSize)
+					roots.push_back(node.leftFirst + c);
+			}
+		}
+
+		return roots;
+	}
+
+	void BVH::ResetSubtreeBaselines()
+	{
+		std::vector<uint32_t> primCounts;
+		std::vector<float> costs;
+		ComputeSubtreeCosts(primCounts, costs);
+
+		m_subtreeBaselines.assign(m_nodes.size(), -1.0f);
+		for (uint32_t root : FindRebuildRoots(primCounts))
+		{
+			float area = NodeArea(m_nodes[root]);
+			m_subtreeBaselines[root] = area > 0.0f ? costs[root] / area : 0.0f;
+		}
+	}
+
+	void BVH::UpdateRefitStats(double timeMs)
+	{
+		float rootArea = m_nodes.empty() ? 0.0f : NodeArea(m_nodes[0]);
+
+		m_refitStats.timeMs = timeMs;
+		m_refitStats.sahCost = rootArea > 0.0f ? m_sahSum / rootArea : m_buildSAHCost;
+		m_refitStats.sahRatio = m_buildSAHCost > 0.0f ? m_refitStats.sahCost / m_buildSAHCost : 1.0f;
+		m_refitStats.rebuildRecommended = m_refitStats.sahRatio > m_desc.rebuildThreshold;
+	}
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "TriangleMesh.h"
+#include "Math/Types.h"
+
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	/// <summary>
+	/// 32 byte bvh node. Children of an inner node are allocated as a sibling pair
+	/// (leftFirst, leftFirst + 1) and pairs are laid out in depth-first order.
+	/// </summary>
+	struct BVHNode
+	{
+		float min[3];
+		uint32_t leftFirst; // inner: index of the left child. leaf: first index into BVH::GetPrimitiveIndices()
+		float max[3];
+		uint32_t count;     // 0 for inner nodes, primitive count for leaves
+
+		bool IsLeaf() const { return count > 0; }
+	};
+
+	static_assert(sizeof(BVHNode) == 32, "BVHNode must stay 32 bytes");
+
+	enum class BVHBuildMode
+	{
+		BinnedSAH, // best tree quality
+		LBVH       // morton code sort, several times faster to build, meant for dynamic geometry
+	};
+
+	struct BVHDesc
+	{
+		BVHBuildMode buildMode = BVHBuildMode::BinnedSAH;
+		uint32_t maxLeafSize = 4;      // a node with more primitives than this is always split
+		uint32_t binCount = 16;        // [2, 64]
+		float traversalCost = 1.0f;    // SAH cost of visiting an inner node
+		float intersectionCost = 1.0f; // SAH cost of one ray/triangle test
+
+		bool multithreaded = true;
+		// nodes with at least this many primitives are binned and partitioned with JobSystem::ParallelFor,
+		// smaller nodes are built as independent subtree tasks
+		uint32_t parallelThreshold = 16384;
+
+		// Optimize() rebuilds subtrees of at most this many primitives whose SAH cost grew past rebuildThreshold
+		uint32_t partialRebuildSize = 4096;
+		// sah cost / sah cost at build time above which a subtree is rebuilt or a full rebuild is recommended
+		float rebuildThreshold = 1.5f;
+	};
+
+	struct BVHStats
+	{
+		double buildTimeMs = 0.0;
+		float sahCost = 0.0f;
+		uint32_t depth = 0;
+		uint32_t nodeCount = 0;
+		uint32_t leafCount = 0;
+		uint32_t primitiveCount = 0;
+	};
+
+	struct BVHRefitStats
+	{
+		double timeMs = 0.0;
+		uint32_t refittedNodes = 0;
+		uint32_t rotations = 0;
+		uint32_t rebuiltSubtrees = 0;
+		float sahCost = 0.0f;
+		float sahRatio = 1.0f;            // sahCost / sah cost right after Build()
+		bool rebuildRecommended = false; // sahRatio > BVHDesc::rebuildThreshold
+	};
+
+	/// <summary>
+	/// Binned surface area heuristic bvh over a triangle soup.
+	/// The bvh does not own the mesh, it only stores the triangle ids referenced by the leaves,
+	/// so queries take the same TriangleMeshView that was used to build it.
+	/// </summary>
+	class BVH
+	{
+	public:
+		BVH();
+		BVH(const BVHDesc& desc);
+
+		void Build(const TriangleMeshView& mesh);
+		void Clear();
+
+		/// <summary>
+		/// Recomputes every node bounds bottom-up from the updated vertex positions, the topology is kept.
+		/// The mesh must have the same triangles that were used to build the bvh.
+		/// </summary>
+		void Refit(const TriangleMeshView& mesh);
+
+		// same as Refit(mesh) with the vertices transformed by the row-major transform (row vector * matrix)
+		void Refit(const TriangleMeshView& mesh, const Matrix& transform);
+
+		/// <summary>
+		/// Only refits the leaves holding the changed triangles and their ancestors.
+		/// Cost is linear in the number of touched nodes.
+		/// </summary>
+		void Refit(const TriangleMeshView& mesh, const uint32_t* changedTriangles, uint32_t changedCount);
+
+		/// <summary>
+		/// Restores tree quality after refits: tree rotations over every inner node, then a rebuild of the
+		/// subtrees (of at most partialRebuildSize primitives) whose SAH cost grew past rebuildThreshold.
+		/// </summary>
+		void Optimize(const TriangleMeshView& mesh);
+
+		void SetDesc(const BVHDesc& desc);
+		const BVHDesc& GetDesc() const;
+		const BVHStats& GetStats() const;
+		const BVHRefitStats& GetRefitStats() const;
+
+		const std::vector<BVHNode>& GetNodes() const;
+		const std::vector<uint32_t>& GetPrimitiveIndices() const;
+		AABB GetBounds() const;
+		bool IsEmpty() const;
+
+		/// <summary>
+		/// Sum over the nodes of (area(node) / area(root)) * cost, where cost is traversalCost
+		/// for inner nodes and count * intersectionCost for leaves
+		/// </summary>
+		float ComputeSAHCost() const;
+		uint32_t ComputeDepth() const;
+
+	private:
+		struct Split
+		{
+			uint32_t axis = 0;
+			uint32_t bin = 0;
+			float cost = 3.402823466e+38f;
+			float centroidMin = 0.0f;
+			float binScale = 0.0f;
+		};
+
+		void BuildBinnedSAH();
+		void BuildLBVH();
+
+		// splits the node, returns false if it stays a leaf. Large nodes use the job system.
+		bool SplitNode(const BVHNode& node, uint32_t& leftCount, bool parallel);
+		void Subdivide(std::vector<BVHNode>& nodes, uint32_t nodeIndex);
+		Split FindBestSplit(const BVHNode& node, bool parallel) const;
+		uint32_t Partition(const BVHNode& node, const Split& split, bool parallel);
+		void UpdateNodeBounds(BVHNode& node, bool parallel) const;
+		void UpdateStats(double buildTimeMs);
+
+		void ComputePrimitiveData(const TriangleMeshView& mesh, const uint32_t* triangles, uint32_t count);
+
+		/// <summary>
+		/// Lays source out into m_nodes in depth-first pair order. A source node with substitute[i] >= 0
+		/// is replaced by the root of subtrees[substitute[i]]. origin receives the source index of every
+		/// output node (UINT32_MAX for nodes that came from a subtree).
+		/// </summary>
+		void Compact(const std::vector<BVHNode>& source, const std::vector<int32_t>& substitute,
+			const std::deque<std::vector<BVHNode>>& subtrees, bool renumberPrimitives, std::vector<uint32_t>* origin);
+
+		void RefitNodes(const TriangleMeshView& mesh, const Matrix* transform);
+		void LeafBounds(BVHNode& node, const TriangleMeshView& mesh, const Matrix* transform) const;
+		void EnsureLinks();
+		uint32_t Rotate();
+		uint32_t RebuildDegradedSubtrees(const TriangleMeshView& mesh);
+		void ComputeSubtreeCosts(std::vector<uint32_t>& primCounts, std::vector<float>& costs) const;
+		std::vector<uint32_t> FindRebuildRoots(const std::vector<uint32_t>& primCounts) const;
+		void ResetSubtreeBaselines();
+		void UpdateRefitStats(double timeMs);
+
+		BVHDesc m_desc;
+		BVHStats m_stats;
+		BVHRefitStats m_refitStats;
+
+		std::vector<BVHNode> m_nodes;
+		std::vector<uint32_t> m_primIndices;
+
+		// refit data. Links are built on the first partial refit and dropped whenever the layout changes
+		std::vector<uint32_t> m_parents;
+		std::vector<uint32_t> m_primLeaves;
+		std::vector<float> m_subtreeBaselines; // cost / area of partial rebuild roots when built, -1 for other nodes
+		std::vector<uint32_t> m_dirty;
+		std::vector<uint8_t> m_marks;
+		float m_sahSum = 0.0f; // un-normalized sah cost, kept up to date by the partial refit
+		float m_buildSAHCost = 0.0f;
+
+		// per triangle build data, released after the build
+		std::vector<float> m_primBounds;    // min xyz, max xyz
+		std::vector<float> m_primCentroids; // xyz
+		std::vector<uint32_t> m_scratch;
+	};
+}
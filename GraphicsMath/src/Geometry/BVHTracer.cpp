@@ -0,0 +1,715 @@
+#include "BVHTracer.h"
+#include "Core/JobSystem.h"
+#include "Math/SIMD.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <type_traits>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_stackSize = 128;
+		constexpr uint32_t s_streamChunkSize = 4096;
+		constexpr float s_detEpsilon = 1e-20f;
+
+		struct StackEntry
+		{
+			uint32_t node;
+			float t;
+		};
+
+		struct PacketStackEntry
+		{
+			uint32_t node;
+			uint32_t mask;
+		};
+
+		struct StreamEntry
+		{
+			uint32_t node;
+			uint32_t offset;
+			uint32_t count;
+		};
+
+		struct StreamRay
+		{
+			float origin[3];
+			float tMin;
+			float direction[3];
+			float tMax;
+			float invDirection[3];
+		};
+
+		// clamps tiny components so the slab test never computes 0 * inf
+		float SafeInverse(float d)
+		{
+			if (fabsf(d) < 1e-20f)
+				d = d < 0.0f ? -1e-20f : 1e-20f;
+
+			return 1.0f / d;
+		}
+
+		// entry distance of the ray into the node, FLT_MAX on a miss
+		float SlabTest(const BVHNode& node, const float* origin, const float* invDirection, float tMin, float tMax)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				float t0 = (node.min[a] - origin[a]) * invDirection[a];
+				float t1 = (node.max[a] - origin[a]) * invDirection[a];
+				tMin = std::max(tMin, std::min(t0, t1));
+				tMax = std::min(tMax, std::max(t0, t1));
+			}
+
+			return tMin <= tMax ? tMin : FLT_MAX;
+		}
+
+		// lane mask of the rays that hit the node
+		template<typename SIMDFloat>
+		int SlabTest(const BVHNode& node, SIMDFloat ox, SIMDFloat oy, SIMDFloat oz, SIMDFloat ix, SIMDFloat iy, SIMDFloat iz, SIMDFloat tMin, SIMDFloat tMax)
+		{
+			SIMDFloat t0x = (SIMDFloat(node.min[0]) - ox) * ix;
+			SIMDFloat t1x = (SIMDFloat(node.max[0]) - ox) * ix;
+			SIMDFloat t0y = (SIMDFloat(node.min[1]) - oy) * iy;
+			SIMDFloat t1y = (SIMDFloat(node.max[1]) - oy) * iy;
+			SIMDFloat t0z = (SIMDFloat(node.min[2]) - oz) * iz;
+			SIMDFloat t1z = (SIMDFloat(node.max[2]) - oz) * iz;
+
+			SIMDFloat tNear = Max(Max(Min(t0x, t1x), Min(t0y, t1y)), Max(Min(t0z, t1z), tMin));
+			SIMDFloat tFar = Min(Min(Max(t0x, t1x), Max(t0y, t1y)), Min(Max(t0z, t1z), tMax));
+			return MoveMask(tNear <= tFar);
+		}
+
+		// [lo, hi] = [a0, a1] * [b0, b1]
+		void IntervalMultiply(float a0, float a1, float b0, float b1, float& lo, float& hi)
+		{
+			float p0 = a0 * b0;
+			float p1 = a0 * b1;
+			float p2 = a1 * b0;
+			float p3 = a1 * b1;
+			lo = std::min(std::min(p0, p1), std::min(p2, p3));
+			hi = std::max(std::max(p0, p1), std::max(p2, p3));
+		}
+
+		/// <summary>
+		/// Moller-Trumbore, one ray per lane against one triangle per lane.
+		/// Returns the lane mask of the hits in [tMin, tMax).
+		/// </summary>
+		template<typename SIMDFloat>
+		int IntersectTriangles(SIMDFloat ox, SIMDFloat oy, SIMDFloat oz, SIMDFloat dx, SIMDFloat dy, SIMDFloat dz, SIMDFloat tMin, SIMDFloat tMax,
+			SIMDFloat v0x, SIMDFloat v0y, SIMDFloat v0z, SIMDFloat e1x, SIMDFloat e1y, SIMDFloat e1z, SIMDFloat e2x, SIMDFloat e2y, SIMDFloat e2z,
+			SIMDFloat& t, SIMDFloat& u, SIMDFloat& v)
+		{
+			// p = d x e2
+			SIMDFloat px = dy * e2z - dz * e2y;
+			SIMDFloat py = dz * e2x - dx * e2z;
+			SIMDFloat pz = dx * e2y - dy * e2x;
+			SIMDFloat det = e1x * px + e1y * py + e1z * pz;
+			SIMDFloat invDet = SIMDFloat(1.0f) / det;
+
+			SIMDFloat sx = ox - v0x;
+			SIMDFloat sy = oy - v0y;
+			SIMDFloat sz = oz - v0z;
+			u = (sx * px + sy * py + sz * pz) * invDet;
+
+			// q = s x e1
+			SIMDFloat qx = sy * e1z - sz * e1y;
+			SIMDFloat qy = sz * e1x - sx * e1z;
+			SIMDFloat qz = sx * e1y - sy * e1x;
+			v = (dx * qx + dy * qy + dz * qz) * invDet;
+			t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+			SIMDFloat zero(0.0f);
+			SIMDFloat mask = (Abs(det) > SIMDFloat(s_detEpsilon)) & (u >= zero) & (v >= zero) & (u + v <= SIMDFloat(1.0f)) & (t >= tMin) & (t < tMax);
+			return MoveMask(mask);
+		}
+	}
+
+	BVHTracer::BVHTracer()
+		: m_bvh(nullptr)
+	{
+	}
+
+	BVHTracer::BVHTracer(const BVH& bvh, const TriangleMeshView& mesh)
+		: m_bvh(nullptr)
+	{
+		Set(bvh, mesh);
+	}
+
+	void BVHTracer::Set(const BVH& bvh, const TriangleMeshView& mesh)
+	{
+		m_bvh = &bvh;
+
+		const std::vector<BVHNode>& nodes = bvh.GetNodes();
+		const std::vector<uint32_t>& primIndices = bvh.GetPrimitiveIndices();
+
+		m_leafBlocks.assign(nodes.size(), UINT32_MAX);
+		uint32_t blockCount = 0;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(nodes.size()); i++)
+		{
+			if (!nodes[i].IsLeaf())
+				continue;
+
+			m_leafBlocks[i] = blockCount;
+			blockCount += (nodes[i].count + 7) / 8;
+		}
+
+		m_blocks.resize(blockCount);
+		JobSystem::ParallelFor(0, static_cast<uint32_t>(nodes.size()), 1024, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+				{
+					const BVHNode& node = nodes[i];
+					if (!node.IsLeaf())
+						continue;
+
+					for (uint32_t j = 0; j < (node.count + 7) / 8 * 8; j++)
+					{
+						TriangleBlock& block = m_blocks[m_leafBlocks[i] + j / 8];
+						uint32_t lane = j % 8;
+						if (j >= node.count)
+						{
+							for (int a = 0; a < 3; a++)
+							{
+								block.v0[a][lane] = 0.0f;
+								block.e1[a][lane] = 0.0f;
+								block.e2[a][lane] = 0.0f;
+							}
+							block.triangles[lane] = UINT32_MAX;
+							continue;
+						}
+
+						uint32_t tri = primIndices[node.leftFirst + j];
+						const float* p0 = mesh.GetTrianglePosition(tri, 0);
+						const float* p1 = mesh.GetTrianglePosition(tri, 1);
+						const float* p2 = mesh.GetTrianglePosition(tri, 2);
+						for (int a = 0; a < 3; a++)
+						{
+							block.v0[a][lane] = p0[a];
+							block.e1[a][lane] = p1[a] - p0[a];
+							block.e2[a][lane] = p2[a] - p0[a];
+						}
+						block.triangles[lane] = tri;
+					}
+				}
+			});
+	}
+
+	void BVHTracer::Clear()
+	{
+		m_bvh = nullptr;
+		m_blocks.clear();
+		m_leafBlocks.clear();
+	}
+
+	RayHit BVHTracer::Intersect(const Ray& ray) const
+	{
+		RayHit hit;
+		TraceRay<false>(ray, hit);
+		return hit;
+	}
+
+	bool BVHTracer::Occluded(const Ray& ray) const
+	{
+		RayHit hit;
+		return TraceRay<true>(ray, hit);
+	}
+
+	template<uint32_t N>
+	void BVHTracer::Intersect(const RayPacket<N>& packet, RayHit* hits) const
+	{
+		TracePacket<N, false>(packet, hits);
+	}
+
+	template<uint32_t N>
+	uint32_t BVHTracer::Occluded(const RayPacket<N>& packet) const
+	{
+		return TracePacket<N, true>(packet, nullptr);
+	}
+
+	template void BVHTracer::Intersect<4>(const RayPacket<4>& packet, RayHit* hits) const;
+	template void BVHTracer::Intersect<8>(const RayPacket<8>& packet, RayHit* hits) const;
+	template void BVHTracer::Intersect<16>(const RayPacket<16>& packet, RayHit* hits) const;
+	template uint32_t BVHTracer::Occluded<4>(const RayPacket<4>& packet) const;
+	template uint32_t BVHTracer::Occluded<8>(const RayPacket<8>& packet) const;
+	template uint32_t BVHTracer::Occluded<16>(const RayPacket<16>& packet) const;
+
+	void BVHTracer::IntersectStream(const Ray* rays, uint32_t count, RayHit* hits) const
+	{
+		TraceStream<false>(rays, count, hits, nullptr);
+	}
+
+	void BVHTracer::OccludedStream(const Ray* rays, uint32_t count, bool* occluded) const
+	{
+		TraceStream<true>(rays, count, nullptr, occluded);
+	}
+
+	template<bool AnyHit>
+	bool BVHTracer::IntersectLeaf(uint32_t nodeIndex, uint32_t count, const float* origin, const float* direction, float tMin, RayHit& hit) const
+	{
+		Float8 ox(origin[0]), oy(origin[1]), oz(origin[2]);
+		Float8 dx(direction[0]), dy(direction[1]), dz(direction[2]);
+		Float8 tMin8(tMin);
+
+		bool found = false;
+		uint32_t firstBlock = m_leafBlocks[nodeIndex];
+		uint32_t lastBlock = firstBlock + (count + 7) / 8;
+		for (uint32_t i = firstBlock; i < lastBlock; i++)
+		{
+			const TriangleBlock& b = m_blocks[i];
+
+			Float8 t, u, v;
+			int bits = IntersectTriangles(ox, oy, oz, dx, dy, dz, tMin8, Float8(hit.t),
+				Float8::Load(b.v0[0]), Float8::Load(b.v0[1]), Float8::Load(b.v0[2]),
+				Float8::Load(b.e1[0]), Float8::Load(b.e1[1]), Float8::Load(b.e1[2]),
+				Float8::Load(b.e2[0]), Float8::Load(b.e2[1]), Float8::Load(b.e2[2]), t, u, v);
+
+			if (!bits)
+				continue;
+
+			alignas(32) float tLanes[8], uLanes[8], vLanes[8];
+			t.Store(tLanes);
+			u.Store(uLanes);
+			v.Store(vLanes);
+			for (uint32_t lane = 0; lane < 8; lane++)
+			{
+				if (!(bits & (1 << lane)) || tLanes[lane] >= hit.t)
+					continue;
+
+				hit.t = tLanes[lane];
+				hit.u = uLanes[lane];
+				hit.v = vLanes[lane];
+				hit.triangle = b.triangles[lane];
+				found = true;
+
+				if (AnyHit)
+					return true;
+			}
+		}
+
+		return found;
+	}
+
+	template<bool AnyHit>
+	bool BVHTracer::TraceRay(const Ray& ray, RayHit& hit) const
+	{
+		if (!m_bvh || m_leafBlocks.empty() || ray.tMin > ray.tMax)
+			return false;
+
+		const BVHNode* nodes = m_bvh->GetNodes().data();
+		float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+		float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+		float invDirection[3] = { SafeInverse(direction[0]), SafeInverse(direction[1]), SafeInverse(direction[2]) };
+
+		hit.t = ray.tMax;
+		bool found = false;
+
+		StackEntry stack[s_stackSize];
+		uint32_t stackSize = 0;
+		if (SlabTest(nodes[0], origin, invDirection, ray.tMin, hit.t) != FLT_MAX)
+			stack[stackSize++] = { 0, ray.tMin };
+
+		while (stackSize > 0)
+		{
+			StackEntry entry = stack[--stackSize];
+			if (entry.t > hit.t)
+				continue;
+
+			uint32_t nodeIndex = entry.node;
+			while (true)
+			{
+				const BVHNode& node = nodes[nodeIndex];
+				if (node.IsLeaf())
+				{
+					if (IntersectLeaf<AnyHit>(nodeIndex, node.count, origin, direction, ray.tMin, hit))
+					{
+						found = true;
+						if (AnyHit)
+							return true;
+					}
+					break;
+				}
+
+				uint32_t nearChild = node.leftFirst;
+				uint32_t farChild = node.leftFirst + 1;
+				float tNear = SlabTest(nodes[nearChild], origin, invDirection, ray.tMin, hit.t);
+				float tFar = SlabTest(nodes[farChild], origin, invDirection, ray.tMin, hit.t);
+				if (tFar < tNear)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(tNear, tFar);
+				}
+
+				if (tNear == FLT_MAX)
+					break;
+
+				if (tFar != FLT_MAX)
+				{
+					assert(stackSize < s_stackSize && "bvh is too deep for the traversal stack");
+					stack[stackSize++] = { farChild, tFar };
+				}
+				nodeIndex = nearChild;
+			}
+		}
+
+		if (!found)
+			hit = RayHit();
+
+		return found;
+	}
+
+	template<uint32_t N, bool AnyHit>
+	uint32_t BVHTracer::TracePacket(const RayPacket<N>& packet, RayHit* hits) const
+	{
+		// 16 rays are traced as two 8-wide groups, 4 rays as one 4-wide group
+		using SIMDFloat = std::conditional_t<N >= 8, Float8, Float4>;
+		constexpr uint32_t W = SIMDFloat::Width;
+		constexpr uint32_t G = N / W;
+		constexpr uint32_t groupBits = (1u << W) - 1;
+
+		alignas(32) float invX[N], invY[N], invZ[N];
+		alignas(32) float tMax[N];
+		float hitU[N], hitV[N];
+		uint32_t hitTriangles[N];
+
+		// packet interval for the conservative node test, see IntervalMultiply
+		float originLo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float originHi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		float invLo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float invHi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		float tMinAll = FLT_MAX;
+		float tMaxAll = -FLT_MAX;
+		float direction[3] = { 0.0f, 0.0f, 0.0f };
+
+		uint32_t active = 0;
+		for (uint32_t i = 0; i < N; i++)
+		{
+			invX[i] = SafeInverse(packet.directionX[i]);
+			invY[i] = SafeInverse(packet.directionY[i]);
+			invZ[i] = SafeInverse(packet.directionZ[i]);
+			tMax[i] = packet.tMax[i];
+			hitTriangles[i] = UINT32_MAX;
+
+			if (packet.tMin[i] > packet.tMax[i])
+				continue;
+
+			active |= 1u << i;
+			const float o[3] = { packet.originX[i], packet.originY[i], packet.originZ[i] };
+			const float inv[3] = { invX[i], invY[i], invZ[i] };
+			for (int a = 0; a < 3; a++)
+			{
+				originLo[a] = std::min(originLo[a], o[a]);
+				originHi[a] = std::max(originHi[a], o[a]);
+				invLo[a] = std::min(invLo[a], inv[a]);
+				invHi[a] = std::max(invHi[a], inv[a]);
+			}
+			tMinAll = std::min(tMinAll, packet.tMin[i]);
+			tMaxAll = std::max(tMaxAll, packet.tMax[i]);
+			direction[0] += packet.directionX[i];
+			direction[1] += packet.directionY[i];
+			direction[2] += packet.directionZ[i];
+		}
+
+		uint32_t occluded = 0;
+		if (!m_bvh || m_leafBlocks.empty() || !active)
+		{
+			if (!AnyHit)
+				for (uint32_t i = 0; i < N; i++)
+					hits[i] = RayHit();
+			return 0;
+		}
+
+		const BVHNode* nodes = m_bvh->GetNodes().data();
+
+		PacketStackEntry stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = { 0, active };
+
+		while (stackSize > 0)
+		{
+			PacketStackEntry entry = stack[--stackSize];
+			const BVHNode& node = nodes[entry.node];
+			uint32_t mask = entry.mask & ~occluded;
+			if (!mask)
+				continue;
+
+			uint32_t hitMask = mask;
+
+			// the first active ray hitting the node keeps the whole packet, otherwise the packet is culled
+			// by interval arithmetic or tested ray by ray
+			uint32_t firstRay = 0;
+			while (!(mask & (1u << firstRay)))
+				firstRay++;
+
+			const float firstOrigin[3] = { packet.originX[firstRay], packet.originY[firstRay], packet.originZ[firstRay] };
+			const float firstInvDirection[3] = { invX[firstRay], invY[firstRay], invZ[firstRay] };
+			if (SlabTest(node, firstOrigin, firstInvDirection, packet.tMin[firstRay], tMax[firstRay]) == FLT_MAX)
+			{
+				// a lower bound of every ray's entry distance against an upper bound of every exit distance
+				float nearMax = tMinAll;
+				float farMin = tMaxAll;
+				for (int a = 0; a < 3; a++)
+				{
+					float t0Lo, t0Hi, t1Lo, t1Hi;
+					IntervalMultiply(node.min[a] - originHi[a], node.min[a] - originLo[a], invLo[a], invHi[a], t0Lo, t0Hi);
+					IntervalMultiply(node.max[a] - originHi[a], node.max[a] - originLo[a], invLo[a], invHi[a], t1Lo, t1Hi);
+					nearMax = std::max(nearMax, std::min(t0Lo, t1Lo));
+					farMin = std::min(farMin, std::max(t0Hi, t1Hi));
+				}
+				if (nearMax > farMin)
+					continue;
+
+				// rays that miss the node stay masked out in its subtree
+				hitMask = 0;
+				for (uint32_t g = 0; g < G; g++)
+				{
+					uint32_t groupMask = (mask >> (g * W)) & groupBits;
+					if (!groupMask)
+						continue;
+
+					int bits = SlabTest(node,
+						SIMDFloat::Load(packet.originX + g * W), SIMDFloat::Load(packet.originY + g * W), SIMDFloat::Load(packet.originZ + g * W),
+						SIMDFloat::Load(invX + g * W), SIMDFloat::Load(invY + g * W), SIMDFloat::Load(invZ + g * W),
+						SIMDFloat::Load(packet.tMin + g * W), SIMDFloat::Load(tMax + g * W));
+					hitMask |= (static_cast<uint32_t>(bits) & groupMask) << (g * W);
+				}
+				if (!hitMask)
+					continue;
+			}
+
+			if (!node.IsLeaf())
+			{
+				// visit first the child the packet points to
+				const BVHNode& left = nodes[node.leftFirst];
+				const BVHNode& right = nodes[node.leftFirst + 1];
+				float d = 0.0f;
+				for (int a = 0; a < 3; a++)
+					d += ((right.min[a] + right.max[a]) - (left.min[a] + left.max[a])) * direction[a];
+
+				uint32_t nearChild = d >= 0.0f ? node.leftFirst : node.leftFirst + 1;
+				assert(stackSize + 2 <= s_stackSize && "bvh is too deep for the traversal stack");
+				stack[stackSize++] = { nearChild == node.leftFirst ? node.leftFirst + 1 : node.leftFirst, hitMask };
+				stack[stackSize++] = { nearChild, hitMask };
+				continue;
+			}
+
+			// leaf: every triangle against the active rays, 8 (or 4) rays per test
+			bool found = false;
+			uint32_t firstBlock = m_leafBlocks[entry.node];
+			uint32_t lastBlock = firstBlock + (node.count + 7) / 8;
+			for (uint32_t i = firstBlock; i < lastBlock; i++)
+			{
+				const TriangleBlock& b = m_blocks[i];
+				for (uint32_t lane = 0; lane < 8 && b.triangles[lane] != UINT32_MAX; lane++)
+				{
+					SIMDFloat v0x(b.v0[0][lane]), v0y(b.v0[1][lane]), v0z(b.v0[2][lane]);
+					SIMDFloat e1x(b.e1[0][lane]), e1y(b.e1[1][lane]), e1z(b.e1[2][lane]);
+					SIMDFloat e2x(b.e2[0][lane]), e2y(b.e2[1][lane]), e2z(b.e2[2][lane]);
+
+					for (uint32_t g = 0; g < G; g++)
+					{
+						uint32_t groupMask = (hitMask >> (g * W)) & ~(occluded >> (g * W)) & groupBits;
+						if (!groupMask)
+							continue;
+
+						SIMDFloat t, u, v;
+						uint32_t bits = IntersectTriangles(
+							SIMDFloat::Load(packet.originX + g * W), SIMDFloat::Load(packet.originY + g * W), SIMDFloat::Load(packet.originZ + g * W),
+							SIMDFloat::Load(packet.directionX + g * W), SIMDFloat::Load(packet.directionY + g * W), SIMDFloat::Load(packet.directionZ + g * W),
+							SIMDFloat::Load(packet.tMin + g * W), SIMDFloat::Load(tMax + g * W),
+							v0x, v0y, v0z, e1x, e1y, e1z, e2x, e2y, e2z, t, u, v) & groupMask;
+
+						if (!bits)
+							continue;
+
+						if (AnyHit)
+						{
+							occluded |= bits << (g * W);
+							continue;
+						}
+
+						alignas(32) float tLanes[W], uLanes[W], vLanes[W];
+						t.Store(tLanes);
+						u.Store(uLanes);
+						v.Store(vLanes);
+						for (uint32_t k = 0; k < W; k++)
+						{
+							if (!(bits & (1u << k)))
+								continue;
+
+							uint32_t ray = g * W + k;
+							tMax[ray] = tLanes[k];
+							hitU[ray] = uLanes[k];
+							hitV[ray] = vLanes[k];
+							hitTriangles[ray] = b.triangles[lane];
+						}
+						found = true;
+					}
+				}
+			}
+
+			if (AnyHit && (occluded & active) == active)
+				break;
+
+			if (found)
+			{
+				tMaxAll = -FLT_MAX;
+				for (uint32_t i = 0; i < N; i++)
+					if (active & (1u << i))
+						tMaxAll = std::max(tMaxAll, tMax[i]);
+			}
+		}
+
+		if (!AnyHit)
+		{
+			for (uint32_t i = 0; i < N; i++)
+			{
+				hits[i] = RayHit();
+				if (hitTriangles[i] == UINT32_MAX)
+					continue;
+
+				hits[i].t = tMax[i];
+				hits[i].u = hitU[i];
+				hits[i].v = hitV[i];
+				hits[i].triangle = hitTriangles[i];
+			}
+		}
+
+		return occluded;
+	}
+
+	template<bool AnyHit>
+	void BVHTracer::TraceStream(const Ray* rays, uint32_t count, RayHit* hits, bool* occluded) const
+	{
+		if (!m_bvh || m_leafBlocks.empty())
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (AnyHit)
+					occluded[i] = false;
+				else
+					hits[i] = RayHit();
+			}
+			return;
+		}
+
+		const BVHNode* nodes = m_bvh->GetNodes().data();
+
+		// every chunk is an independent stream
+		JobSystem::ParallelFor(0, count, s_streamChunkSize, [&](uint32_t first, uint32_t last)
+			{
+				uint32_t rayCount = last - first;
+				std::vector<StreamRay> streamRays(rayCount);
+				std::vector<RayHit> streamHits(rayCount);
+
+				// ray ids per node, used as a stack: the rays of a node are appended after the rays of its parent
+				std::vector<uint32_t> ids;
+				ids.reserve(rayCount * 4);
+
+				for (uint32_t i = 0; i < rayCount; i++)
+				{
+					const Ray& ray = rays[first + i];
+					StreamRay& r = streamRays[i];
+					r.origin[0] = ray.origin.x;
+					r.origin[1] = ray.origin.y;
+					r.origin[2] = ray.origin.z;
+					r.direction[0] = ray.direction.x;
+					r.direction[1] = ray.direction.y;
+					r.direction[2] = ray.direction.z;
+					for (int a = 0; a < 3; a++)
+						r.invDirection[a] = SafeInverse(r.direction[a]);
+					r.tMin = ray.tMin;
+					r.tMax = ray.tMax;
+					streamHits[i].t = ray.tMax;
+
+					if (ray.tMin <= ray.tMax)
+						ids.push_back(i);
+				}
+
+				std::vector<StreamEntry> stack;
+				stack.push_back({ 0, 0, static_cast<uint32_t>(ids.size()) });
+				while (!stack.empty())
+				{
+					StreamEntry entry = stack.back();
+					stack.pop_back();
+
+					// drops the rays of the subtree that was finished since this entry was pushed
+					ids.resize(entry.offset + entry.count);
+
+					const BVHNode& node = nodes[entry.node];
+					uint32_t begin = static_cast<uint32_t>(ids.size());
+					for (uint32_t i = 0; i < entry.count; i += 8)
+					{
+						alignas(32) float ox[8], oy[8], oz[8], ix[8], iy[8], iz[8], tMin[8], tMax[8];
+						uint32_t n = std::min(8u, entry.count - i);
+						for (uint32_t k = 0; k < 8; k++)
+						{
+							const StreamRay& r = streamRays[ids[entry.offset + std::min(i + k, entry.count - 1)]];
+							ox[k] = r.origin[0];
+							oy[k] = r.origin[1];
+							oz[k] = r.origin[2];
+							ix[k] = r.invDirection[0];
+							iy[k] = r.invDirection[1];
+							iz[k] = r.invDirection[2];
+							tMin[k] = r.tMin;
+							tMax[k] = r.tMax;
+						}
+
+						int bits = SlabTest(node, Float8::Load(ox), Float8::Load(oy), Float8::Load(oz),
+							Float8::Load(ix), Float8::Load(iy), Float8::Load(iz), Float8::Load(tMin), Float8::Load(tMax));
+
+						for (uint32_t k = 0; k < n; k++)
+						{
+							if (!(bits & (1 << k)))
+								continue;
+
+							uint32_t id = ids[entry.offset + i + k];
+							ids.push_back(id);
+						}
+					}
+
+					uint32_t survivors = static_cast<uint32_t>(ids.size()) - begin;
+					if (!survivors)
+						continue;
+
+					if (node.IsLeaf())
+					{
+						for (uint32_t i = begin; i < begin + survivors; i++)
+						{
+							StreamRay& r = streamRays[ids[i]];
+							RayHit& hit = streamHits[ids[i]];
+							if (!IntersectLeaf<AnyHit>(entry.node, node.count, r.origin, r.direction, r.tMin, hit))
+								continue;
+
+							// an occluded ray fails every later slab test
+							r.tMax = AnyHit ? -FLT_MAX : hit.t;
+						}
+						continue;
+					}
+
+					// children ordered by the direction of the first ray
+					const BVHNode& left = nodes[node.leftFirst];
+					const BVHNode& right = nodes[node.leftFirst + 1];
+					const StreamRay& r = streamRays[ids[begin]];
+					float d = 0.0f;
+					for (int a = 0; a < 3; a++)
+						d += ((right.min[a] + right.max[a]) - (left.min[a] + left.max[a])) * r.direction[a];
+
+					uint32_t nearChild = d >= 0.0f ? node.leftFirst : node.leftFirst + 1;
+					stack.push_back({ nearChild == node.leftFirst ? node.leftFirst + 1 : node.leftFirst, begin, survivors });
+					stack.push_back({ nearChild, begin, survivors });
+				}
+
+				for (uint32_t i = 0; i < rayCount; i++)
+				{
+					if (AnyHit)
+						occluded[first + i] = streamHits[i].IsHit();
+					else
+						hits[first + i] = streamHits[i].IsHit() ? streamHits[i] : RayHit();
+				}
+			});
+	}
+}
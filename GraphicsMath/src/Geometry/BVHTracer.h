@@ -0,0 +1,75 @@
+#pragma once
+
+#include "BVH.h"
+#include "Ray.h"
+#include "TriangleMesh.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	/// <summary>
+	/// Ray queries against a BVH. Leaf triangles are copied into 8-wide structure of arrays blocks
+	/// (vertex 0 and both edges) so the Moller-Trumbore test runs on 8 triangles or 8 rays at once.
+	///
+	/// Three ways to trace:
+	///  - single rays
+	///  - packets of 4/8/16 coherent rays, nodes are culled for the whole packet with interval arithmetic
+	///    before the per ray slab tests and rays that left the packet stay masked out below the node
+	///  - streams of incoherent rays, traversed breadth first so every node is tested against all the rays
+	///    that reached it, split over the job system in chunks
+	/// </summary>
+	class BVHTracer
+	{
+	public:
+		BVHTracer();
+		BVHTracer(const BVH& bvh, const TriangleMeshView& mesh);
+
+		/// <summary>
+		/// Keeps a pointer to the bvh and copies the leaf triangles out of the mesh.
+		/// Must be called again after BVH::Build, Refit or Optimize.
+		/// </summary>
+		void Set(const BVH& bvh, const TriangleMeshView& mesh);
+		void Clear();
+
+		// closest hit
+		RayHit Intersect(const Ray& ray) const;
+		// any hit in [tMin, tMax], for shadow rays
+		bool Occluded(const Ray& ray) const;
+
+		// N = 4, 8 or 16. hits receives N results
+		template<uint32_t N>
+		void Intersect(const RayPacket<N>& packet, RayHit* hits) const;
+		// returns a bit mask of the occluded rays
+		template<uint32_t N>
+		uint32_t Occluded(const RayPacket<N>& packet) const;
+
+		void IntersectStream(const Ray* rays, uint32_t count, RayHit* hits) const;
+		void OccludedStream(const Ray* rays, uint32_t count, bool* occluded) const;
+
+	private:
+		struct alignas(32) TriangleBlock
+		{
+			float v0[3][8];
+			float e1[3][8];
+			float e2[3][8];
+			uint32_t triangles[8]; // UINT32_MAX for padding lanes
+		};
+
+		template<bool AnyHit>
+		bool TraceRay(const Ray& ray, RayHit& hit) const;
+		template<uint32_t N, bool AnyHit>
+		uint32_t TracePacket(const RayPacket<N>& packet, RayHit* hits) const;
+		template<bool AnyHit>
+		void TraceStream(const Ray* rays, uint32_t count, RayHit* hits, bool* occluded) const;
+
+		// tests one ray against every block of a leaf, returns true on a hit closer than hit.t
+		template<bool AnyHit>
+		bool IntersectLeaf(uint32_t nodeIndex, uint32_t count, const float* origin, const float* direction, float tMin, RayHit& hit) const;
+
+		const BVH* m_bvh;
+		std::vector<TriangleBlock> m_blocks;
+		std::vector<uint32_t> m_leafBlocks; // per node index of the first block, blocks of a leaf are contiguous
+	};
+}
@@ -0,0 +1,168 @@
+#include "BoundingVolumes.h"
+
+#include "Math/Functions.h"
+#include "Math/Operators.h"
+#include <algorithm>
+#include <math.h>
+
+namespace GM
+{
+	// =========================================== AABB ===================================================
+
+	bool AABBIsEmpty(const AABB& box)
+	{
+		return box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+	}
+
+	// grows the box to include the point
+	void AABBGrow(AABB& box, const Vector& point)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			box.min[i] = std::min(box.min[i], point[i]);
+			box.max[i] = std::max(box.max[i], point[i]);
+		}
+	}
+
+	// grows the box to include other box
+	void AABBGrow(AABB& box, const AABB& other)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			box.min[i] = std::min(box.min[i], other.min[i]);
+			box.max[i] = std::max(box.max[i], other.max[i]);
+		}
+	}
+
+	AABB AABBUnion(const AABB& b0, const AABB& b1)
+	{
+		AABB res = b0;
+		AABBGrow(res, b1);
+		return res;
+	}
+
+	Vector AABBCenter(const AABB& box)
+	{
+		Vector res = 0.5f * (box.min + box.max);
+		res.w = 1.0f;
+		return res;
+	}
+
+	// = max - min
+	Vector AABBExtent(const AABB& box)
+	{
+		Vector res = box.max - box.min;
+		res.w = 0.0f;
+		return res;
+	}
+
+	// = 2 * (x*y + y*z + z*x) of the extent
+	float AABBSurfaceArea(const AABB& box)
+	{
+		if (AABBIsEmpty(box))
+			return 0.0f;
+
+		Vector e = AABBExtent(box);
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	float AABBVolume(const AABB& box)
+	{
+		if (AABBIsEmpty(box))
+			return 0.0f;
+
+		Vector e = AABBExtent(box);
+		return e.x * e.y * e.z;
+	}
+
+	bool AABBOverlaps(const AABB& b0, const AABB& b1)
+	{
+		return b0.min.x <= b1.max.x && b0.max.x >= b1.min.x &&
+			b0.min.y <= b1.max.y && b0.max.y >= b1.min.y &&
+			b0.min.z <= b1.max.z && b0.max.z >= b1.min.z;
+	}
+
+	bool AABBContains(const AABB& box, const Vector& point)
+	{
+		return point.x >= box.min.x && point.x <= box.max.x &&
+			point.y >= box.min.y && point.y <= box.max.y &&
+			point.z >= box.min.z && point.z <= box.max.z;
+	}
+
+	// true if inner is completely inside outer
+	bool AABBContains(const AABB& outer, const AABB& inner)
+	{
+		return inner.min.x >= outer.min.x && inner.max.x <= outer.max.x &&
+			inner.min.y >= outer.min.y && inner.max.y <= outer.max.y &&
+			inner.min.z >= outer.min.z && inner.max.z <= outer.max.z;
+	}
+
+
+
+
+	// =========================================== Sphere =================================================
+
+	AABB SphereBounds(const Sphere& sphere)
+	{
+		Vector r(sphere.radius, sphere.radius, sphere.radius, 0.0f);
+		return AABB(sphere.center - r, sphere.center + r);
+	}
+
+	float SphereVolume(const Sphere& sphere)
+	{
+		return 4.0f / 3.0f * GM_PI * sphere.radius * sphere.radius * sphere.radius;
+	}
+
+	bool SphereContains(const Sphere& sphere, const Vector& point)
+	{
+		Vector d = point - sphere.center;
+		return Vec3Dot(d, d) <= sphere.radius * sphere.radius;
+	}
+
+
+
+
+	// =========================================== OBB ====================================================
+
+	AABB OBBBounds(const OBB& box)
+	{
+		// half size along each world axis is the sum of the projected half axes
+		Vector half(0.0f, 0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			for (int k = 0; k < 3; k++)
+				half[i] += fabsf(box.axes[k][i]) * box.extents[k];
+		}
+
+		return AABB(box.center - half, box.center + half);
+	}
+
+	float OBBVolume(const OBB& box)
+	{
+		return 8.0f * box.extents.x * box.extents.y * box.extents.z;
+	}
+
+	OBB OBBTransform(const OBB& box, const Matrix& transform)
+	{
+		OBB res = box;
+		res.center = Vec3Transform(box.center, transform);
+		for (int i = 0; i < 3; i++)
+		{
+			res.center[i] += transform.v[3][i];
+			res.axes[i] = Vec3Transform(box.axes[i], transform);
+			res.axes[i].w = 0.0f;
+		}
+
+		return res;
+	}
+
+	// world space corner i in [0, 7], bit 0/1/2 of i selects the +/- side of axis x/y/z
+	Vector OBBCorner(const OBB& box, uint32_t i)
+	{
+		Vector res = box.center;
+		for (int k = 0; k < 3; k++)
+			res = res + ((i >> k) & 1 ? box.extents[k] : -box.extents[k]) * box.axes[k];
+
+		return res;
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Math/Types.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	/// <summary>
+	/// Axis aligned bounding box. Only the (x, y, z) components are used.
+	/// An empty box has min > max, so growing it by any point yields that point.
+	/// </summary>
+	struct AABB
+	{
+		Vector min;
+		Vector max;
+
+		AABB(const Vector& min, const Vector& max)
+			: min(min), max(max)
+		{
+		}
+
+		AABB()
+			: min(3.402823466e+38f, 3.402823466e+38f, 3.402823466e+38f, 0.0f),
+			max(-3.402823466e+38f, -3.402823466e+38f, -3.402823466e+38f, 0.0f)
+		{
+		}
+	};
+
+	struct Sphere
+	{
+		Vector center;
+		float radius;
+
+		Sphere(const Vector& center, float radius)
+			: center(center), radius(radius)
+		{
+		}
+
+		Sphere()
+			: center(0.0f, 0.0f, 0.0f, 1.0f), radius(0.0f)
+		{
+		}
+	};
+
+	/// <summary>
+	/// Oriented bounding box. axes are orthonormal, extents are the half sizes along them.
+	/// </summary>
+	struct OBB
+	{
+		Vector center;
+		Vector extents;
+		Vector axes[3];
+
+		OBB(const Vector& center, const Vector& extents, const Vector& axisX, const Vector& axisY, const Vector& axisZ)
+			: center(center), extents(extents), axes{ axisX, axisY, axisZ }
+		{
+		}
+
+		OBB()
+			: center(0.0f, 0.0f, 0.0f, 1.0f), extents(0.0f, 0.0f, 0.0f, 0.0f),
+			axes{ Vector(1.0f, 0.0f, 0.0f, 0.0f), Vector(0.0f, 1.0f, 0.0f, 0.0f), Vector(0.0f, 0.0f, 1.0f, 0.0f) }
+		{
+		}
+	};
+
+
+
+
+	// =========================================== AABB ===================================================
+
+	bool AABBIsEmpty(const AABB& box);
+
+	// grows the box to include the point
+	void AABBGrow(AABB& box, const Vector& point);
+
+	// grows the box to include other box
+	void AABBGrow(AABB& box, const AABB& other);
+
+	AABB AABBUnion(const AABB& b0, const AABB& b1);
+
+	Vector AABBCenter(const AABB& box);
+
+	// = max - min
+	Vector AABBExtent(const AABB& box);
+
+	// = 2 * (x*y + y*z + z*x) of the extent
+	float AABBSurfaceArea(const AABB& box);
+
+	float AABBVolume(const AABB& box);
+
+	bool AABBOverlaps(const AABB& b0, const AABB& b1);
+
+	bool AABBContains(const AABB& box, const Vector& point);
+
+	// true if inner is completely inside outer
+	bool AABBContains(const AABB& outer, const AABB& inner);
+
+
+
+
+	// =========================================== Sphere =================================================
+
+	AABB SphereBounds(const Sphere& sphere);
+
+	float SphereVolume(const Sphere& sphere);
+
+	bool SphereContains(const Sphere& sphere, const Vector& point);
+
+
+
+
+	// =========================================== OBB ====================================================
+
+	AABB OBBBounds(const OBB& box);
+
+	float OBBVolume(const OBB& box);
+
+	// rotates and translates the box by the row-major transform (row vector * matrix), scale is not supported
+	OBB OBBTransform(const OBB& box, const Matrix& transform);
+
+	// world space corner i in [0, 7], bit 0/1/2 of i selects the +/- side of axis x/y/z
+	Vector OBBCorner(const OBB& box, uint32_t i);
+}
\ No newline at end of file
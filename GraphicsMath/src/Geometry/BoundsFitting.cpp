@@ -0,0 +1,681 @@
+#include "BoundsFitting.h"
+#include "Core/JobSystem.h"
+#include "Math/Decomposition.h"
+#include "Math/SIMD.h"
+
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <vector>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_grainSize = 16384;
+		constexpr uint32_t s_parallelThreshold = 65536;
+		constexpr double s_miniballEpsilon = 1e-32;
+
+		uint32_t ChunkCount(uint32_t count)
+		{
+			return JobSystem::GetThreadCount() > 1 && count >= s_parallelThreshold ? JobSystem::ComputeChunkCount(count, s_grainSize) : 1;
+		}
+
+		// points that can be read with a 4 float load: the load of the last point of a stride 3 array would
+		// read past the end
+		uint32_t SimdCount(uint32_t count, uint32_t stride)
+		{
+			return stride >= 4 || count == 0 ? count : count - 1;
+		}
+
+		// x, y, z of 4 consecutive points, every load reads the float after the position
+		void LoadPositions4(const float* p, size_t stride, Float4& x, Float4& y, Float4& z)
+		{
+			__m128 a = _mm_loadu_ps(p);
+			__m128 b = _mm_loadu_ps(p + stride);
+			__m128 c = _mm_loadu_ps(p + 2 * stride);
+			__m128 d = _mm_loadu_ps(p + 3 * stride);
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			x = a;
+			y = b;
+			z = c;
+		}
+
+		struct RitterSphere
+		{
+			float x, y, z;
+			float radius;
+			float radiusSq;
+
+			void Grow(const float* p)
+			{
+				float dx = p[0] - x, dy = p[1] - y, dz = p[2] - z;
+				float distanceSq = dx * dx + dy * dy + dz * dz;
+				if (distanceSq <= radiusSq)
+					return;
+
+				// the new sphere touches the point and the far side of the old one
+				float distance = sqrtf(distanceSq);
+				float newRadius = 0.5f * (radius + distance);
+				float k = (newRadius - radius) / distance;
+				x += k * dx;
+				y += k * dy;
+				z += k * dz;
+				radius = newRadius;
+				radiusSq = radius * radius;
+			}
+
+			// 4 points at a time are tested against the current sphere, only blocks with a point outside are grown
+			// one point after the other. After the first few hundred points almost every block is inside
+			void Grow(const float* positions, uint32_t stride, uint32_t first, uint32_t last, uint32_t simdCount)
+			{
+				uint32_t i = first;
+				for (; i + 4 <= last && i + 4 <= simdCount; i += 4)
+				{
+					const float* p = positions + static_cast<size_t>(i) * stride;
+					Float4 px, py, pz;
+					LoadPositions4(p, stride, px, py, pz);
+					Float4 dx = px - Float4(x), dy = py - Float4(y), dz = pz - Float4(z);
+					Float4 distanceSq = MulAdd(dx, dx, MulAdd(dy, dy, dz * dz));
+					if (MoveMask(distanceSq > Float4(radiusSq)) == 0)
+						continue;
+
+					for (uint32_t k = 0; k < 4; k++)
+						Grow(p + k * stride);
+				}
+
+				for (; i < last; i++)
+					Grow(positions + static_cast<size_t>(i) * stride);
+			}
+		};
+
+		/// <summary>
+		/// Smallest enclosing ball with Gaertner's incremental update of the affine basis of the points forced onto
+		/// the boundary: "Fast and Robust Smallest Enclosing Balls", ESA 1999. Welzl's move-to-front recursion only
+		/// runs over the support points, the points outside of the ball are found by pivoting: the farthest one is
+		/// forced onto the boundary of the next round. In double, the positions are converted when read.
+		/// </summary>
+		class Miniball
+		{
+		public:
+			Miniball(const float* positions, uint32_t count, uint32_t stride)
+				: m_positions(positions), m_count(count), m_stride(stride), m_listSize(0), m_supportEnd(0),
+				m_size(0), m_current(0), m_sqrRadius(-1.0)
+			{
+				for (int j = 0; j < 3; j++)
+					m_c[0][j] = 0.0;
+			}
+
+			void Build()
+			{
+				uint32_t chunkCount = ChunkCount(m_count);
+				std::vector<uint32_t> chunkPivots(chunkCount);
+				std::vector<double> chunkExcess(chunkCount);
+
+				double oldSqrRadius;
+				do
+				{
+					oldSqrRadius = m_sqrRadius;
+
+					// the point farthest outside, the first one on ties
+					JobSystem::ParallelForChunks(m_count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+						{
+							uint32_t pivot = first;
+							double maxExcess = 0.0;
+							for (uint32_t i = first; i < last; i++)
+							{
+								double e = Excess(i);
+								if (e > maxExcess)
+								{
+									maxExcess = e;
+									pivot = i;
+								}
+							}
+							chunkPivots[chunk] = pivot;
+							chunkExcess[chunk] = maxExcess;
+						});
+
+					uint32_t best = 0;
+					for (uint32_t c = 1; c < chunkCount; c++)
+					{
+						if (chunkExcess[c] > chunkExcess[best])
+							best = c;
+					}
+
+					uint32_t pivot = chunkPivots[best];
+					if (chunkExcess[best] > 0.0 && !IsSupport(pivot) && Push(pivot))
+					{
+						MtfMb(m_supportEnd);
+						Pop();
+						PivotMoveToFront(pivot);
+					}
+				} while (oldSqrRadius < m_sqrRadius);
+			}
+
+			const double* GetCenter() const { return m_c[m_current]; }
+
+		private:
+			// Welzl over the first end points of the list, recursing at most 4 levels deep
+			void MtfMb(uint32_t end)
+			{
+				m_supportEnd = 0;
+				if (m_size == 4)
+					return;
+
+				for (uint32_t i = 0; i < end; i++)
+				{
+					uint32_t point = m_list[i];
+					if (Excess(point) > 0.0 && Push(point))
+					{
+						MtfMb(i);
+						Pop();
+						MoveToFront(i);
+					}
+				}
+			}
+
+			// the points before i keep their relative order, the ones after i their position
+			void MoveToFront(uint32_t i)
+			{
+				if (m_supportEnd <= i)
+					m_supportEnd++;
+
+				uint32_t point = m_list[i];
+				for (uint32_t k = i; k > 0; k--)
+					m_list[k] = m_list[k - 1];
+				m_list[0] = point;
+			}
+
+			// at most 4 points support a ball in 3D, the list never needs more than 5
+			void PivotMoveToFront(uint32_t point)
+			{
+				uint32_t size = m_listSize < 5 ? m_listSize + 1 : 5;
+				for (uint32_t k = size - 1; k > 0; k--)
+					m_list[k] = m_list[k - 1];
+				m_list[0] = point;
+				m_listSize = size;
+
+				if (++m_supportEnd == 5)
+					m_supportEnd = 4;
+			}
+
+			bool IsSupport(uint32_t point) const
+			{
+				for (uint32_t i = 0; i < m_supportEnd; i++)
+				{
+					if (m_list[i] == point)
+						return true;
+				}
+				return false;
+			}
+
+			double Excess(uint32_t i) const
+			{
+				const float* p = m_positions + static_cast<size_t>(i) * m_stride;
+				const double* c = m_c[m_current];
+				double dx = p[0] - c[0], dy = p[1] - c[1], dz = p[2] - c[2];
+				return dx * dx + dy * dy + dz * dz - m_sqrRadius;
+			}
+
+			// false when the point is affinely dependent on the forced points, the ball is left unchanged then
+			bool Push(uint32_t i)
+			{
+				const float* point = m_positions + static_cast<size_t>(i) * m_stride;
+				double p[3] = { point[0], point[1], point[2] };
+				int m = m_size;
+				if (m == 0)
+				{
+					for (int j = 0; j < 3; j++)
+						m_q0[j] = m_c[0][j] = p[j];
+					m_r[0] = 0.0;
+				}
+				else
+				{
+					for (int j = 0; j < 3; j++)
+						m_v[m][j] = p[j] - m_q0[j];
+
+					// removes the components along the previous basis vectors
+					for (int k = 1; k < m; k++)
+					{
+						double a = 0.0;
+						for (int j = 0; j < 3; j++)
+							a += m_v[k][j] * m_v[m][j];
+						a *= 2.0 / m_z[k];
+
+						for (int j = 0; j < 3; j++)
+							m_v[m][j] -= a * m_v[k][j];
+					}
+
+					m_z[m] = 2.0 * (m_v[m][0] * m_v[m][0] + m_v[m][1] * m_v[m][1] + m_v[m][2] * m_v[m][2]);
+					if (m_z[m] < s_miniballEpsilon * m_sqrRadius)
+						return false;
+
+					double e = -m_r[m - 1];
+					for (int j = 0; j < 3; j++)
+						e += (p[j] - m_c[m - 1][j]) * (p[j] - m_c[m - 1][j]);
+
+					double f = e / m_z[m];
+					for (int j = 0; j < 3; j++)
+						m_c[m][j] = m_c[m - 1][j] + f * m_v[m][j];
+					m_r[m] = m_r[m - 1] + e * f / 2.0;
+				}
+
+				// the ball stays the current one after the pop, a pop only releases the point from the boundary
+				m_current = m;
+				m_sqrRadius = m_r[m];
+				m_size = m + 1;
+				return true;
+			}
+
+			void Pop()
+			{
+				m_size--;
+			}
+
+			const float* m_positions;
+			uint32_t m_count;
+			uint32_t m_stride;
+
+			uint32_t m_list[5]; // support points first, in move-to-front order
+			uint32_t m_listSize;
+			uint32_t m_supportEnd;
+
+			int m_size;    // points forced onto the boundary
+			int m_current; // level of the current ball
+			double m_sqrRadius;
+			double m_q0[3];
+			double m_z[4];
+			double m_v[4][3];
+			double m_c[4][3];
+			double m_r[4]; // squared radius per level
+		};
+	}
+
+	// SIMD min / max over the points
+	AABB AABBFromPoints(const float* positions, uint32_t count, uint32_t stride)
+	{
+		struct Bounds
+		{
+			Float4 min;
+			Float4 max;
+		};
+
+		if (count == 0)
+			return AABB();
+
+		uint32_t simdCount = SimdCount(count, stride);
+		uint32_t chunkCount = ChunkCount(count);
+		std::vector<Bounds> chunkBounds(chunkCount);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				// two accumulators hide the latency of min / max, lane w is ignored
+				Float4 min0 = FLT_MAX, min1 = FLT_MAX;
+				Float4 max0 = -FLT_MAX, max1 = -FLT_MAX;
+				const float* p = positions + static_cast<size_t>(first) * stride;
+				uint32_t i = first;
+				uint32_t simdLast = last < simdCount ? last : simdCount;
+				for (; i + 2 <= simdLast; i += 2, p += 2 * stride)
+				{
+					Float4 a = Float4::LoadUnaligned(p);
+					Float4 b = Float4::LoadUnaligned(p + stride);
+					min0 = Min(min0, a);
+					max0 = Max(max0, a);
+					min1 = Min(min1, b);
+					max1 = Max(max1, b);
+				}
+
+				for (; i < last; i++, p += stride)
+				{
+					Float4 a = _mm_set_ps(0.0f, p[2], p[1], p[0]);
+					min0 = Min(min0, a);
+					max0 = Max(max0, a);
+				}
+
+				chunkBounds[chunk] = { Min(min0, min1), Max(max0, max1) };
+			});
+
+		AABB res;
+		for (const Bounds& b : chunkBounds)
+		{
+			alignas(16) float min[4], max[4];
+			_mm_store_ps(min, b.min.m);
+			_mm_store_ps(max, b.max.m);
+			AABBGrow(res, AABB(Vector(min[0], min[1], min[2], 0.0f), Vector(max[0], max[1], max[2], 0.0f)));
+		}
+
+		return res;
+	}
+
+	Sphere SphereFromPointsRitter(const float* positions, uint32_t count, uint32_t stride, uint32_t refinePasses)
+	{
+		if (count == 0)
+			return Sphere();
+
+		// the most distant pair of the points extreme along x, y or z gives the first sphere
+		struct Extremes
+		{
+			uint32_t min[4]; // x, y, z and an unused lane
+			uint32_t max[4];
+		};
+
+		uint32_t simdCount = SimdCount(count, stride);
+		uint32_t chunkCount = ChunkCount(count);
+		std::vector<Extremes> chunkExtremes(chunkCount);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				// the value and the index of the extremes per lane, strict compares keep the first index
+				Float4 min = FLT_MAX, max = -FLT_MAX;
+				Float4 minIndex = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(first)));
+				Float4 maxIndex = minIndex;
+				const float* p = positions + static_cast<size_t>(first) * stride;
+				for (uint32_t i = first; i < last; i++, p += stride)
+				{
+					Float4 v = i < simdCount ? Float4::LoadUnaligned(p) : Float4(_mm_set_ps(0.0f, p[2], p[1], p[0]));
+					Float4 index = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(i)));
+					Float4 less = v < min, greater = v > max;
+					min = Select(less, v, min);
+					minIndex = Select(less, index, minIndex);
+					max = Select(greater, v, max);
+					maxIndex = Select(greater, index, maxIndex);
+				}
+
+				Extremes e;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(e.min), _mm_castps_si128(minIndex.m));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(e.max), _mm_castps_si128(maxIndex.m));
+				chunkExtremes[chunk] = e;
+			});
+
+		Extremes extremes = chunkExtremes[0];
+		for (uint32_t c = 1; c < chunkCount; c++)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				if (positions[static_cast<size_t>(chunkExtremes[c].min[a]) * stride + a] < positions[static_cast<size_t>(extremes.min[a]) * stride + a])
+					extremes.min[a] = chunkExtremes[c].min[a];
+				if (positions[static_cast<size_t>(chunkExtremes[c].max[a]) * stride + a] > positions[static_cast<size_t>(extremes.max[a]) * stride + a])
+					extremes.max[a] = chunkExtremes[c].max[a];
+			}
+		}
+
+		const float* p0 = nullptr;
+		const float* p1 = nullptr;
+		float widest = -1.0f;
+		for (int a = 0; a < 3; a++)
+		{
+			const float* min = positions + static_cast<size_t>(extremes.min[a]) * stride;
+			const float* max = positions + static_cast<size_t>(extremes.max[a]) * stride;
+			float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+			float distanceSq = dx * dx + dy * dy + dz * dz;
+			if (distanceSq > widest)
+			{
+				widest = distanceSq;
+				p0 = min;
+				p1 = max;
+			}
+		}
+
+		RitterSphere sphere;
+		sphere.x = 0.5f * (p0[0] + p1[0]);
+		sphere.y = 0.5f * (p0[1] + p1[1]);
+		sphere.z = 0.5f * (p0[2] + p1[2]);
+		sphere.radius = 0.5f * sqrtf(widest);
+		sphere.radiusSq = sphere.radius * sphere.radius;
+		sphere.Grow(positions, stride, 0, count, simdCount);
+
+		// the grown sphere depends on the point order: a slightly too small copy grown from another start
+		// often ends up smaller
+		RitterSphere candidate = sphere;
+		for (uint32_t pass = 0; pass < refinePasses; pass++)
+		{
+			candidate.radius *= 0.95f;
+			candidate.radiusSq = candidate.radius * candidate.radius;
+
+			uint32_t start = static_cast<uint32_t>(static_cast<uint64_t>(count) * (pass + 1) / (refinePasses + 1));
+			candidate.Grow(positions, stride, start, count, simdCount);
+			candidate.Grow(positions, stride, 0, start, simdCount);
+			if (candidate.radius < sphere.radius)
+				sphere = candidate;
+		}
+
+		// the grown radius is only exact to the rounding of the center
+		float scale = fabsf(sphere.x) + fabsf(sphere.y) + fabsf(sphere.z) + sphere.radius;
+		return Sphere(Vector(sphere.x, sphere.y, sphere.z, 1.0f), sphere.radius + 4.0f * FLT_EPSILON * scale);
+	}
+
+	Sphere SphereFromPointsWelzl(const float* positions, uint32_t count, uint32_t stride)
+	{
+		if (count == 0)
+			return Sphere();
+
+		Miniball miniball(positions, count, stride);
+		miniball.Build();
+
+		const double* c = miniball.GetCenter();
+		Vector center(static_cast<float>(c[0]), static_cast<float>(c[1]), static_cast<float>(c[2]), 1.0f);
+
+		// the radius from the rounded center, so every point is inside in float
+		uint32_t simdCount = SimdCount(count, stride);
+		uint32_t chunkCount = ChunkCount(count);
+		std::vector<float> chunkRadiusSq(chunkCount);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				Float4 maxSq = 0.0f;
+				uint32_t i = first;
+				for (; i + 4 <= last && i + 4 <= simdCount; i += 4)
+				{
+					Float4 x, y, z;
+					LoadPositions4(positions + static_cast<size_t>(i) * stride, stride, x, y, z);
+					Float4 dx = x - Float4(center.x), dy = y - Float4(center.y), dz = z - Float4(center.z);
+					maxSq = Max(maxSq, MulAdd(dx, dx, MulAdd(dy, dy, dz * dz)));
+				}
+
+				alignas(16) float lanes[4];
+				_mm_store_ps(lanes, maxSq.m);
+				float res = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+				for (; i < last; i++)
+				{
+					const float* p = positions + static_cast<size_t>(i) * stride;
+					float dx = p[0] - center.x, dy = p[1] - center.y, dz = p[2] - center.z;
+					res = fmaxf(res, dx * dx + dy * dy + dz * dz);
+				}
+				chunkRadiusSq[chunk] = res;
+			});
+
+		float radiusSq = 0.0f;
+		for (float r : chunkRadiusSq)
+			radiusSq = fmaxf(radiusSq, r);
+
+		float radius = sqrtf(radiusSq);
+		if (radius * radius < radiusSq)
+			radius = nextafterf(radius, FLT_MAX);
+		return Sphere(center, radius);
+	}
+
+	OBB OBBFromPointsPCA(const float* positions, uint32_t count, uint32_t stride)
+	{
+		if (count == 0)
+			return OBB();
+
+		// covariance from sums relative to the first point, in double so one pass is enough
+		const float* origin = positions;
+		uint32_t chunkCount = ChunkCount(count);
+		std::vector<double> chunkSums(chunkCount * 9);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				double s[9] = {};
+				for (uint32_t i = first; i < last; i++)
+				{
+					const float* p = positions + static_cast<size_t>(i) * stride;
+					double x = static_cast<double>(p[0]) - origin[0];
+					double y = static_cast<double>(p[1]) - origin[1];
+					double z = static_cast<double>(p[2]) - origin[2];
+					s[0] += x;
+					s[1] += y;
+					s[2] += z;
+					s[3] += x * x;
+					s[4] += x * y;
+					s[5] += x * z;
+					s[6] += y * y;
+					s[7] += y * z;
+					s[8] += z * z;
+				}
+
+				for (int k = 0; k < 9; k++)
+					chunkSums[chunk * 9 + k] = s[k];
+			});
+
+		double s[9] = {};
+		for (uint32_t c = 0; c < chunkCount; c++)
+		{
+			for (int k = 0; k < 9; k++)
+				s[k] += chunkSums[c * 9 + k];
+		}
+
+		double n = count;
+		double mx = s[0] / n, my = s[1] / n, mz = s[2] / n;
+		Matrix covariance;
+		covariance.f[0][0] = static_cast<float>(s[3] / n - mx * mx);
+		covariance.f[0][1] = static_cast<float>(s[4] / n - mx * my);
+		covariance.f[0][2] = static_cast<float>(s[5] / n - mx * mz);
+		covariance.f[1][1] = static_cast<float>(s[6] / n - my * my);
+		covariance.f[1][2] = static_cast<float>(s[7] / n - my * mz);
+		covariance.f[2][2] = static_cast<float>(s[8] / n - mz * mz);
+
+		Vector eigenvalues;
+		Matrix axes = MatEigenSymmetric(covariance, eigenvalues);
+
+		// extents along the principal axes and the axis aligned bounds in the same pass, relative to the mean
+		float cx = static_cast<float>(mx + origin[0]), cy = static_cast<float>(my + origin[1]), cz = static_cast<float>(mz + origin[2]);
+		uint32_t simdCount = SimdCount(count, stride);
+		std::vector<float> chunkRanges(chunkCount * 12);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				// projections on the 3 axes, then x, y, z
+				Float4 min[6], max[6];
+				for (int k = 0; k < 6; k++)
+				{
+					min[k] = FLT_MAX;
+					max[k] = -FLT_MAX;
+				}
+
+				auto project = [&](Float4 x, Float4 y, Float4 z)
+					{
+						x = x - Float4(cx);
+						y = y - Float4(cy);
+						z = z - Float4(cz);
+						for (int k = 0; k < 3; k++)
+						{
+							const Vector& a = axes.v[k];
+							Float4 d = MulAdd(Float4(a.x), x, MulAdd(Float4(a.y), y, Float4(a.z) * z));
+							min[k] = Min(min[k], d);
+							max[k] = Max(max[k], d);
+						}
+						min[3] = Min(min[3], x);
+						max[3] = Max(max[3], x);
+						min[4] = Min(min[4], y);
+						max[4] = Max(max[4], y);
+						min[5] = Min(min[5], z);
+						max[5] = Max(max[5], z);
+					};
+
+				uint32_t i = first;
+				for (; i + 4 <= last && i + 4 <= simdCount; i += 4)
+				{
+					Float4 x, y, z;
+					LoadPositions4(positions + static_cast<size_t>(i) * stride, stride, x, y, z);
+					project(x, y, z);
+				}
+
+				// the tail is repeated over the 4 lanes
+				for (; i < last; i++)
+				{
+					const float* p = positions + static_cast<size_t>(i) * stride;
+					project(p[0], p[1], p[2]);
+				}
+
+				for (int k = 0; k < 6; k++)
+				{
+					alignas(16) float lo[4], hi[4];
+					_mm_store_ps(lo, min[k].m);
+					_mm_store_ps(hi, max[k].m);
+					chunkRanges[chunk * 12 + k * 2] = fminf(fminf(lo[0], lo[1]), fminf(lo[2], lo[3]));
+					chunkRanges[chunk * 12 + k * 2 + 1] = fmaxf(fmaxf(hi[0], hi[1]), fmaxf(hi[2], hi[3]));
+				}
+			});
+
+		float range[12];
+		for (int k = 0; k < 6; k++)
+		{
+			range[k * 2] = FLT_MAX;
+			range[k * 2 + 1] = -FLT_MAX;
+		}
+		for (uint32_t c = 0; c < chunkCount; c++)
+		{
+			for (int k = 0; k < 6; k++)
+			{
+				range[k * 2] = fminf(range[k * 2], chunkRanges[c * 12 + k * 2]);
+				range[k * 2 + 1] = fmaxf(range[k * 2 + 1], chunkRanges[c * 12 + k * 2 + 1]);
+			}
+		}
+
+		// flat point sets have no volume, the sum of the face areas decides then
+		float obbSize[3], aabbSize[3];
+		for (int k = 0; k < 3; k++)
+		{
+			obbSize[k] = range[k * 2 + 1] - range[k * 2];
+			aabbSize[k] = range[k * 2 + 7] - range[k * 2 + 6];
+		}
+		float obbVolume = obbSize[0] * obbSize[1] * obbSize[2];
+		float aabbVolume = aabbSize[0] * aabbSize[1] * aabbSize[2];
+		float obbArea = obbSize[0] * obbSize[1] + obbSize[1] * obbSize[2] + obbSize[2] * obbSize[0];
+		float aabbArea = aabbSize[0] * aabbSize[1] + aabbSize[1] * aabbSize[2] + aabbSize[2] * aabbSize[0];
+
+		OBB res;
+		Vector center(cx, cy, cz, 1.0f);
+		if (aabbVolume < obbVolume || (aabbVolume == obbVolume && aabbArea <= obbArea))
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				center[k] += 0.5f * (range[k * 2 + 6] + range[k * 2 + 7]);
+				res.extents[k] = 0.5f * (range[k * 2 + 7] - range[k * 2 + 6]);
+			}
+			res.center = center;
+			return res;
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			float mid = 0.5f * (range[k * 2] + range[k * 2 + 1]);
+			center.x += mid * axes.v[k].x;
+			center.y += mid * axes.v[k].y;
+			center.z += mid * axes.v[k].z;
+			res.extents[k] = 0.5f * (range[k * 2 + 1] - range[k * 2]);
+			res.axes[k] = axes.v[k];
+		}
+		res.center = center;
+		return res;
+	}
+
+	BoundsFitReport CompareBoundsFitting(const float* positions, uint32_t count, uint32_t stride)
+	{
+		BoundsFitReport res;
+		auto time = [](auto&& fit)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				fit();
+				auto end = std::chrono::high_resolution_clock::now();
+				return std::chrono::duration<double, std::milli>(end - start).count();
+			};
+
+		res.aabbTimeMs = time([&]() { res.aabb = AABBFromPoints(positions, count, stride); });
+		res.ritterTimeMs = time([&]() { res.ritter = SphereFromPointsRitter(positions, count, stride); });
+		res.welzlTimeMs = time([&]() { res.welzl = SphereFromPointsWelzl(positions, count, stride); });
+		res.obbTimeMs = time([&]() { res.obb = OBBFromPointsPCA(positions, count, stride); });
+
+		res.aabbVolume = AABBVolume(res.aabb);
+		res.ritterVolume = SphereVolume(res.ritter);
+		res.welzlVolume = SphereVolume(res.welzl);
+		res.obbVolume = OBBVolume(res.obb);
+		return res;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	// Bounding volumes fitted to point streams. positions is the first 3 floats of every element, stride is in floats,
+	// so the vertex arrays of Utils::BasicMesh (stride 3, 5, 6 or 8) and Vector arrays (stride 4) can be passed as is.
+	// Large streams are split over the job system, the results do not depend on the thread count.
+
+	// SIMD min / max over the points
+	AABB AABBFromPoints(const float* positions, uint32_t count, uint32_t stride);
+
+	/// <summary>
+	/// Approximate bounding sphere. Ritter's sphere from the most distant pair of axis extremes, then
+	/// refinePasses passes that shrink a copy by 5% and grow it back over the points visited from a different
+	/// start, keeping the smallest. Usually within a few percent of the minimal radius, every pass is one SIMD
+	/// pass over the points.
+	/// </summary>
+	Sphere SphereFromPointsRitter(const float* positions, uint32_t count, uint32_t stride, uint32_t refinePasses = 4);
+
+	/// <summary>
+	/// Minimal bounding sphere. Welzl's algorithm with move-to-front over the support points and pivoting
+	/// (Gaertner), in double precision with a recursion depth of at most 4. One pass over the points per pivot,
+	/// a handful for most meshes: about the time of the Ritter sphere, up to 4x for points spread over a sphere.
+	/// </summary>
+	Sphere SphereFromPointsWelzl(const float* positions, uint32_t count, uint32_t stride);
+
+	/// <summary>
+	/// Box along the principal axes of the covariance of the points. Much tighter than the AABB for elongated,
+	/// rotated objects. The covariance weights dense regions more, so for symmetric shapes the axes can be poor,
+	/// the axis aligned box is returned instead when its volume is smaller.
+	/// </summary>
+	OBB OBBFromPointsPCA(const float* positions, uint32_t count, uint32_t stride);
+
+	// time and volume of every fitting method over the same points
+	struct BoundsFitReport
+	{
+		AABB aabb;
+		Sphere ritter;
+		Sphere welzl;
+		OBB obb;
+
+		double aabbTimeMs = 0.0;
+		double ritterTimeMs = 0.0;
+		double welzlTimeMs = 0.0;
+		double obbTimeMs = 0.0;
+
+		float aabbVolume = 0.0f;
+		float ritterVolume = 0.0f;
+		float welzlVolume = 0.0f; // lower bound of every sphere
+		float obbVolume = 0.0f;
+	};
+
+	BoundsFitReport CompareBoundsFitting(const float* positions, uint32_t count, uint32_t stride);
+}
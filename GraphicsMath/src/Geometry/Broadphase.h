@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace GM
+{
+	// overlapping pair reported by a broadphase, proxyA < proxyB
+	struct ProxyPair
+	{
+		uint32_t proxyA;
+		uint32_t proxyB;
+	};
+}
@@ -0,0 +1,159 @@
+#include "ConvexShape.h"
+#include "Math/Functions.h"
+#include "Math/Operators.h"
+
+#include <assert.h>
+#include <math.h>
+
+namespace GM
+{
+	ConvexShape ConvexSphere(const Vector& center, float radius)
+	{
+		ConvexShape res;
+		res.type = ConvexShapeType::Point;
+		res.radius = radius;
+		res.transform.v[3] = Vector(center.x, center.y, center.z, 1.0f);
+		return res;
+	}
+
+	ConvexShape ConvexBox(const Vector& halfExtents, const Matrix& transform)
+	{
+		ConvexShape res;
+		res.type = ConvexShapeType::Box;
+		res.halfExtents = Vector(halfExtents.x, halfExtents.y, halfExtents.z, 0.0f);
+		res.transform = transform;
+		return res;
+	}
+
+	ConvexShape ConvexBox(const AABB& box)
+	{
+		Vector center = 0.5f * (box.min + box.max);
+		return ConvexBox(0.5f * (box.max - box.min), MatTranslate(center.x, center.y, center.z));
+	}
+
+	ConvexShape ConvexBox(const OBB& box)
+	{
+		Matrix transform(
+			Vector(box.axes[0].x, box.axes[0].y, box.axes[0].z, 0.0f),
+			Vector(box.axes[1].x, box.axes[1].y, box.axes[1].z, 0.0f),
+			Vector(box.axes[2].x, box.axes[2].y, box.axes[2].z, 0.0f),
+			Vector(box.center.x, box.center.y, box.center.z, 1.0f));
+		return ConvexBox(box.extents, transform);
+	}
+
+	// segment of length 2 * halfHeight along the local y axis, capped by hemispheres
+	ConvexShape ConvexCapsule(float halfHeight, float radius, const Matrix& transform)
+	{
+		ConvexShape res;
+		res.type = ConvexShapeType::Segment;
+		res.halfExtents = Vector(0.0f, halfHeight, 0.0f, 0.0f);
+		res.radius = radius;
+		res.transform = transform;
+		return res;
+	}
+
+	// the points are referenced, not copied. Interior points are allowed but cost support time
+	ConvexShape ConvexHull(const Vector* points, uint32_t count, const Matrix& transform)
+	{
+		assert(points && count > 0 && "a hull needs at least one point");
+
+		ConvexShape res;
+		res.type = ConvexShapeType::Hull;
+		res.points = points;
+		res.pointCount = count;
+		res.transform = transform;
+		return res;
+	}
+
+	// applies transform after the current transform of the shape
+	ConvexShape ConvexShapeTransform(const ConvexShape& shape, const Matrix& transform)
+	{
+		ConvexShape res = shape;
+		res.transform = shape.transform * transform;
+		return res;
+	}
+
+	ConvexShape ConvexShapeTransform(const ConvexShape& shape, const Quaternion& rotation, const Vector& translation)
+	{
+		Matrix transform = MatRotationQuaternion(rotation);
+		transform.v[3] = Vector(translation.x, translation.y, translation.z, 1.0f);
+		return ConvexShapeTransform(shape, transform);
+	}
+
+	// farthest core point along dir, in local and world space. dir does not need to be normalized
+	void ConvexShapeSupportCore(const ConvexShape& shape, const Vector& dir, Vector& local, Vector& world)
+	{
+		// the world support of local * M is the local support along M * dir
+		const Matrix& m = shape.transform;
+		float dx = m.f[0][0] * dir.x + m.f[0][1] * dir.y + m.f[0][2] * dir.z;
+		float dy = m.f[1][0] * dir.x + m.f[1][1] * dir.y + m.f[1][2] * dir.z;
+		float dz = m.f[2][0] * dir.x + m.f[2][1] * dir.y + m.f[2][2] * dir.z;
+
+		switch (shape.type)
+		{
+		case ConvexShapeType::Point:
+			local = Vector(0.0f, 0.0f, 0.0f, 1.0f);
+			break;
+
+		case ConvexShapeType::Segment:
+			local = Vector(0.0f, dy >= 0.0f ? shape.halfExtents.y : -shape.halfExtents.y, 0.0f, 1.0f);
+			break;
+
+		case ConvexShapeType::Box:
+			local = Vector(
+				dx >= 0.0f ? shape.halfExtents.x : -shape.halfExtents.x,
+				dy >= 0.0f ? shape.halfExtents.y : -shape.halfExtents.y,
+				dz >= 0.0f ? shape.halfExtents.z : -shape.halfExtents.z,
+				1.0f);
+			break;
+
+		case ConvexShapeType::Hull:
+		{
+			uint32_t best = 0;
+			float bestDot = shape.points[0].x * dx + shape.points[0].y * dy + shape.points[0].z * dz;
+			for (uint32_t i = 1; i < shape.pointCount; i++)
+			{
+				float d = shape.points[i].x * dx + shape.points[i].y * dy + shape.points[i].z * dz;
+				if (d > bestDot)
+				{
+					bestDot = d;
+					best = i;
+				}
+			}
+			local = Vector(shape.points[best].x, shape.points[best].y, shape.points[best].z, 1.0f);
+			break;
+		}
+		}
+
+		world = ConvexShapeToWorld(shape, local);
+	}
+
+	// farthest point of the shape (core and radius) along dir, in world space
+	Vector ConvexShapeSupport(const ConvexShape& shape, const Vector& dir)
+	{
+		Vector local, world;
+		ConvexShapeSupportCore(shape, dir, local, world);
+		if (shape.radius > 0.0f)
+		{
+			float length = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+			if (length > 0.0f)
+			{
+				float s = shape.radius / length;
+				world = Vector(world.x + dir.x * s, world.y + dir.y * s, world.z + dir.z * s, 1.0f);
+			}
+		}
+
+		return world;
+	}
+
+	// local core point to world space
+	Vector ConvexShapeToWorld(const ConvexShape& shape, const Vector& local)
+	{
+		const Matrix& m = shape.transform;
+		return Vector(
+			local.x * m.f[0][0] + local.y * m.f[1][0] + local.z * m.f[2][0] + m.f[3][0],
+			local.x * m.f[0][1] + local.y * m.f[1][1] + local.z * m.f[2][1] + m.f[3][1],
+			local.x * m.f[0][2] + local.y * m.f[1][2] + local.z * m.f[2][2] + m.f[3][2],
+			1.0f);
+	}
+}
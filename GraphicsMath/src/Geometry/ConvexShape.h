@@ -0,0 +1,68 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	enum class ConvexShapeType
+	{
+		Point,
+		Segment, // along local y, from -halfExtents.y to +halfExtents.y
+		Box,
+		Hull
+	};
+
+	/// <summary>
+	/// Convex shape given by its support function: a core (point, segment, box or point cloud) in local space,
+	/// mapped to world space by transform, plus a radius around the core in world units.
+	/// A sphere is a point with a radius, a capsule a segment with a radius.
+	/// transform is a row-major local to world matrix (row vector * matrix). Any linear part works,
+	/// scale and shear apply to the core but not to the radius.
+	/// </summary>
+	struct ConvexShape
+	{
+		ConvexShapeType type;
+		Vector halfExtents;
+		float radius;
+		const Vector* points;  // Hull, not owned
+		uint32_t pointCount;
+		Matrix transform;
+
+		ConvexShape()
+			: type(ConvexShapeType::Point), halfExtents(0.0f, 0.0f, 0.0f, 0.0f), radius(0.0f),
+			points(nullptr), pointCount(0),
+			transform(
+				1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f)
+		{
+		}
+	};
+
+	ConvexShape ConvexSphere(const Vector& center, float radius);
+	ConvexShape ConvexBox(const Vector& halfExtents, const Matrix& transform);
+	ConvexShape ConvexBox(const AABB& box);
+	ConvexShape ConvexBox(const OBB& box);
+
+	// segment of length 2 * halfHeight along the local y axis, capped by hemispheres
+	ConvexShape ConvexCapsule(float halfHeight, float radius, const Matrix& transform);
+
+	// the points are referenced, not copied. Interior points are allowed but cost support time
+	ConvexShape ConvexHull(const Vector* points, uint32_t count, const Matrix& transform);
+
+	// applies transform after the current transform of the shape
+	ConvexShape ConvexShapeTransform(const ConvexShape& shape, const Matrix& transform);
+	ConvexShape ConvexShapeTransform(const ConvexShape& shape, const Quaternion& rotation, const Vector& translation);
+
+	// farthest core point along dir, in local and world space. dir does not need to be normalized
+	void ConvexShapeSupportCore(const ConvexShape& shape, const Vector& dir, Vector& local, Vector& world);
+
+	// farthest point of the shape (core and radius) along dir, in world space
+	Vector ConvexShapeSupport(const ConvexShape& shape, const Vector& dir);
+
+	// local core point to world space
+	Vector ConvexShapeToWorld(const ConvexShape& shape, const Vector& local);
+}
@@ -0,0 +1,521 @@
+#include "DynamicAABBTree.h"
+#include "Intersection.h"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_stackSize = 1024;
+		constexpr uint32_t s_nullNode = DynamicAABBTree::NullProxy;
+
+		// the proxy box grown by the margin and stretched along the predicted motion
+		AABB FatBox(const AABB& box, const Vector& displacement, const DynamicAABBTreeDesc& desc)
+		{
+			AABB res = box;
+			for (int i = 0; i < 3; i++)
+			{
+				res.min[i] -= desc.fatMargin;
+				res.max[i] += desc.fatMargin;
+
+				float d = displacement[i] * desc.displacementMultiplier;
+				if (d < 0.0f)
+					res.min[i] += d;
+				else
+					res.max[i] += d;
+			}
+
+			return res;
+		}
+
+		float UnionArea(const AABB& b0, const AABB& b1)
+		{
+			return AABBSurfaceArea(AABBUnion(b0, b1));
+		}
+	}
+
+	DynamicAABBTree::DynamicAABBTree()
+		: DynamicAABBTree(DynamicAABBTreeDesc())
+	{
+	}
+
+	DynamicAABBTree::DynamicAABBTree(const DynamicAABBTreeDesc& desc)
+		: m_desc(desc), m_root(s_nullNode), m_freeList(s_nullNode), m_proxyCount(0)
+	{
+	}
+
+	// preallocates nodes for proxyCount proxies
+	void DynamicAABBTree::Reserve(uint32_t proxyCount)
+	{
+		// a tree of n leaves has n - 1 inner nodes
+		m_nodes.reserve(2 * static_cast<size_t>(proxyCount));
+		m_moveBuffer.reserve(proxyCount);
+	}
+
+	void DynamicAABBTree::Clear()
+	{
+		m_nodes.clear();
+		m_moveBuffer.clear();
+		m_root = s_nullNode;
+		m_freeList = s_nullNode;
+		m_proxyCount = 0;
+	}
+
+	uint32_t DynamicAABBTree::CreateProxy(const AABB& box, uint32_t userData)
+	{
+		uint32_t proxy = AllocateNode();
+		Node& node = m_nodes[proxy];
+		node.box = FatBox(box, Vector(0.0f, 0.0f, 0.0f, 0.0f), m_desc);
+		node.userData = userData;
+		node.height = 0;
+		node.moved = true;
+
+		InsertLeaf(proxy);
+		m_moveBuffer.push_back(proxy);
+		m_proxyCount++;
+		return proxy;
+	}
+
+	void DynamicAABBTree::DestroyProxy(uint32_t proxy)
+	{
+		assert(proxy < m_nodes.size() && m_nodes[proxy].height == 0 && "invalid proxy");
+
+		if (m_nodes[proxy].moved)
+		{
+			auto it = std::find(m_moveBuffer.begin(), m_moveBuffer.end(), proxy);
+			if (it != m_moveBuffer.end())
+				*it = s_nullNode;
+		}
+
+		RemoveLeaf(proxy);
+		FreeNode(proxy);
+		m_proxyCount--;
+	}
+
+	bool DynamicAABBTree::MoveProxy(uint32_t proxy, const AABB& box, const Vector& displacement)
+	{
+		assert(proxy < m_nodes.size() && m_nodes[proxy].height == 0 && "invalid proxy");
+
+		Node& node = m_nodes[proxy];
+		AABB fat = FatBox(box, displacement, m_desc);
+		if (AABBContains(node.box, box))
+		{
+			// keep the fat box unless it became much larger than needed (the object slowed down)
+			AABB loose = fat;
+			for (int i = 0; i < 3; i++)
+			{
+				loose.min[i] -= 4.0f * m_desc.fatMargin;
+				loose.max[i] += 4.0f * m_desc.fatMargin;
+			}
+
+			if (AABBContains(loose, node.box))
+				return false;
+		}
+
+		RemoveLeaf(proxy);
+		m_nodes[proxy].box = fat;
+		InsertLeaf(proxy);
+
+		if (!m_nodes[proxy].moved)
+		{
+			m_nodes[proxy].moved = true;
+			m_moveBuffer.push_back(proxy);
+		}
+
+		return true;
+	}
+
+	uint32_t DynamicAABBTree::GetUserData(uint32_t proxy) const
+	{
+		assert(proxy < m_nodes.size() && m_nodes[proxy].height == 0 && "invalid proxy");
+		return m_nodes[proxy].userData;
+	}
+
+	const AABB& DynamicAABBTree::GetFatAABB(uint32_t proxy) const
+	{
+		assert(proxy < m_nodes.size() && m_nodes[proxy].height == 0 && "invalid proxy");
+		return m_nodes[proxy].box;
+	}
+
+	void DynamicAABBTree::FindPairs(std::vector<ProxyPair>& pairs)
+	{
+		pairs.clear();
+
+		std::vector<uint32_t> overlaps;
+		for (uint32_t proxy : m_moveBuffer)
+		{
+			if (proxy == s_nullNode)
+				continue;
+
+			overlaps.clear();
+			Query(m_nodes[proxy].box, overlaps);
+			for (uint32_t other : overlaps)
+			{
+				// when both moved the pair is reported by the larger proxy only
+				if (other == proxy || (m_nodes[other].moved && other > proxy))
+					continue;
+
+				pairs.push_back({ std::min(proxy, other), std::max(proxy, other) });
+			}
+		}
+
+		for (uint32_t proxy : m_moveBuffer)
+		{
+			if (proxy != s_nullNode)
+				m_nodes[proxy].moved = false;
+		}
+		m_moveBuffer.clear();
+
+		std::sort(pairs.begin(), pairs.end(), [](const ProxyPair& p0, const ProxyPair& p1)
+			{
+				return p0.proxyA != p1.proxyA ? p0.proxyA < p1.proxyA : p0.proxyB < p1.proxyB;
+			});
+	}
+
+	// every overlapping pair of fat boxes, sorted
+	void DynamicAABBTree::FindAllPairs(std::vector<ProxyPair>& pairs) const
+	{
+		pairs.clear();
+
+		std::vector<uint32_t> overlaps;
+		for (uint32_t proxy = 0; proxy < static_cast<uint32_t>(m_nodes.size()); proxy++)
+		{
+			if (m_nodes[proxy].height != 0)
+				continue;
+
+			overlaps.clear();
+			Query(m_nodes[proxy].box, overlaps);
+			std::sort(overlaps.begin(), overlaps.end());
+			for (uint32_t other : overlaps)
+			{
+				if (other > proxy)
+					pairs.push_back({ proxy, other });
+			}
+		}
+	}
+
+	// appends the proxies whose fat box overlaps the region
+	void DynamicAABBTree::Query(const AABB& region, std::vector<uint32_t>& proxies) const
+	{
+		if (m_root == s_nullNode)
+			return;
+
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = m_root;
+		while (stackSize > 0)
+		{
+			const Node& node = m_nodes[stack[--stackSize]];
+			if (!AABBOverlaps(node.box, region))
+				continue;
+
+			if (node.IsLeaf())
+			{
+				proxies.push_back(static_cast<uint32_t>(&node - m_nodes.data()));
+				continue;
+			}
+
+			assert(stackSize + 2 <= s_stackSize && "tree is too deep for the query stack");
+			stack[stackSize++] = node.child1;
+			stack[stackSize++] = node.child2;
+		}
+	}
+
+	void DynamicAABBTree::Query(const Sphere& region, std::vector<uint32_t>& proxies) const
+	{
+		if (m_root == s_nullNode)
+			return;
+
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = m_root;
+		while (stackSize > 0)
+		{
+			const Node& node = m_nodes[stack[--stackSize]];
+			if (!OverlapSphereAABB(region, node.box))
+				continue;
+
+			if (node.IsLeaf())
+			{
+				proxies.push_back(static_cast<uint32_t>(&node - m_nodes.data()));
+				continue;
+			}
+
+			assert(stackSize + 2 <= s_stackSize && "tree is too deep for the query stack");
+			stack[stackSize++] = node.child1;
+			stack[stackSize++] = node.child2;
+		}
+	}
+
+	void DynamicAABBTree::RayCast(const Ray& ray, const std::function<float(uint32_t proxy, const Ray& ray)>& callback) const
+	{
+		if (m_root == s_nullNode)
+			return;
+
+		Ray clipped = ray;
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = m_root;
+		while (stackSize > 0)
+		{
+			uint32_t index = stack[--stackSize];
+			const Node& node = m_nodes[index];
+
+			float t;
+			if (!IntersectRayAABB(clipped, node.box, t))
+				continue;
+
+			if (node.IsLeaf())
+			{
+				float tMax = callback(index, clipped);
+				if (tMax < 0.0f)
+					return;
+
+				clipped.tMax = std::min(clipped.tMax, tMax);
+				continue;
+			}
+
+			assert(stackSize + 2 <= s_stackSize && "tree is too deep for the query stack");
+			stack[stackSize++] = node.child1;
+			stack[stackSize++] = node.child2;
+		}
+	}
+
+	uint32_t DynamicAABBTree::GetProxyCount() const
+	{
+		return m_proxyCount;
+	}
+
+	uint32_t DynamicAABBTree::GetHeight() const
+	{
+		return m_root == s_nullNode ? 0 : static_cast<uint32_t>(m_nodes[m_root].height);
+	}
+
+	// sum of the inner node surface areas / root surface area
+	float DynamicAABBTree::ComputeAreaRatio() const
+	{
+		if (m_root == s_nullNode)
+			return 0.0f;
+
+		float rootArea = AABBSurfaceArea(m_nodes[m_root].box);
+		if (rootArea <= 0.0f)
+			return 0.0f;
+
+		float total = 0.0f;
+		for (const Node& node : m_nodes)
+		{
+			if (node.height > 0)
+				total += AABBSurfaceArea(node.box);
+		}
+
+		return total / rootArea;
+	}
+
+	uint32_t DynamicAABBTree::AllocateNode()
+	{
+		uint32_t index;
+		if (m_freeList != s_nullNode)
+		{
+			index = m_freeList;
+			m_freeList = m_nodes[index].parent;
+		}
+		else
+		{
+			index = static_cast<uint32_t>(m_nodes.size());
+			m_nodes.emplace_back();
+		}
+
+		Node& node = m_nodes[index];
+		node.parent = s_nullNode;
+		node.child1 = s_nullNode;
+		node.child2 = s_nullNode;
+		node.userData = 0;
+		node.height = 0;
+		node.moved = false;
+		return index;
+	}
+
+	void DynamicAABBTree::FreeNode(uint32_t node)
+	{
+		m_nodes[node].parent = m_freeList;
+		m_nodes[node].height = -1;
+		m_freeList = node;
+	}
+
+	void DynamicAABBTree::InsertLeaf(uint32_t leaf)
+	{
+		if (m_root == s_nullNode)
+		{
+			m_root = leaf;
+			m_nodes[leaf].parent = s_nullNode;
+			return;
+		}
+
+		uint32_t sibling = FindBestSibling(m_nodes[leaf].box);
+
+		// the new parent takes the place of the sibling
+		uint32_t oldParent = m_nodes[sibling].parent;
+		uint32_t newParent = AllocateNode();
+		Node& parent = m_nodes[newParent];
+		parent.parent = oldParent;
+		parent.child1 = sibling;
+		parent.child2 = leaf;
+		parent.box = AABBUnion(m_nodes[leaf].box, m_nodes[sibling].box);
+		parent.height = m_nodes[sibling].height + 1;
+
+		if (oldParent == s_nullNode)
+			m_root = newParent;
+		else if (m_nodes[oldParent].child1 == sibling)
+			m_nodes[oldParent].child1 = newParent;
+		else
+			m_nodes[oldParent].child2 = newParent;
+
+		m_nodes[sibling].parent = newParent;
+		m_nodes[leaf].parent = newParent;
+
+		RefitAncestors(oldParent);
+	}
+
+	void DynamicAABBTree::RemoveLeaf(uint32_t leaf)
+	{
+		if (leaf == m_root)
+		{
+			m_root = s_nullNode;
+			return;
+		}
+
+		uint32_t parent = m_nodes[leaf].parent;
+		uint32_t grandParent = m_nodes[parent].parent;
+		uint32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+		// the sibling takes the place of the parent
+		m_nodes[sibling].parent = grandParent;
+		if (grandParent == s_nullNode)
+			m_root = sibling;
+		else if (m_nodes[grandParent].child1 == parent)
+			m_nodes[grandParent].child1 = sibling;
+		else
+			m_nodes[grandParent].child2 = sibling;
+
+		FreeNode(parent);
+		RefitAncestors(grandParent);
+	}
+
+	uint32_t DynamicAABBTree::FindBestSibling(const AABB& box) const
+	{
+		// descends towards the cheapest child while that is cheaper than making the current node the sibling.
+		// Pairing with a node costs the area of the new parent, every ancestor grows by the inherited cost.
+		uint32_t index = m_root;
+		while (!m_nodes[index].IsLeaf())
+		{
+			const Node& node = m_nodes[index];
+			float area = AABBSurfaceArea(node.box);
+			float combinedArea = UnionArea(node.box, box);
+
+			float cost = 2.0f * combinedArea;
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			float childCost[2];
+			uint32_t children[2] = { node.child1, node.child2 };
+			for (int i = 0; i < 2; i++)
+			{
+				const Node& child = m_nodes[children[i]];
+				childCost[i] = UnionArea(child.box, box) + inheritanceCost;
+				if (!child.IsLeaf())
+					childCost[i] -= AABBSurfaceArea(child.box);
+			}
+
+			if (cost < childCost[0] && cost < childCost[1])
+				break;
+
+			index = childCost[0] <= childCost[1] ? children[0] : children[1];
+		}
+
+		return index;
+	}
+
+	// refits and rotates from node up to the root
+	void DynamicAABBTree::RefitAncestors(uint32_t node)
+	{
+		while (node != s_nullNode)
+		{
+			Node& n = m_nodes[node];
+			const Node& c1 = m_nodes[n.child1];
+			const Node& c2 = m_nodes[n.child2];
+			n.box = AABBUnion(c1.box, c2.box);
+			n.height = 1 + std::max(c1.height, c2.height);
+
+			Rotate(node);
+			node = m_nodes[node].parent;
+		}
+	}
+
+	void DynamicAABBTree::Rotate(uint32_t node)
+	{
+		// swaps a child of node with a grandchild under the other child when that lowers the area of the other child,
+		// e.g. node(b, c(f, g)) -> node(f, c(b, g)). The box of node is unchanged since it keeps the same leaves.
+		Node& n = m_nodes[node];
+		if (n.height < 2)
+			return;
+
+		uint32_t b = n.child1;
+		uint32_t c = n.child2;
+
+		float bestCost = 0.0f;
+		uint32_t bestChild = s_nullNode;      // child of node moved down
+		uint32_t bestGrandChild = s_nullNode; // grandchild moved up
+
+		auto consider = [&](uint32_t child, uint32_t other)
+			{
+				const Node& o = m_nodes[other];
+				if (o.IsLeaf())
+					return;
+
+				float area = AABBSurfaceArea(o.box);
+				const AABB& childBox = m_nodes[child].box;
+
+				// child <-> o.child1 leaves o with (child, o.child2) and the other way around
+				float cost1 = UnionArea(childBox, m_nodes[o.child2].box) - area;
+				float cost2 = UnionArea(childBox, m_nodes[o.child1].box) - area;
+				if (cost1 < bestCost)
+				{
+					bestCost = cost1;
+					bestChild = child;
+					bestGrandChild = o.child1;
+				}
+				if (cost2 < bestCost)
+				{
+					bestCost = cost2;
+					bestChild = child;
+					bestGrandChild = o.child2;
+				}
+			};
+
+		consider(b, c);
+		consider(c, b);
+		if (bestChild == s_nullNode)
+			return;
+
+		uint32_t other = bestChild == b ? c : b;
+		Node& o = m_nodes[other];
+
+		if (n.child1 == bestChild)
+			n.child1 = bestGrandChild;
+		else
+			n.child2 = bestGrandChild;
+
+		if (o.child1 == bestGrandChild)
+			o.child1 = bestChild;
+		else
+			o.child2 = bestChild;
+
+		m_nodes[bestGrandChild].parent = node;
+		m_nodes[bestChild].parent = other;
+
+		o.box = AABBUnion(m_nodes[o.child1].box, m_nodes[o.child2].box);
+		o.height = 1 + std::max(m_nodes[o.child1].height, m_nodes[o.child2].height);
+		n.height = 1 + std::max(m_nodes[n.child1].height, m_nodes[n.child2].height);
+	}
+}
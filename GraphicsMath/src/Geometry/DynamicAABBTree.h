@@ -0,0 +1,109 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "Broadphase.h"
+#include "Ray.h"
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	struct DynamicAABBTreeDesc
+	{
+		float fatMargin = 0.1f;            // added on every side of a proxy box
+		float displacementMultiplier = 4.0f; // fat boxes are also stretched along displacement * multiplier
+	};
+
+	/// <summary>
+	/// Broadphase over moving boxes. Leaves store fat boxes (the box grown by a margin and the predicted motion),
+	/// so a move that stays inside its fat box does not touch the tree.
+	/// Leaves are inserted next to the sibling of least surface area cost and tree rotations
+	/// keep the inner node areas low. Nodes live in a pool that only grows, proxies are indices into it.
+	/// </summary>
+	class DynamicAABBTree
+	{
+	public:
+		static constexpr uint32_t NullProxy = UINT32_MAX;
+
+		DynamicAABBTree();
+		DynamicAABBTree(const DynamicAABBTreeDesc& desc);
+
+		// preallocates nodes for proxyCount proxies
+		void Reserve(uint32_t proxyCount);
+		void Clear();
+
+		uint32_t CreateProxy(const AABB& box, uint32_t userData);
+		void DestroyProxy(uint32_t proxy);
+
+		/// <summary>
+		/// Returns false in O(1) when box is still inside the fat box of the proxy, otherwise the proxy is
+		/// reinserted with a new fat box and reported by the next FindPairs().
+		/// </summary>
+		bool MoveProxy(uint32_t proxy, const AABB& box, const Vector& displacement);
+
+		uint32_t GetUserData(uint32_t proxy) const;
+		const AABB& GetFatAABB(uint32_t proxy) const;
+
+		/// <summary>
+		/// Pairs between the proxies created or reinserted since the last call and every other proxy,
+		/// sorted and without duplicates. Clears the moved set.
+		/// </summary>
+		void FindPairs(std::vector<ProxyPair>& pairs);
+
+		// every overlapping pair of fat boxes, sorted
+		void FindAllPairs(std::vector<ProxyPair>& pairs) const;
+
+		// appends the proxies whose fat box overlaps the region
+		void Query(const AABB& region, std::vector<uint32_t>& proxies) const;
+		void Query(const Sphere& region, std::vector<uint32_t>& proxies) const;
+
+		/// <summary>
+		/// Calls callback for every proxy whose fat box the ray hits, nearest boxes are not guaranteed first.
+		/// The callback returns the new ray tMax (ray.tMax to continue unchanged, the hit distance to clip)
+		/// or a negative value to stop the query.
+		/// </summary>
+		void RayCast(const Ray& ray, const std::function<float(uint32_t proxy, const Ray& ray)>& callback) const;
+
+		uint32_t GetProxyCount() const;
+		uint32_t GetHeight() const;
+
+		// sum of the inner node surface areas / root surface area
+		float ComputeAreaRatio() const;
+
+	private:
+		struct Node
+		{
+			AABB box;
+			uint32_t parent;   // next free node while the node is in the free list
+			uint32_t child1;   // NullProxy for leaves
+			uint32_t child2;
+			uint32_t userData;
+			int32_t height;    // 0 for leaves, -1 for free nodes
+			bool moved;
+
+			bool IsLeaf() const { return child1 == NullProxy; }
+		};
+
+		uint32_t AllocateNode();
+		void FreeNode(uint32_t node);
+
+		void InsertLeaf(uint32_t leaf);
+		void RemoveLeaf(uint32_t leaf);
+		uint32_t FindBestSibling(const AABB& box) const;
+
+		// refits and rotates from node up to the root
+		void RefitAncestors(uint32_t node);
+		void Rotate(uint32_t node);
+
+		DynamicAABBTreeDesc m_desc;
+
+		std::vector<Node> m_nodes;
+		uint32_t m_root;
+		uint32_t m_freeList;
+		uint32_t m_proxyCount;
+
+		std::vector<uint32_t> m_moveBuffer;
+	};
+}
@@ -0,0 +1,698 @@
+#include "GJK.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_maxIterations = 64;
+		constexpr uint32_t s_epaMaxIterations = 64;
+		constexpr uint32_t s_epaMaxVertices = 4 + s_epaMaxIterations;
+		constexpr uint32_t s_epaMaxFaces = 4 + 2 * s_epaMaxIterations + 64;
+		constexpr uint32_t s_epaMaxEdges = 64;
+		constexpr uint32_t s_parallelThreshold = 64;
+
+		// closer than this relative to the squared size of the simplex the cores are treated as touching and EPA
+		// decides the sign, float precision cannot tell which side of a face the origin is on
+		constexpr float s_overlapTolerance = 1e-8f;
+		constexpr float s_convergenceTolerance = 1e-6f;
+		constexpr float s_precisionTolerance = 1e-6f;
+		constexpr float s_epaTolerance = 1e-4f;
+
+		Vector Add3(const Vector& a, const Vector& b) { return Vector(a.x + b.x, a.y + b.y, a.z + b.z, 0.0f); }
+		Vector Sub3(const Vector& a, const Vector& b) { return Vector(a.x - b.x, a.y - b.y, a.z - b.z, 0.0f); }
+		Vector Mul3(const Vector& a, float s) { return Vector(a.x * s, a.y * s, a.z * s, 0.0f); }
+		float Dot3(const Vector& a, const Vector& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+		Vector Cross3(const Vector& a, const Vector& b) { return Vector(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x, 0.0f); }
+
+		struct SimplexVertex
+		{
+			Vector w;      // a - b
+			Vector a;      // world core points
+			Vector b;
+			Vector localA;
+			Vector localB;
+		};
+
+		struct Simplex
+		{
+			SimplexVertex v[4];
+			float lambda[4];
+			uint32_t count;
+		};
+
+		SimplexVertex Support(const ConvexShape& a, const ConvexShape& b, const Vector& dir)
+		{
+			SimplexVertex res;
+			ConvexShapeSupportCore(a, dir, res.localA, res.a);
+			ConvexShapeSupportCore(b, Vector(-dir.x, -dir.y, -dir.z, 0.0f), res.localB, res.b);
+			res.w = Sub3(res.a, res.b);
+			return res;
+		}
+
+		// ====== closest point of the simplex to the origin ======
+		// every solver keeps the vertices of the feature the closest point lies on, with its barycentric weights
+
+		void KeepVertices(Simplex& s, uint32_t i0, uint32_t i1, uint32_t i2, uint32_t count, float l0, float l1, float l2)
+		{
+			SimplexVertex v0 = s.v[i0], v1 = s.v[i1], v2 = s.v[i2];
+			s.v[0] = v0;
+			s.v[1] = v1;
+			s.v[2] = v2;
+			s.lambda[0] = l0;
+			s.lambda[1] = l1;
+			s.lambda[2] = l2;
+			s.count = count;
+		}
+
+		void SolveSegment(Simplex& s, uint32_t i0, uint32_t i1)
+		{
+			const Vector& a = s.v[i0].w;
+			Vector ab = Sub3(s.v[i1].w, a);
+			float lengthSq = Dot3(ab, ab);
+			float t = lengthSq > 0.0f ? -Dot3(a, ab) / lengthSq : 0.0f;
+			if (t <= 0.0f)
+				KeepVertices(s, i0, i0, i0, 1, 1.0f, 0.0f, 0.0f);
+			else if (t >= 1.0f)
+				KeepVertices(s, i1, i1, i1, 1, 1.0f, 0.0f, 0.0f);
+			else
+				KeepVertices(s, i0, i1, i1, 2, 1.0f - t, t, 0.0f);
+		}
+
+		Vector ClosestPoint(const Simplex& s)
+		{
+			Vector res(0.0f, 0.0f, 0.0f, 0.0f);
+			for (uint32_t i = 0; i < s.count; i++)
+				res = Add3(res, Mul3(s.v[i].w, s.lambda[i]));
+			return res;
+		}
+
+		// Voronoi regions of the triangle, see Ericson, Real-Time Collision Detection 5.1.5
+		void SolveTriangle(Simplex& s, uint32_t i0, uint32_t i1, uint32_t i2)
+		{
+			const Vector& a = s.v[i0].w;
+			const Vector& b = s.v[i1].w;
+			const Vector& c = s.v[i2].w;
+			Vector ab = Sub3(b, a);
+			Vector ac = Sub3(c, a);
+
+			float d1 = -Dot3(ab, a);
+			float d2 = -Dot3(ac, a);
+			if (d1 <= 0.0f && d2 <= 0.0f)
+				return KeepVertices(s, i0, i0, i0, 1, 1.0f, 0.0f, 0.0f);
+
+			float d3 = -Dot3(ab, b);
+			float d4 = -Dot3(ac, b);
+			if (d3 >= 0.0f && d4 <= d3)
+				return KeepVertices(s, i1, i1, i1, 1, 1.0f, 0.0f, 0.0f);
+
+			float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			{
+				float t = d1 / (d1 - d3);
+				return KeepVertices(s, i0, i1, i1, 2, 1.0f - t, t, 0.0f);
+			}
+
+			float d5 = -Dot3(ab, c);
+			float d6 = -Dot3(ac, c);
+			if (d6 >= 0.0f && d5 <= d6)
+				return KeepVertices(s, i2, i2, i2, 1, 1.0f, 0.0f, 0.0f);
+
+			float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			{
+				float t = d2 / (d2 - d6);
+				return KeepVertices(s, i0, i2, i2, 2, 1.0f - t, t, 0.0f);
+			}
+
+			float va = d3 * d6 - d5 * d4;
+			if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			{
+				float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+				return KeepVertices(s, i1, i2, i2, 2, 1.0f - t, t, 0.0f);
+			}
+
+			float sum = va + vb + vc;
+			if (sum <= 0.0f)
+			{
+				// degenerate triangle, the closest of its edges
+				Simplex best = s;
+				SolveSegment(best, i0, i1);
+				float bestSq = Dot3(ClosestPoint(best), ClosestPoint(best));
+				const uint32_t edges[2][2] = { { i0, i2 }, { i1, i2 } };
+				for (const auto& e : edges)
+				{
+					Simplex edge = s;
+					SolveSegment(edge, e[0], e[1]);
+					Vector p = ClosestPoint(edge);
+					if (Dot3(p, p) < bestSq)
+					{
+						bestSq = Dot3(p, p);
+						best = edge;
+					}
+				}
+				s = best;
+				return;
+			}
+
+			float v = vb / sum;
+			float w = vc / sum;
+			KeepVertices(s, i0, i1, i2, 3, 1.0f - v - w, v, w);
+		}
+
+		// false when the origin is inside the tetrahedron
+		bool SolveTetrahedron(Simplex& s)
+		{
+			const uint32_t faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+
+			Simplex best;
+			float bestSq = 3.402823466e+38f;
+			bool outside = false;
+			for (const auto& f : faces)
+			{
+				// the origin and the fourth vertex on opposite sides of the face plane, or a flat tetrahedron
+				const Vector& a = s.v[f[0]].w;
+				Vector n = Cross3(Sub3(s.v[f[1]].w, a), Sub3(s.v[f[2]].w, a));
+				float signOrigin = -Dot3(n, a);
+				float signOpposite = Dot3(n, Sub3(s.v[f[3]].w, a));
+				if (signOrigin * signOpposite > 0.0f)
+					continue;
+
+				outside = true;
+				Simplex face = s;
+				SolveTriangle(face, f[0], f[1], f[2]);
+				Vector p = ClosestPoint(face);
+				if (Dot3(p, p) < bestSq)
+				{
+					bestSq = Dot3(p, p);
+					best = face;
+				}
+			}
+
+			if (!outside)
+				return false;
+
+			s = best;
+			return true;
+		}
+
+		// reduces the simplex to the feature closest to the origin. False when the origin is inside
+		bool Solve(Simplex& s)
+		{
+			switch (s.count)
+			{
+			case 1:
+				s.lambda[0] = 1.0f;
+				return true;
+			case 2:
+				SolveSegment(s, 0, 1);
+				return true;
+			case 3:
+				SolveTriangle(s, 0, 1, 2);
+				return true;
+			default:
+				return SolveTetrahedron(s);
+			}
+		}
+
+		enum class GJKMode
+		{
+			Distance,
+			Overlap  // stops at the first plane separating the shapes including their radii
+		};
+
+		struct GJKOutput
+		{
+			Simplex simplex;
+			Vector closest;        // closest point of the core difference to the origin
+			bool coresOverlap;
+			bool separated;        // Overlap mode only
+			uint32_t iterations;
+		};
+
+		GJKOutput RunGJK(const ConvexShape& a, const ConvexShape& b, const GJKCache* cache, GJKMode mode)
+		{
+			GJKOutput out;
+			Simplex& s = out.simplex;
+			out.coresOverlap = false;
+			out.separated = false;
+			out.iterations = 0;
+
+			if (cache && cache->count > 0)
+			{
+				// the cached local points in the current placement of the shapes
+				s.count = cache->count;
+				for (uint32_t i = 0; i < s.count; i++)
+				{
+					SimplexVertex& v = s.v[i];
+					v.localA = cache->localA[i];
+					v.localB = cache->localB[i];
+					v.a = ConvexShapeToWorld(a, v.localA);
+					v.b = ConvexShapeToWorld(b, v.localB);
+					v.w = Sub3(v.a, v.b);
+				}
+			}
+			else
+			{
+				Vector dir = Sub3(b.transform.v[3], a.transform.v[3]);
+				if (Dot3(dir, dir) == 0.0f)
+					dir = Vector(1.0f, 0.0f, 0.0f, 0.0f);
+				s.v[0] = Support(a, b, dir);
+				s.count = 1;
+			}
+
+			float radius = a.radius + b.radius;
+			float previousVV = 3.402823466e+38f;
+			Simplex previousSimplex;
+			for (;;)
+			{
+				out.iterations++;
+
+				// vertices before the reduction, a support point equal to a dropped vertex means the
+				// reduction cycles between features
+				Vector previous[4];
+				uint32_t previousCount = s.count;
+				float sizeSq = 0.0f;
+				for (uint32_t i = 0; i < s.count; i++)
+				{
+					previous[i] = s.v[i].w;
+					sizeSq = fmaxf(sizeSq, Dot3(s.v[i].w, s.v[i].w));
+				}
+
+				if (!Solve(s))
+				{
+					out.coresOverlap = true;
+					out.closest = Vector(0.0f, 0.0f, 0.0f, 0.0f);
+					break;
+				}
+
+				Vector v = ClosestPoint(s);
+				out.closest = v;
+				float vv = Dot3(v, v);
+				if (vv <= s_overlapTolerance * sizeSq)
+				{
+					out.coresOverlap = true;
+					break;
+				}
+
+				if (mode == GJKMode::Overlap && vv <= radius * radius)
+					break;
+
+				// no progress, the distance is at float precision and the last step only added noise
+				if (vv >= previousVV)
+				{
+					s = previousSimplex;
+					out.closest = ClosestPoint(s);
+					break;
+				}
+
+				if (out.iterations >= s_maxIterations)
+					break;
+				previousVV = vv;
+				previousSimplex = s;
+
+				SimplexVertex w = Support(a, b, Vector(-v.x, -v.y, -v.z, 0.0f));
+
+				// every point of the difference is at least vw / |v| along v, a lower bound of the distance
+				float vw = Dot3(v, w.w);
+				if (mode == GJKMode::Overlap && vw > 0.0f && vw * vw > vv * radius * radius)
+				{
+					out.separated = true;
+					break;
+				}
+
+				// relative to the distance, plus the rounding error of dot(v, w)
+				if (vv - vw <= s_convergenceTolerance * vv + s_precisionTolerance * sqrtf(vv * Dot3(w.w, w.w)))
+					break;
+
+				bool duplicate = false;
+				for (uint32_t i = 0; i < previousCount; i++)
+				{
+					Vector d = Sub3(previous[i], w.w);
+					duplicate |= Dot3(d, d) == 0.0f;
+				}
+				if (duplicate)
+					break;
+
+				s.v[s.count++] = w;
+			}
+
+			return out;
+		}
+
+		void StoreCache(const Simplex& s, GJKCache* cache)
+		{
+			if (!cache)
+				return;
+
+			cache->count = s.count;
+			for (uint32_t i = 0; i < s.count; i++)
+			{
+				cache->localA[i] = s.v[i].localA;
+				cache->localB[i] = s.v[i].localB;
+			}
+		}
+
+		// ====== EPA ======
+
+		struct EPAFace
+		{
+			uint32_t i[3];
+			Vector normal;
+			float distance;
+			bool valid;
+		};
+
+		struct EPAPolytope
+		{
+			SimplexVertex vertices[s_epaMaxVertices];
+			EPAFace faces[s_epaMaxFaces];
+			uint32_t vertexCount;
+			uint32_t faceCount;
+		};
+
+		bool AddFace(EPAPolytope& p, uint32_t i0, uint32_t i1, uint32_t i2)
+		{
+			if (p.faceCount == s_epaMaxFaces)
+				return false;
+
+			EPAFace& f = p.faces[p.faceCount++];
+			f.i[0] = i0;
+			f.i[1] = i1;
+			f.i[2] = i2;
+
+			const Vector& a = p.vertices[i0].w;
+			Vector n = Cross3(Sub3(p.vertices[i1].w, a), Sub3(p.vertices[i2].w, a));
+			float length = sqrtf(Dot3(n, n));
+			f.valid = length > 0.0f;
+			f.normal = f.valid ? Mul3(n, 1.0f / length) : Vector(0.0f, 0.0f, 0.0f, 0.0f);
+			f.distance = Dot3(f.normal, a);
+			return true;
+		}
+
+		uint32_t FindClosestFace(const EPAPolytope& p)
+		{
+			float best = 3.402823466e+38f;
+			uint32_t closest = UINT32_MAX;
+			for (uint32_t f = 0; f < p.faceCount; f++)
+			{
+				if (p.faces[f].valid && p.faces[f].distance < best)
+				{
+					best = p.faces[f].distance;
+					closest = f;
+				}
+			}
+
+			return closest;
+		}
+
+		// adds w to the polytope: the faces that see it are removed and the hole is closed by a fan of faces
+		// from w to the horizon. False when the face buffers overflow
+		bool ExpandPolytope(EPAPolytope& p, const SimplexVertex& w)
+		{
+			uint32_t vi = p.vertexCount++;
+			p.vertices[vi] = w;
+
+			// remove the faces that see the new vertex, the edges of one removed face only form the horizon
+			uint32_t edges[s_epaMaxEdges][2];
+			uint32_t edgeCount = 0;
+			bool overflow = false;
+			for (uint32_t f = 0; f < p.faceCount; f++)
+			{
+				EPAFace& visible = p.faces[f];
+				if (!visible.valid || Dot3(visible.normal, Sub3(w.w, p.vertices[visible.i[0]].w)) <= 0.0f)
+					continue;
+
+				visible.valid = false;
+				for (uint32_t e = 0; e < 3; e++)
+				{
+					uint32_t e0 = visible.i[e], e1 = visible.i[(e + 1) % 3];
+					bool shared = false;
+					for (uint32_t k = 0; k < edgeCount; k++)
+					{
+						if (edges[k][0] == e1 && edges[k][1] == e0)
+						{
+							edges[k][0] = edges[--edgeCount][0];
+							edges[k][1] = edges[edgeCount][1];
+							shared = true;
+							break;
+						}
+					}
+					if (shared)
+						continue;
+
+					if (edgeCount == s_epaMaxEdges)
+					{
+						overflow = true;
+						break;
+					}
+					edges[edgeCount][0] = e0;
+					edges[edgeCount][1] = e1;
+					edgeCount++;
+				}
+			}
+
+			// compact the face list
+			uint32_t faceCount = 0;
+			for (uint32_t f = 0; f < p.faceCount; f++)
+			{
+				if (p.faces[f].valid)
+					p.faces[faceCount++] = p.faces[f];
+			}
+			p.faceCount = faceCount;
+
+			if (overflow || p.faceCount + edgeCount > s_epaMaxFaces)
+				return false;
+
+			for (uint32_t e = 0; e < edgeCount; e++)
+				AddFace(p, edges[e][0], edges[e][1], vi);
+			return true;
+		}
+
+		// grows a simplex that touches the origin into a tetrahedron. False for flat differences
+		bool ExpandToTetrahedron(const ConvexShape& a, const ConvexShape& b, Simplex& s)
+		{
+			const Vector axes[6] = {
+				Vector(1.0f, 0.0f, 0.0f, 0.0f), Vector(-1.0f, 0.0f, 0.0f, 0.0f),
+				Vector(0.0f, 1.0f, 0.0f, 0.0f), Vector(0.0f, -1.0f, 0.0f, 0.0f),
+				Vector(0.0f, 0.0f, 1.0f, 0.0f), Vector(0.0f, 0.0f, -1.0f, 0.0f) };
+
+			if (s.count == 1)
+			{
+				for (const Vector& axis : axes)
+				{
+					SimplexVertex w = Support(a, b, axis);
+					Vector d = Sub3(w.w, s.v[0].w);
+					if (Dot3(d, d) > 0.0f)
+					{
+						s.v[s.count++] = w;
+						break;
+					}
+				}
+				if (s.count == 1)
+					return false;
+			}
+
+			if (s.count == 2)
+			{
+				Vector d = Sub3(s.v[1].w, s.v[0].w);
+				float ax = fabsf(d.x), ay = fabsf(d.y), az = fabsf(d.z);
+				Vector axis = ax <= ay && ax <= az ? axes[0] : (ay <= az ? axes[2] : axes[4]);
+				Vector p0 = Cross3(d, axis);
+				Vector p1 = Cross3(d, p0);
+				const Vector dirs[4] = { p0, Mul3(p0, -1.0f), p1, Mul3(p1, -1.0f) };
+				for (const Vector& dir : dirs)
+				{
+					SimplexVertex w = Support(a, b, dir);
+					Vector n = Cross3(d, Sub3(w.w, s.v[0].w));
+					if (Dot3(n, n) > 1e-12f * Dot3(d, d) * Dot3(d, d))
+					{
+						s.v[s.count++] = w;
+						break;
+					}
+				}
+				if (s.count == 2)
+					return false;
+			}
+
+			if (s.count == 3)
+			{
+				Vector n = Cross3(Sub3(s.v[1].w, s.v[0].w), Sub3(s.v[2].w, s.v[0].w));
+				float nn = Dot3(n, n);
+				SimplexVertex w0 = Support(a, b, n);
+				SimplexVertex w1 = Support(a, b, Mul3(n, -1.0f));
+				float h0 = Dot3(n, Sub3(w0.w, s.v[0].w));
+				float h1 = -Dot3(n, Sub3(w1.w, s.v[0].w));
+				if (fmaxf(h0, h1) * fmaxf(h0, h1) <= 1e-12f * nn * fmaxf(nn, 1.0f))
+					return false;
+
+				s.v[s.count++] = h0 >= h1 ? w0 : w1;
+			}
+
+			return true;
+		}
+
+		// penetration of overlapping cores: depth along the normal from A to B and the deepest core points
+		void RunEPA(const ConvexShape& a, const ConvexShape& b, const Simplex& simplex, const Vector* seed, ConvexContact& contact)
+		{
+			contact.distance = 0.0f;
+			contact.normal = Vector(0.0f, 1.0f, 0.0f, 0.0f);
+			contact.pointA = simplex.v[0].a;
+			contact.pointB = simplex.v[0].b;
+
+			Simplex s = simplex;
+			if (!ExpandToTetrahedron(a, b, s))
+				return;
+
+			EPAPolytope p;
+			p.vertexCount = 4;
+			p.faceCount = 0;
+			for (uint32_t i = 0; i < 4; i++)
+				p.vertices[i] = s.v[i];
+
+			// faces wound so their normals point away from the opposite vertex
+			Vector n = Cross3(Sub3(s.v[1].w, s.v[0].w), Sub3(s.v[2].w, s.v[0].w));
+			if (Dot3(n, Sub3(s.v[3].w, s.v[0].w)) > 0.0f)
+				std::swap(p.vertices[1], p.vertices[2]);
+			AddFace(p, 0, 1, 2);
+			AddFace(p, 0, 3, 1);
+			AddFace(p, 0, 2, 3);
+			AddFace(p, 1, 3, 2);
+
+			// the penetration normal of the last frame is usually close to the answer, its support point
+			// puts a face near the closest one from the start
+			if (seed)
+			{
+				// only a point clearly outside, one on the surface would add slivers
+				SimplexVertex w = Support(a, b, *seed);
+				float growth = 0.0f;
+				for (uint32_t f = 0; f < p.faceCount; f++)
+				{
+					if (p.faces[f].valid)
+						growth = fmaxf(growth, (Dot3(p.faces[f].normal, w.w) - p.faces[f].distance) / fmaxf(1.0f, p.faces[f].distance));
+				}
+				if (growth > s_epaTolerance)
+					ExpandPolytope(p, w);
+			}
+
+			for (uint32_t iteration = 0; ; iteration++)
+			{
+				contact.iterations++;
+
+				uint32_t closest = FindClosestFace(p);
+				if (closest == UINT32_MAX)
+					return;
+
+				const EPAFace& face = p.faces[closest];
+				SimplexVertex w = Support(a, b, face.normal);
+				float growth = Dot3(face.normal, w.w) - face.distance;
+				if (growth <= s_epaTolerance * fmaxf(1.0f, face.distance) || iteration >= s_epaMaxIterations ||
+					p.vertexCount == s_epaMaxVertices || !ExpandPolytope(p, w))
+					break;
+			}
+
+			// the origin projected on the closest face, its barycentric weights give the deepest points
+			uint32_t closest = FindClosestFace(p);
+			if (closest == UINT32_MAX)
+				return;
+
+			const EPAFace& face = p.faces[closest];
+			const SimplexVertex& v0 = p.vertices[face.i[0]];
+			const SimplexVertex& v1 = p.vertices[face.i[1]];
+			const SimplexVertex& v2 = p.vertices[face.i[2]];
+			Vector proj = Mul3(face.normal, face.distance);
+
+			Vector e0 = Sub3(v1.w, v0.w), e1 = Sub3(v2.w, v0.w), e2 = Sub3(proj, v0.w);
+			float d00 = Dot3(e0, e0), d01 = Dot3(e0, e1), d11 = Dot3(e1, e1);
+			float d20 = Dot3(e2, e0), d21 = Dot3(e2, e1);
+			float denom = d00 * d11 - d01 * d01;
+			float l1 = denom != 0.0f ? (d11 * d20 - d01 * d21) / denom : 0.0f;
+			float l2 = denom != 0.0f ? (d00 * d21 - d01 * d20) / denom : 0.0f;
+			float l0 = 1.0f - l1 - l2;
+
+			contact.distance = -face.distance;
+			contact.normal = face.normal;
+			contact.pointA = Add3(Add3(Mul3(v0.a, l0), Mul3(v1.a, l1)), Mul3(v2.a, l2));
+			contact.pointB = Add3(Add3(Mul3(v0.b, l0), Mul3(v1.b, l1)), Mul3(v2.b, l2));
+		}
+
+		// moves the core points out to the surfaces
+		void ApplyRadii(const ConvexShape& a, const ConvexShape& b, ConvexContact& contact)
+		{
+			contact.distance -= a.radius + b.radius;
+			contact.pointA = Add3(contact.pointA, Mul3(contact.normal, a.radius));
+			contact.pointB = Sub3(contact.pointB, Mul3(contact.normal, b.radius));
+			contact.pointA.w = 1.0f;
+			contact.pointB.w = 1.0f;
+		}
+	}
+
+	// GJK with an early out as soon as a separating plane is found. Touching shapes overlap
+	bool ConvexOverlap(const ConvexShape& a, const ConvexShape& b, GJKCache* cache)
+	{
+		GJKOutput out = RunGJK(a, b, cache, GJKMode::Overlap);
+		StoreCache(out.simplex, cache);
+		if (out.coresOverlap)
+			return true;
+		if (out.separated)
+			return false;
+
+		float radius = a.radius + b.radius;
+		return Dot3(out.closest, out.closest) <= radius * radius;
+	}
+
+	ConvexContact ConvexQuery(const ConvexShape& a, const ConvexShape& b, GJKCache* cache)
+	{
+		GJKOutput out = RunGJK(a, b, cache, GJKMode::Distance);
+		StoreCache(out.simplex, cache);
+
+		ConvexContact contact;
+		contact.iterations = out.iterations;
+		if (out.coresOverlap)
+		{
+			RunEPA(a, b, out.simplex, cache && cache->hasNormal ? &cache->normal : nullptr, contact);
+			if (cache)
+			{
+				cache->normal = contact.normal;
+				cache->hasNormal = true;
+			}
+		}
+		else
+		{
+			// closest = pointA - pointB, the normal from A to B is its opposite
+			const Simplex& s = out.simplex;
+			float length = sqrtf(Dot3(out.closest, out.closest));
+			contact.distance = length;
+			contact.normal = Mul3(out.closest, -1.0f / length);
+			if (cache)
+				cache->hasNormal = false;
+			contact.pointA = Vector(0.0f, 0.0f, 0.0f, 0.0f);
+			contact.pointB = Vector(0.0f, 0.0f, 0.0f, 0.0f);
+			for (uint32_t i = 0; i < s.count; i++)
+			{
+				contact.pointA = Add3(contact.pointA, Mul3(s.v[i].a, s.lambda[i]));
+				contact.pointB = Add3(contact.pointB, Mul3(s.v[i].b, s.lambda[i]));
+			}
+		}
+
+		ApplyRadii(a, b, contact);
+		return contact;
+	}
+
+	void ConvexQuery(const ConvexShape* shapes, const ProxyPair* pairs, uint32_t count, GJKCache* caches, ConvexContact* contacts)
+	{
+		auto query = [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+					contacts[i] = ConvexQuery(shapes[pairs[i].proxyA], shapes[pairs[i].proxyB], caches ? &caches[i] : nullptr);
+			};
+
+		if (JobSystem::GetThreadCount() > 1 && count >= s_parallelThreshold)
+			JobSystem::ParallelFor(0, count, s_parallelThreshold / 2, query);
+		else
+			query(0, count);
+	}
+}
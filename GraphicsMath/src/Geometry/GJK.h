@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "ConvexShape.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	/// <summary>
+	/// Simplex of the last query of a shape pair, kept by the caller between frames.
+	/// The vertices are stored as local core points of both shapes, so they stay valid points of the
+	/// Minkowski difference after the shapes moved and seed the next query close to the answer.
+	/// </summary>
+	struct GJKCache
+	{
+		uint32_t count = 0; // 0 = cold start
+		Vector localA[4];
+		Vector localB[4];
+		Vector normal;          // penetration normal of the last query, seeds EPA
+		bool hasNormal = false;
+	};
+
+	struct ConvexContact
+	{
+		float distance = 0.0f; // separation, or minus the penetration depth when the shapes overlap
+		Vector normal;         // unit, from A to B. Moving B by -distance * normal separates overlapping shapes
+		Vector pointA;         // closest (or deepest) point of A
+		Vector pointB;         // closest (or deepest) point of B
+		uint32_t iterations = 0; // GJK + EPA iterations
+
+		bool IsOverlapping() const { return distance < 0.0f; }
+	};
+
+	// GJK with an early out as soon as a separating plane is found. Shapes touching within float precision overlap
+	bool ConvexOverlap(const ConvexShape& a, const ConvexShape& b, GJKCache* cache = nullptr);
+
+	/// <summary>
+	/// Distance and closest points when the shapes are apart (GJK), penetration depth and deepest points
+	/// when they overlap. Only overlapping cores need EPA: shapes that touch within their radii are resolved
+	/// by GJK alone, which makes rounded shapes the cheap choice for resting contacts.
+	/// </summary>
+	ConvexContact ConvexQuery(const ConvexShape& a, const ConvexShape& b, GJKCache* cache = nullptr);
+
+	/// <summary>
+	/// ConvexQuery over pairs of shapes, for example the output of a broadphase. Runs on the job system
+	/// for large batches. caches is optional, otherwise it holds one cache per pair.
+	/// </summary>
+	void ConvexQuery(const ConvexShape* shapes, const ProxyPair* pairs, uint32_t count, GJKCache* caches, ConvexContact* contacts);
+}
@@ -0,0 +1,514 @@
+#include "Intersection.h"
+#include "Math/SIMD.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+namespace GM
+{
+	namespace
+	{
+		// scalar overloads so the kernels below compile for float and Float8
+		float Min(float a, float b) { return std::min(a, b); }
+		float Max(float a, float b) { return std::max(a, b); }
+		float Abs(float a) { return fabsf(a); }
+		float Sqrt(float a) { return sqrtf(a); }
+		float Select(bool mask, float a, float b) { return mask ? a : b; }
+
+		// clamps tiny components so the slab tests never compute 0 * inf
+		template<typename T>
+		T SafeInverse(T d)
+		{
+			T tiny(1e-20f);
+			return T(1.0f) / Select(Abs(d) < tiny, Select(d < T(0.0f), -tiny, tiny), d);
+		}
+
+		// slab test against [min, max] with the inverse direction, t receives the entry distance
+		template<typename T>
+		auto Slabs(T ox, T oy, T oz, T ix, T iy, T iz, T tMin, T tMax, T minX, T minY, T minZ, T maxX, T maxY, T maxZ, T& t)
+		{
+			T t0x = (minX - ox) * ix;
+			T t1x = (maxX - ox) * ix;
+			T t0y = (minY - oy) * iy;
+			T t1y = (maxY - oy) * iy;
+			T t0z = (minZ - oz) * iz;
+			T t1z = (maxZ - oz) * iz;
+
+			T tNear = Max(Max(Min(t0x, t1x), Min(t0y, t1y)), Max(Min(t0z, t1z), tMin));
+			T tFar = Min(Min(Max(t0x, t1x), Max(t0y, t1y)), Min(Max(t0z, t1z), tMax));
+			auto hit = tNear <= tFar;
+			t = Select(hit, tNear, T(FLT_MAX));
+			return hit;
+		}
+
+		template<typename T>
+		auto RaySphere(T ox, T oy, T oz, T dx, T dy, T dz, T tMin, T tMax, T cx, T cy, T cz, T r, T& t)
+		{
+			T px = ox - cx;
+			T py = oy - cy;
+			T pz = oz - cz;
+			T a = dx * dx + dy * dy + dz * dz;
+			T b = px * dx + py * dy + pz * dz;
+			T c = px * px + py * py + pz * pz - r * r;
+			T disc = b * b - a * c;
+			T s = Sqrt(Max(disc, T(0.0f)));
+			T invA = T(1.0f) / a;
+
+			// a ray starting inside enters at tMin
+			T tEntry = Max((-b - s) * invA, tMin);
+			T tExit = (-b + s) * invA;
+			auto hit = (disc >= T(0.0f)) & (tExit >= tMin) & (tEntry <= tMax);
+			t = Select(hit, tEntry, T(FLT_MAX));
+			return hit;
+		}
+
+		template<typename T>
+		auto RayOBB(T ox, T oy, T oz, T dx, T dy, T dz, T tMin, T tMax, T cx, T cy, T cz, T ex, T ey, T ez, const T (&axes)[3][3], T& t)
+		{
+			// ray in the box frame, then a slab test against [-extents, extents]
+			T px = ox - cx;
+			T py = oy - cy;
+			T pz = oz - cz;
+			T lo[3], li[3];
+			for (int i = 0; i < 3; i++)
+			{
+				lo[i] = px * axes[i][0] + py * axes[i][1] + pz * axes[i][2];
+				li[i] = SafeInverse(dx * axes[i][0] + dy * axes[i][1] + dz * axes[i][2]);
+			}
+
+			return Slabs(lo[0], lo[1], lo[2], li[0], li[1], li[2], tMin, tMax, -ex, -ey, -ez, ex, ey, ez, t);
+		}
+
+		template<typename T>
+		auto RayPlane(T ox, T oy, T oz, T dx, T dy, T dz, T tMin, T tMax, T nx, T ny, T nz, T d, T& t)
+		{
+			T denom = nx * dx + ny * dy + nz * dz;
+			T tPlane = -(nx * ox + ny * oy + nz * oz + d) / denom;
+			auto hit = (Abs(denom) > T(1e-20f)) & (tPlane >= tMin) & (tPlane <= tMax);
+			t = Select(hit, tPlane, T(FLT_MAX));
+			return hit;
+		}
+
+		template<typename T>
+		auto RayTriangle(T ox, T oy, T oz, T dx, T dy, T dz, T tMin, T tMax, const T (&v0)[3], const T (&v1)[3], const T (&v2)[3], T& t, T& u, T& v)
+		{
+			T e1x = v1[0] - v0[0], e1y = v1[1] - v0[1], e1z = v1[2] - v0[2];
+			T e2x = v2[0] - v0[0], e2y = v2[1] - v0[1], e2z = v2[2] - v0[2];
+
+			// p = d x e2
+			T px = dy * e2z - dz * e2y;
+			T py = dz * e2x - dx * e2z;
+			T pz = dx * e2y - dy * e2x;
+			T det = e1x * px + e1y * py + e1z * pz;
+			T invDet = T(1.0f) / det;
+
+			T sx = ox - v0[0];
+			T sy = oy - v0[1];
+			T sz = oz - v0[2];
+			T uHit = (sx * px + sy * py + sz * pz) * invDet;
+
+			// q = s x e1
+			T qx = sy * e1z - sz * e1y;
+			T qy = sz * e1x - sx * e1z;
+			T qz = sx * e1y - sy * e1x;
+			T vHit = (dx * qx + dy * qy + dz * qz) * invDet;
+			T tHit = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+			T zero(0.0f);
+			auto hit = (Abs(det) > T(1e-20f)) & (uHit >= zero) & (vHit >= zero) & (uHit + vHit <= T(1.0f)) & (tHit >= tMin) & (tHit <= tMax);
+			t = Select(hit, tHit, T(FLT_MAX));
+			u = Select(hit, uHit, zero);
+			v = Select(hit, vHit, zero);
+			return hit;
+		}
+
+		template<typename T>
+		auto SphereAABB(T cx, T cy, T cz, T r, T minX, T minY, T minZ, T maxX, T maxY, T maxZ)
+		{
+			// squared distance from the center to the box
+			T zero(0.0f);
+			T dx = Max(Max(minX - cx, cx - maxX), zero);
+			T dy = Max(Max(minY - cy, cy - maxY), zero);
+			T dz = Max(Max(minZ - cz, cz - maxZ), zero);
+			return dx * dx + dy * dy + dz * dz <= r * r;
+		}
+
+		template<typename T>
+		auto AABBAABB(T minX0, T minY0, T minZ0, T maxX0, T maxY0, T maxZ0, T minX1, T minY1, T minZ1, T maxX1, T maxY1, T maxZ1)
+		{
+			return (minX0 <= maxX1) & (maxX0 >= minX1) & (minY0 <= maxY1) & (maxY0 >= minY1) & (minZ0 <= maxZ1) & (maxZ0 >= minZ1);
+		}
+
+
+
+
+		// 8 elements starting at first, lanes past count repeat the last element
+		Float8 Lanes(const float* p, uint32_t first, uint32_t count)
+		{
+			if (first + 8 <= count)
+				return Float8::LoadUnaligned(p + first);
+
+			alignas(32) float f[8];
+			for (uint32_t i = 0; i < 8; i++)
+				f[i] = p[std::min(first + i, count - 1)];
+
+			return Float8::Load(f);
+		}
+
+		void StoreLanes(float* p, uint32_t first, uint32_t count, Float8 v)
+		{
+			if (!p)
+				return;
+
+			if (first + 8 <= count)
+			{
+				v.StoreUnaligned(p + first);
+				return;
+			}
+
+			alignas(32) float f[8];
+			v.Store(f);
+			for (uint32_t i = first; i < count; i++)
+				p[i] = f[i - first];
+		}
+
+		struct RayLanes
+		{
+			Float8 ox, oy, oz, dx, dy, dz, tMin, tMax;
+
+			RayLanes(const Ray& ray)
+				: ox(ray.origin.x), oy(ray.origin.y), oz(ray.origin.z),
+				dx(ray.direction.x), dy(ray.direction.y), dz(ray.direction.z),
+				tMin(ray.tMin), tMax(ray.tMax)
+			{
+			}
+
+			RayLanes(const RaySoA& rays, uint32_t first)
+				: ox(Lanes(rays.originX, first, rays.count)), oy(Lanes(rays.originY, first, rays.count)), oz(Lanes(rays.originZ, first, rays.count)),
+				dx(Lanes(rays.directionX, first, rays.count)), dy(Lanes(rays.directionY, first, rays.count)), dz(Lanes(rays.directionZ, first, rays.count)),
+				tMin(Lanes(rays.tMin, first, rays.count)), tMax(Lanes(rays.tMax, first, rays.count))
+			{
+			}
+		};
+
+		/// <summary>
+		/// Runs kernel(first) over [0, count) in steps of 8. The kernel returns the lane mask of its hits,
+		/// lanes past count are dropped before the hits are counted and written to mask.
+		/// </summary>
+		template<typename Kernel>
+		uint32_t RunBatch(uint32_t count, uint32_t* mask, const Kernel& kernel)
+		{
+			if (mask)
+				memset(mask, 0, IntersectionMaskSize(count) * sizeof(uint32_t));
+
+			uint32_t hits = 0;
+			for (uint32_t i = 0; i < count; i += 8)
+			{
+				uint32_t bits = static_cast<uint32_t>(kernel(i));
+				if (count - i < 8)
+					bits &= (1u << (count - i)) - 1;
+
+				if (mask)
+					mask[i / 32] |= bits << (i % 32);
+
+				for (; bits; bits &= bits - 1)
+					hits++;
+			}
+
+			return hits;
+		}
+
+		uint32_t RaySpheres(const SphereSoA& spheres, float* t, uint32_t* mask, const RaySoA* rays, const Ray* ray)
+		{
+			return RunBatch(spheres.count, mask, [&](uint32_t i)
+				{
+					RayLanes r = rays ? RayLanes(*rays, i) : RayLanes(*ray);
+					Float8 tHit;
+					Float8 hit = RaySphere(r.ox, r.oy, r.oz, r.dx, r.dy, r.dz, r.tMin, r.tMax,
+						Lanes(spheres.centerX, i, spheres.count), Lanes(spheres.centerY, i, spheres.count), Lanes(spheres.centerZ, i, spheres.count),
+						Lanes(spheres.radius, i, spheres.count), tHit);
+
+					StoreLanes(t, i, spheres.count, tHit);
+					return MoveMask(hit);
+				});
+		}
+
+		uint32_t RayAABBs(const AABBSoA& boxes, float* t, uint32_t* mask, const RaySoA* rays, const Ray* ray)
+		{
+			return RunBatch(boxes.count, mask, [&](uint32_t i)
+				{
+					RayLanes r = rays ? RayLanes(*rays, i) : RayLanes(*ray);
+					Float8 tHit;
+					Float8 hit = Slabs(r.ox, r.oy, r.oz, SafeInverse(r.dx), SafeInverse(r.dy), SafeInverse(r.dz), r.tMin, r.tMax,
+						Lanes(boxes.minX, i, boxes.count), Lanes(boxes.minY, i, boxes.count), Lanes(boxes.minZ, i, boxes.count),
+						Lanes(boxes.maxX, i, boxes.count), Lanes(boxes.maxY, i, boxes.count), Lanes(boxes.maxZ, i, boxes.count), tHit);
+
+					StoreLanes(t, i, boxes.count, tHit);
+					return MoveMask(hit);
+				});
+		}
+
+		uint32_t RayOBBs(const OBBSoA& boxes, float* t, uint32_t* mask, const RaySoA* rays, const Ray* ray)
+		{
+			return RunBatch(boxes.count, mask, [&](uint32_t i)
+				{
+					RayLanes r = rays ? RayLanes(*rays, i) : RayLanes(*ray);
+					Float8 axes[3][3];
+					for (int a = 0; a < 3; a++)
+					{
+						for (int c = 0; c < 3; c++)
+							axes[a][c] = Lanes(boxes.axes[a][c], i, boxes.count);
+					}
+
+					Float8 tHit;
+					Float8 hit = RayOBB(r.ox, r.oy, r.oz, r.dx, r.dy, r.dz, r.tMin, r.tMax,
+						Lanes(boxes.centerX, i, boxes.count), Lanes(boxes.centerY, i, boxes.count), Lanes(boxes.centerZ, i, boxes.count),
+						Lanes(boxes.extentX, i, boxes.count), Lanes(boxes.extentY, i, boxes.count), Lanes(boxes.extentZ, i, boxes.count), axes, tHit);
+
+					StoreLanes(t, i, boxes.count, tHit);
+					return MoveMask(hit);
+				});
+		}
+
+		uint32_t RayPlanes(const PlaneSoA& planes, float* t, uint32_t* mask, const RaySoA* rays, const Ray* ray)
+		{
+			return RunBatch(planes.count, mask, [&](uint32_t i)
+				{
+					RayLanes r = rays ? RayLanes(*rays, i) : RayLanes(*ray);
+					Float8 tHit;
+					Float8 hit = RayPlane(r.ox, r.oy, r.oz, r.dx, r.dy, r.dz, r.tMin, r.tMax,
+						Lanes(planes.normalX, i, planes.count), Lanes(planes.normalY, i, planes.count), Lanes(planes.normalZ, i, planes.count),
+						Lanes(planes.d, i, planes.count), tHit);
+
+					StoreLanes(t, i, planes.count, tHit);
+					return MoveMask(hit);
+				});
+		}
+
+		uint32_t RayTriangles(const TriangleSoA& triangles, float* t, float* u, float* v, uint32_t* mask, const RaySoA* rays, const Ray* ray)
+		{
+			return RunBatch(triangles.count, mask, [&](uint32_t i)
+				{
+					RayLanes r = rays ? RayLanes(*rays, i) : RayLanes(*ray);
+					Float8 v0[3], v1[3], v2[3];
+					for (int c = 0; c < 3; c++)
+					{
+						v0[c] = Lanes(triangles.v0[c], i, triangles.count);
+						v1[c] = Lanes(triangles.v1[c], i, triangles.count);
+						v2[c] = Lanes(triangles.v2[c], i, triangles.count);
+					}
+
+					Float8 tHit, uHit, vHit;
+					Float8 hit = RayTriangle(r.ox, r.oy, r.oz, r.dx, r.dy, r.dz, r.tMin, r.tMax, v0, v1, v2, tHit, uHit, vHit);
+
+					StoreLanes(t, i, triangles.count, tHit);
+					StoreLanes(u, i, triangles.count, uHit);
+					StoreLanes(v, i, triangles.count, vHit);
+					return MoveMask(hit);
+				});
+		}
+	}
+
+
+
+
+	// =========================================== Single =================================================
+
+	bool IntersectRaySphere(const Ray& ray, const Sphere& sphere, float& t)
+	{
+		return RaySphere(ray.origin.x, ray.origin.y, ray.origin.z, ray.direction.x, ray.direction.y, ray.direction.z, ray.tMin, ray.tMax,
+			sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius, t);
+	}
+
+	bool IntersectRayAABB(const Ray& ray, const AABB& box, float& t)
+	{
+		return Slabs(ray.origin.x, ray.origin.y, ray.origin.z,
+			SafeInverse(ray.direction.x), SafeInverse(ray.direction.y), SafeInverse(ray.direction.z), ray.tMin, ray.tMax,
+			box.min.x, box.min.y, box.min.z, box.max.x, box.max.y, box.max.z, t);
+	}
+
+	bool IntersectRayOBB(const Ray& ray, const OBB& box, float& t)
+	{
+		const float axes[3][3] =
+		{
+			{ box.axes[0].x, box.axes[0].y, box.axes[0].z },
+			{ box.axes[1].x, box.axes[1].y, box.axes[1].z },
+			{ box.axes[2].x, box.axes[2].y, box.axes[2].z }
+		};
+
+		return RayOBB(ray.origin.x, ray.origin.y, ray.origin.z, ray.direction.x, ray.direction.y, ray.direction.z, ray.tMin, ray.tMax,
+			box.center.x, box.center.y, box.center.z, box.extents.x, box.extents.y, box.extents.z, axes, t);
+	}
+
+	// false when the ray is parallel to the plane
+	bool IntersectRayPlane(const Ray& ray, const Vector& plane, float& t)
+	{
+		return RayPlane(ray.origin.x, ray.origin.y, ray.origin.z, ray.direction.x, ray.direction.y, ray.direction.z, ray.tMin, ray.tMax,
+			plane.x, plane.y, plane.z, plane.w, t);
+	}
+
+	// Moller-Trumbore, both faces. position = (1 - u - v) * p0 + u * p1 + v * p2
+	bool IntersectRayTriangle(const Ray& ray, const Vector& p0, const Vector& p1, const Vector& p2, float& t, float& u, float& v)
+	{
+		const float v0[3] = { p0.x, p0.y, p0.z };
+		const float v1[3] = { p1.x, p1.y, p1.z };
+		const float v2[3] = { p2.x, p2.y, p2.z };
+		return RayTriangle(ray.origin.x, ray.origin.y, ray.origin.z, ray.direction.x, ray.direction.y, ray.direction.z, ray.tMin, ray.tMax,
+			v0, v1, v2, t, u, v);
+	}
+
+	bool OverlapSphereAABB(const Sphere& sphere, const AABB& box)
+	{
+		return SphereAABB(sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius,
+			box.min.x, box.min.y, box.min.z, box.max.x, box.max.y, box.max.z);
+	}
+
+	Containment ClassifyFrustumAABB(const Frustum& frustum, const AABB& box)
+	{
+		const Vector planes[6] = { frustum.left, frustum.right, frustum.bottom, frustum.top, frustum.nearZ, frustum.farZ };
+		float cx = 0.5f * (box.min.x + box.max.x), cy = 0.5f * (box.min.y + box.max.y), cz = 0.5f * (box.min.z + box.max.z);
+		float ex = 0.5f * (box.max.x - box.min.x), ey = 0.5f * (box.max.y - box.min.y), ez = 0.5f * (box.max.z - box.min.z);
+
+		Containment res = Containment::Contains;
+		for (const Vector& plane : planes)
+		{
+			// distance of the center and projected radius of the box along the plane normal
+			float d = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+			float r = fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+			if (d < -r)
+				return Containment::Disjoint;
+			if (d < r)
+				res = Containment::Intersects;
+		}
+
+		return res;
+	}
+
+	bool OverlapFrustumAABB(const Frustum& frustum, const AABB& box)
+	{
+		return ClassifyFrustumAABB(frustum, box) != Containment::Disjoint;
+	}
+
+	bool OverlapFrustumSphere(const Frustum& frustum, const Sphere& sphere)
+	{
+		const Vector planes[6] = { frustum.left, frustum.right, frustum.bottom, frustum.top, frustum.nearZ, frustum.farZ };
+		for (const Vector& plane : planes)
+		{
+			if (plane.x * sphere.center.x + plane.y * sphere.center.y + plane.z * sphere.center.z + plane.w < -sphere.radius)
+				return false;
+		}
+
+		return true;
+	}
+
+
+
+
+	// =========================================== Batch ==================================================
+
+	uint32_t IntersectRaySpheres(const Ray& ray, const SphereSoA& spheres, float* t, uint32_t* mask)
+	{
+		return RaySpheres(spheres, t, mask, nullptr, &ray);
+	}
+
+	uint32_t IntersectRaysSpheres(const RaySoA& rays, const SphereSoA& spheres, float* t, uint32_t* mask)
+	{
+		assert(rays.count == spheres.count && "ray and sphere counts must match");
+		return RaySpheres(spheres, t, mask, &rays, nullptr);
+	}
+
+	uint32_t IntersectRayAABBs(const Ray& ray, const AABBSoA& boxes, float* t, uint32_t* mask)
+	{
+		return RayAABBs(boxes, t, mask, nullptr, &ray);
+	}
+
+	uint32_t IntersectRaysAABBs(const RaySoA& rays, const AABBSoA& boxes, float* t, uint32_t* mask)
+	{
+		assert(rays.count == boxes.count && "ray and box counts must match");
+		return RayAABBs(boxes, t, mask, &rays, nullptr);
+	}
+
+	uint32_t IntersectRayOBBs(const Ray& ray, const OBBSoA& boxes, float* t, uint32_t* mask)
+	{
+		return RayOBBs(boxes, t, mask, nullptr, &ray);
+	}
+
+	uint32_t IntersectRaysOBBs(const RaySoA& rays, const OBBSoA& boxes, float* t, uint32_t* mask)
+	{
+		assert(rays.count == boxes.count && "ray and box counts must match");
+		return RayOBBs(boxes, t, mask, &rays, nullptr);
+	}
+
+	uint32_t IntersectRayPlanes(const Ray& ray, const PlaneSoA& planes, float* t, uint32_t* mask)
+	{
+		return RayPlanes(planes, t, mask, nullptr, &ray);
+	}
+
+	uint32_t IntersectRaysPlanes(const RaySoA& rays, const PlaneSoA& planes, float* t, uint32_t* mask)
+	{
+		assert(rays.count == planes.count && "ray and plane counts must match");
+		return RayPlanes(planes, t, mask, &rays, nullptr);
+	}
+
+	uint32_t IntersectRayTriangles(const Ray& ray, const TriangleSoA& triangles, float* t, float* u, float* v, uint32_t* mask)
+	{
+		return RayTriangles(triangles, t, u, v, mask, nullptr, &ray);
+	}
+
+	uint32_t IntersectRaysTriangles(const RaySoA& rays, const TriangleSoA& triangles, float* t, float* u, float* v, uint32_t* mask)
+	{
+		assert(rays.count == triangles.count && "ray and triangle counts must match");
+		return RayTriangles(triangles, t, u, v, mask, &rays, nullptr);
+	}
+
+	uint32_t OverlapSphereAABBs(const Sphere& sphere, const AABBSoA& boxes, uint32_t* mask)
+	{
+		Float8 cx(sphere.center.x), cy(sphere.center.y), cz(sphere.center.z), r(sphere.radius);
+		return RunBatch(boxes.count, mask, [&](uint32_t i)
+			{
+				return MoveMask(SphereAABB(cx, cy, cz, r,
+					Lanes(boxes.minX, i, boxes.count), Lanes(boxes.minY, i, boxes.count), Lanes(boxes.minZ, i, boxes.count),
+					Lanes(boxes.maxX, i, boxes.count), Lanes(boxes.maxY, i, boxes.count), Lanes(boxes.maxZ, i, boxes.count)));
+			});
+	}
+
+	uint32_t OverlapSpheresAABBs(const SphereSoA& spheres, const AABBSoA& boxes, uint32_t* mask)
+	{
+		assert(spheres.count == boxes.count && "sphere and box counts must match");
+		return RunBatch(boxes.count, mask, [&](uint32_t i)
+			{
+				return MoveMask(SphereAABB(
+					Lanes(spheres.centerX, i, spheres.count), Lanes(spheres.centerY, i, spheres.count), Lanes(spheres.centerZ, i, spheres.count),
+					Lanes(spheres.radius, i, spheres.count),
+					Lanes(boxes.minX, i, boxes.count), Lanes(boxes.minY, i, boxes.count), Lanes(boxes.minZ, i, boxes.count),
+					Lanes(boxes.maxX, i, boxes.count), Lanes(boxes.maxY, i, boxes.count), Lanes(boxes.maxZ, i, boxes.count)));
+			});
+	}
+
+	uint32_t OverlapAABBAABBs(const AABB& box, const AABBSoA& boxes, uint32_t* mask)
+	{
+		Float8 minX(box.min.x), minY(box.min.y), minZ(box.min.z), maxX(box.max.x), maxY(box.max.y), maxZ(box.max.z);
+		return RunBatch(boxes.count, mask, [&](uint32_t i)
+			{
+				return MoveMask(AABBAABB(minX, minY, minZ, maxX, maxY, maxZ,
+					Lanes(boxes.minX, i, boxes.count), Lanes(boxes.minY, i, boxes.count), Lanes(boxes.minZ, i, boxes.count),
+					Lanes(boxes.maxX, i, boxes.count), Lanes(boxes.maxY, i, boxes.count), Lanes(boxes.maxZ, i, boxes.count)));
+			});
+	}
+
+	uint32_t OverlapAABBsAABBs(const AABBSoA& boxes0, const AABBSoA& boxes1, uint32_t* mask)
+	{
+		assert(boxes0.count == boxes1.count && "box counts must match");
+		return RunBatch(boxes0.count, mask, [&](uint32_t i)
+			{
+				return MoveMask(AABBAABB(
+					Lanes(boxes0.minX, i, boxes0.count), Lanes(boxes0.minY, i, boxes0.count), Lanes(boxes0.minZ, i, boxes0.count),
+					Lanes(boxes0.maxX, i, boxes0.count), Lanes(boxes0.maxY, i, boxes0.count), Lanes(boxes0.maxZ, i, boxes0.count),
+					Lanes(boxes1.minX, i, boxes1.count), Lanes(boxes1.minY, i, boxes1.count), Lanes(boxes1.minZ, i, boxes1.count),
+					Lanes(boxes1.maxX, i, boxes1.count), Lanes(boxes1.maxY, i, boxes1.count), Lanes(boxes1.maxZ, i, boxes1.count)));
+			});
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "Ray.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	// =========================================== Structure of arrays ====================================
+	// Non owning views over count elements, no alignment or padding is required.
+	// Planes use the Frustum convention: dot(normal, p) + d = 0, dot(normal, p) + d >= 0 is the front side.
+
+	struct RaySoA
+	{
+		const float* originX;
+		const float* originY;
+		const float* originZ;
+		const float* directionX;
+		const float* directionY;
+		const float* directionZ;
+		const float* tMin;
+		const float* tMax;
+		uint32_t count;
+	};
+
+	struct SphereSoA
+	{
+		const float* centerX;
+		const float* centerY;
+		const float* centerZ;
+		const float* radius;
+		uint32_t count;
+	};
+
+	struct AABBSoA
+	{
+		const float* minX;
+		const float* minY;
+		const float* minZ;
+		const float* maxX;
+		const float* maxY;
+		const float* maxZ;
+		uint32_t count;
+	};
+
+	struct OBBSoA
+	{
+		const float* centerX;
+		const float* centerY;
+		const float* centerZ;
+		const float* extentX;
+		const float* extentY;
+		const float* extentZ;
+		const float* axes[3][3]; // axes[i][c] = component c of axis i
+		uint32_t count;
+	};
+
+	struct PlaneSoA
+	{
+		const float* normalX;
+		const float* normalY;
+		const float* normalZ;
+		const float* d;
+		uint32_t count;
+	};
+
+	struct TriangleSoA
+	{
+		const float* v0[3]; // v0[c] = component c of the first vertex
+		const float* v1[3];
+		const float* v2[3];
+		uint32_t count;
+	};
+
+	// number of uint32_t words of a hit mask over count elements, bit i % 32 of word i / 32 is element i
+	inline uint32_t IntersectionMaskSize(uint32_t count) { return (count + 31) / 32; }
+
+
+
+
+	// =========================================== Single =================================================
+	// t is the entry distance along the ray, tMin when the ray starts inside the volume
+
+	bool IntersectRaySphere(const Ray& ray, const Sphere& sphere, float& t);
+	bool IntersectRayAABB(const Ray& ray, const AABB& box, float& t);
+	bool IntersectRayOBB(const Ray& ray, const OBB& box, float& t);
+
+	// false when the ray is parallel to the plane
+	bool IntersectRayPlane(const Ray& ray, const Vector& plane, float& t);
+
+	// Moller-Trumbore, both faces. position = (1 - u - v) * p0 + u * p1 + v * p2
+	bool IntersectRayTriangle(const Ray& ray, const Vector& p0, const Vector& p1, const Vector& p2, float& t, float& u, float& v);
+
+	bool OverlapSphereAABB(const Sphere& sphere, const AABB& box);
+
+	enum class Containment
+	{
+		Disjoint,
+		Intersects,
+		Contains
+	};
+
+	// Plane tests only: boxes and spheres just outside a frustum edge or corner can be reported as intersecting.
+	// The frustum planes must be normalized for the sphere test.
+	Containment ClassifyFrustumAABB(const Frustum& frustum, const AABB& box);
+	bool OverlapFrustumAABB(const Frustum& frustum, const AABB& box);
+	bool OverlapFrustumSphere(const Frustum& frustum, const Sphere& sphere);
+
+
+
+
+	// =========================================== Batch ==================================================
+	// 8 elements per iteration (AVX, or two SSE registers).
+	// One versus many: a single ray or volume against every element of the array.
+	// Many versus many: element i of the first array against element i of the second, the counts must match.
+	// Every output array is optional (nullptr) and holds count elements, t is FLT_MAX and u, v are 0 on a miss.
+	// The mask has IntersectionMaskSize(count) words. Returns the number of hits.
+
+	uint32_t IntersectRaySpheres(const Ray& ray, const SphereSoA& spheres, float* t, uint32_t* mask);
+	uint32_t IntersectRaysSpheres(const RaySoA& rays, const SphereSoA& spheres, float* t, uint32_t* mask);
+
+	uint32_t IntersectRayAABBs(const Ray& ray, const AABBSoA& boxes, float* t, uint32_t* mask);
+	uint32_t IntersectRaysAABBs(const RaySoA& rays, const AABBSoA& boxes, float* t, uint32_t* mask);
+
+	uint32_t IntersectRayOBBs(const Ray& ray, const OBBSoA& boxes, float* t, uint32_t* mask);
+	uint32_t IntersectRaysOBBs(const RaySoA& rays, const OBBSoA& boxes, float* t, uint32_t* mask);
+
+	uint32_t IntersectRayPlanes(const Ray& ray, const PlaneSoA& planes, float* t, uint32_t* mask);
+	uint32_t IntersectRaysPlanes(const RaySoA& rays, const PlaneSoA& planes, float* t, uint32_t* mask);
+
+	uint32_t IntersectRayTriangles(const Ray& ray, const TriangleSoA& triangles, float* t, float* u, float* v, uint32_t* mask);
+	uint32_t IntersectRaysTriangles(const RaySoA& rays, const TriangleSoA& triangles, float* t, float* u, float* v, uint32_t* mask);
+
+	uint32_t OverlapSphereAABBs(const Sphere& sphere, const AABBSoA& boxes, uint32_t* mask);
+	uint32_t OverlapSpheresAABBs(const SphereSoA& spheres, const AABBSoA& boxes, uint32_t* mask);
+
+	uint32_t OverlapAABBAABBs(const AABB& box, const AABBSoA& boxes, uint32_t* mask);
+	uint32_t OverlapAABBsAABBs(const AABBSoA& boxes0, const AABBSoA& boxes1, uint32_t* mask);
+}
@@ -0,0 +1,484 @@
+#include "LooseOctree.h"
+#include "Intersection.h"
+
+#include <assert.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_stackSize = 256;
+		constexpr uint32_t s_null = LooseOctree::NullIndex;
+
+		// child of the cell at center in the direction of point, bit 0/1/2 = +x/+y/+z
+		uint32_t Octant(const Vector& center, float x, float y, float z)
+		{
+			return (x >= center.x ? 1u : 0u) | (y >= center.y ? 2u : 0u) | (z >= center.z ? 4u : 0u);
+		}
+
+		AABB CubeBounds(const Vector& center, float halfSize)
+		{
+			return AABB(Vector(center.x - halfSize, center.y - halfSize, center.z - halfSize, 0.0f),
+				Vector(center.x + halfSize, center.y + halfSize, center.z + halfSize, 0.0f));
+		}
+	}
+
+	LooseOctree::LooseOctree()
+		: LooseOctree(LooseOctreeDesc())
+	{
+	}
+
+	LooseOctree::LooseOctree(const LooseOctreeDesc& desc)
+		: m_desc(desc), m_freeNodes(s_null), m_nodeCount(0), m_freeObjects(s_null), m_objectCount(0)
+	{
+		// every pop pushes at most 8 children, a path of maxDepth nodes leaves 7 siblings per level behind
+		assert(desc.maxDepth <= 32 && "octree is too deep for the query stack");
+		assert(desc.looseness >= 1.0f && "looseness must be at least 1");
+		Clear();
+	}
+
+	void LooseOctree::Reserve(uint32_t objectCount, uint32_t nodeCount)
+	{
+		m_objects.reserve(objectCount);
+		m_nodes.reserve(nodeCount);
+	}
+
+	void LooseOctree::Clear()
+	{
+		m_nodes.clear();
+		m_objects.clear();
+		m_freeNodes = s_null;
+		m_freeObjects = s_null;
+		m_objectCount = 0;
+
+		Node root;
+		root.center = Vector(m_desc.center.x, m_desc.center.y, m_desc.center.z, m_desc.halfSize);
+		root.parent = s_null;
+		for (uint32_t& child : root.children)
+			child = s_null;
+		root.firstObject = s_null;
+		root.objectCount = 0;
+		root.subtreeCount = 0;
+		root.depth = 0;
+		m_nodes.push_back(root);
+		m_nodeCount = 1;
+	}
+
+	uint32_t LooseOctree::Insert(const AABB& box, uint32_t userData)
+	{
+		uint32_t object;
+		if (m_freeObjects != s_null)
+		{
+			object = m_freeObjects;
+			m_freeObjects = m_objects[object].next;
+		}
+		else
+		{
+			object = static_cast<uint32_t>(m_objects.size());
+			m_objects.emplace_back();
+		}
+
+		m_objects[object].box = box;
+		m_objects[object].userData = userData;
+		InsertObject(object, 0);
+		m_objectCount++;
+		return object;
+	}
+
+	void LooseOctree::Remove(uint32_t object)
+	{
+		assert(object < m_objects.size() && m_objects[object].node != s_null && "invalid object");
+
+		uint32_t node = m_objects[object].node;
+		RemoveObject(object);
+		Prune(node);
+
+		m_objects[object].next = m_freeObjects;
+		m_freeObjects = object;
+		m_objectCount--;
+	}
+
+	bool LooseOctree::Move(uint32_t object, const AABB& box)
+	{
+		assert(object < m_objects.size() && m_objects[object].node != s_null && "invalid object");
+
+		Object& o = m_objects[object];
+		o.box = box;
+		if (Fits(o.node, box))
+			return false;
+
+		// nearby moves only climb a level or two, the root always fits
+		uint32_t node = o.node;
+		uint32_t start = m_nodes[node].parent;
+		while (!Fits(start, box))
+			start = m_nodes[start].parent;
+
+		RemoveObject(object);
+		InsertObject(object, start);
+		Prune(node);
+		return true;
+	}
+
+	uint32_t LooseOctree::GetUserData(uint32_t object) const
+	{
+		return m_objects[object].userData;
+	}
+
+	const AABB& LooseOctree::GetAABB(uint32_t object) const
+	{
+		return m_objects[object].box;
+	}
+
+	uint32_t LooseOctree::GetObjectNode(uint32_t object) const
+	{
+		return m_objects[object].node;
+	}
+
+	// appends the objects whose box overlaps the region
+	void LooseOctree::Query(const Frustum& frustum, std::vector<uint32_t>& objects) const
+	{
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			uint32_t index = stack[--stackSize];
+			const Node& node = m_nodes[index];
+
+			// the root also holds the objects outside of its bounds and is never culled
+			if (index != 0)
+			{
+				Containment c = ClassifyFrustumAABB(frustum, GetNodeBounds(index));
+				if (c == Containment::Disjoint)
+					continue;
+
+				if (c == Containment::Contains)
+				{
+					CollectSubtree(index, objects);
+					continue;
+				}
+			}
+
+			for (uint32_t o = node.firstObject; o != s_null; o = m_objects[o].next)
+			{
+				if (OverlapFrustumAABB(frustum, m_objects[o].box))
+					objects.push_back(o);
+			}
+
+			for (uint32_t child : node.children)
+			{
+				if (child != s_null)
+					stack[stackSize++] = child;
+			}
+		}
+	}
+
+	void LooseOctree::Query(const Sphere& region, std::vector<uint32_t>& objects) const
+	{
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			uint32_t index = stack[--stackSize];
+			const Node& node = m_nodes[index];
+			if (index != 0 && !OverlapSphereAABB(region, GetNodeBounds(index)))
+				continue;
+
+			for (uint32_t o = node.firstObject; o != s_null; o = m_objects[o].next)
+			{
+				if (OverlapSphereAABB(region, m_objects[o].box))
+					objects.push_back(o);
+			}
+
+			for (uint32_t child : node.children)
+			{
+				if (child != s_null)
+					stack[stackSize++] = child;
+			}
+		}
+	}
+
+	void LooseOctree::Query(const AABB& region, std::vector<uint32_t>& objects) const
+	{
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			uint32_t index = stack[--stackSize];
+			const Node& node = m_nodes[index];
+			if (index != 0 && !AABBOverlaps(region, GetNodeBounds(index)))
+				continue;
+
+			for (uint32_t o = node.firstObject; o != s_null; o = m_objects[o].next)
+			{
+				if (AABBOverlaps(region, m_objects[o].box))
+					objects.push_back(o);
+			}
+
+			for (uint32_t child : node.children)
+			{
+				if (child != s_null)
+					stack[stackSize++] = child;
+			}
+		}
+	}
+
+	void LooseOctree::RayCast(const Ray& ray, const std::function<float(uint32_t object, const Ray& ray)>& callback) const
+	{
+		// children are pushed far to near, the octant on the side of the ray origin is popped first
+		uint32_t nearOctant = (ray.direction.x < 0.0f ? 1u : 0u) | (ray.direction.y < 0.0f ? 2u : 0u) | (ray.direction.z < 0.0f ? 4u : 0u);
+
+		Ray clipped = ray;
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			uint32_t index = stack[--stackSize];
+			const Node& node = m_nodes[index];
+
+			float t;
+			if (index != 0 && !IntersectRayAABB(clipped, GetNodeBounds(index), t))
+				continue;
+
+			for (uint32_t o = node.firstObject; o != s_null; o = m_objects[o].next)
+			{
+				if (!IntersectRayAABB(clipped, m_objects[o].box, t))
+					continue;
+
+				float tMax = callback(o, clipped);
+				if (tMax < 0.0f)
+					return;
+
+				clipped.tMax = tMax;
+			}
+
+			for (uint32_t i = 8; i-- > 0;)
+			{
+				uint32_t child = node.children[i ^ nearOctant];
+				if (child != s_null)
+					stack[stackSize++] = child;
+			}
+		}
+	}
+
+	uint32_t LooseOctree::GetRoot() const
+	{
+		return 0;
+	}
+
+	uint32_t LooseOctree::GetNodeChild(uint32_t node, uint32_t i) const
+	{
+		return m_nodes[node].children[i];
+	}
+
+	uint32_t LooseOctree::GetNodeParent(uint32_t node) const
+	{
+		return m_nodes[node].parent;
+	}
+
+	uint32_t LooseOctree::GetNodeDepth(uint32_t node) const
+	{
+		return m_nodes[node].depth;
+	}
+
+	uint32_t LooseOctree::GetNodeObjectCount(uint32_t node) const
+	{
+		return m_nodes[node].objectCount;
+	}
+
+	uint32_t LooseOctree::GetNodeSubtreeObjectCount(uint32_t node) const
+	{
+		return m_nodes[node].subtreeCount;
+	}
+
+	void LooseOctree::GetNodeObjects(uint32_t node, std::vector<uint32_t>& objects) const
+	{
+		for (uint32_t o = m_nodes[node].firstObject; o != s_null; o = m_objects[o].next)
+			objects.push_back(o);
+	}
+
+	AABB LooseOctree::GetNodeCell(uint32_t node) const
+	{
+		return CubeBounds(m_nodes[node].center, m_nodes[node].center.w);
+	}
+
+	AABB LooseOctree::GetNodeBounds(uint32_t node) const
+	{
+		return CubeBounds(m_nodes[node].center, m_nodes[node].center.w * m_desc.looseness);
+	}
+
+	// deepest existing node at most maxDepth deep whose cell contains point, the root for points outside
+	uint32_t LooseOctree::FindNode(const Vector& point, uint32_t maxDepth) const
+	{
+		if (!AABBContains(GetNodeCell(0), point))
+			return 0;
+
+		// inside a cell the octant of the point is the child cell that contains it
+		uint32_t node = 0;
+		while (m_nodes[node].depth < maxDepth)
+		{
+			uint32_t child = m_nodes[node].children[Octant(m_nodes[node].center, point.x, point.y, point.z)];
+			if (child == s_null)
+				break;
+
+			node = child;
+		}
+
+		return node;
+	}
+
+	uint32_t LooseOctree::GetObjectCount() const
+	{
+		return m_objectCount;
+	}
+
+	uint32_t LooseOctree::GetNodeCount() const
+	{
+		return m_nodeCount;
+	}
+
+	uint32_t LooseOctree::AllocateNode(uint32_t parent, uint32_t octant)
+	{
+		uint32_t node;
+		if (m_freeNodes != s_null)
+		{
+			node = m_freeNodes;
+			m_freeNodes = m_nodes[node].parent;
+		}
+		else
+		{
+			node = static_cast<uint32_t>(m_nodes.size());
+			m_nodes.emplace_back();
+		}
+
+		const Node& p = m_nodes[parent];
+		float half = 0.5f * p.center.w;
+		Node& n = m_nodes[node];
+		n.center = Vector(
+			p.center.x + (octant & 1 ? half : -half),
+			p.center.y + (octant & 2 ? half : -half),
+			p.center.z + (octant & 4 ? half : -half),
+			half);
+		n.parent = parent;
+		for (uint32_t& child : n.children)
+			child = s_null;
+		n.firstObject = s_null;
+		n.objectCount = 0;
+		n.subtreeCount = 0;
+		n.depth = p.depth + 1;
+
+		m_nodes[parent].children[octant] = node;
+		m_nodeCount++;
+		return node;
+	}
+
+	void LooseOctree::FreeNode(uint32_t node)
+	{
+		m_nodes[node].parent = m_freeNodes;
+		m_freeNodes = node;
+		m_nodeCount--;
+	}
+
+	bool LooseOctree::Fits(uint32_t node, const AABB& box) const
+	{
+		return node == 0 || AABBContains(GetNodeBounds(node), box);
+	}
+
+	void LooseOctree::InsertObject(uint32_t object, uint32_t start)
+	{
+		const AABB& box = m_objects[object].box;
+		float cx = 0.5f * (box.min.x + box.max.x);
+		float cy = 0.5f * (box.min.y + box.max.y);
+		float cz = 0.5f * (box.min.z + box.max.z);
+
+		// down to the deepest cell around the box center whose bounds still hold the box
+		uint32_t node = start;
+		while (m_nodes[node].depth < m_desc.maxDepth)
+		{
+			const Node& n = m_nodes[node];
+			uint32_t octant = Octant(n.center, cx, cy, cz);
+			float half = 0.5f * n.center.w;
+			Vector childCenter(
+				n.center.x + (octant & 1 ? half : -half),
+				n.center.y + (octant & 2 ? half : -half),
+				n.center.z + (octant & 4 ? half : -half),
+				0.0f);
+			if (!AABBContains(CubeBounds(childCenter, half * m_desc.looseness), box))
+				break;
+
+			uint32_t child = n.children[octant];
+			node = child != s_null ? child : AllocateNode(node, octant);
+		}
+
+		Object& o = m_objects[object];
+		Node& n = m_nodes[node];
+		o.node = node;
+		o.prev = s_null;
+		o.next = n.firstObject;
+		if (n.firstObject != s_null)
+			m_objects[n.firstObject].prev = object;
+		n.firstObject = object;
+		n.objectCount++;
+
+		for (uint32_t i = node; i != s_null; i = m_nodes[i].parent)
+			m_nodes[i].subtreeCount++;
+	}
+
+	void LooseOctree::RemoveObject(uint32_t object)
+	{
+		Object& o = m_objects[object];
+		Node& n = m_nodes[o.node];
+		if (o.prev != s_null)
+			m_objects[o.prev].next = o.next;
+		else
+			n.firstObject = o.next;
+		if (o.next != s_null)
+			m_objects[o.next].prev = o.prev;
+		n.objectCount--;
+
+		for (uint32_t i = o.node; i != s_null; i = m_nodes[i].parent)
+			m_nodes[i].subtreeCount--;
+
+		o.node = s_null;
+	}
+
+	// frees node and its ancestors while they hold no objects, the root is kept
+	void LooseOctree::Prune(uint32_t node)
+	{
+		while (node != 0 && m_nodes[node].subtreeCount == 0)
+		{
+			uint32_t parent = m_nodes[node].parent;
+			for (uint32_t& child : m_nodes[parent].children)
+			{
+				if (child == node)
+					child = s_null;
+			}
+
+			FreeNode(node);
+			node = parent;
+		}
+	}
+
+	// appends every object of the subtree without testing them
+	void LooseOctree::CollectSubtree(uint32_t node, std::vector<uint32_t>& objects) const
+	{
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = node;
+		while (stackSize > 0)
+		{
+			const Node& n = m_nodes[stack[--stackSize]];
+			for (uint32_t o = n.firstObject; o != s_null; o = m_objects[o].next)
+				objects.push_back(o);
+
+			for (uint32_t child : n.children)
+			{
+				if (child != s_null)
+					stack[stackSize++] = child;
+			}
+		}
+	}
+}
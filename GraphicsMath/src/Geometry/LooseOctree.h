@@ -0,0 +1,132 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "Ray.h"
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	struct LooseOctreeDesc
+	{
+		Vector center = Vector(0.0f, 0.0f, 0.0f, 1.0f);
+		float halfSize = 1024.0f; // half size of the root cell. Objects that do not fit in the root stay in it
+		uint32_t maxDepth = 8;    // [0, 32], the root is depth 0
+		float looseness = 2.0f;   // node bounds are the cell scaled by this, >= 1
+	};
+
+	/// <summary>
+	/// Octree over boxes where every node's bounds are its cell grown by the looseness factor, so an object
+	/// is stored in exactly one node: the deepest one whose cell contains the box center and whose bounds
+	/// contain the box. Insertion walks down the cells in O(depth).
+	/// Nodes and objects live in pools that only grow, handles are indices into them.
+	/// A node at depth d is the grid cell of size 2 * halfSize / 2^d, which maps onto streaming cells.
+	/// </summary>
+	class LooseOctree
+	{
+	public:
+		static constexpr uint32_t NullIndex = UINT32_MAX;
+
+		LooseOctree();
+		LooseOctree(const LooseOctreeDesc& desc);
+
+		void Reserve(uint32_t objectCount, uint32_t nodeCount);
+		void Clear();
+
+		uint32_t Insert(const AABB& box, uint32_t userData);
+		void Remove(uint32_t object);
+
+		/// <summary>
+		/// Returns false in O(1) when the box still fits the bounds of its node. Otherwise the object is
+		/// reinserted from the nearest ancestor that holds the box, and nodes left empty are freed.
+		/// </summary>
+		bool Move(uint32_t object, const AABB& box);
+
+		uint32_t GetUserData(uint32_t object) const;
+		const AABB& GetAABB(uint32_t object) const;
+		uint32_t GetObjectNode(uint32_t object) const;
+
+		// appends the objects whose box overlaps the region
+		void Query(const Frustum& frustum, std::vector<uint32_t>& objects) const;
+		void Query(const Sphere& region, std::vector<uint32_t>& objects) const;
+		void Query(const AABB& region, std::vector<uint32_t>& objects) const;
+
+		/// <summary>
+		/// Calls callback for every object whose box the ray hits. Children are visited in the order of the ray
+		/// direction, the objects of a node are not sorted. The callback returns the new ray tMax (ray.tMax to
+		/// continue unchanged, the hit distance to clip) or a negative value to stop the query.
+		/// </summary>
+		void RayCast(const Ray& ray, const std::function<float(uint32_t object, const Ray& ray)>& callback) const;
+
+		// nodes, for streaming and LOD heuristics. The root always exists and is node 0
+
+		uint32_t GetRoot() const;
+
+		// child i in [0, 7] or NullIndex, bit 0/1/2 of i selects the +/- half of axis x/y/z
+		uint32_t GetNodeChild(uint32_t node, uint32_t i) const;
+		uint32_t GetNodeParent(uint32_t node) const;
+		uint32_t GetNodeDepth(uint32_t node) const;
+
+		// objects stored in the node itself / in the node and all of its descendants
+		uint32_t GetNodeObjectCount(uint32_t node) const;
+		uint32_t GetNodeSubtreeObjectCount(uint32_t node) const;
+
+		// the objects stored in the node itself
+		void GetNodeObjects(uint32_t node, std::vector<uint32_t>& objects) const;
+
+		AABB GetNodeCell(uint32_t node) const;
+		AABB GetNodeBounds(uint32_t node) const;
+
+		// deepest existing node at most maxDepth deep whose cell contains point, the root for points outside
+		uint32_t FindNode(const Vector& point, uint32_t maxDepth) const;
+
+		uint32_t GetObjectCount() const;
+		uint32_t GetNodeCount() const;
+
+	private:
+		struct Node
+		{
+			Vector center;       // w = half size of the cell
+			uint32_t parent;     // next free node while the node is in the free list
+			uint32_t children[8];
+			uint32_t firstObject;
+			uint32_t objectCount;
+			uint32_t subtreeCount;
+			uint32_t depth;
+		};
+
+		struct Object
+		{
+			AABB box;
+			uint32_t userData;
+			uint32_t node;       // NullIndex while the object is in the free list
+			uint32_t prev;       // objects of a node form a doubly linked list
+			uint32_t next;       // next free object while the object is in the free list
+		};
+
+		uint32_t AllocateNode(uint32_t parent, uint32_t octant);
+		void FreeNode(uint32_t node);
+
+		bool Fits(uint32_t node, const AABB& box) const;
+		void InsertObject(uint32_t object, uint32_t start);
+		void RemoveObject(uint32_t object);
+
+		// frees node and its ancestors while they hold no objects, the root is kept
+		void Prune(uint32_t node);
+
+		// appends every object of the subtree without testing them
+		void CollectSubtree(uint32_t node, std::vector<uint32_t>& objects) const;
+
+		LooseOctreeDesc m_desc;
+
+		std::vector<Node> m_nodes;
+		uint32_t m_freeNodes;
+		uint32_t m_nodeCount;
+
+		std::vector<Object> m_objects;
+		uint32_t m_freeObjects;
+		uint32_t m_objectCount;
+	};
+}
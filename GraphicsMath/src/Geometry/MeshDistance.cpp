@@ -0,0 +1,541 @@
+#include "MeshDistance.h"
+#include "Core/JobSystem.h"
+#include "Math/SIMD.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_stackSize = 128;
+		constexpr uint32_t s_batchGrainSize = 256;
+		constexpr float s_inv4Pi = 0.0795774715f;
+
+		// the denominators of the closest point are squared lengths and areas, clamping them keeps degenerate
+		// triangles from producing 0 / 0
+		constexpr float s_minDenominator = 1.175494351e-38f;
+
+		// padding lanes sit so far away that their squared distance overflows to infinity
+		constexpr float s_paddingPosition = 1e30f;
+
+		struct StackEntry
+		{
+			uint32_t node;
+			float sqrDistance;
+		};
+
+		float SqrDistance(const BVHNode& node, const float* p)
+		{
+			float d = 0.0f;
+			for (int a = 0; a < 3; a++)
+			{
+				float e = std::max(std::max(node.min[a] - p[a], p[a] - node.max[a]), 0.0f);
+				d += e * e;
+			}
+
+			return d;
+		}
+
+		float SqrDistance(const float* a, const float* b)
+		{
+			float x = a[0] - b[0];
+			float y = a[1] - b[1];
+			float z = a[2] - b[2];
+			return x * x + y * y + z * z;
+		}
+
+		/// <summary>
+		/// Closest point on one triangle per lane, Ericson's "Real-Time Collision Detection" 5.1.5. The seven
+		/// Voronoi regions are tested as masks and the barycentrics of the first matching region are selected.
+		/// Returns the squared distance, the closest point is v0 + v * e1 + w * e2.
+		/// </summary>
+		Float8 ClosestPointTriangles(Float8 px, Float8 py, Float8 pz, Float8 v0x, Float8 v0y, Float8 v0z,
+			Float8 e1x, Float8 e1y, Float8 e1z, Float8 e2x, Float8 e2y, Float8 e2z, Float8& v, Float8& w)
+		{
+			Float8 zero(0.0f);
+			Float8 one(1.0f);
+			Float8 minDenominator(s_minDenominator);
+
+			Float8 apx = px - v0x;
+			Float8 apy = py - v0y;
+			Float8 apz = pz - v0z;
+			Float8 d1 = e1x * apx + e1y * apy + e1z * apz;
+			Float8 d2 = e2x * apx + e2y * apy + e2z * apz;
+
+			// p - v1 = ap - e1
+			Float8 d3 = d1 - (e1x * e1x + e1y * e1y + e1z * e1z);
+			Float8 d4 = d2 - (e2x * e1x + e2y * e1y + e2z * e1z);
+
+			// p - v2 = ap - e2
+			Float8 d5 = d1 - (e1x * e2x + e1y * e2y + e1z * e2z);
+			Float8 d6 = d2 - (e2x * e2x + e2y * e2y + e2z * e2z);
+
+			Float8 va = d3 * d6 - d5 * d4;
+			Float8 vb = d5 * d2 - d1 * d6;
+			Float8 vc = d1 * d4 - d3 * d2;
+
+			// face region, then every region overrides the ones after it in Ericson's order
+			Float8 denominator = one / Max(va + vb + vc, minDenominator);
+			v = vb * denominator;
+			w = vc * denominator;
+
+			Float8 d43 = d4 - d3;
+			Float8 d56 = d5 - d6;
+			Float8 edge12 = (va <= zero) & (d43 >= zero) & (d56 >= zero);
+			Float8 t12 = d43 / Max(d43 + d56, minDenominator);
+			v = Select(edge12, one - t12, v);
+			w = Select(edge12, t12, w);
+
+			Float8 edge02 = (vb <= zero) & (d2 >= zero) & (d6 <= zero);
+			v = Select(edge02, zero, v);
+			w = Select(edge02, d2 / Max(d2 - d6, minDenominator), w);
+
+			Float8 vertex2 = (d6 >= zero) & (d5 <= d6);
+			v = Select(vertex2, zero, v);
+			w = Select(vertex2, one, w);
+
+			Float8 edge01 = (vc <= zero) & (d1 >= zero) & (d3 <= zero);
+			v = Select(edge01, d1 / Max(d1 - d3, minDenominator), v);
+			w = Select(edge01, zero, w);
+
+			Float8 vertex1 = (d3 >= zero) & (d4 <= d3);
+			v = Select(vertex1, one, v);
+			w = Select(vertex1, zero, w);
+
+			Float8 vertex0 = (d1 <= zero) & (d2 <= zero);
+			v = Select(vertex0, zero, v);
+			w = Select(vertex0, zero, w);
+
+			Float8 dx = apx - v * e1x - w * e2x;
+			Float8 dy = apy - v * e1y - w * e2y;
+			Float8 dz = apz - v * e1z - w * e2z;
+			return dx * dx + dy * dy + dz * dz;
+		}
+	}
+
+	MeshDistance::MeshDistance()
+		: m_bvh(nullptr)
+	{
+	}
+
+	MeshDistance::MeshDistance(const MeshDistanceDesc& desc)
+		: m_desc(desc), m_bvh(nullptr)
+	{
+	}
+
+	MeshDistance::MeshDistance(const BVH& bvh, const TriangleMeshView& mesh)
+		: m_bvh(nullptr)
+	{
+		Set(bvh, mesh);
+	}
+
+	void MeshDistance::Set(const BVH& bvh, const TriangleMeshView& mesh)
+	{
+		m_bvh = &bvh;
+
+		const std::vector<BVHNode>& nodes = bvh.GetNodes();
+		const std::vector<uint32_t>& primIndices = bvh.GetPrimitiveIndices();
+
+		m_leafBlocks.assign(nodes.size(), UINT32_MAX);
+		uint32_t blockCount = 0;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(nodes.size()); i++)
+		{
+			if (!nodes[i].IsLeaf())
+				continue;
+
+			m_leafBlocks[i] = blockCount;
+			blockCount += (nodes[i].count + 7) / 8;
+		}
+
+		m_blocks.resize(blockCount);
+		JobSystem::ParallelFor(0, static_cast<uint32_t>(nodes.size()), 1024, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+				{
+					const BVHNode& node = nodes[i];
+					if (!node.IsLeaf())
+						continue;
+
+					for (uint32_t j = 0; j < (node.count + 7) / 8 * 8; j++)
+					{
+						TriangleBlock& block = m_blocks[m_leafBlocks[i] + j / 8];
+						uint32_t lane = j % 8;
+						if (j >= node.count)
+						{
+							for (int a = 0; a < 3; a++)
+							{
+								block.v0[a][lane] = s_paddingPosition;
+								block.e1[a][lane] = 0.0f;
+								block.e2[a][lane] = 0.0f;
+							}
+							block.triangles[lane] = UINT32_MAX;
+							continue;
+						}
+
+						uint32_t tri = primIndices[node.leftFirst + j];
+						const float* p0 = mesh.GetTrianglePosition(tri, 0);
+						const float* p1 = mesh.GetTrianglePosition(tri, 1);
+						const float* p2 = mesh.GetTrianglePosition(tri, 2);
+						for (int a = 0; a < 3; a++)
+						{
+							block.v0[a][lane] = p0[a];
+							block.e1[a][lane] = p1[a] - p0[a];
+							block.e2[a][lane] = p2[a] - p0[a];
+						}
+						block.triangles[lane] = tri;
+					}
+				}
+			});
+
+		BuildWindingNodes();
+	}
+
+	void MeshDistance::Clear()
+	{
+		m_bvh = nullptr;
+		m_blocks.clear();
+		m_leafBlocks.clear();
+		m_windingNodes.clear();
+	}
+
+	void MeshDistance::SetDesc(const MeshDistanceDesc& desc)
+	{
+		m_desc = desc;
+	}
+
+	const MeshDistanceDesc& MeshDistance::GetDesc() const
+	{
+		return m_desc;
+	}
+
+	void MeshDistance::BuildWindingNodes()
+	{
+		const std::vector<BVHNode>& nodes = m_bvh->GetNodes();
+		m_windingNodes.resize(nodes.size());
+
+		// children always come after their parent, so a reverse sweep sees both children of a node first
+		for (uint32_t i = static_cast<uint32_t>(nodes.size()); i-- > 0;)
+		{
+			const BVHNode& node = nodes[i];
+			WindingNode& wn = m_windingNodes[i];
+			double center[3] = { 0.0, 0.0, 0.0 };
+			double normal[3] = { 0.0, 0.0, 0.0 };
+			double area = 0.0;
+			float radius = 0.0f;
+
+			if (node.IsLeaf())
+			{
+				uint32_t firstBlock = m_leafBlocks[i];
+				uint32_t weightCount = 0;
+				double centroidSum[3] = { 0.0, 0.0, 0.0 };
+				for (uint32_t j = 0; j < node.count; j++)
+				{
+					const TriangleBlock& b = m_blocks[firstBlock + j / 8];
+					uint32_t lane = j % 8;
+					float e1[3] = { b.e1[0][lane], b.e1[1][lane], b.e1[2][lane] };
+					float e2[3] = { b.e2[0][lane], b.e2[1][lane], b.e2[2][lane] };
+					double n[3] = {
+						0.5 * (static_cast<double>(e1[1]) * e2[2] - static_cast<double>(e1[2]) * e2[1]),
+						0.5 * (static_cast<double>(e1[2]) * e2[0] - static_cast<double>(e1[0]) * e2[2]),
+						0.5 * (static_cast<double>(e1[0]) * e2[1] - static_cast<double>(e1[1]) * e2[0]) };
+					double a = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					for (int c = 0; c < 3; c++)
+					{
+						double centroid = b.v0[c][lane] + (static_cast<double>(e1[c]) + e2[c]) / 3.0;
+						center[c] += a * centroid;
+						centroidSum[c] += centroid;
+						normal[c] += n[c];
+					}
+					area += a;
+					weightCount++;
+				}
+
+				for (int c = 0; c < 3; c++)
+					center[c] = area > 0.0 ? center[c] / area : centroidSum[c] / std::max(weightCount, 1u);
+
+				float c[3] = { static_cast<float>(center[0]), static_cast<float>(center[1]), static_cast<float>(center[2]) };
+				for (uint32_t j = 0; j < node.count; j++)
+				{
+					const TriangleBlock& b = m_blocks[firstBlock + j / 8];
+					uint32_t lane = j % 8;
+					float v0[3] = { b.v0[0][lane], b.v0[1][lane], b.v0[2][lane] };
+					float v1[3] = { v0[0] + b.e1[0][lane], v0[1] + b.e1[1][lane], v0[2] + b.e1[2][lane] };
+					float v2[3] = { v0[0] + b.e2[0][lane], v0[1] + b.e2[1][lane], v0[2] + b.e2[2][lane] };
+					radius = std::max(radius, std::max(SqrDistance(c, v0), std::max(SqrDistance(c, v1), SqrDistance(c, v2))));
+				}
+				radius = sqrtf(radius);
+			}
+			else
+			{
+				const WindingNode& left = m_windingNodes[node.leftFirst];
+				const WindingNode& right = m_windingNodes[node.leftFirst + 1];
+				area = static_cast<double>(left.area) + right.area;
+				for (int c = 0; c < 3; c++)
+				{
+					center[c] = area > 0.0 ? (static_cast<double>(left.center[c]) * left.area + static_cast<double>(right.center[c]) * right.area) / area
+						: 0.5 * (static_cast<double>(left.center[c]) + right.center[c]);
+					normal[c] = static_cast<double>(left.normal[c]) + right.normal[c];
+				}
+
+				float c[3] = { static_cast<float>(center[0]), static_cast<float>(center[1]), static_cast<float>(center[2]) };
+				radius = std::max(sqrtf(SqrDistance(c, left.center)) + left.radius, sqrtf(SqrDistance(c, right.center)) + right.radius);
+			}
+
+			// the farthest corner of the node bounds also holds every triangle, whichever is smaller
+			float corner = 0.0f;
+			for (int c = 0; c < 3; c++)
+			{
+				float e = std::max(fabsf(static_cast<float>(center[c]) - node.min[c]), fabsf(node.max[c] - static_cast<float>(center[c])));
+				corner += e * e;
+			}
+
+			for (int c = 0; c < 3; c++)
+			{
+				wn.center[c] = static_cast<float>(center[c]);
+				wn.normal[c] = static_cast<float>(normal[c]);
+			}
+			wn.radius = std::min(radius, sqrtf(corner));
+			wn.area = static_cast<float>(area);
+		}
+	}
+
+	void MeshDistance::ClosestPointLeaf(uint32_t nodeIndex, uint32_t count, const float* p, float& bestSqrDistance, MeshClosestPoint& result) const
+	{
+		Float8 px(p[0]), py(p[1]), pz(p[2]);
+
+		uint32_t firstBlock = m_leafBlocks[nodeIndex];
+		uint32_t lastBlock = firstBlock + (count + 7) / 8;
+		for (uint32_t i = firstBlock; i < lastBlock; i++)
+		{
+			const TriangleBlock& b = m_blocks[i];
+
+			Float8 v, w;
+			Float8 d = ClosestPointTriangles(px, py, pz,
+				Float8::Load(b.v0[0]), Float8::Load(b.v0[1]), Float8::Load(b.v0[2]),
+				Float8::Load(b.e1[0]), Float8::Load(b.e1[1]), Float8::Load(b.e1[2]),
+				Float8::Load(b.e2[0]), Float8::Load(b.e2[1]), Float8::Load(b.e2[2]), v, w);
+
+			if (!MoveMask(d < Float8(bestSqrDistance)))
+				continue;
+
+			alignas(32) float dLanes[8], vLanes[8], wLanes[8];
+			d.Store(dLanes);
+			v.Store(vLanes);
+			w.Store(wLanes);
+			for (uint32_t lane = 0; lane < 8; lane++)
+			{
+				if (!(dLanes[lane] < bestSqrDistance))
+					continue;
+
+				bestSqrDistance = dLanes[lane];
+				result.u = vLanes[lane];
+				result.v = wLanes[lane];
+				result.triangle = b.triangles[lane];
+				result.point = Vector(
+					b.v0[0][lane] + result.u * b.e1[0][lane] + result.v * b.e2[0][lane],
+					b.v0[1][lane] + result.u * b.e1[1][lane] + result.v * b.e2[1][lane],
+					b.v0[2][lane] + result.u * b.e1[2][lane] + result.v * b.e2[2][lane], 1.0f);
+			}
+		}
+	}
+
+	MeshClosestPoint MeshDistance::ClosestPoint(const Vector& p, float maxDistance) const
+	{
+		MeshClosestPoint result;
+		if (!m_bvh || m_leafBlocks.empty())
+			return result;
+
+		const BVHNode* nodes = m_bvh->GetNodes().data();
+		float point[3] = { p.x, p.y, p.z };
+		float best = maxDistance < sqrtf(FLT_MAX) ? maxDistance * maxDistance : FLT_MAX;
+
+		StackEntry stack[s_stackSize];
+		uint32_t stackSize = 0;
+		float rootDistance = SqrDistance(nodes[0], point);
+		if (rootDistance < best)
+			stack[stackSize++] = { 0, rootDistance };
+
+		while (stackSize > 0)
+		{
+			StackEntry entry = stack[--stackSize];
+			if (entry.sqrDistance >= best)
+				continue;
+
+			uint32_t nodeIndex = entry.node;
+			while (true)
+			{
+				const BVHNode& node = nodes[nodeIndex];
+				if (node.IsLeaf())
+				{
+					ClosestPointLeaf(nodeIndex, node.count, point, best, result);
+					break;
+				}
+
+				uint32_t nearChild = node.leftFirst;
+				uint32_t farChild = node.leftFirst + 1;
+				float dNear = SqrDistance(nodes[nearChild], point);
+				float dFar = SqrDistance(nodes[farChild], point);
+				if (dFar < dNear)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(dNear, dFar);
+				}
+
+				if (dNear >= best)
+					break;
+
+				if (dFar < best)
+				{
+					assert(stackSize < s_stackSize && "bvh is too deep for the traversal stack");
+					stack[stackSize++] = { farChild, dFar };
+				}
+				nodeIndex = nearChild;
+			}
+		}
+
+		if (result.IsValid())
+			result.distance = sqrtf(best);
+
+		return result;
+	}
+
+	float MeshDistance::WindingNumberLeaf(uint32_t nodeIndex, uint32_t count, const float* p) const
+	{
+		Float8 px(p[0]), py(p[1]), pz(p[2]);
+
+		float sum = 0.0f;
+		uint32_t firstBlock = m_leafBlocks[nodeIndex];
+		uint32_t lastBlock = firstBlock + (count + 7) / 8;
+		for (uint32_t i = firstBlock; i < lastBlock; i++)
+		{
+			const TriangleBlock& b = m_blocks[i];
+
+			// solid angle of the triangle (a, b, c) relative to p, Van Oosterom and Strackee:
+			// tan(omega / 2) = det(a, b, c) / (|a||b||c| + (a.b)|c| + (b.c)|a| + (c.a)|b|)
+			Float8 ax = Float8::Load(b.v0[0]) - px;
+			Float8 ay = Float8::Load(b.v0[1]) - py;
+			Float8 az = Float8::Load(b.v0[2]) - pz;
+			Float8 bx = ax + Float8::Load(b.e1[0]);
+			Float8 by = ay + Float8::Load(b.e1[1]);
+			Float8 bz = az + Float8::Load(b.e1[2]);
+			Float8 cx = ax + Float8::Load(b.e2[0]);
+			Float8 cy = ay + Float8::Load(b.e2[1]);
+			Float8 cz = az + Float8::Load(b.e2[2]);
+
+			Float8 la = Sqrt(ax * ax + ay * ay + az * az);
+			Float8 lb = Sqrt(bx * bx + by * by + bz * bz);
+			Float8 lc = Sqrt(cx * cx + cy * cy + cz * cz);
+			Float8 det = ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx);
+			Float8 denominator = la * lb * lc + (ax * bx + ay * by + az * bz) * lc + (bx * cx + by * cy + bz * cz) * la + (cx * ax + cy * ay + cz * az) * lb;
+
+			alignas(32) float detLanes[8], denominatorLanes[8];
+			det.Store(detLanes);
+			denominator.Store(denominatorLanes);
+			for (uint32_t lane = 0; lane < 8; lane++)
+			{
+				if (b.triangles[lane] != UINT32_MAX)
+					sum += 2.0f * atan2f(detLanes[lane], denominatorLanes[lane]);
+			}
+		}
+
+		return sum * s_inv4Pi;
+	}
+
+	float MeshDistance::WindingNumber(const Vector& p) const
+	{
+		if (!m_bvh || m_leafBlocks.empty())
+			return 0.0f;
+
+		const BVHNode* nodes = m_bvh->GetNodes().data();
+		float point[3] = { p.x, p.y, p.z };
+		float accuracy = m_desc.windingAccuracy * m_desc.windingAccuracy;
+
+		float sum = 0.0f;
+		uint32_t stack[s_stackSize];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			uint32_t nodeIndex = stack[--stackSize];
+			const BVHNode& node = nodes[nodeIndex];
+			const WindingNode& wn = m_windingNodes[nodeIndex];
+
+			// far field: the node as one dipole at its center, dot(normal, center - p) / (4 pi |center - p|^3)
+			float d[3] = { wn.center[0] - point[0], wn.center[1] - point[1], wn.center[2] - point[2] };
+			float sqrDistance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+			if (sqrDistance > accuracy * wn.radius * wn.radius)
+			{
+				float distance = sqrtf(sqrDistance);
+				sum += (wn.normal[0] * d[0] + wn.normal[1] * d[1] + wn.normal[2] * d[2]) * s_inv4Pi / (sqrDistance * distance);
+				continue;
+			}
+
+			if (node.IsLeaf())
+			{
+				sum += WindingNumberLeaf(nodeIndex, node.count, point);
+				continue;
+			}
+
+			assert(stackSize + 2 <= s_stackSize && "bvh is too deep for the traversal stack");
+			stack[stackSize++] = node.leftFirst;
+			stack[stackSize++] = node.leftFirst + 1;
+		}
+
+		return sum;
+	}
+
+	bool MeshDistance::IsInside(const Vector& p) const
+	{
+		return WindingNumber(p) > 0.5f;
+	}
+
+	float MeshDistance::SignedDistance(const Vector& p, float maxDistance) const
+	{
+		MeshClosestPoint closest = ClosestPoint(p, maxDistance);
+		float distance = closest.IsValid() ? closest.distance : maxDistance;
+		return IsInside(p) ? -distance : distance;
+	}
+
+	template<typename Fn>
+	void MeshDistance::ForEachPoint(uint32_t count, const Fn& fn) const
+	{
+		if (!m_desc.multithreaded || JobSystem::GetThreadCount() == 1 || count <= s_batchGrainSize)
+		{
+			fn(0, count);
+			return;
+		}
+
+		JobSystem::ParallelFor(0, count, s_batchGrainSize, fn);
+	}
+
+	void MeshDistance::ClosestPoints(const Vector* points, uint32_t count, MeshClosestPoint* results, float maxDistance) const
+	{
+		ForEachPoint(count, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+					results[i] = ClosestPoint(points[i], maxDistance);
+			});
+	}
+
+	void MeshDistance::WindingNumbers(const Vector* points, uint32_t count, float* windingNumbers) const
+	{
+		ForEachPoint(count, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+					windingNumbers[i] = WindingNumber(points[i]);
+			});
+	}
+
+	void MeshDistance::SignedDistances(const Vector* points, uint32_t count, float* distances, float maxDistance) const
+	{
+		ForEachPoint(count, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+					distances[i] = SignedDistance(points[i], maxDistance);
+			});
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "BVH.h"
+#include "TriangleMesh.h"
+#include "Math/Types.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	struct MeshClosestPoint
+	{
+		Vector point;
+		float distance = 3.402823466e+38f;
+		float u = 0.0f; // barycentrics, point = (1 - u - v) * p0 + u * p1 + v * p2
+		float v = 0.0f;
+		uint32_t triangle = UINT32_MAX; // UINT32_MAX when no triangle is within the search distance
+
+		bool IsValid() const { return triangle != UINT32_MAX; }
+	};
+
+	struct MeshDistanceDesc
+	{
+		// a node seen from further than windingAccuracy * its radius is summed as a single dipole. The error of
+		// the winding number falls with the square of it: about 0.05 at worst and 0.005 on average for 2,
+		// far from the 0.5 that separates inside and outside
+		float windingAccuracy = 2.0f;
+
+		bool multithreaded = true;
+	};
+
+	/// <summary>
+	/// Closest point, winding number and signed distance queries against a BVH.
+	/// Leaf triangles are copied into 8-wide structure of arrays blocks, the closest point on 8 triangles is found
+	/// at once with Ericson's Voronoi region tests evaluated as masks. The nearest search visits the closer child
+	/// first and skips every node whose bounds are further than the best distance so far.
+	///
+	/// The sign comes from the generalized winding number (Barill et al. 2018, "Fast Winding Numbers for Soups and
+	/// Clouds"): exact solid angles for the leaves near the point, the area weighted normal of a node as a dipole
+	/// for nodes far away. It is about 1 inside and 0 outside of a closed mesh and still degrades gracefully with
+	/// holes, flipped triangles or self intersections where ray parity fails.
+	/// Triangles are expected counter clockwise seen from the outside.
+	/// </summary>
+	class MeshDistance
+	{
+	public:
+		MeshDistance();
+		MeshDistance(const MeshDistanceDesc& desc);
+		MeshDistance(const BVH& bvh, const TriangleMeshView& mesh);
+
+		/// <summary>
+		/// Keeps a pointer to the bvh and copies the leaf triangles out of the mesh.
+		/// Must be called again after BVH::Build, Refit or Optimize.
+		/// </summary>
+		void Set(const BVH& bvh, const TriangleMeshView& mesh);
+		void Clear();
+
+		void SetDesc(const MeshDistanceDesc& desc);
+		const MeshDistanceDesc& GetDesc() const;
+
+		// closest point on the mesh within maxDistance, nodes further away are never visited
+		MeshClosestPoint ClosestPoint(const Vector& p, float maxDistance = 3.402823466e+38f) const;
+
+		// about 1 inside, 0 outside
+		float WindingNumber(const Vector& p) const;
+		bool IsInside(const Vector& p) const;
+
+		// negative inside. Points further than maxDistance from the mesh get +-maxDistance
+		float SignedDistance(const Vector& p, float maxDistance = 3.402823466e+38f) const;
+
+		// batch versions, split over the job system
+		void ClosestPoints(const Vector* points, uint32_t count, MeshClosestPoint* results, float maxDistance = 3.402823466e+38f) const;
+		void WindingNumbers(const Vector* points, uint32_t count, float* windingNumbers) const;
+		void SignedDistances(const Vector* points, uint32_t count, float* distances, float maxDistance = 3.402823466e+38f) const;
+
+	private:
+		struct alignas(32) TriangleBlock
+		{
+			float v0[3][8];
+			float e1[3][8];
+			float e2[3][8];
+			uint32_t triangles[8]; // UINT32_MAX for padding lanes
+		};
+
+		// per node far field of the winding number
+		struct WindingNode
+		{
+			float center[3]; // area weighted centroid
+			float radius;    // of the sphere around center holding every triangle of the node
+			float normal[3]; // sum of the area weighted normals
+			float area;
+		};
+
+		void BuildWindingNodes();
+		void ClosestPointLeaf(uint32_t nodeIndex, uint32_t count, const float* p, float& bestSqrDistance, MeshClosestPoint& result) const;
+		float WindingNumberLeaf(uint32_t nodeIndex, uint32_t count, const float* p) const;
+
+		template<typename Fn>
+		void ForEachPoint(uint32_t count, const Fn& fn) const;
+
+		MeshDistanceDesc m_desc;
+
+		const BVH* m_bvh;
+		std::vector<TriangleBlock> m_blocks;
+		std::vector<uint32_t> m_leafBlocks; // per node index of the first block, blocks of a leaf are contiguous
+		std::vector<WindingNode> m_windingNodes;
+	};
+}
@@ -0,0 +1,1091 @@
+#include "QuickHull.h"
+#include "Core/JobSystem.h"
+#include "Math/SIMD.h"
+
+#include <assert.h>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_none = UINT32_MAX;
+		constexpr uint32_t s_grainSize = 4096;
+
+		struct Extremes
+		{
+			float min[3];
+			float max[3];
+			uint32_t minIndex[3];
+			uint32_t maxIndex[3];
+		};
+	}
+
+	void HullMesh::Clear()
+	{
+		vertices.clear();
+		vertexEdges.clear();
+		edges.clear();
+		faces.clear();
+	}
+
+	// hill climbing over the vertices of the faces around the current vertex, returns the vertex farthest along dir.
+	// Walking whole faces instead of the edge neighbours does not stop at a vertex that bulges out of a long edge of
+	// a merged face. Starting from the result of the previous frame makes it close to O(1) for coherent queries
+	uint32_t HullMeshSupport(const HullMesh& hull, const Vector& dir, uint32_t start)
+	{
+		assert(start < hull.vertices.size() && "start is not a vertex of the hull");
+
+		uint32_t v = start;
+		float best = hull.vertices[v].x * dir.x + hull.vertices[v].y * dir.y + hull.vertices[v].z * dir.z;
+		for (;;)
+		{
+			uint32_t bestNeighbour = v;
+			uint32_t first = hull.vertexEdges[v];
+			uint32_t e = first;
+			do
+			{
+				// the face left of e, from the vertex after v back to the one before it
+				for (uint32_t f = hull.edges[e].next; f != e; f = hull.edges[f].next)
+				{
+					const HullHalfEdge& edge = hull.edges[f];
+					const Vector& p = hull.vertices[edge.origin];
+					float d = p.x * dir.x + p.y * dir.y + p.z * dir.z;
+					if (d > best)
+					{
+						best = d;
+						bestNeighbour = edge.origin;
+					}
+				}
+				e = hull.edges[e ^ 1].next;
+			} while (e != first);
+
+			if (bestNeighbour == v)
+				return v;
+
+			v = bestNeighbour;
+		}
+	}
+
+	// GJK shape over the hull vertices, the hull must outlive the shape
+	ConvexShape ConvexHull(const HullMesh& hull, const Matrix& transform)
+	{
+		assert(!hull.IsEmpty() && "empty hull");
+		return ConvexHull(hull.vertices.data(), static_cast<uint32_t>(hull.vertices.size()), transform);
+	}
+
+	QuickHull::QuickHull()
+		: QuickHull(QuickHullDesc())
+	{
+	}
+
+	QuickHull::QuickHull(const QuickHullDesc& desc)
+		: m_desc(desc), m_center(0.0f, 0.0f, 0.0f, 0.0f), m_epsilon(0.0f), m_mergeTolerance(0.0f), m_iteration(0),
+		m_outsideSize(0), m_outsideGarbage(0)
+	{
+	}
+
+	bool QuickHull::Build(const Vector* points, uint32_t count, HullMesh& hull)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		hull.Clear();
+		m_stats = QuickHullStats();
+		m_faces.clear();
+		m_freeFaces.clear();
+		m_pending.clear();
+		m_outsideSize = 0;
+		m_outsideGarbage = 0;
+		m_iteration = 0;
+
+		bool built = false;
+		if (count >= 4)
+		{
+			// bounds and extreme points, the first index wins ties so the result does not depend on the chunking
+			uint32_t chunkCount = Parallel(count) ? JobSystem::ComputeChunkCount(count, s_grainSize) : 1;
+			std::vector<Extremes> chunkExtremes(chunkCount);
+			JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+				{
+					Extremes e;
+					for (int a = 0; a < 3; a++)
+					{
+						e.min[a] = e.max[a] = points[first][a];
+						e.minIndex[a] = e.maxIndex[a] = first;
+					}
+
+					for (uint32_t i = first + 1; i < last; i++)
+					{
+						for (int a = 0; a < 3; a++)
+						{
+							float f = points[i][a];
+							if (f < e.min[a])
+							{
+								e.min[a] = f;
+								e.minIndex[a] = i;
+							}
+							if (f > e.max[a])
+							{
+								e.max[a] = f;
+								e.maxIndex[a] = i;
+							}
+						}
+					}
+					chunkExtremes[chunk] = e;
+				});
+
+			Extremes bounds = chunkExtremes[0];
+			for (uint32_t c = 1; c < chunkCount; c++)
+			{
+				const Extremes& e = chunkExtremes[c];
+				for (int a = 0; a < 3; a++)
+				{
+					if (e.min[a] < bounds.min[a])
+					{
+						bounds.min[a] = e.min[a];
+						bounds.minIndex[a] = e.minIndex[a];
+					}
+					if (e.max[a] > bounds.max[a])
+					{
+						bounds.max[a] = e.max[a];
+						bounds.maxIndex[a] = e.maxIndex[a];
+					}
+				}
+			}
+
+			// the input is only exact to the precision of its largest coordinates, the work is done relative to the
+			// center of the bounds so the planes do not lose more
+			float maxSum = 0.0f;
+			for (int a = 0; a < 3; a++)
+				maxSum += fmaxf(fabsf(bounds.min[a]), fabsf(bounds.max[a]));
+			m_epsilon = m_desc.epsilon > 0.0f ? m_desc.epsilon : 3.0f * FLT_EPSILON * maxSum;
+			m_center = Vector(
+				0.5f * (bounds.min[0] + bounds.max[0]),
+				0.5f * (bounds.min[1] + bounds.max[1]),
+				0.5f * (bounds.min[2] + bounds.max[2]),
+				0.0f);
+
+			m_points.resize(count);
+			m_vertexMarks.assign(count, 0);
+			JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t, uint32_t first, uint32_t last)
+				{
+					for (uint32_t i = first; i < last; i++)
+						m_points[i] = { points[i].x - m_center.x, points[i].y - m_center.y, points[i].z - m_center.z, i };
+				});
+
+			uint32_t extremes[6];
+			for (int a = 0; a < 3; a++)
+			{
+				extremes[a * 2] = bounds.minIndex[a];
+				extremes[a * 2 + 1] = bounds.maxIndex[a];
+			}
+
+			if (BuildInitialHull(extremes))
+			{
+				// first in first out: the faces around the early, far points are refined before the points
+				// near them are moved again, about a third fewer reassignments than depth first on scans
+				size_t head = 0;
+				while (head < m_pending.size())
+				{
+					uint32_t face = m_pending[head];
+					if (!m_faces[face].alive || m_faces[face].outsideCount == 0)
+					{
+						if (++head >= 4096 && head * 2 >= m_pending.size())
+						{
+							m_pending.erase(m_pending.begin(), m_pending.begin() + head);
+							head = 0;
+						}
+						continue;
+					}
+
+					AddPoint(face);
+				}
+
+				ExtractMesh(points, hull);
+				built = true;
+			}
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_stats.buildTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+		m_stats.epsilon = m_epsilon;
+		m_stats.vertexCount = static_cast<uint32_t>(hull.vertices.size());
+		m_stats.faceCount = static_cast<uint32_t>(hull.faces.size());
+		return built;
+	}
+
+	void QuickHull::SetDesc(const QuickHullDesc& desc)
+	{
+		m_desc = desc;
+	}
+
+	const QuickHullDesc& QuickHull::GetDesc() const
+	{
+		return m_desc;
+	}
+
+	const QuickHullStats& QuickHull::GetStats() const
+	{
+		return m_stats;
+	}
+
+	// extremes: index of the min and max point along x, y and z
+	bool QuickHull::BuildInitialHull(const uint32_t* extremes)
+	{
+		// the widest axis gives the first edge, then the point farthest from its line and the one farthest
+		// from the plane of the triangle
+		uint32_t i0 = 0, i1 = 0;
+		float widest = -1.0f;
+		for (int a = 0; a < 3; a++)
+		{
+			const float* min = &m_points[extremes[a * 2]].x;
+			const float* max = &m_points[extremes[a * 2 + 1]].x;
+			if (max[a] - min[a] > widest)
+			{
+				widest = max[a] - min[a];
+				i0 = extremes[a * 2];
+				i1 = extremes[a * 2 + 1];
+			}
+		}
+		if (widest <= m_epsilon)
+			return false;
+
+		const Point p0 = m_points[i0];
+		const Point p1 = m_points[i1];
+		float ux = p1.x - p0.x, uy = p1.y - p0.y, uz = p1.z - p0.z;
+		float uu = ux * ux + uy * uy + uz * uz;
+		uint32_t i2 = FindFarthest([&](const Point& p)
+			{
+				float dx = p.x - p0.x, dy = p.y - p0.y, dz = p.z - p0.z;
+				float cx = dy * uz - dz * uy, cy = dz * ux - dx * uz, cz = dx * uy - dy * ux;
+				return cx * cx + cy * cy + cz * cz;
+			});
+
+		const Point p2 = m_points[i2];
+		float vx = p2.x - p0.x, vy = p2.y - p0.y, vz = p2.z - p0.z;
+		float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+		float nn = nx * nx + ny * ny + nz * nz;
+		if (nn <= m_epsilon * m_epsilon * uu)
+			return false;
+
+		uint32_t i3 = FindFarthest([&](const Point& p)
+			{
+				return fabsf(nx * (p.x - p0.x) + ny * (p.y - p0.y) + nz * (p.z - p0.z));
+			});
+
+		const Point p3 = m_points[i3];
+		float height = nx * (p3.x - p0.x) + ny * (p3.y - p0.y) + nz * (p3.z - p0.z);
+		if (fabsf(height) <= m_epsilon * sqrtf(nn))
+			return false;
+
+		// the base faces away from the apex
+		if (height > 0.0f)
+		{
+			uint32_t swap = i1;
+			i1 = i2;
+			i2 = swap;
+		}
+
+		uint32_t faces[4] = {
+			AllocateFace(i0, i1, i2),
+			AllocateFace(i1, i0, i3),
+			AllocateFace(i2, i1, i3),
+			AllocateFace(i0, i2, i3) };
+
+		for (uint32_t f : faces)
+		{
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t a = m_faces[f].v[k], b = m_faces[f].v[(k + 1) % 3];
+				for (uint32_t g : faces)
+				{
+					for (uint32_t j = 0; j < 3; j++)
+					{
+						if (m_faces[g].v[j] == b && m_faces[g].v[(j + 1) % 3] == a)
+							m_faces[f].twin[k] = g * 3 + j;
+					}
+				}
+			}
+		}
+
+		m_orphans.clear();
+		m_orphans.reserve(m_points.size());
+		for (const Point& p : m_points)
+		{
+			if (p.index != i0 && p.index != i1 && p.index != i2 && p.index != i3)
+				m_orphans.push_back(p);
+		}
+		AssignOrphans(faces, 4);
+
+		for (uint32_t f : faces)
+		{
+			if (m_faces[f].outsideCount > 0)
+				m_pending.push_back(f);
+		}
+
+		return true;
+	}
+
+	uint32_t QuickHull::AllocateFace(uint32_t a, uint32_t b, uint32_t c)
+	{
+		uint32_t index;
+		if (!m_freeFaces.empty())
+		{
+			index = m_freeFaces.back();
+			m_freeFaces.pop_back();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(m_faces.size());
+			m_faces.emplace_back();
+		}
+
+		Face& f = m_faces[index];
+		f.v[0] = a;
+		f.v[1] = b;
+		f.v[2] = c;
+		f.twin[0] = f.twin[1] = f.twin[2] = s_none;
+		f.outsideBegin = 0;
+		f.outsideCount = 0;
+		f.mark = 0;
+		f.alive = true;
+
+		// the cross product of thin triangles cancels badly in float
+		const Point& pa = m_points[a];
+		const Point& pb = m_points[b];
+		const Point& pc = m_points[c];
+		double ux = static_cast<double>(pb.x) - pa.x, uy = static_cast<double>(pb.y) - pa.y, uz = static_cast<double>(pb.z) - pa.z;
+		double vx = static_cast<double>(pc.x) - pa.x, vy = static_cast<double>(pc.y) - pa.y, vz = static_cast<double>(pc.z) - pa.z;
+		double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+		double length = sqrt(nx * nx + ny * ny + nz * nz);
+		if (length > 0.0)
+		{
+			nx /= length;
+			ny /= length;
+			nz /= length;
+		}
+
+		double cx = (static_cast<double>(pa.x) + pb.x + pc.x) / 3.0;
+		double cy = (static_cast<double>(pa.y) + pb.y + pc.y) / 3.0;
+		double cz = (static_cast<double>(pa.z) + pb.z + pc.z) / 3.0;
+		f.normal[0] = static_cast<float>(nx);
+		f.normal[1] = static_cast<float>(ny);
+		f.normal[2] = static_cast<float>(nz);
+		f.distance = static_cast<float>(nx * cx + ny * cy + nz * cz);
+		return index;
+	}
+
+	// depth first walk over the faces that see the eye. The edges to the faces that do not see it are added in
+	// the order of the walk, which goes around the eye.
+	// A face sees the eye as soon as the eye is above its plane, not only above epsilon: a face kept with the eye
+	// slightly above it would leave a concave edge to the cone and an ill-conditioned plane
+	bool QuickHull::FindHorizon(uint32_t face, const Point& eye)
+	{
+		m_visible.clear();
+		m_horizon.clear();
+		m_stack.clear();
+
+		m_faces[face].mark = m_iteration;
+		m_visible.push_back(face);
+
+		// (next edge to cross, edges left) per visited face. The first face crosses its 3 edges, the others the
+		// 2 edges after the one they were entered from
+		m_stack.push_back(face * 3);
+		m_stack.push_back(3);
+		while (!m_stack.empty())
+		{
+			size_t top = m_stack.size();
+			uint32_t edge = m_stack[top - 2];
+			if (m_stack[top - 1] == 0)
+			{
+				m_stack.resize(top - 2);
+				continue;
+			}
+
+			uint32_t f = edge / 3, k = edge % 3;
+			m_stack[top - 2] = f * 3 + (k + 1) % 3;
+			m_stack[top - 1]--;
+
+			uint32_t twin = m_faces[f].twin[k];
+			uint32_t neighbour = twin / 3;
+			if (m_faces[neighbour].mark == m_iteration)
+				continue;
+
+			if (Distance(m_faces[neighbour], eye) > 0.0f)
+			{
+				m_faces[neighbour].mark = m_iteration;
+				m_visible.push_back(neighbour);
+				m_stack.push_back(neighbour * 3 + (twin % 3 + 1) % 3);
+				m_stack.push_back(2);
+			}
+			else
+			{
+				m_horizon.push_back(edge);
+			}
+		}
+
+		// the horizon must be one loop through distinct vertices
+		size_t count = m_horizon.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t edge = m_horizon[i], next = m_horizon[(i + 1) % count];
+			uint32_t v = m_faces[edge / 3].v[edge % 3];
+			if (m_vertexMarks[v] == m_iteration || m_faces[edge / 3].v[(edge % 3 + 1) % 3] != m_faces[next / 3].v[next % 3])
+				return false;
+
+			m_vertexMarks[v] = m_iteration;
+		}
+
+		return count >= 3;
+	}
+
+	void QuickHull::AddPoint(uint32_t face)
+	{
+		m_iteration++;
+
+		uint32_t eyeIndex = m_outside[m_faces[face].outsideBegin].index;
+		if (!FindHorizon(face, m_points[eyeIndex]))
+		{
+			DropFurthest(face);
+			return;
+		}
+
+		m_orphans.clear();
+		for (uint32_t f : m_visible)
+		{
+			const Face& visible = m_faces[f];
+			for (uint32_t i = visible.outsideBegin; i < visible.outsideBegin + visible.outsideCount; i++)
+			{
+				if (m_outside[i].index != eyeIndex)
+					m_orphans.push_back(m_outside[i]);
+			}
+			m_outsideGarbage += visible.outsideCount;
+		}
+
+		m_stats.iterations++;
+
+		// a cone of faces from the horizon to the eye. The visible faces are freed afterwards so the horizon
+		// stays readable while the cone is built
+		m_newFaces.clear();
+		for (uint32_t edge : m_horizon)
+		{
+			uint32_t f = edge / 3, k = edge % 3;
+			uint32_t a = m_faces[f].v[k], b = m_faces[f].v[(k + 1) % 3];
+			uint32_t twin = m_faces[f].twin[k];
+
+			uint32_t n = AllocateFace(a, b, eyeIndex);
+			m_faces[n].twin[0] = twin;
+			m_faces[twin / 3].twin[twin % 3] = n * 3;
+			m_newFaces.push_back(n);
+		}
+
+		uint32_t newCount = static_cast<uint32_t>(m_newFaces.size());
+		for (uint32_t i = 0; i < newCount; i++)
+		{
+			uint32_t n = m_newFaces[i], next = m_newFaces[(i + 1) % newCount];
+			m_faces[n].twin[1] = next * 3 + 2;
+			m_faces[next].twin[2] = n * 3 + 1;
+		}
+
+		for (uint32_t f : m_visible)
+		{
+			m_faces[f].alive = false;
+			m_freeFaces.push_back(f);
+		}
+
+		if (m_outsideGarbage > m_outsideSize / 2 && m_outsideGarbage > m_faces.size())
+			CompactOutside();
+
+		AssignOrphans(m_newFaces.data(), newCount);
+		for (uint32_t n : m_newFaces)
+		{
+			if (m_faces[n].outsideCount > 0)
+				m_pending.push_back(n);
+		}
+	}
+
+	// removes the furthest outside point of the face, the next furthest takes its place
+	void QuickHull::DropFurthest(uint32_t face)
+	{
+		m_stats.droppedPoints++;
+
+		Face& f = m_faces[face];
+		m_outside[f.outsideBegin] = m_outside[f.outsideBegin + f.outsideCount - 1];
+		f.outsideCount--;
+
+		uint32_t furthest = f.outsideBegin;
+		float furthestDistance = -1.0f;
+		for (uint32_t i = f.outsideBegin; i < f.outsideBegin + f.outsideCount; i++)
+		{
+			float d = Distance(f, m_outside[i]);
+			if (d > furthestDistance)
+			{
+				furthestDistance = d;
+				furthest = i;
+			}
+		}
+
+		if (f.outsideCount > 0)
+		{
+			Point swap = m_outside[f.outsideBegin];
+			m_outside[f.outsideBegin] = m_outside[furthest];
+			m_outside[furthest] = swap;
+		}
+	}
+
+	// assigns m_orphans to the farthest of the faces they are outside of, the others are dropped
+	void QuickHull::AssignOrphans(const uint32_t* faces, uint32_t faceCount)
+	{
+		uint32_t count = static_cast<uint32_t>(m_orphans.size());
+		m_orphanFaces.resize(count);
+		m_orphanDistances.resize(count);
+
+		m_planes.resize(faceCount * 4);
+		for (uint32_t j = 0; j < faceCount; j++)
+		{
+			const Face& f = m_faces[faces[j]];
+			m_planes[j * 4 + 0] = f.normal[0];
+			m_planes[j * 4 + 1] = f.normal[1];
+			m_planes[j * 4 + 2] = f.normal[2];
+			m_planes[j * 4 + 3] = -f.distance;
+		}
+
+		// the slot in faces of every orphan, s_none when it is inside all of them
+		const Point* orphans = m_orphans.data();
+		const float* planes = m_planes.data();
+		uint32_t* slots = m_orphanFaces.data();
+		float* distances = m_orphanDistances.data();
+		float epsilon = m_epsilon;
+		auto assign = [=](uint32_t first, uint32_t last)
+			{
+				// 4 orphans at a time against every face, the slot is tracked as a float and -1 becomes s_none
+				uint32_t i = first;
+				for (; i + 4 <= last; i += 4)
+				{
+					__m128 x = _mm_loadu_ps(&orphans[i].x);
+					__m128 y = _mm_loadu_ps(&orphans[i + 1].x);
+					__m128 z = _mm_loadu_ps(&orphans[i + 2].x);
+					__m128 w = _mm_loadu_ps(&orphans[i + 3].x);
+					_MM_TRANSPOSE4_PS(x, y, z, w);
+
+					Float4 best = epsilon;
+					Float4 slot = -1.0f;
+					for (uint32_t j = 0; j < faceCount; j++)
+					{
+						const float* plane = planes + j * 4;
+						Float4 d = MulAdd(Float4(plane[0]), x, MulAdd(Float4(plane[1]), y, MulAdd(Float4(plane[2]), z, Float4(plane[3]))));
+						slot = Select(d > best, Float4(static_cast<float>(j)), slot);
+						best = Max(d, best);
+					}
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(slots + i), _mm_cvttps_epi32(slot.m));
+					best.StoreUnaligned(distances + i);
+				}
+
+				for (; i < last; i++)
+				{
+					const Point& p = orphans[i];
+					float best = epsilon;
+					uint32_t slot = s_none;
+					for (uint32_t j = 0; j < faceCount; j++)
+					{
+						float d = planes[j * 4] * p.x + planes[j * 4 + 1] * p.y + planes[j * 4 + 2] * p.z + planes[j * 4 + 3];
+						if (d > best)
+						{
+							best = d;
+							slot = j;
+						}
+					}
+					slots[i] = slot;
+					distances[i] = best;
+				}
+			};
+
+		if (Parallel(count))
+			JobSystem::ParallelFor(0, count, s_grainSize, assign);
+		else
+			assign(0, count);
+
+		// counting sort into new ranges at the end of m_outside, in orphan order so the sets are the same for any
+		// thread count. The furthest point of every face goes first
+		m_slotCounts.assign(faceCount, 0);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (slots[i] != s_none)
+				m_slotCounts[slots[i]]++;
+		}
+
+		m_slotBegins.resize(faceCount);
+		m_slotDistances.assign(faceCount, -1.0f);
+		uint32_t end = m_outsideSize;
+		for (uint32_t j = 0; j < faceCount; j++)
+		{
+			m_slotBegins[j] = end;
+			end += m_slotCounts[j];
+			m_slotCounts[j] = 0;
+		}
+
+		// m_outside is used as a buffer of m_outsideSize points, growing it does not touch every element
+		if (end > m_outside.size())
+			m_outside.resize(end > 2 * m_outside.size() ? end : 2 * m_outside.size());
+
+		Point* outside = m_outside.data();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t slot = slots[i];
+			if (slot == s_none)
+				continue;
+
+			uint32_t first = m_slotBegins[slot];
+			uint32_t at = first + m_slotCounts[slot]++;
+			if (distances[i] > m_slotDistances[slot])
+			{
+				m_slotDistances[slot] = distances[i];
+				outside[at] = outside[first];
+				outside[first] = orphans[i];
+			}
+			else
+			{
+				outside[at] = orphans[i];
+			}
+		}
+
+		for (uint32_t j = 0; j < faceCount; j++)
+		{
+			Face& f = m_faces[faces[j]];
+			f.outsideBegin = m_slotBegins[j];
+			f.outsideCount = m_slotCounts[j];
+		}
+		m_outsideSize = end;
+	}
+
+	// moves the ranges of the live faces to the front of m_outside
+	void QuickHull::CompactOutside()
+	{
+		uint32_t size = 0;
+		for (const Face& f : m_faces)
+		{
+			if (f.alive)
+				size += f.outsideCount;
+		}
+
+		if (m_outsideScratch.size() < size)
+			m_outsideScratch.resize(m_outside.size());
+
+		uint32_t end = 0;
+		for (Face& f : m_faces)
+		{
+			if (!f.alive || f.outsideCount == 0)
+				continue;
+
+			memcpy(&m_outsideScratch[end], &m_outside[f.outsideBegin], f.outsideCount * sizeof(Point));
+			f.outsideBegin = end;
+			end += f.outsideCount;
+		}
+
+		m_outside.swap(m_outsideScratch);
+		m_outsideSize = end;
+		m_outsideGarbage = 0;
+	}
+
+	// index of the point with the largest distance(point), the first one on ties
+	template<typename Fn>
+	uint32_t QuickHull::FindFarthest(Fn&& distance) const
+	{
+		uint32_t count = static_cast<uint32_t>(m_points.size());
+		uint32_t chunkCount = Parallel(count) ? JobSystem::ComputeChunkCount(count, s_grainSize) : 1;
+		std::vector<uint32_t> chunkBest(chunkCount);
+		std::vector<float> chunkDistances(chunkCount);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				uint32_t best = first;
+				float bestDistance = distance(m_points[first]);
+				for (uint32_t i = first + 1; i < last; i++)
+				{
+					float d = distance(m_points[i]);
+					if (d > bestDistance)
+					{
+						bestDistance = d;
+						best = i;
+					}
+				}
+				chunkBest[chunk] = best;
+				chunkDistances[chunk] = bestDistance;
+			});
+
+		uint32_t best = 0;
+		for (uint32_t c = 1; c < chunkCount; c++)
+		{
+			if (chunkDistances[c] > chunkDistances[best])
+				best = c;
+		}
+
+		return chunkBest[best];
+	}
+
+	// groups coplanar triangles, then writes every group as one convex polygon
+	void QuickHull::ExtractMesh(const Vector* points, HullMesh& hull)
+	{
+		ComputeRegions();
+
+		m_hullEdges.assign(m_faces.size() * 3, s_none);
+		m_vertexMap.assign(m_points.size(), s_none);
+		m_loopFrom.assign(m_points.size(), s_none);
+
+		m_faceLoops.clear();
+		m_faceLoopStarts.clear();
+		uint32_t regionCount = static_cast<uint32_t>(m_regionStarts.size()) - 1;
+		for (uint32_t r = 0; r < regionCount; r++)
+		{
+			uint32_t first = m_regionStarts[r], last = m_regionStarts[r + 1];
+			if (last - first > 1 && FindBoundary(first, last, r))
+			{
+				m_faceLoopStarts.push_back(static_cast<uint32_t>(m_faceLoops.size()));
+				m_faceLoops.insert(m_faceLoops.end(), m_loop.begin(), m_loop.end());
+				continue;
+			}
+
+			// single triangles, and groups whose boundary is not one simple loop
+			for (uint32_t i = first; i < last; i++)
+			{
+				uint32_t f = m_regionFaces[i];
+				m_faceLoopStarts.push_back(static_cast<uint32_t>(m_faceLoops.size()));
+				m_faceLoops.push_back(f * 3);
+				m_faceLoops.push_back(f * 3 + 1);
+				m_faceLoops.push_back(f * 3 + 2);
+			}
+		}
+		m_faceLoopStarts.push_back(static_cast<uint32_t>(m_faceLoops.size()));
+
+		FindEdgeVertices();
+
+		// a closed triangle mesh has 3 / 2 edges per triangle and 2 faces per vertex
+		uint32_t faceCount = static_cast<uint32_t>(m_faceLoopStarts.size()) - 1;
+		hull.vertices.reserve(m_stats.triangleCount / 2 + 2);
+		hull.vertexEdges.reserve(m_stats.triangleCount / 2 + 2);
+		hull.edges.reserve(m_faceLoops.size());
+		hull.faces.reserve(faceCount);
+		for (uint32_t f = 0; f < faceCount; f++)
+			AddHullFace(points, hull, m_faceLoops.data() + m_faceLoopStarts[f], m_faceLoopStarts[f + 1] - m_faceLoopStarts[f]);
+	}
+
+	// grows groups of triangles whose vertices are within the merge tolerance of the plane of the first one
+	void QuickHull::ComputeRegions()
+	{
+		m_mergeTolerance = m_desc.mergeTolerance > 0.0f ? m_desc.mergeTolerance : 2.0f * m_epsilon;
+
+		// large triangles seed first: the plane of a thin one is poorly defined and would not take its neighbours.
+		// A counting sort over the top bits of the squared area is ordered enough
+		m_seeds.clear();
+		m_slotCounts.assign(4096, 0);
+		m_seedKeys.resize(m_faces.size());
+		for (uint32_t f = 0; f < static_cast<uint32_t>(m_faces.size()); f++)
+		{
+			if (!m_faces[f].alive)
+				continue;
+
+			const Point& a = m_points[m_faces[f].v[0]];
+			const Point& b = m_points[m_faces[f].v[1]];
+			const Point& c = m_points[m_faces[f].v[2]];
+			float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+			float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+			float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+			float areaSq = nx * nx + ny * ny + nz * nz;
+
+			uint32_t bits;
+			memcpy(&bits, &areaSq, sizeof(bits));
+			m_seedKeys[f] = 4095 - (bits >> 20);
+			m_slotCounts[m_seedKeys[f]]++;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& c : m_slotCounts)
+		{
+			uint32_t size = c;
+			c = offset;
+			offset += size;
+		}
+
+		m_seeds.resize(offset);
+		for (uint32_t f = 0; f < static_cast<uint32_t>(m_faces.size()); f++)
+		{
+			if (m_faces[f].alive)
+				m_seeds[m_slotCounts[m_seedKeys[f]]++] = f;
+		}
+
+		m_regions.assign(m_faces.size(), s_none);
+		m_regionFaces.clear();
+		m_regionStarts.clear();
+		for (uint32_t seed : m_seeds)
+		{
+			if (m_regions[seed] != s_none)
+				continue;
+
+			m_stats.triangleCount++;
+			uint32_t region = static_cast<uint32_t>(m_regionStarts.size());
+			m_regionStarts.push_back(static_cast<uint32_t>(m_regionFaces.size()));
+			m_regions[seed] = region;
+			m_regionFaces.push_back(seed);
+			if (!m_desc.mergeFaces)
+				continue;
+
+			const Face& plane = m_faces[seed];
+			for (size_t i = m_regionStarts.back(); i < m_regionFaces.size(); i++)
+			{
+				const Face& f = m_faces[m_regionFaces[i]];
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					// facing away is folded over a thin hull. A zero area triangle has a zero normal and still
+					// joins, left alone it would split the polygon it lies in
+					uint32_t g = f.twin[k] / 3;
+					const Face& neighbour = m_faces[g];
+					if (m_regions[g] != s_none ||
+						neighbour.normal[0] * plane.normal[0] + neighbour.normal[1] * plane.normal[1] + neighbour.normal[2] * plane.normal[2] < 0.0f)
+						continue;
+
+					bool coplanar = true;
+					for (uint32_t j = 0; j < 3 && coplanar; j++)
+						coplanar = fabsf(Distance(plane, m_points[neighbour.v[j]])) <= m_mergeTolerance;
+
+					if (coplanar)
+					{
+						m_stats.triangleCount++;
+						m_regions[g] = region;
+						m_regionFaces.push_back(g);
+					}
+				}
+			}
+		}
+		m_regionStarts.push_back(static_cast<uint32_t>(m_regionFaces.size()));
+	}
+
+	// the edges between the group and other groups, chained into m_loop. False unless they form one simple loop
+	// around a convex polygon
+	bool QuickHull::FindBoundary(uint32_t first, uint32_t last, uint32_t region)
+	{
+		m_loop.clear();
+		bool simple = true;
+		uint32_t boundaryCount = 0;
+		uint32_t start = s_none;
+		for (uint32_t i = first; i < last; i++)
+		{
+			uint32_t f = m_regionFaces[i];
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				if (m_regions[m_faces[f].twin[k] / 3] == region)
+					continue;
+
+				// a vertex on the boundary twice pinches the polygon
+				uint32_t v = m_faces[f].v[k];
+				simple = simple && m_loopFrom[v] == s_none;
+				m_loopFrom[v] = f * 3 + k;
+				start = f * 3 + k;
+				boundaryCount++;
+			}
+		}
+
+		if (simple)
+		{
+			uint32_t edge = start;
+			do
+			{
+				m_loop.push_back(edge);
+				uint32_t to = m_faces[edge / 3].v[(edge % 3 + 1) % 3];
+				edge = m_loopFrom[to];
+			} while (edge != start && edge != s_none && m_loop.size() <= boundaryCount);
+
+			simple = edge == start && m_loop.size() == boundaryCount;
+		}
+
+		for (uint32_t i = first; i < last; i++)
+		{
+			uint32_t f = m_regionFaces[i];
+			for (uint32_t k = 0; k < 3; k++)
+				m_loopFrom[m_faces[f].v[k]] = s_none;
+		}
+
+		// the polygon must stay convex: a reflex corner deeper than rounding would be a local maximum for
+		// hill climbing. Seen along the normal of the seed triangle
+		const float* n = m_faces[m_regionFaces[first]].normal;
+		size_t count = m_loop.size();
+		for (size_t i = 0; i < count && simple; i++)
+		{
+			const Point& a = m_points[m_faces[m_loop[i] / 3].v[m_loop[i] % 3]];
+			const Point& b = m_points[m_faces[m_loop[(i + 1) % count] / 3].v[m_loop[(i + 1) % count] % 3]];
+			const Point& c = m_points[m_faces[m_loop[(i + 2) % count] / 3].v[m_loop[(i + 2) % count] % 3]];
+			float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+			float vx = c.x - b.x, vy = c.y - b.y, vz = c.z - b.z;
+			float turn = n[0] * (uy * vz - uz * vy) + n[1] * (uz * vx - ux * vz) + n[2] * (ux * vy - uy * vx);
+			float ac = sqrtf((c.x - a.x) * (c.x - a.x) + (c.y - a.y) * (c.y - a.y) + (c.z - a.z) * (c.z - a.z));
+			simple = turn >= -m_epsilon * ac; // turn / |ac| is the distance of b from the chord ac
+		}
+
+		return simple;
+	}
+
+	// points on a hull edge between two merged polygons: corners of only those 2 polygons, within the merge
+	// tolerance of the line through their neighbours. They are dropped so the polygons stay strictly convex
+	void QuickHull::FindEdgeVertices()
+	{
+		auto origin = [this](uint32_t edge) { return m_faces[edge / 3].v[edge % 3]; };
+
+		m_vertexFaces.assign(m_points.size(), 0);
+		m_dropVertex.assign(m_points.size(), 0);
+		if (!m_desc.mergeFaces)
+			return;
+
+		for (uint32_t edge : m_faceLoops)
+			m_vertexFaces[origin(edge)]++;
+
+		for (uint32_t v = 0; v < static_cast<uint32_t>(m_points.size()); v++)
+			m_dropVertex[v] = m_vertexFaces[v] == 2;
+
+		// both polygons of a vertex must see it between its neighbours
+		uint32_t faceCount = static_cast<uint32_t>(m_faceLoopStarts.size()) - 1;
+		for (uint32_t f = 0; f < faceCount; f++)
+		{
+			const uint32_t* loop = m_faceLoops.data() + m_faceLoopStarts[f];
+			uint32_t count = m_faceLoopStarts[f + 1] - m_faceLoopStarts[f];
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t v = origin(loop[i]);
+				if (!m_dropVertex[v])
+					continue;
+
+				const Point& a = m_points[origin(loop[(i + count - 1) % count])];
+				const Point& b = m_points[v];
+				const Point& c = m_points[origin(loop[(i + 1) % count])];
+				double ux = static_cast<double>(b.x) - a.x, uy = static_cast<double>(b.y) - a.y, uz = static_cast<double>(b.z) - a.z;
+				double vx = static_cast<double>(c.x) - a.x, vy = static_cast<double>(c.y) - a.y, vz = static_cast<double>(c.z) - a.z;
+				double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+				double tolerance = m_mergeTolerance;
+
+				// |u x v| / |v| is the distance of b from the line ac
+				bool between = ux * vx + uy * vy + uz * vz > 0.0 && (vx - ux) * vx + (vy - uy) * vy + (vz - uz) * vz > 0.0;
+				if (!between || nx * nx + ny * ny + nz * nz > tolerance * tolerance * (vx * vx + vy * vy + vz * vz))
+					m_dropVertex[v] = 0;
+			}
+		}
+
+		// every polygon keeps at least 3 corners. Keeping a vertex can only add corners, so this settles
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+			for (uint32_t f = 0; f < faceCount; f++)
+			{
+				uint32_t kept = 0;
+				for (uint32_t i = m_faceLoopStarts[f]; i < m_faceLoopStarts[f + 1]; i++)
+					kept += !m_dropVertex[origin(m_faceLoops[i])];
+
+				if (kept >= 3)
+					continue;
+
+				for (uint32_t i = m_faceLoopStarts[f]; i < m_faceLoopStarts[f + 1]; i++)
+				{
+					uint32_t v = origin(m_faceLoops[i]);
+					changed = changed || m_dropVertex[v];
+					m_dropVertex[v] = 0;
+				}
+			}
+		}
+	}
+
+	// loop: triangle edges around the polygon, counterclockwise. The edges through dropped vertices become one
+	void QuickHull::AddHullFace(const Vector* points, HullMesh& hull, const uint32_t* loop, uint32_t count)
+	{
+		uint32_t face = static_cast<uint32_t>(hull.faces.size());
+
+		// Newell's normal, exact for planar polygons and a best fit for merged ones
+		double nx = 0.0, ny = 0.0, nz = 0.0;
+		double cx = 0.0, cy = 0.0, cz = 0.0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const Point& p = m_points[m_faces[loop[i] / 3].v[loop[i] % 3]];
+			const Point& q = m_points[m_faces[loop[(i + 1) % count] / 3].v[loop[(i + 1) % count] % 3]];
+			nx += (static_cast<double>(p.y) - q.y) * (static_cast<double>(p.z) + q.z);
+			ny += (static_cast<double>(p.z) - q.z) * (static_cast<double>(p.x) + q.x);
+			nz += (static_cast<double>(p.x) - q.x) * (static_cast<double>(p.y) + q.y);
+			cx += p.x;
+			cy += p.y;
+			cz += p.z;
+		}
+
+		double length = sqrt(nx * nx + ny * ny + nz * nz);
+		if (length > 0.0)
+		{
+			nx /= length;
+			ny /= length;
+			nz /= length;
+		}
+		double w = -(nx * (cx / count + m_center.x) + ny * (cy / count + m_center.y) + nz * (cz / count + m_center.z));
+
+		auto origin = [&](uint32_t i) { return m_faces[loop[i] / 3].v[loop[i] % 3]; };
+
+		// the HullMesh edge from the corner at i to the next corner, over the dropped vertices between them.
+		// Seen from the other polygon the run goes the other way, its first edge is the twin of the last one here
+		auto cornerEdge = [&](uint32_t i)
+			{
+				uint32_t last = i;
+				while (m_dropVertex[origin((last + 1) % count)])
+					last = (last + 1) % count;
+
+				return HullEdge(hull, loop[i], m_faces[loop[last] / 3].twin[loop[last] % 3]);
+			};
+
+		uint32_t start = 0;
+		while (m_dropVertex[origin(start)])
+			start++;
+
+		HullFace hullFace;
+		hullFace.plane = Vector(static_cast<float>(nx), static_cast<float>(ny), static_cast<float>(nz), static_cast<float>(w));
+		hullFace.edge = cornerEdge(start);
+		hull.faces.push_back(hullFace);
+
+		uint32_t i = start;
+		do
+		{
+			uint32_t next = (i + 1) % count;
+			while (m_dropVertex[origin(next)])
+				next = (next + 1) % count;
+
+			uint32_t point = origin(i);
+			uint32_t e = cornerEdge(i);
+			if (m_vertexMap[point] == s_none)
+			{
+				m_vertexMap[point] = static_cast<uint32_t>(hull.vertices.size());
+				hull.vertices.push_back(Vector(points[point].x, points[point].y, points[point].z, 1.0f));
+				hull.vertexEdges.push_back(e);
+			}
+
+			// allocating the next edge may grow hull.edges
+			uint32_t nextEdge = cornerEdge(next);
+			HullHalfEdge& edge = hull.edges[e];
+			edge.origin = m_vertexMap[point];
+			edge.next = nextEdge;
+			edge.face = face;
+			i = next;
+		} while (i != start);
+	}
+
+	// the HullMesh edge of a triangle edge, twin is the triangle edge on the other side. Both sides of an edge are
+	// allocated together as a twin pair
+	uint32_t QuickHull::HullEdge(HullMesh& hull, uint32_t edge, uint32_t twin)
+	{
+		if (m_hullEdges[edge] == s_none)
+		{
+			uint32_t pair = static_cast<uint32_t>(hull.edges.size());
+			m_hullEdges[edge] = pair;
+			m_hullEdges[twin] = pair + 1;
+			hull.edges.resize(pair + 2);
+		}
+
+		return m_hullEdges[edge];
+	}
+
+	bool QuickHull::Parallel(uint32_t count) const
+	{
+		return m_desc.multithreaded && JobSystem::GetThreadCount() > 1 && count >= m_desc.parallelThreshold;
+	}
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "ConvexShape.h"
+#include "Math/Types.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	// half-edges are stored in twin pairs, the twin of edge e is e ^ 1
+	struct HullHalfEdge
+	{
+		uint32_t origin;
+		uint32_t next; // next edge of the face, counterclockwise seen from outside
+		uint32_t face;
+	};
+
+	struct HullFace
+	{
+		Vector plane;  // outward unit normal in xyz, dot(normal, p) + w > 0 outside the hull
+		uint32_t edge; // first edge of the face
+	};
+
+	/// <summary>
+	/// Convex polyhedron as a half-edge mesh. Faces are convex polygons, coplanar triangles are merged.
+	/// vertexEdges[v] is an edge leaving vertex v, the edges around v are e, edges[e ^ 1].next, ...
+	/// </summary>
+	struct HullMesh
+	{
+		std::vector<Vector> vertices;
+		std::vector<uint32_t> vertexEdges;
+		std::vector<HullHalfEdge> edges;
+		std::vector<HullFace> faces;
+
+		void Clear();
+		bool IsEmpty() const { return faces.empty(); }
+	};
+
+	// hill climbing over the vertices of the faces around the current vertex, returns the vertex farthest along dir.
+	// Starting from the result of the previous frame makes it close to O(1) for coherent queries
+	uint32_t HullMeshSupport(const HullMesh& hull, const Vector& dir, uint32_t start = 0);
+
+	// GJK shape over the hull vertices, the hull must outlive the shape
+	ConvexShape ConvexHull(const HullMesh& hull, const Matrix& transform);
+
+	struct QuickHullDesc
+	{
+		float epsilon = 0.0f;         // points closer than this to a face are inside. 0 = from the extent of the input
+		bool mergeFaces = true;       // merges coplanar triangles into polygons
+		float mergeTolerance = 0.0f;  // max distance of a merged vertex from the face plane. 0 = 2 * epsilon
+
+		bool multithreaded = true;
+		uint32_t parallelThreshold = 16384; // fewer points are partitioned on the calling thread
+	};
+
+	struct QuickHullStats
+	{
+		double buildTimeMs = 0.0;
+		float epsilon = 0.0f;       // the one used by the last Build()
+		uint32_t iterations = 0;    // points added to the hull
+		uint32_t droppedPoints = 0; // outside points whose horizon was broken by rounding, left out of the hull
+		uint32_t triangleCount = 0; // before merging
+		uint32_t vertexCount = 0;
+		uint32_t faceCount = 0;
+	};
+
+	/// <summary>
+	/// Quickhull over a point cloud. Every face keeps the list of points outside of it, each iteration adds the
+	/// farthest point of a face, removes the faces it sees and reassigns their points to the new faces around it.
+	/// The first partition and the large reassignments of the early iterations run on the job system, the links
+	/// are built in point order so the hull does not depend on the thread count.
+	/// The builder keeps its scratch memory between builds.
+	/// </summary>
+	class QuickHull
+	{
+	public:
+		QuickHull();
+		QuickHull(const QuickHullDesc& desc);
+
+		// false when the points are fewer than 4, or all on a plane within epsilon. hull is cleared then
+		bool Build(const Vector* points, uint32_t count, HullMesh& hull);
+
+		void SetDesc(const QuickHullDesc& desc);
+		const QuickHullDesc& GetDesc() const;
+		const QuickHullStats& GetStats() const;
+
+	private:
+		struct Point
+		{
+			float x, y, z;
+			uint32_t index;
+		};
+
+		// triangle, edge k goes from v[k] to v[(k + 1) % 3]. Edge ids are face * 3 + k
+		struct Face
+		{
+			uint32_t v[3];
+			uint32_t twin[3];
+			float normal[3];
+			float distance;
+			uint32_t outsideBegin; // range of m_outside, the furthest point first
+			uint32_t outsideCount;
+			uint32_t mark;         // iteration that found the face visible
+			bool alive;
+		};
+
+		// extremes: index of the min and max point along x, y and z
+		bool BuildInitialHull(const uint32_t* extremes);
+		uint32_t AllocateFace(uint32_t a, uint32_t b, uint32_t c);
+		// false when rounding made the visible faces something else than a disk
+		bool FindHorizon(uint32_t face, const Point& eye);
+		void AddPoint(uint32_t face);
+		void DropFurthest(uint32_t face);
+
+		// assigns m_orphans to the farthest of the faces they are outside of, the others are dropped
+		void AssignOrphans(const uint32_t* faces, uint32_t faceCount);
+		void CompactOutside();
+
+		// index of the point with the largest distance(point), the first one on ties
+		template<typename Fn>
+		uint32_t FindFarthest(Fn&& distance) const;
+
+		// groups coplanar triangles, then writes every group as one convex polygon
+		void ExtractMesh(const Vector* points, HullMesh& hull);
+		void ComputeRegions();
+		bool FindBoundary(uint32_t first, uint32_t last, uint32_t region);
+		void FindEdgeVertices();
+		void AddHullFace(const Vector* points, HullMesh& hull, const uint32_t* loop, uint32_t count);
+		uint32_t HullEdge(HullMesh& hull, uint32_t edge, uint32_t twin);
+
+		float Distance(const Face& f, const Point& p) const
+		{
+			return f.normal[0] * p.x + f.normal[1] * p.y + f.normal[2] * p.z - f.distance;
+		}
+
+		bool Parallel(uint32_t count) const;
+
+		QuickHullDesc m_desc;
+		QuickHullStats m_stats;
+		Vector m_center;
+		float m_epsilon;
+		float m_mergeTolerance;
+		uint32_t m_iteration;
+
+		std::vector<Point> m_points; // relative to the center of the bounds, for precision
+		std::vector<Face> m_faces;
+		std::vector<uint32_t> m_freeFaces;
+		std::vector<uint32_t> m_pending; // faces that may have outside points
+
+		// outside points of every face as copies, the reassignments stream through memory instead of chasing
+		// indices. Ranges of deleted faces are garbage until the next compaction
+		std::vector<Point> m_outside;
+		std::vector<Point> m_outsideScratch;
+		uint32_t m_outsideSize;
+		uint32_t m_outsideGarbage;
+
+		std::vector<uint32_t> m_visible;
+		std::vector<uint32_t> m_horizon; // edges of visible faces, in order around the eye
+		std::vector<uint32_t> m_stack;
+		std::vector<uint32_t> m_vertexMarks; // per point, iteration that put it on the horizon
+		std::vector<uint32_t> m_newFaces;
+		std::vector<Point> m_orphans;
+		std::vector<uint32_t> m_orphanFaces;
+		std::vector<float> m_orphanDistances;
+		std::vector<uint32_t> m_slotCounts;
+		std::vector<uint32_t> m_slotBegins;
+		std::vector<float> m_slotDistances;
+		std::vector<float> m_planes; // of the faces in AssignOrphans, packed
+
+		std::vector<uint32_t> m_seeds;        // live faces, largest first
+		std::vector<uint32_t> m_seedKeys;
+		std::vector<uint32_t> m_regions;      // per face
+		std::vector<uint32_t> m_regionFaces;  // faces grouped by region
+		std::vector<uint32_t> m_regionStarts;
+		std::vector<uint32_t> m_loop;         // edges of the current polygon in order
+		std::vector<uint32_t> m_faceLoops;    // edges of every polygon in order
+		std::vector<uint32_t> m_faceLoopStarts;
+		std::vector<uint32_t> m_vertexFaces;  // per point, polygons it is a corner of
+		std::vector<uint8_t> m_dropVertex;    // per point, lies on a hull edge and is left out of the mesh
+		std::vector<uint32_t> m_loopFrom;     // per point, boundary edge leaving it
+		std::vector<uint32_t> m_hullEdges;    // per triangle edge, the HullMesh edge
+		std::vector<uint32_t> m_vertexMap;    // per point, the HullMesh vertex
+	};
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Math/Types.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	struct Ray
+	{
+		Vector origin;
+		Vector direction; // does not need to be normalized, t is in units of direction
+		float tMin = 0.0f;
+		float tMax = 3.402823466e+38f;
+
+		Ray() = default;
+		Ray(const Vector& origin, const Vector& direction, float tMin = 0.0f, float tMax = 3.402823466e+38f)
+			: origin(origin), direction(direction), tMin(tMin), tMax(tMax) { }
+	};
+
+	struct RayHit
+	{
+		float t = 3.402823466e+38f;
+		float u = 0.0f; // barycentrics, position = (1 - u - v) * p0 + u * p1 + v * p2
+		float v = 0.0f;
+		uint32_t triangle = UINT32_MAX; // UINT32_MAX on a miss
+
+		bool IsHit() const { return triangle != UINT32_MAX; }
+	};
+
+	/// <summary>
+	/// Structure of arrays ray packet. N must be 4, 8 or 16.
+	/// Packets are traced faster when the rays are coherent (same origin or similar directions),
+	/// e.g. a tile of primary rays or the shadow rays towards one light.
+	/// </summary>
+	template<uint32_t N>
+	struct alignas(32) RayPacket
+	{
+		static_assert(N == 4 || N == 8 || N == 16, "RayPacket supports 4, 8 or 16 rays");
+		static constexpr uint32_t Size = N;
+
+		float originX[N];
+		float originY[N];
+		float originZ[N];
+		float directionX[N];
+		float directionY[N];
+		float directionZ[N];
+		float tMin[N];
+		float tMax[N];
+
+		void SetRay(uint32_t i, const Ray& ray)
+		{
+			originX[i] = ray.origin.x;
+			originY[i] = ray.origin.y;
+			originZ[i] = ray.origin.z;
+			directionX[i] = ray.direction.x;
+			directionY[i] = ray.direction.y;
+			directionZ[i] = ray.direction.z;
+			tMin[i] = ray.tMin;
+			tMax[i] = ray.tMax;
+		}
+
+		Ray GetRay(uint32_t i) const
+		{
+			return Ray(Vector(originX[i], originY[i], originZ[i], 1.0f), Vector(directionX[i], directionY[i], directionZ[i], 0.0f), tMin[i], tMax[i]);
+		}
+	};
+
+	using RayPacket4 = RayPacket<4>;
+	using RayPacket8 = RayPacket<8>;
+	using RayPacket16 = RayPacket<16>;
+}
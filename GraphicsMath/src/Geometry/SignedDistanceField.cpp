@@ -0,0 +1,712 @@
+#include "SignedDistanceField.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <math.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_fileMagic = 0x46445347; // "GSDF"
+		constexpr uint32_t s_fileVersion = 1;
+
+		constexpr uint32_t s_brickVoxelCount = SignedDistanceField::BrickSize * SignedDistanceField::BrickSize * SignedDistanceField::BrickSize;
+
+		// brick states during the bake
+		constexpr uint8_t s_farOutside = 0;
+		constexpr uint8_t s_farInside = 1;
+		constexpr uint8_t s_surface = 2;
+
+		// distance of the voxels past the exact band before the sweeps reach them
+		constexpr float s_unknown = 1e30f;
+
+		// rounds of the 8 sweep orders. The characteristics of a distance field are straight lines, one round
+		// already follows every one of them (Zhao 2005)
+		constexpr uint32_t s_sweepRounds = 1;
+		constexpr uint32_t s_sweepGrainSize = 8;
+
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t dimensions[3];
+			float origin[3];
+			float voxelSize;
+			float maxDistance;
+			uint32_t surfaceBrickCount; // UINT32_MAX when the file has no brick map
+		};
+
+		// [-maxDistance, maxDistance] to [0, 1]
+		float Normalize(float d, float maxDistance)
+		{
+			return std::min(std::max(d / maxDistance, -1.0f), 1.0f) * 0.5f + 0.5f;
+		}
+
+		float Denormalize(float t, float maxDistance)
+		{
+			return (t * 2.0f - 1.0f) * maxDistance;
+		}
+
+		uint16_t Quantize16(float d, float maxDistance)
+		{
+			return static_cast<uint16_t>(lrintf(Normalize(d, maxDistance) * 65535.0f));
+		}
+
+		uint8_t Quantize8(float d, float maxDistance)
+		{
+			return static_cast<uint8_t>(lrintf(Normalize(d, maxDistance) * 255.0f));
+		}
+	}
+
+	SignedDistanceField::SignedDistanceField()
+	{
+		Clear();
+	}
+
+	SignedDistanceField::SignedDistanceField(const SDFBakeDesc& desc)
+		: m_desc(desc)
+	{
+		Clear();
+	}
+
+	void SignedDistanceField::Bake(const TriangleMeshView& mesh)
+	{
+		BVHDesc bvhDesc;
+		bvhDesc.multithreaded = m_desc.multithreaded;
+		BVH bvh(bvhDesc);
+		bvh.Build(mesh);
+		Bake(bvh, mesh);
+	}
+
+	void SignedDistanceField::Bake(const BVH& bvh, const TriangleMeshView& mesh)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		Clear();
+		if (bvh.IsEmpty())
+			return;
+
+		assert(m_desc.resolution >= 2 && "resolution must be at least 2");
+
+		// the longest axis gets resolution samples, padding included, the grid is centered on the mesh
+		AABB bounds = bvh.GetBounds();
+		float extent[3] = { bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z };
+		float longest = std::max(extent[0], std::max(extent[1], extent[2]));
+		uint32_t resolution = std::max(m_desc.resolution, 2 * m_desc.padding + 2);
+		m_voxelSize = longest > 0.0f ? longest / static_cast<float>(resolution - 1 - 2 * m_desc.padding) : 1.0f;
+
+		float center[3] = { 0.5f * (bounds.min.x + bounds.max.x), 0.5f * (bounds.min.y + bounds.max.y), 0.5f * (bounds.min.z + bounds.max.z) };
+		float origin[3];
+		for (int a = 0; a < 3; a++)
+		{
+			uint32_t inner = static_cast<uint32_t>(ceilf(extent[a] / m_voxelSize - 1e-4f)) + 1;
+			m_dimensions[a] = std::min(inner + 2 * m_desc.padding, resolution);
+			m_brickDimensions[a] = (m_dimensions[a] + BrickSize - 1) / BrickSize;
+			origin[a] = center[a] - 0.5f * static_cast<float>(m_dimensions[a] - 1) * m_voxelSize;
+		}
+		m_origin = Vector(origin[0], origin[1], origin[2], 1.0f);
+
+		float diagonal = m_voxelSize * sqrtf(static_cast<float>(m_dimensions[0] * m_dimensions[0] + m_dimensions[1] * m_dimensions[1] + m_dimensions[2] * m_dimensions[2]));
+		m_maxDistance = m_desc.maxDistance > 0.0f ? m_desc.maxDistance * m_voxelSize : diagonal;
+		float exactDistance = m_desc.exactBand > 0.0f ? std::min(m_desc.exactBand * m_voxelSize, m_maxDistance) : m_maxDistance;
+		bool sweep = exactDistance < m_maxDistance;
+
+		uint32_t brickCount = m_brickDimensions[0] * m_brickDimensions[1] * m_brickDimensions[2];
+		size_t voxelCount = static_cast<size_t>(m_dimensions[0]) * m_dimensions[1] * m_dimensions[2];
+		m_distances.resize(voxelCount);
+		m_fixed.assign(voxelCount, 0);
+
+		// the bricks are the parallel work items, the queries themselves stay single threaded
+		MeshDistanceDesc distanceDesc;
+		distanceDesc.multithreaded = false;
+		MeshDistance distance(distanceDesc);
+		distance.Set(bvh, mesh);
+
+		std::atomic<uint64_t> distanceQueries(0);
+		std::atomic<uint64_t> windingQueries(0);
+		std::atomic<uint32_t> farBricks(0);
+		auto bakeBricks = [&](uint32_t first, uint32_t last)
+			{
+				uint32_t distanceCount = 0;
+				uint32_t windingCount = 0;
+				uint32_t farCount = 0;
+				for (uint32_t i = first; i < last; i++)
+				{
+					if (BakeBrick(distance, i, exactDistance, distanceCount, windingCount))
+						farCount++;
+				}
+
+				distanceQueries += distanceCount;
+				windingQueries += windingCount;
+				farBricks += farCount;
+			};
+
+		// bricks differ a lot in cost, single bricks balance best
+		bool parallel = m_desc.multithreaded && JobSystem::GetThreadCount() > 1;
+		if (parallel)
+			JobSystem::ParallelFor(0, brickCount, 1, bakeBricks);
+		else
+			bakeBricks(0, brickCount);
+
+		if (sweep)
+		{
+			auto sweepStart = std::chrono::high_resolution_clock::now();
+			Sweep();
+			m_stats.sweepTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sweepStart).count();
+		}
+
+		m_voxels.resize(voxelCount);
+		std::atomic<uint64_t> sweptVoxels(0);
+		auto quantize = [&](uint32_t first, uint32_t last)
+			{
+				uint64_t swept = 0;
+				for (uint32_t i = first; i < last; i++)
+				{
+					m_voxels[i] = Quantize16(m_distances[i], m_maxDistance);
+					swept += m_fixed[i] ? 0 : 1;
+				}
+				sweptVoxels += swept;
+			};
+
+		if (parallel)
+			JobSystem::ParallelFor(0, static_cast<uint32_t>(voxelCount), 65536, quantize);
+		else
+			quantize(0, static_cast<uint32_t>(voxelCount));
+
+		ClassifyBricks();
+		if (m_desc.buildBrickMap)
+			BuildBrickMap();
+
+		m_stats.brickCount = brickCount;
+		m_stats.farBricks = farBricks;
+		m_stats.distanceQueries = distanceQueries;
+		m_stats.windingQueries = windingQueries;
+		m_stats.sweptVoxels = sweep ? sweptVoxels.load() : 0;
+
+		m_brickStates.clear();
+		m_brickStates.shrink_to_fit();
+		m_distances.clear();
+		m_distances.shrink_to_fit();
+		m_fixed.clear();
+		m_fixed.shrink_to_fit();
+
+		m_stats.bakeTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	bool SignedDistanceField::BakeBrick(const MeshDistance& distance, uint32_t brick, float exactDistance, uint32_t& distanceQueries, uint32_t& windingQueries)
+	{
+		uint32_t first[3] = {
+			brick % m_brickDimensions[0] * BrickSize,
+			brick / m_brickDimensions[0] % m_brickDimensions[1] * BrickSize,
+			brick / (m_brickDimensions[0] * m_brickDimensions[1]) * BrickSize };
+		uint32_t last[3];
+		float center[3];
+		float halfDiagonal = 0.0f;
+		for (int a = 0; a < 3; a++)
+		{
+			last[a] = std::min(first[a] + BrickSize, m_dimensions[a]);
+			float span = static_cast<float>(last[a] - first[a] - 1) * m_voxelSize;
+			center[a] = m_origin[a] + static_cast<float>(first[a]) * m_voxelSize + 0.5f * span;
+			halfDiagonal += 0.25f * span * span;
+		}
+		halfDiagonal = sqrtf(halfDiagonal);
+
+		// every voxel of the brick is within halfDiagonal of the center, so a brick whose center is further than
+		// exactDistance + halfDiagonal has no exact voxel, and one clear of the surface has a single sign
+		Vector c(center[0], center[1], center[2], 1.0f);
+		MeshClosestPoint closest = distance.ClosestPoint(c, exactDistance + halfDiagonal);
+		distanceQueries++;
+
+		bool uniformSign = !closest.IsValid() || closest.distance > halfDiagonal;
+		bool inside = false;
+		if (uniformSign)
+		{
+			inside = distance.IsInside(c);
+			windingQueries++;
+		}
+
+		if (!closest.IsValid())
+		{
+			float d = inside ? -s_unknown : s_unknown;
+			for (uint32_t z = first[2]; z < last[2]; z++)
+			{
+				for (uint32_t y = first[1]; y < last[1]; y++)
+				{
+					float* row = &m_distances[(static_cast<size_t>(z) * m_dimensions[1] + y) * m_dimensions[0]];
+					std::fill(row + first[0], row + last[0], d);
+				}
+			}
+
+			return true;
+		}
+
+		// unsigned distances first, voxels past the exact band keep exactDistance as a lower bound for the signs
+		float lowerBounds[s_brickVoxelCount];
+		for (uint32_t z = first[2]; z < last[2]; z++)
+		{
+			for (uint32_t y = first[1]; y < last[1]; y++)
+			{
+				size_t row = (static_cast<size_t>(z) * m_dimensions[1] + y) * m_dimensions[0];
+				for (uint32_t x = first[0]; x < last[0]; x++)
+				{
+					Vector p(m_origin.x + static_cast<float>(x) * m_voxelSize, m_origin.y + static_cast<float>(y) * m_voxelSize,
+						m_origin.z + static_cast<float>(z) * m_voxelSize, 1.0f);
+
+					// the voxel is within offset of the distance of the center: past the exact band it needs no query,
+					// otherwise the upper bound is a tight search radius that prunes most of the bvh
+					float dx = p.x - c.x, dy = p.y - c.y, dz = p.z - c.z;
+					float offset = sqrtf(dx * dx + dy * dy + dz * dz);
+					MeshClosestPoint voxelClosest;
+					if (closest.distance - offset < exactDistance)
+					{
+						float searchDistance = std::min((closest.distance + offset) * 1.0001f + 1e-6f * m_voxelSize, exactDistance);
+						voxelClosest = distance.ClosestPoint(p, searchDistance);
+						distanceQueries++;
+					}
+
+					m_distances[row + x] = voxelClosest.IsValid() ? voxelClosest.distance : s_unknown;
+					m_fixed[row + x] = voxelClosest.IsValid() ? 1 : 0;
+					lowerBounds[((z - first[2]) * BrickSize + y - first[1]) * BrickSize + x - first[0]] = voxelClosest.IsValid() ? voxelClosest.distance : exactDistance;
+				}
+			}
+		}
+
+		// two neighbors have the same sign when either is further than one voxel from the surface, the ball
+		// around it holds the other one. Only the voxels next to the surface need a winding number
+		float signDistance = m_voxelSize * 1.0001f;
+		int8_t signs[s_brickVoxelCount];
+		for (uint32_t z = first[2]; z < last[2]; z++)
+		{
+			for (uint32_t y = first[1]; y < last[1]; y++)
+			{
+				size_t row = (static_cast<size_t>(z) * m_dimensions[1] + y) * m_dimensions[0];
+				for (uint32_t x = first[0]; x < last[0]; x++)
+				{
+					uint32_t local = ((z - first[2]) * BrickSize + y - first[1]) * BrickSize + x - first[0];
+					int8_t sign = 0;
+					if (uniformSign)
+						sign = inside ? -1 : 1;
+
+					uint32_t neighbors[3] = { local - 1, local - BrickSize, local - BrickSize * BrickSize };
+					bool hasNeighbor[3] = { x > first[0], y > first[1], z > first[2] };
+					for (int a = 0; a < 3 && sign == 0; a++)
+					{
+						if (hasNeighbor[a] && std::max(lowerBounds[local], lowerBounds[neighbors[a]]) > signDistance)
+							sign = signs[neighbors[a]];
+					}
+
+					if (sign == 0)
+					{
+						Vector p(m_origin.x + static_cast<float>(x) * m_voxelSize, m_origin.y + static_cast<float>(y) * m_voxelSize,
+							m_origin.z + static_cast<float>(z) * m_voxelSize, 1.0f);
+						sign = distance.IsInside(p) ? -1 : 1;
+						windingQueries++;
+					}
+
+					signs[local] = sign;
+					if (sign < 0)
+						m_distances[row + x] = -m_distances[row + x];
+				}
+			}
+		}
+
+		return false;
+	}
+
+	void SignedDistanceField::SweepVoxel(uint32_t x, uint32_t y, uint32_t z)
+	{
+		size_t i = (static_cast<size_t>(z) * m_dimensions[1] + y) * m_dimensions[0] + x;
+		if (m_fixed[i])
+			return;
+
+		// smallest neighbor along every axis
+		size_t strides[3] = { 1, m_dimensions[0], static_cast<size_t>(m_dimensions[0]) * m_dimensions[1] };
+		uint32_t coords[3] = { x, y, z };
+		float n[3];
+		for (int a = 0; a < 3; a++)
+		{
+			float lo = coords[a] > 0 ? fabsf(m_distances[i - strides[a]]) : s_unknown;
+			float hi = coords[a] + 1 < m_dimensions[a] ? fabsf(m_distances[i + strides[a]]) : s_unknown;
+			n[a] = std::min(lo, hi);
+		}
+		if (n[0] > n[1])
+			std::swap(n[0], n[1]);
+		if (n[1] > n[2])
+			std::swap(n[1], n[2]);
+		if (n[0] > n[1])
+			std::swap(n[0], n[1]);
+
+		// |grad d| = 1 upwind, with as many axes as the solution stays above
+		float h = m_voxelSize;
+		float d = n[0] + h;
+		if (d > n[1])
+		{
+			float diff = n[0] - n[1];
+			d = 0.5f * (n[0] + n[1] + sqrtf(2.0f * h * h - diff * diff));
+			if (d > n[2])
+			{
+				float sum = n[0] + n[1] + n[2];
+				float discriminant = sum * sum - 3.0f * (n[0] * n[0] + n[1] * n[1] + n[2] * n[2] - h * h);
+				d = (sum + sqrtf(std::max(discriminant, 0.0f))) / 3.0f;
+			}
+		}
+
+		float& current = m_distances[i];
+		if (d < fabsf(current))
+			current = copysignf(d, current);
+	}
+
+	void SignedDistanceField::Sweep()
+	{
+		uint32_t nx = m_dimensions[0], ny = m_dimensions[1], nz = m_dimensions[2];
+		bool parallel = m_desc.multithreaded && JobSystem::GetThreadCount() > 1;
+
+		for (uint32_t round = 0; round < s_sweepRounds; round++)
+		{
+			for (uint32_t order = 0; order < 8; order++)
+			{
+				auto flipX = [&](uint32_t i) { return order & 1 ? nx - 1 - i : i; };
+				auto flipY = [&](uint32_t j) { return order & 2 ? ny - 1 - j : j; };
+				auto flipZ = [&](uint32_t k) { return order & 4 ? nz - 1 - k : k; };
+
+				if (!parallel)
+				{
+					for (uint32_t k = 0; k < nz; k++)
+					{
+						for (uint32_t j = 0; j < ny; j++)
+						{
+							for (uint32_t i = 0; i < nx; i++)
+								SweepVoxel(flipX(i), flipY(j), flipZ(k));
+						}
+					}
+					continue;
+				}
+
+				// a voxel only depends on the upwind axis neighbors, which all lie on the previous plane
+				// i + j + k = s - 1, so the voxels of one plane are independent. Same result as the serial order
+				for (uint32_t s = 0; s < nx + ny + nz - 2; s++)
+				{
+					uint32_t kMin = s > nx + ny - 2 ? s - (nx + ny - 2) : 0;
+					uint32_t kMax = std::min(s, nz - 1);
+					JobSystem::ParallelFor(kMin, kMax + 1, s_sweepGrainSize, [&](uint32_t first, uint32_t last)
+						{
+							for (uint32_t k = first; k < last; k++)
+							{
+								uint32_t rest = s - k;
+								uint32_t jMin = rest > nx - 1 ? rest - (nx - 1) : 0;
+								uint32_t jMax = std::min(rest, ny - 1);
+								for (uint32_t j = jMin; j <= jMax; j++)
+									SweepVoxel(flipX(rest - j), flipY(j), flipZ(k));
+							}
+						});
+				}
+			}
+		}
+	}
+
+	void SignedDistanceField::ClassifyBricks()
+	{
+		uint32_t brickCount = m_brickDimensions[0] * m_brickDimensions[1] * m_brickDimensions[2];
+		m_brickStates.resize(brickCount);
+
+		// a brick is empty when every voxel is clamped to the same side
+		uint16_t outside = Quantize16(m_maxDistance, m_maxDistance);
+		uint16_t inside = Quantize16(-m_maxDistance, m_maxDistance);
+		auto classify = [&](uint32_t firstBrick, uint32_t lastBrick)
+			{
+				for (uint32_t i = firstBrick; i < lastBrick; i++)
+				{
+					uint32_t bx = i % m_brickDimensions[0] * BrickSize;
+					uint32_t by = i / m_brickDimensions[0] % m_brickDimensions[1] * BrickSize;
+					uint32_t bz = i / (m_brickDimensions[0] * m_brickDimensions[1]) * BrickSize;
+					uint16_t first = m_voxels[(static_cast<size_t>(bz) * m_dimensions[1] + by) * m_dimensions[0] + bx];
+					bool empty = first == outside || first == inside;
+					for (uint32_t z = bz; z < std::min(bz + BrickSize, m_dimensions[2]) && empty; z++)
+					{
+						for (uint32_t y = by; y < std::min(by + BrickSize, m_dimensions[1]) && empty; y++)
+						{
+							const uint16_t* row = &m_voxels[(static_cast<size_t>(z) * m_dimensions[1] + y) * m_dimensions[0]];
+							for (uint32_t x = bx; x < std::min(bx + BrickSize, m_dimensions[0]) && empty; x++)
+								empty = row[x] == first;
+						}
+					}
+
+					if (empty)
+						m_brickStates[i] = first == inside ? s_farInside : s_farOutside;
+					else
+						m_brickStates[i] = s_surface;
+				}
+			};
+
+		if (m_desc.multithreaded && JobSystem::GetThreadCount() > 1)
+			JobSystem::ParallelFor(0, brickCount, 64, classify);
+		else
+			classify(0, brickCount);
+
+		for (uint8_t state : m_brickStates)
+		{
+			if (state == s_surface)
+				m_stats.surfaceBricks++;
+		}
+	}
+
+	void SignedDistanceField::BuildBrickMap()
+	{
+		uint32_t brickCount = static_cast<uint32_t>(m_brickStates.size());
+		m_brickMap.resize(brickCount);
+
+		// atlas slots in brick order, so the layout does not depend on the thread count
+		uint32_t surfaceCount = 0;
+		for (uint32_t i = 0; i < brickCount; i++)
+		{
+			if (m_brickStates[i] == s_surface)
+				m_brickMap[i] = s_brickVoxelCount * surfaceCount++;
+			else
+				m_brickMap[i] = m_brickStates[i] == s_farInside ? EmptyInside : EmptyOutside;
+		}
+
+		m_brickVoxels.resize(static_cast<size_t>(surfaceCount) * s_brickVoxelCount);
+		auto fill = [&](uint32_t firstBrick, uint32_t lastBrick)
+			{
+				for (uint32_t i = firstBrick; i < lastBrick; i++)
+				{
+					if (m_brickStates[i] != s_surface)
+						continue;
+
+					uint32_t bx = i % m_brickDimensions[0] * BrickSize;
+					uint32_t by = i / m_brickDimensions[0] % m_brickDimensions[1] * BrickSize;
+					uint32_t bz = i / (m_brickDimensions[0] * m_brickDimensions[1]) * BrickSize;
+					uint8_t* dst = &m_brickVoxels[m_brickMap[i]];
+					for (uint32_t z = 0; z < BrickSize; z++)
+					{
+						for (uint32_t y = 0; y < BrickSize; y++)
+						{
+							for (uint32_t x = 0; x < BrickSize; x++)
+							{
+								float d = GetDistance(std::min(bx + x, m_dimensions[0] - 1), std::min(by + y, m_dimensions[1] - 1), std::min(bz + z, m_dimensions[2] - 1));
+								*dst++ = Quantize8(d, m_maxDistance);
+							}
+						}
+					}
+				}
+			};
+
+		if (m_desc.multithreaded && JobSystem::GetThreadCount() > 1)
+			JobSystem::ParallelFor(0, brickCount, 64, fill);
+		else
+			fill(0, brickCount);
+	}
+
+	void SignedDistanceField::Clear()
+	{
+		m_stats = SDFBakeStats();
+		for (int a = 0; a < 3; a++)
+		{
+			m_dimensions[a] = 0;
+			m_brickDimensions[a] = 0;
+		}
+		m_origin = Vector(0.0f, 0.0f, 0.0f, 1.0f);
+		m_voxelSize = 0.0f;
+		m_maxDistance = 0.0f;
+
+		m_voxels.clear();
+		m_brickMap.clear();
+		m_brickVoxels.clear();
+		m_brickStates.clear();
+		m_distances.clear();
+		m_fixed.clear();
+	}
+
+	void SignedDistanceField::SetDesc(const SDFBakeDesc& desc)
+	{
+		m_desc = desc;
+	}
+
+	const SDFBakeDesc& SignedDistanceField::GetDesc() const
+	{
+		return m_desc;
+	}
+
+	const SDFBakeStats& SignedDistanceField::GetStats() const
+	{
+		return m_stats;
+	}
+
+	bool SignedDistanceField::Save(const std::string& filename) const
+	{
+		std::ofstream out(filename, std::ios::out | std::ios::binary);
+		if (!out)
+			return false;
+
+		FileHeader header;
+		header.magic = s_fileMagic;
+		header.version = s_fileVersion;
+		for (int a = 0; a < 3; a++)
+		{
+			header.dimensions[a] = m_dimensions[a];
+			header.origin[a] = m_origin[a];
+		}
+		header.voxelSize = m_voxelSize;
+		header.maxDistance = m_maxDistance;
+		header.surfaceBrickCount = m_brickMap.empty() ? UINT32_MAX : static_cast<uint32_t>(m_brickVoxels.size() / s_brickVoxelCount);
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(m_voxels.data()), m_voxels.size() * sizeof(uint16_t));
+		if (!m_brickMap.empty())
+		{
+			out.write(reinterpret_cast<const char*>(m_brickMap.data()), m_brickMap.size() * sizeof(uint32_t));
+			out.write(reinterpret_cast<const char*>(m_brickVoxels.data()), m_brickVoxels.size());
+		}
+
+		return static_cast<bool>(out);
+	}
+
+	bool SignedDistanceField::Load(const std::string& filename)
+	{
+		Clear();
+
+		std::ifstream in(filename, std::ios::in | std::ios::binary);
+		if (!in)
+			return false;
+
+		FileHeader header;
+		in.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!in || header.magic != s_fileMagic || header.version != s_fileVersion)
+			return false;
+
+		for (int a = 0; a < 3; a++)
+		{
+			m_dimensions[a] = header.dimensions[a];
+			m_brickDimensions[a] = (m_dimensions[a] + BrickSize - 1) / BrickSize;
+		}
+		m_origin = Vector(header.origin[0], header.origin[1], header.origin[2], 1.0f);
+		m_voxelSize = header.voxelSize;
+		m_maxDistance = header.maxDistance;
+
+		m_voxels.resize(static_cast<size_t>(m_dimensions[0]) * m_dimensions[1] * m_dimensions[2]);
+		in.read(reinterpret_cast<char*>(m_voxels.data()), m_voxels.size() * sizeof(uint16_t));
+		if (header.surfaceBrickCount != UINT32_MAX)
+		{
+			m_brickMap.resize(static_cast<size_t>(m_brickDimensions[0]) * m_brickDimensions[1] * m_brickDimensions[2]);
+			m_brickVoxels.resize(static_cast<size_t>(header.surfaceBrickCount) * s_brickVoxelCount);
+			in.read(reinterpret_cast<char*>(m_brickMap.data()), m_brickMap.size() * sizeof(uint32_t));
+			in.read(reinterpret_cast<char*>(m_brickVoxels.data()), m_brickVoxels.size());
+		}
+
+		if (!in)
+		{
+			Clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool SignedDistanceField::IsEmpty() const
+	{
+		return m_voxels.empty();
+	}
+
+	const uint32_t* SignedDistanceField::GetDimensions() const
+	{
+		return m_dimensions;
+	}
+
+	const Vector& SignedDistanceField::GetOrigin() const
+	{
+		return m_origin;
+	}
+
+	float SignedDistanceField::GetVoxelSize() const
+	{
+		return m_voxelSize;
+	}
+
+	float SignedDistanceField::GetMaxDistance() const
+	{
+		return m_maxDistance;
+	}
+
+	AABB SignedDistanceField::GetBounds() const
+	{
+		if (IsEmpty())
+			return AABB();
+
+		Vector size(static_cast<float>(m_dimensions[0] - 1) * m_voxelSize, static_cast<float>(m_dimensions[1] - 1) * m_voxelSize,
+			static_cast<float>(m_dimensions[2] - 1) * m_voxelSize, 0.0f);
+		return AABB(Vector(m_origin.x, m_origin.y, m_origin.z, 0.0f), Vector(m_origin.x + size.x, m_origin.y + size.y, m_origin.z + size.z, 0.0f));
+	}
+
+	float SignedDistanceField::GetDistance(uint32_t x, uint32_t y, uint32_t z) const
+	{
+		assert(x < m_dimensions[0] && y < m_dimensions[1] && z < m_dimensions[2] && "sample outside of the grid");
+		uint16_t q = m_voxels[(static_cast<size_t>(z) * m_dimensions[1] + y) * m_dimensions[0] + x];
+		return Denormalize(static_cast<float>(q) / 65535.0f, m_maxDistance);
+	}
+
+	float SignedDistanceField::Sample(const Vector& p) const
+	{
+		assert(!IsEmpty() && "sampling an empty distance field");
+
+		uint32_t i[3];
+		float t[3];
+		for (int a = 0; a < 3; a++)
+		{
+			float g = std::min(std::max((p[a] - m_origin[a]) / m_voxelSize, 0.0f), static_cast<float>(m_dimensions[a] - 1));
+			i[a] = std::min(static_cast<uint32_t>(g), m_dimensions[a] > 1 ? m_dimensions[a] - 2 : 0);
+			t[a] = g - static_cast<float>(i[a]);
+		}
+
+		uint32_t j[3];
+		for (int a = 0; a < 3; a++)
+			j[a] = std::min(i[a] + 1, m_dimensions[a] - 1);
+
+		float c00 = GetDistance(i[0], i[1], i[2]) + t[0] * (GetDistance(j[0], i[1], i[2]) - GetDistance(i[0], i[1], i[2]));
+		float c10 = GetDistance(i[0], j[1], i[2]) + t[0] * (GetDistance(j[0], j[1], i[2]) - GetDistance(i[0], j[1], i[2]));
+		float c01 = GetDistance(i[0], i[1], j[2]) + t[0] * (GetDistance(j[0], i[1], j[2]) - GetDistance(i[0], i[1], j[2]));
+		float c11 = GetDistance(i[0], j[1], j[2]) + t[0] * (GetDistance(j[0], j[1], j[2]) - GetDistance(i[0], j[1], j[2]));
+		float c0 = c00 + t[1] * (c10 - c00);
+		float c1 = c01 + t[1] * (c11 - c01);
+		return c0 + t[2] * (c1 - c0);
+	}
+
+	const std::vector<uint16_t>& SignedDistanceField::GetVoxels() const
+	{
+		return m_voxels;
+	}
+
+	const std::vector<uint32_t>& SignedDistanceField::GetBrickMap() const
+	{
+		return m_brickMap;
+	}
+
+	const std::vector<uint8_t>& SignedDistanceField::GetBrickVoxels() const
+	{
+		return m_brickVoxels;
+	}
+
+	const uint32_t* SignedDistanceField::GetBrickDimensions() const
+	{
+		return m_brickDimensions;
+	}
+
+	float SignedDistanceField::GetBrickDistance(uint32_t x, uint32_t y, uint32_t z) const
+	{
+		assert(!m_brickMap.empty() && "the field was baked without a brick map");
+		assert(x < m_dimensions[0] && y < m_dimensions[1] && z < m_dimensions[2] && "sample outside of the grid");
+
+		uint32_t entry = m_brickMap[(z / BrickSize * m_brickDimensions[1] + y / BrickSize) * m_brickDimensions[0] + x / BrickSize];
+		if (entry == EmptyOutside)
+			return m_maxDistance;
+		if (entry == EmptyInside)
+			return -m_maxDistance;
+
+		uint32_t local = ((z % BrickSize) * BrickSize + y % BrickSize) * BrickSize + x % BrickSize;
+		return Denormalize(static_cast<float>(m_brickVoxels[entry + local]) / 255.0f, m_maxDistance);
+	}
+}
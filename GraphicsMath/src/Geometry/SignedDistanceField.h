@@ -0,0 +1,127 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "BVH.h"
+#include "MeshDistance.h"
+#include "TriangleMesh.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace GM
+{
+	struct SDFBakeDesc
+	{
+		uint32_t resolution = 64;    // samples along the longest axis of the bounds, padding included
+		uint32_t padding = 2;        // samples added outside of the mesh bounds on every side
+		// distances are clamped to +-maxDistance voxels and quantized over that range. Bricks further away are
+		// filled without queries, so a narrow band bakes much faster than a full field. 0 keeps the whole range
+		float maxDistance = 0.0f;
+		// voxels up to exactBand voxels from the surface get exact closest point queries, the ones further away
+		// are filled by fast sweeping from them (first order, a few percent too large far from the surface).
+		// Queries far from a mesh visit many nodes, sweeping keeps full range fields fast. 0 queries every voxel
+		float exactBand = 4.0f;
+		bool buildBrickMap = false;
+		bool multithreaded = true;
+	};
+
+	struct SDFBakeStats
+	{
+		double bakeTimeMs = 0.0;
+		double sweepTimeMs = 0.0;
+		uint32_t brickCount = 0;
+		uint32_t farBricks = 0;     // without any voxel in the exact band, filled without per voxel queries
+		uint32_t surfaceBricks = 0; // with at least one voxel closer than maxDistance, the bricks of the brick map
+		uint64_t distanceQueries = 0;
+		uint64_t windingQueries = 0;
+		uint64_t sweptVoxels = 0;   // voxels past the exact band, 0 when they are clamped instead
+	};
+
+	/// <summary>
+	/// Signed distance field sampled on a regular grid, negative inside, baked from a triangle mesh with the
+	/// closest point and winding number queries of MeshDistance.
+	///
+	/// The grid is processed in bricks of 8x8x8 samples split over the job system. One query at the brick center
+	/// bounds the whole brick: a brick further than the exact band is skipped without touching its voxels, a brick
+	/// clear of the surface takes its sign from one winding number, and the remaining voxel queries get the
+	/// center distance plus the offset to the voxel as their search radius. Voxels past the exact band are either
+	/// clamped to maxDistance or, for wider ranges, filled with the fast sweeping method (Zhao 2005): Gauss-Seidel
+	/// sweeps of the eikonal equation in the 8 diagonal orders, parallel over the planes x + y + z = constant.
+	///
+	/// Storage is quantized: a dense grid of 16 bit values over [-maxDistance, maxDistance], x fastest, and
+	/// optionally a brick map where only the surface bricks are kept as 8 bit values in an atlas.
+	/// </summary>
+	class SignedDistanceField
+	{
+	public:
+		static constexpr uint32_t BrickSize = 8;
+		static constexpr uint32_t EmptyOutside = UINT32_MAX;    // brick map entries of bricks clamped
+		static constexpr uint32_t EmptyInside = UINT32_MAX - 1; // to +-maxDistance
+
+		SignedDistanceField();
+		SignedDistanceField(const SDFBakeDesc& desc);
+
+		void Bake(const TriangleMeshView& mesh);
+		// uses an existing bvh of the mesh
+		void Bake(const BVH& bvh, const TriangleMeshView& mesh);
+		void Clear();
+
+		void SetDesc(const SDFBakeDesc& desc);
+		const SDFBakeDesc& GetDesc() const;
+		const SDFBakeStats& GetStats() const;
+
+		// binary, dense grid and brick map as baked
+		bool Save(const std::string& filename) const;
+		bool Load(const std::string& filename);
+
+		bool IsEmpty() const;
+		const uint32_t* GetDimensions() const;
+		// position of sample (0, 0, 0), sample (x, y, z) is at origin + (x, y, z) * voxelSize
+		const Vector& GetOrigin() const;
+		float GetVoxelSize() const;
+		// in world units
+		float GetMaxDistance() const;
+		AABB GetBounds() const;
+
+		// decoded sample, the coordinates must be inside the grid
+		float GetDistance(uint32_t x, uint32_t y, uint32_t z) const;
+		// trilinear interpolation, points outside of the grid are clamped to its border
+		float Sample(const Vector& p) const;
+
+		const std::vector<uint16_t>& GetVoxels() const;
+
+		// one entry per brick, x fastest: first voxel of the brick in GetBrickVoxels(), or EmptyOutside / EmptyInside
+		const std::vector<uint32_t>& GetBrickMap() const;
+		// BrickSize^3 values per surface brick, x fastest, samples past the grid border repeat the last one
+		const std::vector<uint8_t>& GetBrickVoxels() const;
+		const uint32_t* GetBrickDimensions() const;
+		// decoded sample of the brick map
+		float GetBrickDistance(uint32_t x, uint32_t y, uint32_t z) const;
+
+	private:
+		// returns true when the brick was skipped as a whole
+		bool BakeBrick(const MeshDistance& distance, uint32_t brick, float exactDistance, uint32_t& distanceQueries, uint32_t& windingQueries);
+		void Sweep();
+		void SweepVoxel(uint32_t x, uint32_t y, uint32_t z);
+		void ClassifyBricks();
+		void BuildBrickMap();
+
+		SDFBakeDesc m_desc;
+		SDFBakeStats m_stats;
+
+		uint32_t m_dimensions[3];
+		uint32_t m_brickDimensions[3];
+		Vector m_origin;
+		float m_voxelSize;
+		float m_maxDistance;
+
+		std::vector<uint16_t> m_voxels;
+		std::vector<uint32_t> m_brickMap;
+		std::vector<uint8_t> m_brickVoxels;
+		// bake data, released after the bake
+		std::vector<uint8_t> m_brickStates; // 0 far outside, 1 far inside, 2 surface
+		std::vector<float> m_distances;     // signed, +-s_unknown past the exact band
+		std::vector<uint8_t> m_fixed;       // 1 for the voxels of the exact band
+	};
+}
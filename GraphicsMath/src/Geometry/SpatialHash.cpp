@@ -0,0 +1,475 @@
+#include "SpatialHash.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_grainSize = 8192;
+
+		uint32_t NextPowerOfTwo(uint32_t v)
+		{
+			uint32_t res = 1;
+			while (res < v && res < 0x80000000u)
+				res <<= 1;
+
+			return res;
+		}
+
+		// floorf is a library call without SSE4.1, the build calls this for every point
+		int32_t Floor(float f)
+		{
+			int32_t i = static_cast<int32_t>(f);
+			return i - (f < static_cast<float>(i));
+		}
+
+		// returns the previous value. Without other threads touching the counter a plain add avoids the locked instruction
+		uint32_t Increment(std::atomic<uint32_t>& counter, bool concurrent)
+		{
+			if (concurrent)
+				return counter.fetch_add(1, std::memory_order_relaxed);
+
+			uint32_t value = counter.load(std::memory_order_relaxed);
+			counter.store(value + 1, std::memory_order_relaxed);
+			return value;
+		}
+	}
+
+	SpatialHash::SpatialHash()
+		: SpatialHash(SpatialHashDesc())
+	{
+	}
+
+	SpatialHash::SpatialHash(const SpatialHashDesc& desc)
+		: m_desc(desc), m_invCellSize(1.0f / desc.cellSize), m_count(0), m_tableMask(0),
+		m_cellMin{ 0, 0, 0 }, m_cellMax{ -1, -1, -1 }, m_cursorCapacity(0)
+	{
+	}
+
+	void SpatialHash::Build(const Vector* points, uint32_t count)
+	{
+		Build(count > 0 ? &points[0].x : nullptr, count, 4);
+	}
+
+	// stride in floats, the position is the first 3 floats of every element
+	void SpatialHash::Build(const float* positions, uint32_t count, uint32_t stride)
+	{
+		assert(m_desc.cellSize > 0.0f && "cell size must be positive");
+
+		m_invCellSize = 1.0f / m_desc.cellSize;
+		m_count = count;
+
+		uint32_t tableSize = NextPowerOfTwo(m_desc.tableSize > 0 ? m_desc.tableSize : std::max(count, 1u));
+		m_tableMask = tableSize - 1;
+
+		bool parallel = m_desc.multithreaded && JobSystem::GetThreadCount() > 1 && count >= m_desc.parallelThreshold;
+		auto run = [parallel](uint32_t n, const std::function<void(uint32_t first, uint32_t last)>& fn)
+			{
+				if (parallel)
+					JobSystem::ParallelFor(0, n, s_grainSize, fn);
+				else
+					fn(0, n);
+			};
+
+		if (m_cursorCapacity < tableSize)
+		{
+			m_bucketCursors.reset(new std::atomic<uint32_t>[tableSize]);
+			m_cursorCapacity = tableSize;
+		}
+		run(tableSize, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t b = first; b < last; b++)
+					m_bucketCursors[b].store(0, std::memory_order_relaxed);
+			});
+
+		// bucket of every point, bucket sizes and the cell bounds per chunk
+		m_pointBuckets.resize(count);
+		uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(count, s_grainSize) : 1;
+		std::vector<CellRange> chunkBounds(chunkCount);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				CellRange bounds;
+				for (int a = 0; a < 3; a++)
+				{
+					bounds.min[a] = INT32_MAX;
+					bounds.max[a] = INT32_MIN;
+				}
+
+				for (uint32_t i = first; i < last; i++)
+				{
+					const float* p = positions + static_cast<size_t>(i) * stride;
+					int32_t cell[3];
+					Cell(p[0], p[1], p[2], cell);
+					for (int a = 0; a < 3; a++)
+					{
+						bounds.min[a] = std::min(bounds.min[a], cell[a]);
+						bounds.max[a] = std::max(bounds.max[a], cell[a]);
+					}
+
+					uint32_t bucket = Hash(cell[0], cell[1], cell[2]);
+					m_pointBuckets[i] = bucket;
+					Increment(m_bucketCursors[bucket], parallel);
+				}
+				chunkBounds[chunk] = bounds;
+			});
+
+		for (int a = 0; a < 3; a++)
+		{
+			m_cellMin[a] = INT32_MAX;
+			m_cellMax[a] = INT32_MIN;
+			for (const CellRange& bounds : chunkBounds)
+			{
+				m_cellMin[a] = std::min(m_cellMin[a], bounds.min[a]);
+				m_cellMax[a] = std::max(m_cellMax[a], bounds.max[a]);
+			}
+		}
+
+		// exclusive prefix sum of the bucket sizes: chunk sums, chunk offsets, then the chunks
+		m_bucketStart.resize(static_cast<size_t>(tableSize) + 1);
+		uint32_t scanChunks = parallel ? JobSystem::ComputeChunkCount(tableSize, s_grainSize) : 1;
+		std::vector<uint32_t> chunkSums(scanChunks + 1, 0);
+		JobSystem::ParallelForChunks(tableSize, scanChunks, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				uint32_t sum = 0;
+				for (uint32_t b = first; b < last; b++)
+					sum += m_bucketCursors[b].load(std::memory_order_relaxed);
+				chunkSums[chunk + 1] = sum;
+			});
+
+		for (uint32_t c = 0; c < scanChunks; c++)
+			chunkSums[c + 1] += chunkSums[c];
+
+		JobSystem::ParallelForChunks(tableSize, scanChunks, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				uint32_t offset = chunkSums[chunk];
+				for (uint32_t b = first; b < last; b++)
+				{
+					uint32_t size = m_bucketCursors[b].load(std::memory_order_relaxed);
+					m_bucketStart[b] = offset;
+					m_bucketCursors[b].store(offset, std::memory_order_relaxed);
+					offset += size;
+				}
+			});
+		m_bucketStart[tableSize] = count;
+
+		// scatter. Serially the points land in index order inside their bucket, in parallel the buckets are
+		// sorted on the point index afterwards so the layout does not depend on the thread count
+		m_points.resize(count);
+		run(count, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+				{
+					const float* p = positions + static_cast<size_t>(i) * stride;
+					uint32_t dest = Increment(m_bucketCursors[m_pointBuckets[i]], parallel);
+					m_points[dest] = { p[0], p[1], p[2], i };
+				}
+			});
+
+		if (!parallel)
+			return;
+
+		run(tableSize, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t b = first; b < last; b++)
+				{
+					// buckets hold a few points, an insertion sort is enough
+					for (uint32_t i = m_bucketStart[b] + 1; i < m_bucketStart[b + 1]; i++)
+					{
+						SortedPoint point = m_points[i];
+						uint32_t j = i;
+						for (; j > m_bucketStart[b] && m_points[j - 1].index > point.index; j--)
+							m_points[j] = m_points[j - 1];
+						m_points[j] = point;
+					}
+				}
+			});
+	}
+
+	void SpatialHash::Clear()
+	{
+		m_count = 0;
+		m_bucketStart.clear();
+		m_points.clear();
+		m_pointBuckets.clear();
+		m_bucketCursors.reset();
+		m_cursorCapacity = 0;
+		m_chunkPairs.clear();
+	}
+
+	// appends the indices of the points within radius of center
+	void SpatialHash::QueryRadius(const Vector& center, float radius, std::vector<uint32_t>& results) const
+	{
+		Radius(center, radius, results);
+	}
+
+	void SpatialHash::QueryRadius(const Vector* centers, uint32_t count, float radius, std::vector<uint32_t>& offsets, std::vector<uint32_t>& results) const
+	{
+		offsets.assign(static_cast<size_t>(count) + 1, 0);
+		results.clear();
+
+		bool parallel = m_desc.multithreaded && JobSystem::GetThreadCount() > 1 && count >= m_desc.parallelThreshold / 16;
+		uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(count, 256) : 1;
+		std::vector<std::vector<uint32_t>> chunkResults(chunkCount);
+		JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				std::vector<uint32_t>& r = chunk == 0 ? results : chunkResults[chunk];
+				for (uint32_t i = first; i < last; i++)
+				{
+					size_t before = r.size();
+					Radius(centers[i], radius, r);
+					offsets[i + 1] = static_cast<uint32_t>(r.size() - before);
+				}
+			});
+
+		for (uint32_t c = 1; c < chunkCount; c++)
+			results.insert(results.end(), chunkResults[c].begin(), chunkResults[c].end());
+
+		for (uint32_t i = 0; i < count; i++)
+			offsets[i + 1] += offsets[i];
+	}
+
+	uint32_t SpatialHash::QueryKNearest(const Vector& point, uint32_t k, uint32_t* results, float* distancesSq, float maxDistance) const
+	{
+		if (m_count == 0 || k == 0)
+			return 0;
+
+		// max heap on the distance, the root is the current k-th nearest
+		std::vector<std::pair<float, uint32_t>> heap;
+		heap.reserve(k);
+		float maxDistanceSq = maxDistance * maxDistance;
+
+		int32_t c[3];
+		Cell(point.x, point.y, point.z, c);
+
+		// rings of cells at chebyshev distance ring, until the bounds or maxDistance are passed
+		int32_t maxRing = 0;
+		for (int a = 0; a < 3; a++)
+			maxRing = std::max(maxRing, std::max(c[a] - m_cellMin[a], m_cellMax[a] - c[a]));
+		if (maxDistance < 3.402823466e+38f)
+			maxRing = std::min(maxRing, static_cast<int32_t>(ceilf(maxDistance * m_invCellSize)) + 1);
+
+		for (int32_t ring = 0; ring <= maxRing; ring++)
+		{
+			int32_t lo[3], hi[3];
+			for (int a = 0; a < 3; a++)
+			{
+				lo[a] = std::max(c[a] - ring, m_cellMin[a]);
+				hi[a] = std::min(c[a] + ring, m_cellMax[a]);
+			}
+
+			for (int32_t z = lo[2]; z <= hi[2]; z++)
+			{
+				for (int32_t y = lo[1]; y <= hi[1]; y++)
+				{
+					// inside the shell only the two x ends belong to this ring
+					bool shell = abs(z - c[2]) == ring || abs(y - c[1]) == ring;
+					int32_t step = shell ? 1 : std::max(2 * ring, 1);
+					for (int32_t x = shell ? lo[0] : c[0] - ring; x <= hi[0]; x += step)
+					{
+						if (x < lo[0])
+							continue;
+
+						uint32_t bucket = Hash(x, y, z);
+						for (uint32_t i = m_bucketStart[bucket]; i < m_bucketStart[bucket + 1]; i++)
+						{
+							const SortedPoint& p = m_points[i];
+							int32_t pc[3];
+							Cell(p.x, p.y, p.z, pc);
+							if (pc[0] != x || pc[1] != y || pc[2] != z)
+								continue;
+
+							float dx = p.x - point.x;
+							float dy = p.y - point.y;
+							float dz = p.z - point.z;
+							float d = dx * dx + dy * dy + dz * dz;
+							if (d > maxDistanceSq)
+								continue;
+
+							if (heap.size() < k)
+							{
+								heap.push_back({ d, p.index });
+								std::push_heap(heap.begin(), heap.end());
+							}
+							else if (d < heap.front().first)
+							{
+								std::pop_heap(heap.begin(), heap.end());
+								heap.back() = { d, p.index };
+								std::push_heap(heap.begin(), heap.end());
+							}
+						}
+					}
+				}
+			}
+
+			// points in the next rings are at least ring * cellSize away
+			float ringDistance = ring * m_desc.cellSize;
+			if (heap.size() == k && heap.front().first <= ringDistance * ringDistance)
+				break;
+		}
+
+		std::sort_heap(heap.begin(), heap.end());
+		for (size_t i = 0; i < heap.size(); i++)
+		{
+			results[i] = heap[i].second;
+			if (distancesSq)
+				distancesSq[i] = heap[i].first;
+		}
+
+		return static_cast<uint32_t>(heap.size());
+	}
+
+	// every pair of points within distance of each other, in a deterministic order
+	void SpatialHash::FindPairs(float distance, std::vector<ProxyPair>& pairs)
+	{
+		pairs.clear();
+
+		bool parallel = m_desc.multithreaded && JobSystem::GetThreadCount() > 1 && m_count >= m_desc.parallelThreshold;
+		uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(m_count, s_grainSize / 8) : 1;
+		if (m_chunkPairs.size() < chunkCount)
+			m_chunkPairs.resize(chunkCount);
+
+		float distanceSq = distance * distance;
+		JobSystem::ParallelForChunks(m_count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+			{
+				std::vector<ProxyPair>& out = chunk == 0 ? pairs : m_chunkPairs[chunk];
+				out.clear();
+				for (uint32_t i = first; i < last; i++)
+				{
+					const SortedPoint& p = m_points[i];
+
+					// every pair is seen from both points, the one with the lower index reports it
+					ForEachInRange(ComputeRange(Vector(p.x, p.y, p.z, 1.0f), distance), [&](uint32_t j)
+						{
+							const SortedPoint& q = m_points[j];
+							if (q.index <= p.index)
+								return;
+
+							float dx = q.x - p.x;
+							float dy = q.y - p.y;
+							float dz = q.z - p.z;
+							if (dx * dx + dy * dy + dz * dz <= distanceSq)
+								out.push_back({ p.index, q.index });
+						});
+				}
+			});
+
+		for (uint32_t c = 1; c < chunkCount; c++)
+			pairs.insert(pairs.end(), m_chunkPairs[c].begin(), m_chunkPairs[c].end());
+	}
+
+	void SpatialHash::SetDesc(const SpatialHashDesc& desc)
+	{
+		m_desc = desc;
+	}
+
+	const SpatialHashDesc& SpatialHash::GetDesc() const
+	{
+		return m_desc;
+	}
+
+	uint32_t SpatialHash::GetPointCount() const
+	{
+		return m_count;
+	}
+
+	uint32_t SpatialHash::Hash(int32_t x, int32_t y, int32_t z) const
+	{
+		uint32_t h = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u ^ static_cast<uint32_t>(z) * 83492791u;
+
+		// the table index is taken from the low bits, mix the high bits down
+		h ^= h >> 16;
+		h *= 0x7feb352du;
+		h ^= h >> 15;
+		return h & m_tableMask;
+	}
+
+	void SpatialHash::Cell(float x, float y, float z, int32_t* cell) const
+	{
+		cell[0] = Floor(x * m_invCellSize);
+		cell[1] = Floor(y * m_invCellSize);
+		cell[2] = Floor(z * m_invCellSize);
+	}
+
+	SpatialHash::CellRange SpatialHash::ComputeRange(const Vector& center, float radius) const
+	{
+		CellRange range;
+		Cell(center.x - radius, center.y - radius, center.z - radius, range.min);
+		Cell(center.x + radius, center.y + radius, center.z + radius, range.max);
+		for (int a = 0; a < 3; a++)
+		{
+			range.min[a] = std::max(range.min[a], m_cellMin[a]);
+			range.max[a] = std::min(range.max[a], m_cellMax[a]);
+		}
+
+		return range;
+	}
+
+	// calls fn(sortedIndex) for the points of the cells in range, every point at most once
+	template<typename Fn>
+	void SpatialHash::ForEachInRange(const CellRange& range, Fn&& fn) const
+	{
+		uint64_t cellCount = 1;
+		for (int a = 0; a < 3; a++)
+		{
+			if (range.min[a] > range.max[a])
+				return;
+
+			cellCount *= static_cast<uint64_t>(static_cast<int64_t>(range.max[a]) - range.min[a] + 1);
+		}
+
+		// a range with more cells than buckets is cheaper as a scan over every point
+		if (cellCount > m_tableMask + 1ull)
+		{
+			for (uint32_t i = 0; i < m_count; i++)
+			{
+				int32_t pc[3];
+				Cell(m_points[i].x, m_points[i].y, m_points[i].z, pc);
+				if (pc[0] >= range.min[0] && pc[0] <= range.max[0] &&
+					pc[1] >= range.min[1] && pc[1] <= range.max[1] &&
+					pc[2] >= range.min[2] && pc[2] <= range.max[2])
+					fn(i);
+			}
+			return;
+		}
+
+		for (int32_t z = range.min[2]; z <= range.max[2]; z++)
+		{
+			for (int32_t y = range.min[1]; y <= range.max[1]; y++)
+			{
+				for (int32_t x = range.min[0]; x <= range.max[0]; x++)
+				{
+					// several cells can share a bucket, only the points of this cell are visited
+					uint32_t bucket = Hash(x, y, z);
+					for (uint32_t i = m_bucketStart[bucket]; i < m_bucketStart[bucket + 1]; i++)
+					{
+						int32_t pc[3];
+						Cell(m_points[i].x, m_points[i].y, m_points[i].z, pc);
+						if (pc[0] == x && pc[1] == y && pc[2] == z)
+							fn(i);
+					}
+				}
+			}
+		}
+	}
+
+	void SpatialHash::Radius(const Vector& center, float radius, std::vector<uint32_t>& results) const
+	{
+		if (m_count == 0)
+			return;
+
+		float radiusSq = radius * radius;
+		ForEachInRange(ComputeRange(center, radius), [&](uint32_t i)
+			{
+				const SortedPoint& p = m_points[i];
+				float dx = p.x - center.x;
+				float dy = p.y - center.y;
+				float dz = p.z - center.z;
+				if (dx * dx + dy * dy + dz * dz <= radiusSq)
+					results.push_back(p.index);
+			});
+	}
+}
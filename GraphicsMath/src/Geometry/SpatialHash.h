@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Broadphase.h"
+#include "Math/Types.h"
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	struct SpatialHashDesc
+	{
+		float cellSize = 1.0f;   // queries are fastest with a radius close to the cell size
+		uint32_t tableSize = 0;  // bucket count, rounded up to a power of two. 0 = point count
+		bool multithreaded = true;
+		uint32_t parallelThreshold = 16384; // fewer points are built and queried on the calling thread
+	};
+
+	/// <summary>
+	/// Uniform grid over points with the cells hashed into a fixed bucket table.
+	/// The build is a counting sort, points end up sorted by bucket in contiguous arrays (no per cell lists),
+	/// and inside a bucket by point index so results do not depend on the thread count.
+	/// Cells sharing a bucket are told apart by recomputing the cell of every visited point.
+	/// </summary>
+	class SpatialHash
+	{
+	public:
+		SpatialHash();
+		SpatialHash(const SpatialHashDesc& desc);
+
+		void Build(const Vector* points, uint32_t count);
+		// stride in floats, the position is the first 3 floats of every element
+		void Build(const float* positions, uint32_t count, uint32_t stride);
+		void Clear();
+
+		// appends the indices of the points within radius of center
+		void QueryRadius(const Vector& center, float radius, std::vector<uint32_t>& results) const;
+
+		/// <summary>
+		/// One radius query per center, run in parallel. The results of center i are
+		/// results[offsets[i], offsets[i + 1]), offsets receives count + 1 elements.
+		/// </summary>
+		void QueryRadius(const Vector* centers, uint32_t count, float radius, std::vector<uint32_t>& offsets, std::vector<uint32_t>& results) const;
+
+		/// <summary>
+		/// Up to k nearest points within maxDistance, nearest first. Returns the number found.
+		/// distancesSq is optional.
+		/// </summary>
+		uint32_t QueryKNearest(const Vector& point, uint32_t k, uint32_t* results, float* distancesSq = nullptr, float maxDistance = 3.402823466e+38f) const;
+
+		// every pair of points within distance of each other, in a deterministic order
+		void FindPairs(float distance, std::vector<ProxyPair>& pairs);
+
+		void SetDesc(const SpatialHashDesc& desc);
+		const SpatialHashDesc& GetDesc() const;
+		uint32_t GetPointCount() const;
+
+	private:
+		struct CellRange
+		{
+			int32_t min[3];
+			int32_t max[3];
+		};
+
+		uint32_t Hash(int32_t x, int32_t y, int32_t z) const;
+		void Cell(float x, float y, float z, int32_t* cell) const;
+		CellRange ComputeRange(const Vector& center, float radius) const;
+
+		// calls fn(sortedIndex) for the points of the cells in range, every point at most once
+		template<typename Fn>
+		void ForEachInRange(const CellRange& range, Fn&& fn) const;
+
+		void Radius(const Vector& center, float radius, std::vector<uint32_t>& results) const;
+
+		SpatialHashDesc m_desc;
+		float m_invCellSize;
+		uint32_t m_count;
+		uint32_t m_tableMask;
+
+		// cell bounds of the points, queries never look outside of it
+		int32_t m_cellMin[3];
+		int32_t m_cellMax[3];
+
+		// points sorted by bucket, position and index together so a visited point costs one cache line
+		struct SortedPoint
+		{
+			float x, y, z;
+			uint32_t index;
+		};
+
+		std::vector<uint32_t> m_bucketStart; // tableSize + 1
+		std::vector<SortedPoint> m_points;
+
+		// build data
+		std::vector<uint32_t> m_pointBuckets;
+		std::unique_ptr<std::atomic<uint32_t>[]> m_bucketCursors;
+		uint32_t m_cursorCapacity;
+
+		std::vector<std::vector<ProxyPair>> m_chunkPairs;
+	};
+}
@@ -0,0 +1,317 @@
+#include "SweepAndPrune.h"
+#include "Core/JobSystem.h"
+#include "Math/SIMD.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_grainSize = 1024;
+		constexpr uint32_t s_padding = 8;
+		constexpr uint32_t s_radixBits = 11;
+		constexpr uint32_t s_radixBuckets = 1u << s_radixBits;
+
+		// order preserving float -> uint32
+		uint32_t SortKey(float f)
+		{
+			uint32_t bits;
+			memcpy(&bits, &f, sizeof(bits));
+			return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+		}
+	}
+
+	SweepAndPrune::SweepAndPrune()
+		: SweepAndPrune(SweepAndPruneDesc())
+	{
+	}
+
+	SweepAndPrune::SweepAndPrune(const SweepAndPruneDesc& desc)
+		: m_desc(desc), m_count(0), m_axis(0)
+	{
+	}
+
+	void SweepAndPrune::Update(const AABB* boxes, uint32_t count)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		uint32_t axis = ChooseAxis(boxes, count);
+		bool incremental = count > 0 && count == m_count && axis == m_axis && m_order.size() == count;
+		m_count = count;
+		m_axis = axis;
+
+		m_keys.resize(count);
+		if (incremental)
+		{
+			for (uint32_t i = 0; i < count; i++)
+				m_keys[i] = SortKey(boxes[m_order[i]].min[axis]);
+
+			incremental = InsertionSort(m_desc.maxSwapsPerBox * count);
+		}
+		else
+		{
+			m_order.resize(count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				m_keys[i] = SortKey(boxes[i].min[axis]);
+				m_order[i] = i;
+			}
+		}
+
+		if (!incremental)
+			RadixSort();
+
+		// sorted structure of arrays, the padding never passes the range test of the sweep
+		const uint32_t axes[3] = { axis, (axis + 1) % 3, (axis + 2) % 3 };
+		for (int a = 0; a < 3; a++)
+		{
+			m_min[a].resize(count + s_padding);
+			m_max[a].resize(count + s_padding);
+			std::fill(m_min[a].begin() + count, m_min[a].end(), std::numeric_limits<float>::quiet_NaN());
+			std::fill(m_max[a].begin() + count, m_max[a].end(), std::numeric_limits<float>::quiet_NaN());
+		}
+
+		auto gather = [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t i = first; i < last; i++)
+				{
+					const AABB& box = boxes[m_order[i]];
+					for (int a = 0; a < 3; a++)
+					{
+						m_min[a][i] = box.min[axes[a]];
+						m_max[a][i] = box.max[axes[a]];
+					}
+				}
+			};
+
+		if (m_desc.multithreaded && count >= m_desc.parallelThreshold)
+			JobSystem::ParallelFor(0, count, s_grainSize, gather);
+		else
+			gather(0, count);
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_stats.sortTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+		m_stats.axis = axis;
+		m_stats.incremental = incremental;
+	}
+
+	void SweepAndPrune::Clear()
+	{
+		m_count = 0;
+		m_axis = 0;
+		m_keys.clear();
+		m_order.clear();
+		m_tempKeys.clear();
+		m_tempOrder.clear();
+		for (int a = 0; a < 3; a++)
+		{
+			m_min[a].clear();
+			m_max[a].clear();
+		}
+		m_chunkPairs.clear();
+		m_stats = SweepAndPruneStats();
+	}
+
+	// overlapping pairs of the boxes given to the last Update()
+	void SweepAndPrune::FindPairs(std::vector<ProxyPair>& pairs)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		pairs.clear();
+		if (!m_desc.multithreaded || m_count < m_desc.parallelThreshold)
+		{
+			Sweep(0, m_count, pairs);
+		}
+		else
+		{
+			// many more segments than threads, dense regions make some segments much slower than others
+			uint32_t chunkCount = JobSystem::ComputeChunkCount(m_count, s_grainSize);
+			if (m_chunkPairs.size() < chunkCount)
+				m_chunkPairs.resize(chunkCount);
+
+			JobSystem::ParallelForChunks(m_count, chunkCount, [&](uint32_t chunk, uint32_t first, uint32_t last)
+				{
+					m_chunkPairs[chunk].clear();
+					Sweep(first, last, m_chunkPairs[chunk]);
+				});
+
+			size_t total = 0;
+			for (uint32_t c = 0; c < chunkCount; c++)
+				total += m_chunkPairs[c].size();
+
+			pairs.reserve(total);
+			for (uint32_t c = 0; c < chunkCount; c++)
+				pairs.insert(pairs.end(), m_chunkPairs[c].begin(), m_chunkPairs[c].end());
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_stats.sweepTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+		m_stats.pairCount = static_cast<uint32_t>(pairs.size());
+	}
+
+	void SweepAndPrune::SetDesc(const SweepAndPruneDesc& desc)
+	{
+		m_desc = desc;
+	}
+
+	const SweepAndPruneDesc& SweepAndPrune::GetDesc() const
+	{
+		return m_desc;
+	}
+
+	const SweepAndPruneStats& SweepAndPrune::GetStats() const
+	{
+		return m_stats;
+	}
+
+	// proxies sorted along the sweep axis
+	const std::vector<uint32_t>& SweepAndPrune::GetOrder() const
+	{
+		return m_order;
+	}
+
+	uint32_t SweepAndPrune::ChooseAxis(const AABB* boxes, uint32_t count) const
+	{
+		if (count == 0)
+			return 0;
+
+		// sums in double, the centers of large worlds would lose the variance in float
+		double sum[3] = { 0.0, 0.0, 0.0 };
+		double sumSq[3] = { 0.0, 0.0, 0.0 };
+		for (uint32_t i = 0; i < count; i++)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				double c = 0.5 * (static_cast<double>(boxes[i].min[a]) + boxes[i].max[a]);
+				sum[a] += c;
+				sumSq[a] += c * c;
+			}
+		}
+
+		uint32_t axis = 0;
+		double bestVariance = -1.0;
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			double variance = sumSq[a] / count - (sum[a] / count) * (sum[a] / count);
+			if (variance > bestVariance)
+			{
+				bestVariance = variance;
+				axis = a;
+			}
+		}
+
+		return axis;
+	}
+
+	bool SweepAndPrune::InsertionSort(uint32_t maxSwaps)
+	{
+		uint32_t swaps = 0;
+		for (uint32_t i = 1; i < m_count; i++)
+		{
+			uint32_t key = m_keys[i];
+			uint32_t proxy = m_order[i];
+			uint32_t j = i;
+			while (j > 0 && m_keys[j - 1] > key)
+			{
+				m_keys[j] = m_keys[j - 1];
+				m_order[j] = m_order[j - 1];
+				j--;
+
+				if (++swaps > maxSwaps)
+				{
+					// put the element back somewhere, the radix sort only needs the (key, proxy) pairs intact
+					m_keys[j] = key;
+					m_order[j] = proxy;
+					return false;
+				}
+			}
+			m_keys[j] = key;
+			m_order[j] = proxy;
+		}
+
+		return true;
+	}
+
+	void SweepAndPrune::RadixSort()
+	{
+		// least significant digit first, 3 passes of 11 bits. Passes where every key has the same digit are skipped.
+		m_tempKeys.resize(m_count);
+		m_tempOrder.resize(m_count);
+
+		std::vector<uint32_t> histogram(s_radixBuckets);
+		for (uint32_t shift = 0; shift < 32; shift += s_radixBits)
+		{
+			std::fill(histogram.begin(), histogram.end(), 0u);
+			for (uint32_t i = 0; i < m_count; i++)
+				histogram[(m_keys[i] >> shift) & (s_radixBuckets - 1)]++;
+
+			if (m_count == 0 || histogram[(m_keys[0] >> shift) & (s_radixBuckets - 1)] == m_count)
+				continue;
+
+			uint32_t offset = 0;
+			for (uint32_t b = 0; b < s_radixBuckets; b++)
+			{
+				uint32_t c = histogram[b];
+				histogram[b] = offset;
+				offset += c;
+			}
+
+			for (uint32_t i = 0; i < m_count; i++)
+			{
+				uint32_t dest = histogram[(m_keys[i] >> shift) & (s_radixBuckets - 1)]++;
+				m_tempKeys[dest] = m_keys[i];
+				m_tempOrder[dest] = m_order[i];
+			}
+
+			m_keys.swap(m_tempKeys);
+			m_order.swap(m_tempOrder);
+		}
+	}
+
+	void SweepAndPrune::Sweep(uint32_t first, uint32_t last, std::vector<ProxyPair>& pairs) const
+	{
+		const float* min0 = m_min[0].data();
+		const float* min1 = m_min[1].data();
+		const float* max1 = m_max[1].data();
+		const float* min2 = m_min[2].data();
+		const float* max2 = m_max[2].data();
+
+		for (uint32_t i = first; i < last; i++)
+		{
+			Float8 iMax0(m_max[0][i]);
+			Float8 iMin1(min1[i]), iMax1(max1[i]);
+			Float8 iMin2(min2[i]), iMax2(max2[i]);
+
+			// boxes after i start at or after min0[i], they overlap on the sweep axis while they start before max0[i]
+			for (uint32_t j = i + 1; j < m_count; j += 8)
+			{
+				Float8 inRange = Float8::LoadUnaligned(min0 + j) <= iMax0;
+				int rangeBits = MoveMask(inRange);
+				if (!rangeBits)
+					break;
+
+				Float8 overlap = inRange &
+					(Float8::LoadUnaligned(min1 + j) <= iMax1) & (Float8::LoadUnaligned(max1 + j) >= iMin1) &
+					(Float8::LoadUnaligned(min2 + j) <= iMax2) & (Float8::LoadUnaligned(max2 + j) >= iMin2);
+
+				for (uint32_t bits = static_cast<uint32_t>(MoveMask(overlap)); bits; bits &= bits - 1)
+				{
+					uint32_t k = 0;
+					while (!(bits & (1u << k)))
+						k++;
+
+					uint32_t a = m_order[i];
+					uint32_t b = m_order[j + k];
+					pairs.push_back({ std::min(a, b), std::max(a, b) });
+				}
+
+				if (rangeBits != 0xFF)
+					break;
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "Broadphase.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	struct SweepAndPruneDesc
+	{
+		bool multithreaded = true;
+		uint32_t parallelThreshold = 8192; // fewer boxes are swept on the calling thread
+
+		// when the box count and the sweep axis did not change since the last Update() the previous order is
+		// insertion sorted. It falls back to a radix sort after maxSwapsPerBox * count swaps.
+		uint32_t maxSwapsPerBox = 8;
+	};
+
+	struct SweepAndPruneStats
+	{
+		double sortTimeMs = 0.0;
+		double sweepTimeMs = 0.0;
+		uint32_t axis = 0;
+		bool incremental = false; // the last Update() kept the previous order
+		uint32_t pairCount = 0;
+	};
+
+	/// <summary>
+	/// Sort based broadphase for many similarly sized boxes. The boxes are sorted by their min endpoint on the
+	/// axis with the largest center variance, then each box is swept against the following boxes until their
+	/// min passes its max, 8 boxes per SIMD test. The sweep is split in segments over the job system, every
+	/// segment writes its own pair buffer and the buffers are concatenated in order, so the output does not
+	/// depend on the thread count.
+	/// </summary>
+	class SweepAndPrune
+	{
+	public:
+		SweepAndPrune();
+		SweepAndPrune(const SweepAndPruneDesc& desc);
+
+		// boxes[i] is proxy i
+		void Update(const AABB* boxes, uint32_t count);
+		void Clear();
+
+		// overlapping pairs of the boxes given to the last Update()
+		void FindPairs(std::vector<ProxyPair>& pairs);
+
+		void SetDesc(const SweepAndPruneDesc& desc);
+		const SweepAndPruneDesc& GetDesc() const;
+		const SweepAndPruneStats& GetStats() const;
+
+		// proxies sorted along the sweep axis
+		const std::vector<uint32_t>& GetOrder() const;
+
+	private:
+		uint32_t ChooseAxis(const AABB* boxes, uint32_t count) const;
+		bool InsertionSort(uint32_t maxSwaps);
+		void RadixSort();
+		void Sweep(uint32_t first, uint32_t last, std::vector<ProxyPair>& pairs) const;
+
+		SweepAndPruneDesc m_desc;
+		SweepAndPruneStats m_stats;
+
+		uint32_t m_count;
+		uint32_t m_axis;
+
+		// sort keys (min endpoint on the sweep axis as an ordered integer) and the proxies in sorted order
+		std::vector<uint32_t> m_keys;
+		std::vector<uint32_t> m_order;
+		std::vector<uint32_t> m_tempKeys;
+		std::vector<uint32_t> m_tempOrder;
+
+		// boxes in sorted order, padded by 8 elements. [0] is the sweep axis
+		std::vector<float> m_min[3];
+		std::vector<float> m_max[3];
+
+		std::vector<std::vector<ProxyPair>> m_chunkPairs;
+	};
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace GM
+{
+	/// <summary>
+	/// Non owning view of an indexed triangle soup. The position is the first 3 floats of every vertex,
+	/// which is how Utils::BasicMesh lays out its vertices (stride 3, 5, 6 or 8 floats).
+	/// </summary>
+	struct TriangleMeshView
+	{
+		const float* vertices = nullptr;
+		uint32_t vertexCount = 0;
+		uint32_t vertexStride = 3; // in floats
+		const uint32_t* indices = nullptr;
+		uint32_t indexCount = 0;
+
+		TriangleMeshView() = default;
+		TriangleMeshView(const float* vertices, uint32_t vertexCount, uint32_t vertexStride, const uint32_t* indices, uint32_t indexCount)
+			: vertices(vertices), vertexCount(vertexCount), vertexStride(vertexStride), indices(indices), indexCount(indexCount) { }
+
+		uint32_t GetTriangleCount() const { return indexCount / 3; }
+
+		const float* GetPosition(uint32_t vertex) const { return vertices + static_cast<size_t>(vertex) * vertexStride; }
+
+		// corner: [0, 2]
+		const float* GetTrianglePosition(uint32_t triangle, uint32_t corner) const { return GetPosition(indices[triangle * 3 + corner]); }
+	};
+}
@@ -0,0 +1,546 @@
+#include "Decomposition.h"
+#include "SIMD.h"
+
+#include <math.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr int s_maxSweeps = 16;
+
+		// fixed sweep counts of the branch free kernels
+		constexpr int s_svdSweeps = 5;
+		constexpr int s_eigenSweeps = 6;
+
+		constexpr float s_gamma = 5.828427125f; // 3 + 2 * sqrt(2)
+		constexpr float s_cosPi8 = 0.9238795325f;
+		constexpr float s_sinPi8 = 0.3826834324f;
+		constexpr float s_qrEpsilon = 1e-6f;
+		constexpr float s_qrMinEpsilon = 1e-18f;
+
+		// float versions of the Float4 / Float8 functions, the kernels below are written once for a single
+		// matrix and for SIMD lanes
+		inline float Select(bool mask, float a, float b) { return mask ? a : b; }
+		inline float Sqrt(float a) { return sqrtf(a); }
+		inline float Abs(float a) { return fabsf(a); }
+		inline float Max(float a, float b) { return fmaxf(a, b); }
+
+		template<typename T, typename Mask>
+		void CondSwap(Mask c, T& x, T& y)
+		{
+			T z = x;
+			x = Select(c, y, x);
+			y = Select(c, z, y);
+		}
+
+		// swaps and negates one side, a swap of two columns of a rotation stays a rotation
+		template<typename T, typename Mask>
+		void CondNegSwap(Mask c, T& x, T& y)
+		{
+			T z = -x;
+			x = Select(c, y, x);
+			y = Select(c, z, y);
+		}
+
+		template<typename T>
+		struct Symmetric3
+		{
+			T s11;
+			T s21, s22;
+			T s31, s32, s33;
+		};
+
+		/// <summary>
+		/// One Jacobi rotation in the (1, 2) plane of s, accumulated into the quaternion q (x, y, z, w).
+		/// The angle is approximated from the first order expansion, or pi / 8 when that would be too large, which
+		/// still converges and needs no trigonometry. The matrix is rotated by one index afterwards so three calls
+		/// cover the (1, 2), (2, 3) and (3, 1) planes; x, y, z are the original axes now at positions 1, 2, 3.
+		/// </summary>
+		template<typename T>
+		void JacobiConjugation(int x, int y, int z, Symmetric3<T>& s, T* q)
+		{
+			T ch = 2.0f * (s.s11 - s.s22);
+			T sh = s.s21;
+			auto exact = T(s_gamma) * sh * sh < ch * ch;
+			T w = T(1.0f) / Sqrt(ch * ch + sh * sh);
+			ch = Select(exact, w * ch, T(s_cosPi8));
+			sh = Select(exact, w * sh, T(s_sinPi8));
+
+			// cos and sin of the full angle
+			T scale = ch * ch + sh * sh;
+			T a = (ch * ch - sh * sh) / scale;
+			T b = (2.0f * sh * ch) / scale;
+
+			// s = transpose(Q) * s * Q
+			Symmetric3<T> t = s;
+			s.s11 = a * (a * t.s11 + b * t.s21) + b * (a * t.s21 + b * t.s22);
+			s.s21 = a * (-b * t.s11 + a * t.s21) + b * (-b * t.s21 + a * t.s22);
+			s.s22 = -b * (-b * t.s11 + a * t.s21) + a * (-b * t.s21 + a * t.s22);
+			s.s31 = a * t.s31 + b * t.s32;
+			s.s32 = -b * t.s31 + a * t.s32;
+			s.s33 = t.s33;
+
+			// q = q * (sh along the rotation axis, ch)
+			T tmp[3] = { q[0] * sh, q[1] * sh, q[2] * sh };
+			sh = sh * q[3];
+			for (int i = 0; i < 4; i++)
+				q[i] = q[i] * ch;
+			q[z] = q[z] + sh;
+			q[3] = q[3] - tmp[z];
+			q[x] = q[x] + tmp[y];
+			q[y] = q[y] - tmp[x];
+
+			// the next plane moves to (1, 2)
+			t = s;
+			s.s11 = t.s22;
+			s.s21 = t.s32;
+			s.s22 = t.s33;
+			s.s31 = t.s21;
+			s.s32 = t.s31;
+			s.s33 = t.s11;
+		}
+
+		// diagonalizes s, q receives the rotation whose columns are the eigenvectors
+		template<typename T>
+		void JacobiEigen(Symmetric3<T>& s, T* q, int sweeps)
+		{
+			q[0] = q[1] = q[2] = 0.0f;
+			q[3] = 1.0f;
+			for (int i = 0; i < sweeps; i++)
+			{
+				JacobiConjugation(0, 1, 2, s, q);
+				JacobiConjugation(1, 2, 0, s, q);
+				JacobiConjugation(2, 0, 1, s, q);
+			}
+		}
+
+		template<typename T>
+		void QuatToMat3(const T* q, T m[3][3])
+		{
+			T x = q[0], y = q[1], z = q[2], w = q[3];
+			T xx = x * x, yy = y * y, zz = z * z;
+			T xy = x * y, xz = x * z, yz = y * z;
+			T wx = w * x, wy = w * y, wz = w * z;
+			m[0][0] = 1.0f - 2.0f * (yy + zz);
+			m[0][1] = 2.0f * (xy - wz);
+			m[0][2] = 2.0f * (xz + wy);
+			m[1][0] = 2.0f * (xy + wz);
+			m[1][1] = 1.0f - 2.0f * (xx + zz);
+			m[1][2] = 2.0f * (yz - wx);
+			m[2][0] = 2.0f * (xz - wy);
+			m[2][1] = 2.0f * (yz + wx);
+			m[2][2] = 1.0f - 2.0f * (xx + yy);
+		}
+
+		template<typename T>
+		void ColumnSwap(T m[3][3], int i, int j, decltype(T() < T()) c)
+		{
+			for (int k = 0; k < 3; k++)
+				CondNegSwap(c, m[k][i], m[k][j]);
+		}
+
+		// Givens rotation (cos, sin) that zeroes a2 against the pivot a1
+		template<typename T>
+		void QRGivens(T a1, T a2, T epsilon, T& c, T& s)
+		{
+			T rho = Sqrt(a1 * a1 + a2 * a2);
+			T sh = Select(rho > epsilon, a2, T(0.0f));
+			T ch = Abs(a1) + Max(rho, epsilon);
+			CondSwap(a1 < T(0.0f), sh, ch);
+			T w = T(1.0f) / Sqrt(ch * ch + sh * sh);
+			ch = ch * w;
+			sh = sh * w;
+
+			// from the half angle to the full one
+			c = 1.0f - 2.0f * sh * sh;
+			s = 2.0f * ch * sh;
+		}
+
+		// b = q * r, q the product of three Givens rotations
+		template<typename T>
+		void QRDecomposition(T b[3][3], T epsilon, T q[3][3], T r[3][3])
+		{
+			T c1, s1, c2, s2, c3, s3;
+
+			// rows 1, 2
+			QRGivens(b[0][0], b[1][0], epsilon, c1, s1);
+			for (int j = 0; j < 3; j++)
+			{
+				T b0 = b[0][j], b1 = b[1][j];
+				b[0][j] = c1 * b0 + s1 * b1;
+				b[1][j] = -s1 * b0 + c1 * b1;
+			}
+
+			// rows 1, 3
+			QRGivens(b[0][0], b[2][0], epsilon, c2, s2);
+			for (int j = 0; j < 3; j++)
+			{
+				T b0 = b[0][j], b2 = b[2][j];
+				b[0][j] = c2 * b0 + s2 * b2;
+				b[2][j] = -s2 * b0 + c2 * b2;
+			}
+
+			// rows 2, 3
+			QRGivens(b[1][1], b[2][1], epsilon, c3, s3);
+			for (int j = 0; j < 3; j++)
+			{
+				T b1 = b[1][j], b2 = b[2][j];
+				b[1][j] = c3 * b1 + s3 * b2;
+				b[2][j] = -s3 * b1 + c3 * b2;
+			}
+
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+					r[i][j] = b[i][j];
+			}
+
+			// q = G1 * G2 * G3, each G the transpose of the rotation applied above
+			q[0][0] = c1 * c2;
+			q[1][0] = s1 * c2;
+			q[2][0] = s2;
+			q[0][1] = -s1 * c3 - c1 * s2 * s3;
+			q[1][1] = c1 * c3 - s1 * s2 * s3;
+			q[2][1] = c2 * s3;
+			q[0][2] = s1 * s3 - c1 * s2 * c3;
+			q[1][2] = -c1 * s3 - s1 * s2 * c3;
+			q[2][2] = c2 * c3;
+		}
+
+		template<typename T>
+		void SVDKernel(const T a[3][3], T u[3][3], T sigma[3], T v[3][3])
+		{
+			Symmetric3<T> s;
+			s.s11 = a[0][0] * a[0][0] + a[1][0] * a[1][0] + a[2][0] * a[2][0];
+			s.s21 = a[0][1] * a[0][0] + a[1][1] * a[1][0] + a[2][1] * a[2][0];
+			s.s22 = a[0][1] * a[0][1] + a[1][1] * a[1][1] + a[2][1] * a[2][1];
+			s.s31 = a[0][2] * a[0][0] + a[1][2] * a[1][0] + a[2][2] * a[2][0];
+			s.s32 = a[0][2] * a[0][1] + a[1][2] * a[1][1] + a[2][2] * a[2][1];
+			s.s33 = a[0][2] * a[0][2] + a[1][2] * a[1][2] + a[2][2] * a[2][2];
+
+			T q[4];
+			JacobiEigen(s, q, s_svdSweeps);
+			QuatToMat3(q, v);
+
+			// b = a * v has orthogonal columns of length sigma
+			T b[3][3];
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+					b[i][j] = a[i][0] * v[0][j] + a[i][1] * v[1][j] + a[i][2] * v[2][j];
+			}
+
+			T rho[3];
+			for (int j = 0; j < 3; j++)
+				rho[j] = b[0][j] * b[0][j] + b[1][j] * b[1][j] + b[2][j] * b[2][j];
+
+			// largest column first
+			auto c = rho[0] < rho[1];
+			ColumnSwap(b, 0, 1, c);
+			ColumnSwap(v, 0, 1, c);
+			CondSwap(c, rho[0], rho[1]);
+			c = rho[0] < rho[2];
+			ColumnSwap(b, 0, 2, c);
+			ColumnSwap(v, 0, 2, c);
+			CondSwap(c, rho[0], rho[2]);
+			c = rho[1] < rho[2];
+			ColumnSwap(b, 1, 2, c);
+			ColumnSwap(v, 1, 2, c);
+
+			// the QR threshold follows the scale of the matrix
+			T epsilon = Max(T(s_qrEpsilon) * Sqrt(s.s11 + s.s22 + s.s33), T(s_qrMinEpsilon));
+
+			T r[3][3];
+			QRDecomposition(b, epsilon, u, r);
+			sigma[0] = r[0][0];
+			sigma[1] = r[1][1];
+			sigma[2] = r[2][2];
+		}
+
+		template<typename T>
+		void PolarKernel(const T a[3][3], T r[3][3], T s[3][3])
+		{
+			T u[3][3], sigma[3], v[3][3];
+			SVDKernel(a, u, sigma, v);
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					r[i][j] = u[i][0] * v[j][0] + u[i][1] * v[j][1] + u[i][2] * v[j][2];
+					s[i][j] = v[i][0] * sigma[0] * v[j][0] + v[i][1] * sigma[1] * v[j][1] + v[i][2] * sigma[2] * v[j][2];
+				}
+			}
+		}
+
+		// eigenvalues largest first, the columns of v are the eigenvectors
+		template<typename T>
+		void EigenKernel(const T a[3][3], T v[3][3], T values[3])
+		{
+			Symmetric3<T> s;
+			s.s11 = a[0][0];
+			s.s21 = a[0][1];
+			s.s22 = a[1][1];
+			s.s31 = a[0][2];
+			s.s32 = a[1][2];
+			s.s33 = a[2][2];
+
+			T q[4];
+			JacobiEigen(s, q, s_eigenSweeps);
+			QuatToMat3(q, v);
+			values[0] = s.s11;
+			values[1] = s.s22;
+			values[2] = s.s33;
+
+			auto c = values[0] < values[1];
+			ColumnSwap(v, 0, 1, c);
+			CondSwap(c, values[0], values[1]);
+			c = values[0] < values[2];
+			ColumnSwap(v, 0, 2, c);
+			CondSwap(c, values[0], values[2]);
+			c = values[1] < values[2];
+			ColumnSwap(v, 1, 2, c);
+			CondSwap(c, values[1], values[2]);
+		}
+
+		void Load(const Matrix& m, float a[3][3])
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+					a[i][j] = m.f[i][j];
+			}
+		}
+
+		Matrix Store(const float a[3][3])
+		{
+			return Matrix(
+				a[0][0], a[0][1], a[0][2], 0.0f,
+				a[1][0], a[1][1], a[1][2], 0.0f,
+				a[2][0], a[2][1], a[2][2], 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f);
+		}
+
+		// the converged off diagonal elements of the fixed sweeps end up denormal, which is several times slower
+		// on x86. Flushes them to zero while the kernels run and restores the caller's mode afterwards
+		class DenormalsAsZero
+		{
+		public:
+			DenormalsAsZero() : m_csr(_mm_getcsr()) { _mm_setcsr(m_csr | s_flushZero | s_denormalsZero); }
+			~DenormalsAsZero() { _mm_setcsr(m_csr); }
+
+		private:
+			static constexpr uint32_t s_flushZero = 0x8000;
+			static constexpr uint32_t s_denormalsZero = 0x0040;
+
+			uint32_t m_csr;
+		};
+
+		// 3x3 matrices in structure of arrays form, element (i, j) of matrix k is lanes[i * 3 + j][k].
+		// The tail of a batch repeats the last matrix
+		struct alignas(32) Batch
+		{
+			float lanes[9][Float8::Width];
+
+			void Load(const Matrix* m, uint32_t count, Float8 a[3][3])
+			{
+				for (uint32_t k = 0; k < Float8::Width; k++)
+				{
+					const Matrix& src = m[k < count ? k : count - 1];
+					for (int e = 0; e < 9; e++)
+						lanes[e][k] = src.f[e / 3][e % 3];
+				}
+
+				for (int e = 0; e < 9; e++)
+					a[e / 3][e % 3] = Float8::Load(lanes[e]);
+			}
+
+			void Store(const Float8 a[3][3], uint32_t count, Matrix* m)
+			{
+				for (int e = 0; e < 9; e++)
+					a[e / 3][e % 3].Store(lanes[e]);
+
+				for (uint32_t k = 0; k < count && k < Float8::Width; k++)
+				{
+					float res[3][3];
+					for (int e = 0; e < 9; e++)
+						res[e / 3][e % 3] = lanes[e][k];
+					m[k] = GM::Store(res);
+				}
+			}
+
+			void Store(const Float8* v, uint32_t count, Vector* out)
+			{
+				for (int e = 0; e < 3; e++)
+					v[e].Store(lanes[e]);
+
+				for (uint32_t k = 0; k < count && k < Float8::Width; k++)
+					out[k] = Vector(lanes[0][k], lanes[1][k], lanes[2][k], 0.0f);
+			}
+		};
+	}
+
+	// =========================================== Eigen ==================================================
+
+	Matrix MatEigenSymmetric(const Matrix& m, Vector& eigenvalues)
+	{
+		// double keeps the small eigenvalues of badly scaled covariances
+		double a[3][3];
+		double v[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = i; j < 3; j++)
+				a[i][j] = a[j][i] = m.f[i][j];
+		}
+
+		// every rotation zeroes one off diagonal element, a sweep over the three converges quadratically
+		for (int sweep = 0; sweep < s_maxSweeps; sweep++)
+		{
+			double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+			double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+			if (off <= 1e-30 * diagonal || off == 0.0)
+				break;
+
+			for (int p = 0; p < 2; p++)
+			{
+				for (int q = p + 1; q < 3; q++)
+				{
+					if (a[p][q] == 0.0)
+						continue;
+
+					// the smaller of the two angles that zero a[p][q]
+					double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+					double t = 1.0 / (fabs(theta) + sqrt(theta * theta + 1.0));
+					if (theta < 0.0)
+						t = -t;
+					double c = 1.0 / sqrt(t * t + 1.0);
+					double s = t * c;
+
+					// a = J^T * a * J, v = v * J
+					for (int k = 0; k < 3; k++)
+					{
+						double kp = a[k][p], kq = a[k][q];
+						a[k][p] = c * kp - s * kq;
+						a[k][q] = s * kp + c * kq;
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						double pk = a[p][k], qk = a[q][k];
+						a[p][k] = c * pk - s * qk;
+						a[q][k] = s * pk + c * qk;
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						double kp = v[k][p], kq = v[k][q];
+						v[k][p] = c * kp - s * kq;
+						v[k][q] = s * kp + c * kq;
+					}
+				}
+			}
+		}
+
+		// largest first, the eigenvectors are the columns of v
+		int order[3] = { 0, 1, 2 };
+		for (int i = 0; i < 2; i++)
+		{
+			for (int j = i + 1; j < 3; j++)
+			{
+				if (a[order[j]][order[j]] > a[order[i]][order[i]])
+				{
+					int swap = order[i];
+					order[i] = order[j];
+					order[j] = swap;
+				}
+			}
+		}
+
+		Matrix res;
+		for (int i = 0; i < 3; i++)
+		{
+			eigenvalues[i] = static_cast<float>(a[order[i]][order[i]]);
+			res.v[i] = Vector(static_cast<float>(v[0][order[i]]), static_cast<float>(v[1][order[i]]), static_cast<float>(v[2][order[i]]), 0.0f);
+		}
+		eigenvalues.w = 0.0f;
+
+		// the third axis follows from the first two, which also makes the rotation right handed
+		const Vector& x = res.v[0];
+		const Vector& y = res.v[1];
+		res.v[2] = Vector(x.y * y.z - x.z * y.y, x.z * y.x - x.x * y.z, x.x * y.y - x.y * y.x, 0.0f);
+		res.v[3] = Vector(0.0f, 0.0f, 0.0f, 1.0f);
+		return res;
+	}
+
+	void MatEigenSymmetric(const Matrix* m, uint32_t count, Matrix* eigenvectors, Vector* eigenvalues)
+	{
+		DenormalsAsZero denormals;
+		for (uint32_t i = 0; i < count; i += Float8::Width)
+		{
+			Batch batch;
+			Float8 a[3][3], v[3][3], values[3];
+			batch.Load(m + i, count - i, a);
+			EigenKernel(a, v, values);
+
+			// the rows of the result are the eigenvectors
+			Float8 rows[3][3];
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+					rows[r][c] = v[c][r];
+			}
+			batch.Store(rows, count - i, eigenvectors + i);
+			batch.Store(values, count - i, eigenvalues + i);
+		}
+	}
+
+	// =========================================== SVD ====================================================
+
+	void MatSVD(const Matrix& m, Matrix& u, Vector& sigma, Matrix& v)
+	{
+		DenormalsAsZero denormals;
+		float a[3][3], ua[3][3], s[3], va[3][3];
+		Load(m, a);
+		SVDKernel(a, ua, s, va);
+		u = Store(ua);
+		v = Store(va);
+		sigma = Vector(s[0], s[1], s[2], 0.0f);
+	}
+
+	void MatSVD(const Matrix* m, uint32_t count, Matrix* u, Vector* sigma, Matrix* v)
+	{
+		DenormalsAsZero denormals;
+		for (uint32_t i = 0; i < count; i += Float8::Width)
+		{
+			Batch batch;
+			Float8 a[3][3], ua[3][3], s[3], va[3][3];
+			batch.Load(m + i, count - i, a);
+			SVDKernel(a, ua, s, va);
+			batch.Store(ua, count - i, u + i);
+			batch.Store(va, count - i, v + i);
+			batch.Store(s, count - i, sigma + i);
+		}
+	}
+
+	void MatPolarDecomposition(const Matrix& m, Matrix& r, Matrix& s)
+	{
+		DenormalsAsZero denormals;
+		float a[3][3], ra[3][3], sa[3][3];
+		Load(m, a);
+		PolarKernel(a, ra, sa);
+		r = Store(ra);
+		s = Store(sa);
+	}
+
+	void MatPolarDecomposition(const Matrix* m, uint32_t count, Matrix* r, Matrix* s)
+	{
+		DenormalsAsZero denormals;
+		for (uint32_t i = 0; i < count; i += Float8::Width)
+		{
+			Batch batch;
+			Float8 a[3][3], ra[3][3], sa[3][3];
+			batch.Load(m + i, count - i, a);
+			PolarKernel(a, ra, sa);
+			batch.Store(ra, count - i, r + i);
+			batch.Store(sa, count - i, s + i);
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Types.h"
+
+#include <stdint.h>
+
+// Decompositions of the upper 3x3 of a Matrix, as a plain 3x3 matrix: f[i][j] is row i, column j and products are
+// ordinary matrix products, so they hold for both the row vector and the column vector reading of a transform.
+
+namespace GM
+{
+	// =========================================== Eigen ==================================================
+
+	/// <summary>
+	/// Eigen decomposition of the upper 3x3 of a symmetric matrix (covariance, inertia tensor) with cyclic Jacobi
+	/// rotations. Only the upper triangle is read.
+	/// </summary>
+	/// <param name="m">symmetric matrix</param>
+	/// <param name="eigenvalues">receives the eigenvalues in x, y, z, largest first</param>
+	/// <returns>rotation whose rows are the unit eigenvectors in the order of the eigenvalues, right handed</returns>
+	Matrix MatEigenSymmetric(const Matrix& m, Vector& eigenvalues);
+
+	/// <summary>
+	/// MatEigenSymmetric over many matrices, 8 at a time in SIMD lanes (one AVX or two SSE registers).
+	/// Branch free: a fixed number of Jacobi sweeps with the approximate rotations of the SVD below instead of
+	/// running to convergence, about 1e-6 relative to the largest eigenvalue.
+	/// </summary>
+	void MatEigenSymmetric(const Matrix* m, uint32_t count, Matrix* eigenvectors, Vector* eigenvalues);
+
+	// =========================================== SVD ====================================================
+
+	/// <summary>
+	/// m = u * diag(sigma) * transpose(v) with u and v rotations. sigma is sorted by decreasing magnitude and
+	/// sigma.z is negative when m flips orientation, which keeps u and v free of reflections.
+	/// McAdams et al. 2011, "Computing the Singular Value Decomposition of 3x3 matrices with minimal branching
+	/// and elementary floating point operations": Jacobi on transpose(m) * m with quaternion rotations, then a
+	/// Givens QR of m * v. No branches, so the batched version runs the same code over SIMD lanes.
+	/// </summary>
+	void MatSVD(const Matrix& m, Matrix& u, Vector& sigma, Matrix& v);
+
+	// MatSVD over many matrices, 8 at a time in SIMD lanes
+	void MatSVD(const Matrix* m, uint32_t count, Matrix* u, Vector* sigma, Matrix* v);
+
+	/// <summary>
+	/// m = r * s with r the rotation closest to m and s symmetric, from the SVD: r = u * transpose(v),
+	/// s = v * diag(sigma) * transpose(v). s has a negative eigenvalue when m flips orientation.
+	/// The rotation part of deformation gradients (shape matching, corotated FEM) and of skinning matrices.
+	/// </summary>
+	void MatPolarDecomposition(const Matrix& m, Matrix& r, Matrix& s);
+
+	// MatPolarDecomposition over many matrices, 8 at a time in SIMD lanes
+	void MatPolarDecomposition(const Matrix* m, uint32_t count, Matrix* r, Matrix* s);
+}
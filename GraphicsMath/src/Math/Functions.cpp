@@ -1032,4 +1032,27 @@ namespace GM
 
 		return res;
 	}
+
+	Frustum FrustumFromMatrix(const Matrix& m)
+	{
+		// clip = p * m, p is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+		// every inequality is a plane made of the columns of m
+		Vector col[4];
+		for (int i = 0; i < 4; i++)
+			col[i] = Vector(m.f[0][i], m.f[1][i], m.f[2][i], m.f[3][i]);
+
+		auto normalize = [](const Vector& plane)
+			{
+				return plane / Vec3Magnitude(plane);
+			};
+
+		Frustum res;
+		res.left = normalize(col[3] + col[0]);
+		res.right = normalize(col[3] - col[0]);
+		res.bottom = normalize(col[3] + col[1]);
+		res.top = normalize(col[3] - col[1]);
+		res.nearZ = normalize(col[2]);
+		res.farZ = normalize(col[3] - col[2]);
+		return res;
+	}
 }
\ No newline at end of file
@@ -257,6 +257,13 @@ namespace GM
 
 
 
+	// dir must not be parallel to the plane, IntersectRayPlane in Geometry/Intersection.h reports that case
 	Vector LinePlaneIntersection(const Vector& point, const Vector& dir, const Vector& plane);
 	Frustum FrustumFov(float fovAngleY, float aspectRatio, float nearZ, float farZ);
+
+	/// <summary>
+	/// Normalized frustum planes of a row vector (view) projection matrix with clip z in [0, w].
+	/// With a view projection matrix the planes are in world space.
+	/// </summary>
+	Frustum FrustumFromMatrix(const Matrix& m);
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+
+// Thin wrappers over SSE / AVX registers used by the batch geometry kernels.
+// Float8 maps to one AVX register when compiled with AVX (/arch:AVX, -mavx), otherwise to two SSE registers.
+
+namespace GM
+{
+	// =========================================== Float4 =================================================
+
+	struct Float4
+	{
+		static constexpr uint32_t Width = 4;
+
+		__m128 m;
+
+		Float4() = default;
+		Float4(__m128 m) : m(m) { }
+		Float4(float f) : m(_mm_set1_ps(f)) { }
+
+		// p must be 16 byte aligned
+		static Float4 Load(const float* p) { return _mm_load_ps(p); }
+		static Float4 LoadUnaligned(const float* p) { return _mm_loadu_ps(p); }
+
+		// p must be 16 byte aligned
+		void Store(float* p) const { _mm_store_ps(p, m); }
+		void StoreUnaligned(float* p) const { _mm_storeu_ps(p, m); }
+
+		float operator[](int i) const { alignas(16) float f[4]; _mm_store_ps(f, m); return f[i]; }
+	};
+
+	inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.m, b.m); }
+	inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.m, b.m); }
+	inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.m, b.m); }
+	inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.m, b.m); }
+	inline Float4 operator-(Float4 a) { return _mm_xor_ps(a.m, _mm_set1_ps(-0.0f)); }
+
+	// comparisons return a lane mask with all bits set where true
+	inline Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.m, b.m); }
+	inline Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.m, b.m); }
+	inline Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.m, b.m); }
+	inline Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.m, b.m); }
+
+	inline Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.m, b.m); }
+	inline Float4 operator|(Float4 a, Float4 b) { return _mm_or_ps(a.m, b.m); }
+
+	inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.m, b.m); }
+	inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.m, b.m); }
+	inline Float4 Abs(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.m); }
+	inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.m); }
+
+	// a * b + c
+	inline Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a.m, b.m), c.m); }
+
+	// mask ? a : b
+	inline Float4 Select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask.m, a.m), _mm_andnot_ps(mask.m, b.m)); }
+
+	// one bit per lane
+	inline int MoveMask(Float4 mask) { return _mm_movemask_ps(mask.m); }
+
+
+
+
+	// =========================================== Float8 =================================================
+
+#ifdef __AVX__
+	struct Float8
+	{
+		static constexpr uint32_t Width = 8;
+
+		__m256 m;
+
+		Float8() = default;
+		Float8(__m256 m) : m(m) { }
+		Float8(float f) : m(_mm256_set1_ps(f)) { }
+
+		// p must be 32 byte aligned
+		static Float8 Load(const float* p) { return _mm256_load_ps(p); }
+		static Float8 LoadUnaligned(const float* p) { return _mm256_loadu_ps(p); }
+
+		// p must be 32 byte aligned
+		void Store(float* p) const { _mm256_store_ps(p, m); }
+		void StoreUnaligned(float* p) const { _mm256_storeu_ps(p, m); }
+
+		float operator[](int i) const { alignas(32) float f[8]; _mm256_store_ps(f, m); return f[i]; }
+	};
+
+	inline Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.m, b.m); }
+	inline Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.m, b.m); }
+	inline Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.m, b.m); }
+	inline Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.m, b.m); }
+	inline Float8 operator-(Float8 a) { return _mm256_xor_ps(a.m, _mm256_set1_ps(-0.0f)); }
+
+	inline Float8 operator<(Float8 a, Float8 b) { return _mm256_cmp_ps(a.m, b.m, _CMP_LT_OQ); }
+	inline Float8 operator<=(Float8 a, Float8 b) { return _mm256_cmp_ps(a.m, b.m, _CMP_LE_OQ); }
+	inline Float8 operator>(Float8 a, Float8 b) { return _mm256_cmp_ps(a.m, b.m, _CMP_GT_OQ); }
+	inline Float8 operator>=(Float8 a, Float8 b) { return _mm256_cmp_ps(a.m, b.m, _CMP_GE_OQ); }
+
+	inline Float8 operator&(Float8 a, Float8 b) { return _mm256_and_ps(a.m, b.m); }
+	inline Float8 operator|(Float8 a, Float8 b) { return _mm256_or_ps(a.m, b.m); }
+
+	inline Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a.m, b.m); }
+	inline Float8 Max(Float8 a, Float8 b) { return _mm256_max_ps(a.m, b.m); }
+	inline Float8 Abs(Float8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.m); }
+	inline Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a.m); }
+
+	inline Float8 MulAdd(Float8 a, Float8 b, Float8 c) { return _mm256_add_ps(_mm256_mul_ps(a.m, b.m), c.m); }
+
+	inline Float8 Select(Float8 mask, Float8 a, Float8 b) { return _mm256_blendv_ps(b.m, a.m, mask.m); }
+
+	inline int MoveMask(Float8 mask) { return _mm256_movemask_ps(mask.m); }
+#else
+	struct Float8
+	{
+		static constexpr uint32_t Width = 8;
+
+		Float4 lo;
+		Float4 hi;
+
+		Float8() = default;
+		Float8(Float4 lo, Float4 hi) : lo(lo), hi(hi) { }
+		Float8(float f) : lo(f), hi(f) { }
+
+		// p must be 16 byte aligned
+		static Float8 Load(const float* p) { return Float8(Float4::Load(p), Float4::Load(p + 4)); }
+		static Float8 LoadUnaligned(const float* p) { return Float8(Float4::LoadUnaligned(p), Float4::LoadUnaligned(p + 4)); }
+
+		// p must be 16 byte aligned
+		void Store(float* p) const { lo.Store(p); hi.Store(p + 4); }
+		void StoreUnaligned(float* p) const { lo.StoreUnaligned(p); hi.StoreUnaligned(p + 4); }
+
+		float operator[](int i) const { return i < 4 ? lo[i] : hi[i - 4]; }
+	};
+
+	inline Float8 operator+(Float8 a, Float8 b) { return Float8(a.lo + b.lo, a.hi + b.hi); }
+	inline Float8 operator-(Float8 a, Float8 b) { return Float8(a.lo - b.lo, a.hi - b.hi); }
+	inline Float8 operator*(Float8 a, Float8 b) { return Float8(a.lo * b.lo, a.hi * b.hi); }
+	inline Float8 operator/(Float8 a, Float8 b) { return Float8(a.lo / b.lo, a.hi / b.hi); }
+	inline Float8 operator-(Float8 a) { return Float8(-a.lo, -a.hi); }
+
+	inline Float8 operator<(Float8 a, Float8 b) { return Float8(a.lo < b.lo, a.hi < b.hi); }
+	inline Float8 operator<=(Float8 a, Float8 b) { return Float8(a.lo <= b.lo, a.hi <= b.hi); }
+	inline Float8 operator>(Float8 a, Float8 b) { return Float8(a.lo > b.lo, a.hi > b.hi); }
+	inline Float8 operator>=(Float8 a, Float8 b) { return Float8(a.lo >= b.lo, a.hi >= b.hi); }
+
+	inline Float8 operator&(Float8 a, Float8 b) { return Float8(a.lo & b.lo, a.hi & b.hi); }
+	inline Float8 operator|(Float8 a, Float8 b) { return Float8(a.lo | b.lo, a.hi | b.hi); }
+
+	inline Float8 Min(Float8 a, Float8 b) { return Float8(Min(a.lo, b.lo), Min(a.hi, b.hi)); }
+	inline Float8 Max(Float8 a, Float8 b) { return Float8(Max(a.lo, b.lo), Max(a.hi, b.hi)); }
+	inline Float8 Abs(Float8 a) { return Float8(Abs(a.lo), Abs(a.hi)); }
+	inline Float8 Sqrt(Float8 a) { return Float8(Sqrt(a.lo), Sqrt(a.hi)); }
+
+	inline Float8 MulAdd(Float8 a, Float8 b, Float8 c) { return Float8(MulAdd(a.lo, b.lo, c.lo), MulAdd(a.hi, b.hi, c.hi)); }
+
+	inline Float8 Select(Float8 mask, Float8 a, Float8 b) { return Float8(Select(mask.lo, a.lo, b.lo), Select(mask.hi, a.hi, b.hi)); }
+
+	inline int MoveMask(Float8 mask) { return MoveMask(mask.lo) | (MoveMask(mask.hi) << 4); }
+#endif // __AVX__
+}
@@ -0,0 +1,138 @@
+#include "IndexBuffer.h"
+
+#include <assert.h>
+#include <emmintrin.h>
+#include <string.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_invalid = ~0u;
+		constexpr uint32_t s_maxIndex16 = 0xffff;
+	}
+
+	uint32_t GetIndexSize(IndexFormat format)
+	{
+		return format == IndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	IndexFormat SelectIndexFormat(uint32_t vertexCount)
+	{
+		return vertexCount <= s_maxIndex16 + 1 ? IndexFormat::UInt16 : IndexFormat::UInt32;
+	}
+
+	void ConvertIndices(const uint32_t* indices, uint32_t indexCount, IndexFormat format, void* destination)
+	{
+		if (format == IndexFormat::UInt32)
+		{
+			if (destination != indices)
+				memmove(destination, indices, static_cast<size_t>(indexCount) * sizeof(uint32_t));
+
+			return;
+		}
+
+		// biased by -32768 to fit the signed saturation of _mm_packs_epi32, unbiased again on the 16 bit lanes.
+		// In place is fine: 8 indices are loaded before their 16 bytes are stored over the first 4
+		uint16_t* dst = static_cast<uint16_t*>(destination);
+		const __m128i bias32 = _mm_set1_epi32(32768);
+		const __m128i bias16 = _mm_set1_epi16(INT16_MIN);
+
+		uint32_t i = 0;
+		for (; i + 8 <= indexCount; i += 8)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i + 4));
+			// the pack would clamp larger indices to 0xffff, their high 16 bits must all be 0
+			assert(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(_mm_or_si128(a, b), 16), _mm_setzero_si128())) == 0xffff && "Index doesn't fit 16 bits");
+			__m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(packed, bias16));
+		}
+
+		for (; i < indexCount; ++i)
+		{
+			assert(indices[i] <= s_maxIndex16 && "Index doesn't fit 16 bits");
+			dst[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+
+	void ConvertIndices(const uint16_t* indices, uint32_t indexCount, uint32_t* destination)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		uint32_t i = 0;
+		for (; i + 8 <= indexCount; i += 8)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi16(v, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 4), _mm_unpackhi_epi16(v, zero));
+		}
+
+		for (; i < indexCount; ++i)
+			destination[i] = indices[i];
+	}
+
+	void SplitMesh(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t maxVertices, std::vector<MeshPart>& parts, std::vector<uint32_t>& vertexRemap, std::vector<uint16_t>& partIndices)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+		assert(maxVertices >= 3 && maxVertices <= s_maxIndex16 + 1 && "Part vertex count must be in [3, 65536]");
+
+		parts.clear();
+		vertexRemap.clear();
+		partIndices.resize(indexCount);
+
+		if (indexCount == 0)
+			return;
+
+		// vertex of the current part, reset through vertexRemap when the part is closed
+		std::vector<uint32_t> local(vertexCount, s_invalid);
+		MeshPart part;
+
+		for (uint32_t t = 0; t < indexCount; t += 3)
+		{
+			const uint32_t* triangle = indices + t;
+			assert(triangle[0] < vertexCount && triangle[1] < vertexCount && triangle[2] < vertexCount && "Index out of range");
+
+			uint32_t newVertices = (local[triangle[0]] == s_invalid) +
+				(local[triangle[1]] == s_invalid && triangle[1] != triangle[0]) +
+				(local[triangle[2]] == s_invalid && triangle[2] != triangle[0] && triangle[2] != triangle[1]);
+
+			if (part.vertexCount + newVertices > maxVertices)
+			{
+				for (uint32_t i = part.firstVertex; i < part.firstVertex + part.vertexCount; ++i)
+					local[vertexRemap[i]] = s_invalid;
+
+				parts.push_back(part);
+				part.firstIndex = t;
+				part.indexCount = 0;
+				part.firstVertex += part.vertexCount;
+				part.vertexCount = 0;
+			}
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				uint32_t& l = local[triangle[corner]];
+				if (l == s_invalid)
+				{
+					l = part.vertexCount++;
+					vertexRemap.push_back(triangle[corner]);
+				}
+
+				partIndices[t + corner] = static_cast<uint16_t>(l);
+			}
+
+			part.indexCount += 3;
+		}
+
+		parts.push_back(part);
+	}
+
+	void GatherVertices(const void* vertices, uint32_t stride, const uint32_t* vertexRemap, uint32_t count, void* destination)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(vertices);
+		uint8_t* dst = static_cast<uint8_t*>(destination);
+
+		for (uint32_t i = 0; i < count; ++i, dst += stride)
+			memcpy(dst, src + static_cast<size_t>(vertexRemap[i]) * stride, stride);
+	}
+}
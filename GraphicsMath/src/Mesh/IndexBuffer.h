@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	enum class IndexFormat : uint8_t
+	{
+		UInt16,
+		UInt32
+	};
+
+	// in bytes
+	uint32_t GetIndexSize(IndexFormat format);
+
+	// 16 bit indices when every vertex fits, 0xffff included: lists don't use the strip cut value
+	IndexFormat SelectIndexFormat(uint32_t vertexCount);
+
+	// destination holds indexCount indices of format and can be indices. To 16 bits every index must be at
+	// most 0xffff (asserted), they are packed 8 at a time with SSE2
+	void ConvertIndices(const uint32_t* indices, uint32_t indexCount, IndexFormat format, void* destination);
+	// widening, destination can't overlap indices
+	void ConvertIndices(const uint16_t* indices, uint32_t indexCount, uint32_t* destination);
+
+	// a range of the split index buffer, drawn with DrawIndexed(indexCount, firstIndex, firstVertex)
+	struct MeshPart
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		uint32_t firstVertex = 0; // in the gathered vertices
+		uint32_t vertexCount = 0;
+	};
+
+	/// <summary>
+	/// Splits a triangle list whose vertices don't fit 16 bit indices into consecutive runs of triangles that
+	/// each reference at most maxVertices vertices. Every part gets its own copy of the vertices it references,
+	/// the ones on the cuts are duplicated: vertexRemap receives the source vertex of every gathered vertex, parts
+	/// one after the other, and partIndices the indices relative to the part's firstVertex. Runs of triangles
+	/// stay in order, so a cache optimized index buffer splits into parts that are cache optimized too.
+	/// </summary>
+	void SplitMesh(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t maxVertices, std::vector<MeshPart>& parts, std::vector<uint32_t>& vertexRemap, std::vector<uint16_t>& partIndices);
+
+	// destination[i] = vertices[vertexRemap[i]], stride in bytes. destination can't overlap vertices
+	void GatherVertices(const void* vertices, uint32_t stride, const uint32_t* vertexRemap, uint32_t count, void* destination);
+}
@@ -0,0 +1,281 @@
+#include "IndexCodec.h"
+
+#include <assert.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint8_t s_header = 0xe0; // high nibble: magic, low nibble: version
+		constexpr uint8_t s_version = 0;
+
+		constexpr uint32_t s_fifoSize = 16;
+		constexpr uint32_t s_edgeSlots = 15;   // code high nibble 15 is a triangle without a cached edge
+		constexpr uint32_t s_vertexSlots = 14; // vertex codes: 0 next, [1, 14] FIFO slot + 1, 15 explicit
+
+		constexpr uint32_t s_codeNext = 0;
+		constexpr uint32_t s_codeExplicit = 15;
+		constexpr uint32_t s_codeNoEdge = 0xf0;
+
+		// 5 bytes of varint at most
+		constexpr size_t s_maxTriangleData = 1 + 3 * 5;
+
+		// ring buffers, slot 0 is the last pushed
+		struct CodecState
+		{
+			uint32_t edges[s_fifoSize][2];
+			uint32_t vertices[s_fifoSize];
+			uint32_t edgeHead = 0;
+			uint32_t vertexHead = 0;
+			uint32_t next = 0; // vertices first used in increasing order cost nothing
+			uint32_t last = 0; // explicit vertices are deltas to the previous one
+
+			CodecState()
+			{
+				for (uint32_t i = 0; i < s_fifoSize; ++i)
+				{
+					edges[i][0] = edges[i][1] = ~0u;
+					vertices[i] = ~0u;
+				}
+			}
+
+			const uint32_t* GetEdge(uint32_t slot) const { return edges[(edgeHead - 1 - slot) & (s_fifoSize - 1)]; }
+			uint32_t GetVertex(uint32_t slot) const { return vertices[(vertexHead - 1 - slot) & (s_fifoSize - 1)]; }
+
+			void PushEdge(uint32_t a, uint32_t b)
+			{
+				edges[edgeHead][0] = a;
+				edges[edgeHead][1] = b;
+				edgeHead = (edgeHead + 1) & (s_fifoSize - 1);
+			}
+
+			void PushVertex(uint32_t v)
+			{
+				vertices[vertexHead] = v;
+				vertexHead = (vertexHead + 1) & (s_fifoSize - 1);
+			}
+		};
+
+		uint8_t* WriteVarint(uint8_t* data, uint32_t v)
+		{
+			while (v >= 0x80)
+			{
+				*data++ = static_cast<uint8_t>(v | 0x80);
+				v >>= 7;
+			}
+
+			*data++ = static_cast<uint8_t>(v);
+			return data;
+		}
+
+		// nullptr when the varint runs past end or is longer than 5 bytes
+		const uint8_t* ReadVarint(const uint8_t* data, const uint8_t* end, uint32_t& v)
+		{
+			v = 0;
+			for (uint32_t shift = 0; shift < 35; shift += 7)
+			{
+				if (data == end)
+					return nullptr;
+
+				uint8_t byte = *data++;
+				v |= static_cast<uint32_t>(byte & 0x7f) << shift;
+				if (byte < 0x80)
+					return data;
+			}
+
+			return nullptr;
+		}
+
+		uint32_t ZigZag(int32_t v)
+		{
+			return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+		}
+
+		int32_t UnZigZag(uint32_t v)
+		{
+			return static_cast<int32_t>((v >> 1) ^ (0u - (v & 1)));
+		}
+
+		// vertex code of v, the explicit delta is appended to data. New vertices go into the FIFO
+		uint32_t EncodeVertex(CodecState& state, uint32_t v, uint8_t*& data)
+		{
+			if (v == state.next)
+			{
+				state.next++;
+				state.PushVertex(v);
+				return s_codeNext;
+			}
+
+			for (uint32_t slot = 0; slot < s_vertexSlots; ++slot)
+			{
+				if (state.GetVertex(slot) == v)
+					return slot + 1;
+			}
+
+			data = WriteVarint(data, ZigZag(static_cast<int32_t>(v - state.last)));
+			state.last = v;
+			state.PushVertex(v);
+			return s_codeExplicit;
+		}
+
+		// false on truncated data
+		bool DecodeVertex(CodecState& state, uint32_t code, const uint8_t*& data, const uint8_t* end, uint32_t& v)
+		{
+			if (code == s_codeNext)
+			{
+				v = state.next++;
+				state.PushVertex(v);
+				return true;
+			}
+
+			if (code != s_codeExplicit)
+			{
+				v = state.GetVertex(code - 1);
+				return true;
+			}
+
+			uint32_t delta;
+			data = ReadVarint(data, end, delta);
+			if (!data)
+				return false;
+
+			v = state.last + static_cast<uint32_t>(UnZigZag(delta));
+			state.last = v;
+			state.PushVertex(v);
+			return true;
+		}
+
+		template<typename Index>
+		bool Decode(const uint8_t* buffer, size_t bufferSize, uint32_t indexCount, Index* destination)
+		{
+			uint32_t triangleCount = indexCount / 3;
+			if (bufferSize < 1 + static_cast<size_t>(triangleCount) || buffer[0] != (s_header | s_version))
+				return false;
+
+			const uint8_t* codes = buffer + 1;
+			const uint8_t* data = codes + triangleCount;
+			const uint8_t* end = buffer + bufferSize;
+
+			CodecState state;
+			for (uint32_t t = 0; t < triangleCount; ++t)
+			{
+				uint32_t code = codes[t];
+				uint32_t a, b, c;
+
+				if (code < s_codeNoEdge)
+				{
+					const uint32_t* edge = state.GetEdge(code >> 4);
+					a = edge[0];
+					b = edge[1];
+					if (!DecodeVertex(state, code & 15, data, end, c))
+						return false;
+
+					state.PushEdge(c, b);
+					state.PushEdge(a, c);
+				}
+				else
+				{
+					if (data == end)
+						return false;
+
+					uint32_t bc = *data++;
+					if (!DecodeVertex(state, code & 15, data, end, a) ||
+						!DecodeVertex(state, bc >> 4, data, end, b) ||
+						!DecodeVertex(state, bc & 15, data, end, c))
+						return false;
+
+					state.PushEdge(b, a);
+					state.PushEdge(c, b);
+					state.PushEdge(a, c);
+				}
+
+				// an edge slot never filled or a vertex code pointing at garbage yields ~0u
+				if (a == ~0u || b == ~0u || c == ~0u)
+					return false;
+
+				destination[t * 3 + 0] = static_cast<Index>(a);
+				destination[t * 3 + 1] = static_cast<Index>(b);
+				destination[t * 3 + 2] = static_cast<Index>(c);
+			}
+
+			return data == end;
+		}
+	}
+
+	size_t EncodeIndices(const uint32_t* indices, uint32_t indexCount, uint8_t* buffer, size_t bufferSize)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+		assert(bufferSize >= GetIndexEncodeBound(indexCount) && "Index encode buffer too small");
+
+		uint32_t triangleCount = indexCount / 3;
+		buffer[0] = s_header | s_version;
+		uint8_t* codes = buffer + 1;
+		uint8_t* data = codes + triangleCount;
+
+		CodecState state;
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const uint32_t* triangle = indices + t * 3;
+			assert(triangle[0] != ~0u && triangle[1] != ~0u && triangle[2] != ~0u && "Index out of range");
+
+			// the triangle rotated so the cached edge comes first
+			uint32_t edgeSlot = s_edgeSlots;
+			uint32_t rotation = 0;
+			for (uint32_t slot = 0; slot < s_edgeSlots && edgeSlot == s_edgeSlots; ++slot)
+			{
+				const uint32_t* edge = state.GetEdge(slot);
+				for (uint32_t r = 0; r < 3; ++r)
+				{
+					if (edge[0] == triangle[r] && edge[1] == triangle[(r + 1) % 3])
+					{
+						edgeSlot = slot;
+						rotation = r;
+						break;
+					}
+				}
+			}
+
+			if (edgeSlot != s_edgeSlots)
+			{
+				uint32_t a = triangle[rotation];
+				uint32_t b = triangle[(rotation + 1) % 3];
+				uint32_t c = triangle[(rotation + 2) % 3];
+
+				codes[t] = static_cast<uint8_t>((edgeSlot << 4) | EncodeVertex(state, c, data));
+				state.PushEdge(c, b);
+				state.PushEdge(a, c);
+			}
+			else
+			{
+				// the b and c codes go first in the data, before the explicit deltas
+				uint8_t* bcCode = data++;
+				uint32_t codeA = EncodeVertex(state, triangle[0], data);
+				uint32_t codeB = EncodeVertex(state, triangle[1], data);
+				uint32_t codeC = EncodeVertex(state, triangle[2], data);
+
+				codes[t] = static_cast<uint8_t>(s_codeNoEdge | codeA);
+				*bcCode = static_cast<uint8_t>((codeB << 4) | codeC);
+				state.PushEdge(triangle[1], triangle[0]);
+				state.PushEdge(triangle[2], triangle[1]);
+				state.PushEdge(triangle[0], triangle[2]);
+			}
+		}
+
+		return data - buffer;
+	}
+
+	size_t GetIndexEncodeBound(uint32_t indexCount)
+	{
+		return 1 + static_cast<size_t>(indexCount / 3) * (1 + s_maxTriangleData);
+	}
+
+	bool DecodeIndices(const uint8_t* buffer, size_t bufferSize, uint32_t indexCount, IndexFormat format, void* destination)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+
+		if (format == IndexFormat::UInt16)
+			return Decode(buffer, bufferSize, indexCount, static_cast<uint16_t*>(destination));
+
+		return Decode(buffer, bufferSize, indexCount, static_cast<uint32_t*>(destination));
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "IndexBuffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace GM
+{
+	/// <summary>
+	/// Lossless triangle list compression for storage and streaming, typically 1 to 2 bytes per triangle on
+	/// meshes that went through MeshOptimizer::OptimizeVertexCache and OptimizeVertexFetch.
+	///
+	/// Every triangle is one code byte. Encoder and decoder keep the same FIFOs of the last 16 edges and the last
+	/// 16 vertices: a triangle sharing a recent edge codes the edge slot and its third vertex as the next new
+	/// vertex, a FIFO slot or an explicit delta. Other triangles code their 3 vertices that way. The code bytes are
+	/// stored together and followed by the explicit data (varint deltas), so the decoder walks both with no
+	/// lookahead. Triangles come back in the same order and winding but may be rotated.
+	/// Returns the encoded size, buffer needs GetIndexEncodeBound(indexCount) bytes.
+	/// </summary>
+	size_t EncodeIndices(const uint32_t* indices, uint32_t indexCount, uint8_t* buffer, size_t bufferSize);
+
+	// worst case size of the encoded indices
+	size_t GetIndexEncodeBound(uint32_t indexCount);
+
+	// destination holds indexCount indices of format. False when buffer is malformed, truncated or has an unknown version
+	bool DecodeIndices(const uint8_t* buffer, size_t bufferSize, uint32_t indexCount, IndexFormat format, void* destination);
+}
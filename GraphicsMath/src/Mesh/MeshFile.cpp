@@ -0,0 +1,418 @@
+#include "MeshFile.h"
+#include "VertexConversion.h"
+#include "Geometry/BoundsFitting.h"
+
+#include <assert.h>
+#include <fstream>
+#include <string.h>
+#include <vector>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_fileMagic = 0x48534d47; // "GMSH"
+		constexpr uint32_t s_fileVersion = 1;
+
+		constexpr uint64_t s_sectionAlignment = 64;
+
+		enum class SectionType : uint32_t
+		{
+			Vertices,
+			Indices,
+			Bounds,
+			Parts
+		};
+
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint64_t fileSize;
+			uint64_t checksum; // of the bytes after the header
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t partCount;
+			uint8_t indexFormat;
+			uint8_t reserved;
+			uint16_t sectionCount;
+		};
+
+		struct FileAttribute
+		{
+			uint8_t semantic;
+			uint8_t format;
+			uint16_t reserved;
+			uint32_t offset;
+		};
+
+		struct FileLayout
+		{
+			uint32_t attributeCount;
+			uint32_t stride;
+			FileAttribute attributes[VertexLayout::MaxAttributes];
+		};
+
+		struct FileSection
+		{
+			uint32_t type;
+			uint32_t reserved;
+			uint64_t offset; // from the start of the file
+			uint64_t size;
+		};
+
+		struct FileBounds
+		{
+			float min[3];
+			float max[3];
+			float center[3];
+			float radius;
+		};
+
+		constexpr uint32_t s_maxSections = 4;
+
+		uint64_t AlignUp(uint64_t v, uint64_t alignment)
+		{
+			return (v + alignment - 1) & ~(alignment - 1);
+		}
+
+		bool IsEmpty(const AABB& bounds)
+		{
+			return bounds.min.x > bounds.max.x;
+		}
+
+		// bounds of the decoded positions, left empty without positions
+		void ComputeBounds(const MeshData& mesh, AABB& bounds, Sphere& sphere)
+		{
+			if (!mesh.layout.Has(VertexSemantic::Position) || mesh.vertexCount == 0)
+				return;
+
+			VertexLayout positionLayout;
+			positionLayout.Add(VertexSemantic::Position, VertexFormat::Float3);
+
+			std::vector<float> positions(static_cast<size_t>(mesh.vertexCount) * 3);
+			ConvertVertices(mesh.layout, mesh.vertices, positionLayout, positions.data(), mesh.vertexCount);
+
+			bounds = AABBFromPoints(positions.data(), mesh.vertexCount, 3);
+			sphere = SphereFromPointsRitter(positions.data(), mesh.vertexCount, 3);
+		}
+
+		constexpr uint64_t s_prime1 = 0x9e3779b185ebca87ull;
+		constexpr uint64_t s_prime2 = 0xc2b2ae3d27d4eb4full;
+		constexpr uint64_t s_prime3 = 0x165667b19e3779f9ull;
+		constexpr uint64_t s_prime4 = 0x85ebca77c2b2ae63ull;
+		constexpr uint64_t s_prime5 = 0x27d4eb2f165667c5ull;
+
+		uint64_t RotateLeft(uint64_t v, uint32_t bits)
+		{
+			return (v << bits) | (v >> (64 - bits));
+		}
+
+		uint64_t Read64(const uint8_t* p)
+		{
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		uint32_t Read32(const uint8_t* p)
+		{
+			uint32_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		uint64_t Round(uint64_t acc, uint64_t input)
+		{
+			acc += input * s_prime2;
+			acc = RotateLeft(acc, 31);
+			return acc * s_prime1;
+		}
+
+		uint64_t MergeRound(uint64_t acc, uint64_t v)
+		{
+			acc ^= Round(0, v);
+			return acc * s_prime1 + s_prime4;
+		}
+	}
+
+	bool MeshFile::Save(const std::string& filename, const MeshData& mesh)
+	{
+		assert((mesh.vertices || mesh.vertexCount == 0) && "Mesh has no vertices");
+		assert((mesh.indices || mesh.indexCount == 0) && "Mesh has no indices");
+		assert((mesh.parts || mesh.partCount == 0) && "Mesh has no parts");
+		assert(mesh.indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+
+		FileLayout layout = {};
+		layout.attributeCount = mesh.layout.GetAttributeCount();
+		layout.stride = mesh.layout.GetStride();
+		for (uint32_t i = 0; i < layout.attributeCount; ++i)
+		{
+			const VertexAttribute& attribute = mesh.layout.GetAttribute(i);
+			layout.attributes[i].semantic = static_cast<uint8_t>(attribute.semantic);
+			layout.attributes[i].format = static_cast<uint8_t>(attribute.format);
+			layout.attributes[i].offset = attribute.offset;
+		}
+
+		FileBounds fileBounds;
+		AABB bounds = mesh.bounds;
+		Sphere sphere = mesh.sphere;
+		if (IsEmpty(bounds))
+			ComputeBounds(mesh, bounds, sphere);
+
+		for (int a = 0; a < 3; a++)
+		{
+			fileBounds.min[a] = bounds.min.f[a];
+			fileBounds.max[a] = bounds.max.f[a];
+			fileBounds.center[a] = sphere.center.f[a];
+		}
+		fileBounds.radius = sphere.radius;
+
+		struct SectionSource
+		{
+			SectionType type;
+			const void* data;
+			uint64_t size;
+		};
+
+		SectionSource sources[s_maxSections];
+		uint32_t sectionCount = 0;
+		sources[sectionCount++] = { SectionType::Vertices, mesh.vertices, static_cast<uint64_t>(mesh.vertexCount) * layout.stride };
+		if (mesh.indexCount > 0)
+			sources[sectionCount++] = { SectionType::Indices, mesh.indices, static_cast<uint64_t>(mesh.indexCount) * GetIndexSize(mesh.indexFormat) };
+		sources[sectionCount++] = { SectionType::Bounds, &fileBounds, sizeof(FileBounds) };
+		if (mesh.partCount > 0)
+			sources[sectionCount++] = { SectionType::Parts, mesh.parts, static_cast<uint64_t>(mesh.partCount) * sizeof(MeshPart) };
+
+		// everything after the header is built in memory to be checksummed
+		uint64_t offset = sizeof(FileHeader) + sizeof(FileLayout) + sectionCount * sizeof(FileSection);
+		FileSection sections[s_maxSections] = {};
+		for (uint32_t i = 0; i < sectionCount; ++i)
+		{
+			offset = AlignUp(offset, s_sectionAlignment);
+			sections[i].type = static_cast<uint32_t>(sources[i].type);
+			sections[i].offset = offset;
+			sections[i].size = sources[i].size;
+			offset += sources[i].size;
+		}
+
+		std::vector<uint8_t> body(static_cast<size_t>(offset - sizeof(FileHeader)), 0);
+		memcpy(body.data(), &layout, sizeof(FileLayout));
+		memcpy(body.data() + sizeof(FileLayout), sections, sectionCount * sizeof(FileSection));
+		for (uint32_t i = 0; i < sectionCount; ++i)
+		{
+			if (sources[i].size > 0)
+				memcpy(body.data() + (sections[i].offset - sizeof(FileHeader)), sources[i].data, static_cast<size_t>(sources[i].size));
+		}
+
+		FileHeader header = {};
+		header.magic = s_fileMagic;
+		header.version = s_fileVersion;
+		header.fileSize = offset;
+		header.checksum = Checksum(body.data(), body.size());
+		header.vertexCount = mesh.vertexCount;
+		header.indexCount = mesh.indexCount;
+		header.partCount = mesh.partCount;
+		header.indexFormat = static_cast<uint8_t>(mesh.indexFormat);
+		header.sectionCount = static_cast<uint16_t>(sectionCount);
+
+		std::ofstream out(filename, std::ios::out | std::ios::binary);
+		if (!out)
+			return false;
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(body.data()), body.size());
+
+		return static_cast<bool>(out);
+	}
+
+	bool MeshFile::Load(const std::string& filename, bool verifyChecksum)
+	{
+		Close();
+
+		if (!m_file.Open(filename))
+			return false;
+
+		const uint8_t* data = m_file.GetData();
+		size_t size = m_file.GetSize();
+
+		FileHeader header;
+		if (size < sizeof(FileHeader) + sizeof(FileLayout))
+		{
+			Close();
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+
+		uint64_t tableEnd = sizeof(FileHeader) + sizeof(FileLayout) + static_cast<uint64_t>(header.sectionCount) * sizeof(FileSection);
+		if (header.magic != s_fileMagic || header.version != s_fileVersion || header.fileSize != size || tableEnd > size ||
+			header.indexFormat > static_cast<uint8_t>(IndexFormat::UInt32) || header.indexCount % 3 != 0)
+		{
+			Close();
+			return false;
+		}
+
+		if (verifyChecksum && Checksum(data + sizeof(FileHeader), size - sizeof(FileHeader)) != header.checksum)
+		{
+			Close();
+			return false;
+		}
+
+		FileLayout layout;
+		memcpy(&layout, data + sizeof(FileHeader), sizeof(layout));
+		if (layout.attributeCount > VertexLayout::MaxAttributes)
+		{
+			Close();
+			return false;
+		}
+
+		MeshData mesh;
+		for (uint32_t i = 0; i < layout.attributeCount; ++i)
+		{
+			const FileAttribute& attribute = layout.attributes[i];
+			VertexSemantic semantic = static_cast<VertexSemantic>(attribute.semantic);
+			VertexFormat format = static_cast<VertexFormat>(attribute.format);
+			if (semantic >= VertexSemantic::Count || format >= VertexFormat::Count || mesh.layout.Has(semantic) ||
+				static_cast<uint64_t>(attribute.offset) + GetFormatSize(format) > layout.stride)
+			{
+				Close();
+				return false;
+			}
+
+			mesh.layout.Add(semantic, format, attribute.offset);
+		}
+		mesh.layout.SetStride(layout.stride);
+
+		mesh.vertexCount = header.vertexCount;
+		mesh.indexCount = header.indexCount;
+		mesh.indexFormat = static_cast<IndexFormat>(header.indexFormat);
+		mesh.partCount = header.partCount;
+
+		// the pointer fix-up: every section is checked against the counts of the header and pointed to in place
+		uint64_t expectedSizes[s_maxSections] =
+		{
+			static_cast<uint64_t>(mesh.vertexCount) * layout.stride,
+			static_cast<uint64_t>(mesh.indexCount) * GetIndexSize(mesh.indexFormat),
+			sizeof(FileBounds),
+			static_cast<uint64_t>(mesh.partCount) * sizeof(MeshPart)
+		};
+
+		const uint8_t* sectionData[s_maxSections] = {};
+		const uint8_t* table = data + sizeof(FileHeader) + sizeof(FileLayout);
+		for (uint32_t i = 0; i < header.sectionCount; ++i)
+		{
+			FileSection section;
+			memcpy(&section, table + i * sizeof(FileSection), sizeof(section));
+
+			// sections of later minor revisions are skipped
+			if (section.type >= s_maxSections)
+				continue;
+
+			if (section.offset % s_sectionAlignment != 0 || section.offset < tableEnd || section.offset > size ||
+				section.size > size - section.offset || section.size != expectedSizes[section.type] || sectionData[section.type])
+			{
+				Close();
+				return false;
+			}
+
+			sectionData[section.type] = data + section.offset;
+		}
+
+		bool hasVertices = sectionData[static_cast<uint32_t>(SectionType::Vertices)] != nullptr;
+		bool hasIndices = sectionData[static_cast<uint32_t>(SectionType::Indices)] != nullptr;
+		bool hasParts = sectionData[static_cast<uint32_t>(SectionType::Parts)] != nullptr;
+		if (!hasVertices || hasIndices != (mesh.indexCount > 0) || hasParts != (mesh.partCount > 0))
+		{
+			Close();
+			return false;
+		}
+
+		mesh.vertices = sectionData[static_cast<uint32_t>(SectionType::Vertices)];
+		mesh.indices = sectionData[static_cast<uint32_t>(SectionType::Indices)];
+		mesh.parts = reinterpret_cast<const MeshPart*>(sectionData[static_cast<uint32_t>(SectionType::Parts)]);
+
+		if (const uint8_t* boundsData = sectionData[static_cast<uint32_t>(SectionType::Bounds)])
+		{
+			FileBounds bounds;
+			memcpy(&bounds, boundsData, sizeof(bounds));
+			mesh.bounds = AABB(Vector(bounds.min[0], bounds.min[1], bounds.min[2], 0.0f), Vector(bounds.max[0], bounds.max[1], bounds.max[2], 0.0f));
+			mesh.sphere = Sphere(Vector(bounds.center[0], bounds.center[1], bounds.center[2], 1.0f), bounds.radius);
+		}
+
+		m_mesh = mesh;
+		return true;
+	}
+
+	void MeshFile::Close()
+	{
+		m_file.Close();
+		m_mesh = MeshData();
+	}
+
+	bool MeshFile::IsLoaded() const
+	{
+		return m_file.IsOpen();
+	}
+
+	const MeshData& MeshFile::GetMesh() const
+	{
+		return m_mesh;
+	}
+
+	uint64_t MeshFile::Checksum(const void* data, size_t size)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		const uint8_t* end = p + size;
+		uint64_t hash;
+
+		if (size >= 32)
+		{
+			// 4 independent lanes keep the multiplies in flight
+			uint64_t v1 = s_prime1 + s_prime2;
+			uint64_t v2 = s_prime2;
+			uint64_t v3 = 0;
+			uint64_t v4 = 0 - s_prime1;
+
+			const uint8_t* limit = end - 32;
+			do
+			{
+				v1 = Round(v1, Read64(p));
+				v2 = Round(v2, Read64(p + 8));
+				v3 = Round(v3, Read64(p + 16));
+				v4 = Round(v4, Read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+
+			hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+			hash = MergeRound(hash, v1);
+			hash = MergeRound(hash, v2);
+			hash = MergeRound(hash, v3);
+			hash = MergeRound(hash, v4);
+		}
+		else
+		{
+			hash = s_prime5;
+		}
+
+		hash += static_cast<uint64_t>(size);
+
+		for (; p + 8 <= end; p += 8)
+			hash = RotateLeft(hash ^ Round(0, Read64(p)), 27) * s_prime1 + s_prime4;
+
+		if (p + 4 <= end)
+		{
+			hash = RotateLeft(hash ^ (Read32(p) * s_prime1), 23) * s_prime2 + s_prime3;
+			p += 4;
+		}
+
+		for (; p < end; ++p)
+			hash = RotateLeft(hash ^ (*p * s_prime5), 11) * s_prime1;
+
+		hash ^= hash >> 33;
+		hash *= s_prime2;
+		hash ^= hash >> 29;
+		hash *= s_prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+}
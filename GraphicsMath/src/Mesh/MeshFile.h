@@ -0,0 +1,63 @@
+#pragma once
+
+#include "VertexLayout.h"
+#include "IndexBuffer.h"
+#include "Core/MappedFile.h"
+#include "Geometry/BoundingVolumes.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace GM
+{
+	// a mesh as stored in a .gmesh file. The pointers are only read by Save, after Load they point into the mapped file
+	struct MeshData
+	{
+		VertexLayout layout;
+		const void* vertices = nullptr;
+		uint32_t vertexCount = 0;
+
+		const void* indices = nullptr; // optional
+		uint32_t indexCount = 0;
+		IndexFormat indexFormat = IndexFormat::UInt32;
+
+		AABB bounds;   // computed from the positions by Save when empty
+		Sphere sphere; // Ritter sphere of the positions when Save computes the bounds
+
+		const MeshPart* parts = nullptr; // optional, e.g. from SplitMesh
+		uint32_t partCount = 0;
+	};
+
+	/// <summary>
+	/// Versioned binary mesh container. The file is a header, the serialized vertex layout and a table of
+	/// sections (vertices, indices, bounds, parts), each section 64 byte aligned. Load maps the file and points
+	/// the MeshData into it: nothing is parsed or copied, pages are read by the OS as the data is first used, so a
+	/// mesh can be handed to the GPU upload straight from the mapping at disk bandwidth.
+	///
+	/// The header holds an XXH64 checksum of everything after it, only checked when asked for: it is a pass over
+	/// the whole file. Load validates the header, layout and section table, the index values and parts are
+	/// trusted like the rest of the data. The file is native little endian.
+	/// </summary>
+	class MeshFile
+	{
+	public:
+		MeshFile() = default;
+
+		static bool Save(const std::string& filename, const MeshData& mesh);
+
+		// false on a missing, truncated or invalid file, or a checksum mismatch when verified
+		bool Load(const std::string& filename, bool verifyChecksum = false);
+		void Close();
+
+		bool IsLoaded() const;
+		// valid until the file is closed
+		const MeshData& GetMesh() const;
+
+		// XXH64 with seed 0
+		static uint64_t Checksum(const void* data, size_t size);
+
+	private:
+		MappedFile m_file;
+		MeshData m_mesh;
+	};
+}
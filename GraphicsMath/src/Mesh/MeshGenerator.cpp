@@ -0,0 +1,735 @@
+#include "MeshGenerator.h"
+#include "VertexConversion.h"
+#include "Core/JobSystem.h"
+#include "Math/Functions.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr float s_twoPi = 2.0f * GM_PI;
+
+		// 4^8 triangles per icosahedron face, 1.3M triangles
+		constexpr uint32_t s_maxSubdivisions = 8;
+
+		// rows of a surface of revolution kept on the stack, so the sines and cosines of a column are computed once per block
+		constexpr uint32_t s_rowBlockSize = 64;
+
+		constexpr uint32_t s_batchGrainSize = 16;
+
+		// unit icosahedron: the cyclic permutations of (0, +-1, +-golden ratio), normalized
+		constexpr float s_icoA = 0.525731112f;
+		constexpr float s_icoB = 0.850650808f;
+
+		constexpr float s_icoVertices[12][3] =
+		{
+			{ -s_icoA,  s_icoB,  0.0f }, {  s_icoA,  s_icoB,  0.0f }, { -s_icoA, -s_icoB,  0.0f }, {  s_icoA, -s_icoB,  0.0f },
+			{  0.0f, -s_icoA,  s_icoB }, {  0.0f,  s_icoA,  s_icoB }, {  0.0f, -s_icoA, -s_icoB }, {  0.0f,  s_icoA, -s_icoB },
+			{  s_icoB,  0.0f, -s_icoA }, {  s_icoB,  0.0f,  s_icoA }, { -s_icoB,  0.0f, -s_icoA }, { -s_icoB,  0.0f,  s_icoA },
+		};
+
+		constexpr uint8_t s_icoFaces[20][3] =
+		{
+			{ 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+			{ 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+			{ 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+			{ 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 },
+		};
+
+		// cube faces in the order of Utils::BasicMesh: back, front, bottom, top, left, right. Corners as signs of the half extents
+		constexpr float s_cubeCorners[6][4][3] =
+		{
+			{ {  1,  1,  1 }, { -1,  1,  1 }, { -1, -1,  1 }, {  1, -1,  1 } },
+			{ { -1,  1, -1 }, {  1,  1, -1 }, {  1, -1, -1 }, { -1, -1, -1 } },
+			{ {  1, -1,  1 }, { -1, -1,  1 }, { -1, -1, -1 }, {  1, -1, -1 } },
+			{ { -1,  1,  1 }, {  1,  1,  1 }, {  1,  1, -1 }, { -1,  1, -1 } },
+			{ { -1,  1,  1 }, { -1,  1, -1 }, { -1, -1, -1 }, { -1, -1,  1 } },
+			{ {  1,  1, -1 }, {  1,  1,  1 }, {  1, -1,  1 }, {  1, -1, -1 } },
+		};
+
+		constexpr float s_cubeNormals[6][3] =
+		{
+			{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f },
+		};
+
+		constexpr float s_planeCorners[4][3] = { { -1, 0, 1 }, { 1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 } };
+		constexpr float s_planeNormal[3] = { 0.0f, 1.0f, 0.0f };
+
+		struct IcosahedronEdges
+		{
+			uint8_t vertices[30][2];  // lower index first
+			uint8_t faceEdges[20][3]; // edges AB, BC and CA of every face
+		};
+
+		IcosahedronEdges BuildIcosahedronEdges()
+		{
+			IcosahedronEdges edges = {};
+			uint32_t edgeCount = 0;
+
+			for (uint32_t f = 0; f < 20; ++f)
+			{
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					uint8_t a = std::min(s_icoFaces[f][k], s_icoFaces[f][(k + 1) % 3]);
+					uint8_t b = std::max(s_icoFaces[f][k], s_icoFaces[f][(k + 1) % 3]);
+
+					uint32_t edge = 0;
+					while (edge < edgeCount && (edges.vertices[edge][0] != a || edges.vertices[edge][1] != b))
+						++edge;
+
+					if (edge == edgeCount)
+					{
+						edges.vertices[edgeCount][0] = a;
+						edges.vertices[edgeCount][1] = b;
+						++edgeCount;
+					}
+
+					edges.faceEdges[f][k] = static_cast<uint8_t>(edge);
+				}
+			}
+
+			assert(edgeCount == 30 && "Icosahedron must have 30 edges");
+			return edges;
+		}
+
+		const IcosahedronEdges& GetIcosahedronEdges()
+		{
+			static const IcosahedronEdges edges = BuildIcosahedronEdges();
+			return edges;
+		}
+
+		// row of a surface of revolution, from the top down
+		struct ProfileRow
+		{
+			float radius;    // distance to the y axis, exactly 0 for a pole
+			float y;
+			float normal[2]; // radial and y
+			float v;
+		};
+
+		class VertexWriter
+		{
+		public:
+			VertexWriter(const PrimitiveDesc& desc, const VertexLayout& layout, void* vertices)
+				: m_vertices(static_cast<uint8_t*>(vertices)), m_stride(layout.GetStride())
+			{
+				m_center[0] = desc.center.x;
+				m_center[1] = desc.center.y;
+				m_center[2] = desc.center.z;
+				m_texCoordScale[0] = desc.texCoordScale[0];
+				m_texCoordScale[1] = desc.texCoordScale[1];
+
+				for (uint32_t s = 0; s < VertexLayout::MaxAttributes; ++s)
+					m_attributes[s] = layout.Find(static_cast<VertexSemantic>(s));
+			}
+
+			// position relative to the center, texcoords before the scale
+			void Write(uint32_t vertex, const float* position, const float* normal, const float* tangent, float u, float v) const
+			{
+				uint8_t* dst = m_vertices + static_cast<size_t>(vertex) * m_stride;
+
+				float data[4] = { position[0] + m_center[0], position[1] + m_center[1], position[2] + m_center[2], 1.0f };
+				Store(dst, VertexSemantic::Position, data);
+
+				data[0] = normal[0]; data[1] = normal[1]; data[2] = normal[2]; data[3] = 0.0f;
+				Store(dst, VertexSemantic::Normal, data);
+
+				Store(dst, VertexSemantic::Tangent, tangent);
+
+				data[0] = u * m_texCoordScale[0]; data[1] = v * m_texCoordScale[1]; data[2] = 0.0f; data[3] = 0.0f;
+				Store(dst, VertexSemantic::TexCoord, data);
+
+				constexpr float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+				Store(dst, VertexSemantic::Color, white);
+			}
+
+		private:
+			void Store(uint8_t* vertex, VertexSemantic semantic, const float* data) const
+			{
+				const VertexAttribute* attribute = m_attributes[static_cast<uint32_t>(semantic)];
+				if (attribute)
+					EncodeAttribute(*attribute, data, vertex);
+			}
+
+			uint8_t* m_vertices;
+			uint32_t m_stride;
+			float m_center[3];
+			float m_texCoordScale[2];
+			const VertexAttribute* m_attributes[VertexLayout::MaxAttributes]; // nullptr when the layout has no such attribute
+		};
+
+		// only counts when there is no index buffer
+		class IndexWriter
+		{
+		public:
+			IndexWriter(uint32_t* indices, uint32_t baseVertex)
+				: m_indices(indices), m_baseVertex(baseVertex), m_count(0)
+			{
+			}
+
+			void Triangle(uint32_t a, uint32_t b, uint32_t c)
+			{
+				if (m_indices)
+				{
+					m_indices[m_count] = m_baseVertex + a;
+					m_indices[m_count + 1] = m_baseVertex + b;
+					m_indices[m_count + 2] = m_baseVertex + c;
+				}
+
+				m_count += 3;
+			}
+
+			uint32_t GetCount() const { return m_count; }
+
+		private:
+			uint32_t* m_indices;
+			uint32_t m_baseVertex;
+			uint32_t m_count;
+		};
+
+		uint32_t GetSegments(const PrimitiveDesc& desc)
+		{
+			return std::max(desc.segments, desc.type == PrimitiveType::Grid ? 1u : 3u);
+		}
+
+		uint32_t GetRings(const PrimitiveDesc& desc)
+		{
+			switch (desc.type)
+			{
+			case PrimitiveType::Grid: return std::max(desc.rings, 1u);
+			case PrimitiveType::Torus: return std::max(desc.rings, 3u);
+			default: return std::max(desc.rings, 2u);
+			}
+		}
+
+		// rows of one capsule hemisphere, equator included
+		uint32_t GetCapsuleRows(const PrimitiveDesc& desc)
+		{
+			return GetRings(desc) / 2 + 1;
+		}
+
+		uint32_t GetIcoFrequency(const PrimitiveDesc& desc)
+		{
+			return 1u << std::min(desc.subdivisions, s_maxSubdivisions);
+		}
+
+		ProfileRow SphereRow(const PrimitiveDesc& desc, uint32_t row, uint32_t rings)
+		{
+			float theta = GM_PI * row / rings;
+			float s = sinf(theta);
+			float c = cosf(theta);
+
+			if (row == 0 || row == rings)
+			{
+				s = 0.0f;
+				c = row == 0 ? 1.0f : -1.0f;
+			}
+
+			return { desc.radius * s, desc.radius * c, { s, c }, static_cast<float>(row) / rings };
+		}
+
+		ProfileRow CapsuleRow(const PrimitiveDesc& desc, uint32_t row, uint32_t hemisphereRows)
+		{
+			// upper hemisphere, then lower hemisphere with the equator repeated: the band between them is the cylinder
+			uint32_t steps = hemisphereRows - 1;
+			bool lower = row >= hemisphereRows;
+			uint32_t step = lower ? row - hemisphereRows : row;
+
+			float theta = 0.5f * GM_PI * (static_cast<float>(step) / steps + (lower ? 1.0f : 0.0f));
+			float s = sinf(theta);
+			float c = cosf(theta);
+
+			if (!lower && step == 0)
+			{
+				s = 0.0f;
+				c = 1.0f;
+			}
+			else if (lower && step == steps)
+			{
+				s = 0.0f;
+				c = -1.0f;
+			}
+			else if (step == (lower ? 0u : steps))
+			{
+				s = 1.0f;
+				c = 0.0f;
+			}
+
+			float halfHeight = 0.5f * desc.height;
+			float length = GM_PI * desc.radius + desc.height;
+			float arc = desc.radius * theta + (lower ? desc.height : 0.0f);
+
+			return { desc.radius * s, desc.radius * c + (lower ? -halfHeight : halfHeight), { s, c }, length > 0.0f ? arc / length : 0.0f };
+		}
+
+		ProfileRow TorusRow(const PrimitiveDesc& desc, uint32_t row, uint32_t rings)
+		{
+			// from the top of the tube outwards and down, the last row repeats the first one
+			float theta = 0.5f * GM_PI - s_twoPi * (row % rings) / rings;
+			float s = sinf(theta);
+			float c = cosf(theta);
+
+			return { desc.radius + desc.tubeRadius * c, desc.tubeRadius * s, { c, s }, static_cast<float>(row) / rings };
+		}
+
+		template<typename RowFn>
+		void Revolve(const VertexWriter& writer, IndexWriter& indices, uint32_t firstVertex, uint32_t rowCount, uint32_t segments, const RowFn& getRow)
+		{
+			uint32_t columns = segments + 1;
+
+			ProfileRow rows[s_rowBlockSize];
+			for (uint32_t firstRow = 0; firstRow < rowCount; firstRow += s_rowBlockSize)
+			{
+				uint32_t blockSize = std::min(s_rowBlockSize, rowCount - firstRow);
+				for (uint32_t r = 0; r < blockSize; ++r)
+					rows[r] = getRow(firstRow + r);
+
+				for (uint32_t i = 0; i < columns; ++i)
+				{
+					// the last column repeats the first one. Pole vertices sit in the middle of their segment, the
+					// direction their triangle faces
+					float u = static_cast<float>(i) / segments;
+					float phi = s_twoPi * (i % segments) / segments;
+					float c = cosf(phi);
+					float s = sinf(phi);
+
+					float poleU = (i + 0.5f) / segments;
+					float polePhi = s_twoPi * poleU;
+					float poleC = cosf(polePhi);
+					float poleS = sinf(polePhi);
+
+					for (uint32_t r = 0; r < blockSize; ++r)
+					{
+						const ProfileRow& row = rows[r];
+						bool pole = row.radius == 0.0f;
+						float rc = pole ? poleC : c;
+						float rs = pole ? poleS : s;
+
+						float position[3] = { row.radius * rc, row.y, row.radius * rs };
+						float normal[3] = { row.normal[0] * rc, row.normal[1], row.normal[0] * rs };
+						float tangent[4] = { -rs, 0.0f, rc, 1.0f };
+						writer.Write(firstVertex + (firstRow + r) * columns + i, position, normal, tangent, pole ? poleU : u, row.v);
+					}
+				}
+			}
+
+			bool previousPole = getRow(0).radius == 0.0f;
+			for (uint32_t r = 1; r < rowCount; ++r)
+			{
+				bool pole = getRow(r).radius == 0.0f;
+				uint32_t top = firstVertex + (r - 1) * columns;
+				uint32_t bottom = firstVertex + r * columns;
+
+				for (uint32_t i = 0; i < segments; ++i)
+				{
+					uint32_t a = top + i;
+					uint32_t b = a + 1;
+					uint32_t d = bottom + i;
+					uint32_t c = d + 1;
+
+					if (previousPole)
+						indices.Triangle(c, d, a);
+					else if (pole)
+						indices.Triangle(a, b, d);
+					else
+					{
+						indices.Triangle(a, b, c);
+						indices.Triangle(c, d, a);
+					}
+				}
+
+				previousPole = pole;
+			}
+		}
+
+		void Disc(const VertexWriter& writer, IndexWriter& indices, uint32_t firstVertex, uint32_t segments, float radius, float y, bool top)
+		{
+			float normal[3] = { 0.0f, top ? 1.0f : -1.0f, 0.0f };
+			float tangent[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+			float center[3] = { 0.0f, y, 0.0f };
+			writer.Write(firstVertex, center, normal, tangent, 0.5f, 0.5f);
+
+			for (uint32_t i = 0; i < segments; ++i)
+			{
+				float phi = s_twoPi * i / segments;
+				float c = cosf(phi);
+				float s = sinf(phi);
+
+				// seen from outside, u along x and v down the screen like the plane
+				float position[3] = { radius * c, y, radius * s };
+				writer.Write(firstVertex + 1 + i, position, normal, tangent, 0.5f + 0.5f * c, top ? 0.5f - 0.5f * s : 0.5f + 0.5f * s);
+
+				uint32_t current = firstVertex + 1 + i;
+				uint32_t next = firstVertex + 1 + (i + 1) % segments;
+				if (top)
+					indices.Triangle(firstVertex, next, current);
+				else
+					indices.Triangle(firstVertex, current, next);
+			}
+		}
+
+		// corners 0, 1, 2, 3 get the texcoords (0, 0), (1, 0), (1, 1), (0, 1)
+		void Quad(const VertexWriter& writer, IndexWriter& indices, uint32_t firstVertex, const float (&corners)[4][3], const float* normal)
+		{
+			float tangent[4] = { corners[1][0] - corners[0][0], corners[1][1] - corners[0][1], corners[1][2] - corners[0][2], 1.0f };
+			float length = sqrtf(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+			float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+			tangent[0] *= invLength;
+			tangent[1] *= invLength;
+			tangent[2] *= invLength;
+
+			// the bitangent follows v, down from corner 0 to corner 3
+			float bitangent[3] = { corners[3][0] - corners[0][0], corners[3][1] - corners[0][1], corners[3][2] - corners[0][2] };
+			float cross[3] =
+			{
+				normal[1] * tangent[2] - normal[2] * tangent[1],
+				normal[2] * tangent[0] - normal[0] * tangent[2],
+				normal[0] * tangent[1] - normal[1] * tangent[0]
+			};
+			tangent[3] = cross[0] * bitangent[0] + cross[1] * bitangent[1] + cross[2] * bitangent[2] < 0.0f ? -1.0f : 1.0f;
+
+			constexpr float texCoords[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+			for (uint32_t i = 0; i < 4; ++i)
+				writer.Write(firstVertex + i, corners[i], normal, tangent, texCoords[i][0], texCoords[i][1]);
+
+			indices.Triangle(firstVertex, firstVertex + 1, firstVertex + 2);
+			indices.Triangle(firstVertex + 2, firstVertex + 3, firstVertex);
+		}
+
+		void Cube(const PrimitiveDesc& desc, const VertexWriter& writer, IndexWriter& indices)
+		{
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				float corners[4][3];
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					for (uint32_t k = 0; k < 3; ++k)
+						corners[i][k] = s_cubeCorners[face][i][k] * desc.halfExtents.f[k];
+				}
+
+				Quad(writer, indices, face * 4, corners, s_cubeNormals[face]);
+			}
+		}
+
+		void Plane(const PrimitiveDesc& desc, const VertexWriter& writer, IndexWriter& indices)
+		{
+			float corners[4][3];
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				for (uint32_t k = 0; k < 3; ++k)
+					corners[i][k] = s_planeCorners[i][k] * desc.halfExtents.f[k];
+			}
+
+			Quad(writer, indices, 0, corners, s_planeNormal);
+		}
+
+		void Grid(const PrimitiveDesc& desc, const VertexWriter& writer, IndexWriter& indices)
+		{
+			uint32_t segments = GetSegments(desc);
+			uint32_t rings = GetRings(desc);
+			uint32_t columns = segments + 1;
+
+			float normal[3] = { 0.0f, 1.0f, 0.0f };
+			float tangent[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+
+			// rows from +z to -z like the plane
+			for (uint32_t j = 0; j <= rings; ++j)
+			{
+				float v = static_cast<float>(j) / rings;
+				for (uint32_t i = 0; i <= segments; ++i)
+				{
+					float u = static_cast<float>(i) / segments;
+					float position[3] = { (2.0f * u - 1.0f) * desc.halfExtents.x, 0.0f, (1.0f - 2.0f * v) * desc.halfExtents.z };
+					writer.Write(j * columns + i, position, normal, tangent, u, v);
+				}
+			}
+
+			for (uint32_t j = 0; j < rings; ++j)
+			{
+				for (uint32_t i = 0; i < segments; ++i)
+				{
+					uint32_t a = j * columns + i;
+					uint32_t b = a + 1;
+					uint32_t c = a + columns + 1;
+					uint32_t d = a + columns;
+
+					indices.Triangle(a, b, c);
+					indices.Triangle(c, d, a);
+				}
+			}
+		}
+
+		void WriteSphereVertex(const PrimitiveDesc& desc, const VertexWriter& writer, uint32_t vertex, float x, float y, float z)
+		{
+			float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+			float normal[3] = { x * invLength, y * invLength, z * invLength };
+			float position[3] = { normal[0] * desc.radius, normal[1] * desc.radius, normal[2] * desc.radius };
+
+			// same parametrization as the surfaces of revolution: x = sin(theta) * cos(phi), z = sin(theta) * sin(phi)
+			float radial = sqrtf(normal[0] * normal[0] + normal[2] * normal[2]);
+			float c = radial > 0.0f ? normal[0] / radial : 1.0f;
+			float s = radial > 0.0f ? normal[2] / radial : 0.0f;
+			float tangent[4] = { -s, 0.0f, c, 1.0f };
+
+			float u = atan2f(s, c) / s_twoPi;
+			if (u < 0.0f)
+				u += 1.0f;
+
+			float v = acosf(std::min(std::max(normal[1], -1.0f), 1.0f)) / GM_PI;
+			writer.Write(vertex, position, normal, tangent, u, v);
+		}
+
+		void IcoSphere(const PrimitiveDesc& desc, const VertexWriter& writer, IndexWriter& indices)
+		{
+			const IcosahedronEdges& edges = GetIcosahedronEdges();
+			uint32_t n = GetIcoFrequency(desc);
+			float invN = 1.0f / n;
+
+			uint32_t firstEdgeVertex = 12;
+			uint32_t firstFaceVertex = firstEdgeVertex + 30 * (n - 1);
+			uint32_t faceVertexCount = (n - 1) * (n - 2) / 2;
+
+			for (uint32_t i = 0; i < 12; ++i)
+				WriteSphereVertex(desc, writer, i, s_icoVertices[i][0], s_icoVertices[i][1], s_icoVertices[i][2]);
+
+			// edge vertices are only computed here from the lower corner, both faces of an edge index the same ones
+			for (uint32_t e = 0; e < 30; ++e)
+			{
+				const float* a = s_icoVertices[edges.vertices[e][0]];
+				const float* b = s_icoVertices[edges.vertices[e][1]];
+
+				for (uint32_t t = 1; t < n; ++t)
+				{
+					float w = t * invN;
+					WriteSphereVertex(desc, writer, firstEdgeVertex + e * (n - 1) + t - 1, a[0] + (b[0] - a[0]) * w, a[1] + (b[1] - a[1]) * w, a[2] + (b[2] - a[2]) * w);
+				}
+			}
+
+			// lattice point (i, j) of a face is A + (B - A) * i / n + (C - A) * j / n
+			auto edgeVertex = [&](uint32_t edge, uint32_t from, uint32_t step)
+			{
+				uint32_t t = edges.vertices[edge][0] == from ? step : n - step;
+				return firstEdgeVertex + edge * (n - 1) + t - 1;
+			};
+
+			auto latticeVertex = [&](uint32_t face, uint32_t i, uint32_t j) -> uint32_t
+			{
+				const uint8_t* corners = s_icoFaces[face];
+				if (j == 0)
+					return i == 0 ? corners[0] : (i == n ? corners[1] : edgeVertex(edges.faceEdges[face][0], corners[0], i));
+				if (i == 0)
+					return j == n ? corners[2] : edgeVertex(edges.faceEdges[face][2], corners[2], n - j);
+				if (i + j == n)
+					return edgeVertex(edges.faceEdges[face][1], corners[1], j);
+
+				// interior rows j = 1 .. n - 2 hold n - 1 - j points each
+				return firstFaceVertex + face * faceVertexCount + (j - 1) * (n - 1) - (j - 1) * j / 2 + i - 1;
+			};
+
+			for (uint32_t f = 0; f < 20; ++f)
+			{
+				const float* a = s_icoVertices[s_icoFaces[f][0]];
+				const float* b = s_icoVertices[s_icoFaces[f][1]];
+				const float* c = s_icoVertices[s_icoFaces[f][2]];
+
+				for (uint32_t j = 1; j + 1 < n; ++j)
+				{
+					for (uint32_t i = 1; i + j < n; ++i)
+					{
+						float wi = i * invN;
+						float wj = j * invN;
+						WriteSphereVertex(desc, writer, latticeVertex(f, i, j),
+							a[0] + (b[0] - a[0]) * wi + (c[0] - a[0]) * wj,
+							a[1] + (b[1] - a[1]) * wi + (c[1] - a[1]) * wj,
+							a[2] + (b[2] - a[2]) * wi + (c[2] - a[2]) * wj);
+					}
+				}
+
+				for (uint32_t j = 0; j < n; ++j)
+				{
+					for (uint32_t i = 0; i + j < n; ++i)
+					{
+						indices.Triangle(latticeVertex(f, i, j), latticeVertex(f, i + 1, j), latticeVertex(f, i, j + 1));
+						if (i + j + 1 < n)
+							indices.Triangle(latticeVertex(f, i + 1, j), latticeVertex(f, i + 1, j + 1), latticeVertex(f, i, j + 1));
+					}
+				}
+			}
+		}
+	}
+
+	PrimitiveSize MeshGenerator::GetSize(const PrimitiveDesc& desc)
+	{
+		uint32_t segments = GetSegments(desc);
+		uint32_t rings = GetRings(desc);
+		uint32_t columns = segments + 1;
+
+		PrimitiveSize size;
+		switch (desc.type)
+		{
+		case PrimitiveType::Cube:
+			size.vertexCount = 24;
+			size.indexCount = 36;
+			break;
+		case PrimitiveType::Plane:
+			size.vertexCount = 4;
+			size.indexCount = 6;
+			break;
+		case PrimitiveType::Grid:
+			size.vertexCount = columns * (rings + 1);
+			size.indexCount = 6 * segments * rings;
+			break;
+		case PrimitiveType::UVSphere:
+			size.vertexCount = columns * (rings + 1);
+			size.indexCount = 6 * segments * (rings - 1);
+			break;
+		case PrimitiveType::IcoSphere:
+		{
+			uint32_t n = GetIcoFrequency(desc);
+			size.vertexCount = 10 * n * n + 2;
+			size.indexCount = 60 * n * n;
+			break;
+		}
+		case PrimitiveType::Cylinder:
+			size.vertexCount = 2 * columns + 2 * (segments + 1);
+			size.indexCount = 6 * segments + 2 * 3 * segments;
+			break;
+		case PrimitiveType::Cone:
+			size.vertexCount = 2 * columns + segments + 1;
+			size.indexCount = 3 * segments + 3 * segments;
+			break;
+		case PrimitiveType::Torus:
+			size.vertexCount = columns * (rings + 1);
+			size.indexCount = 6 * segments * rings;
+			break;
+		case PrimitiveType::Capsule:
+		{
+			uint32_t steps = GetCapsuleRows(desc) - 1;
+			size.vertexCount = columns * 2 * (steps + 1);
+			size.indexCount = 12 * segments * steps;
+			break;
+		}
+		default:
+			assert(false && "Unknown primitive type");
+			break;
+		}
+
+		return size;
+	}
+
+	PrimitiveSize MeshGenerator::Generate(const PrimitiveDesc& desc, const VertexLayout& layout, void* vertices, uint32_t vertexCapacity, uint32_t* indices, uint32_t indexCapacity, uint32_t baseVertex)
+	{
+		PrimitiveSize size = GetSize(desc);
+		assert(vertices && size.vertexCount <= vertexCapacity && "Vertex buffer too small for the primitive");
+		assert((!indices || size.indexCount <= indexCapacity) && "Index buffer too small for the primitive");
+		assert(layout.Has(VertexSemantic::Position) && "Vertex layout needs a position");
+
+		VertexWriter writer(desc, layout, vertices);
+		IndexWriter indexWriter(indices, baseVertex);
+
+		uint32_t segments = GetSegments(desc);
+		uint32_t rings = GetRings(desc);
+		float halfHeight = 0.5f * desc.height;
+
+		switch (desc.type)
+		{
+		case PrimitiveType::Cube:
+			Cube(desc, writer, indexWriter);
+			break;
+		case PrimitiveType::Plane:
+			Plane(desc, writer, indexWriter);
+			break;
+		case PrimitiveType::Grid:
+			Grid(desc, writer, indexWriter);
+			break;
+		case PrimitiveType::UVSphere:
+			Revolve(writer, indexWriter, 0, rings + 1, segments, [&](uint32_t row) { return SphereRow(desc, row, rings); });
+			break;
+		case PrimitiveType::IcoSphere:
+			IcoSphere(desc, writer, indexWriter);
+			break;
+		case PrimitiveType::Cylinder:
+		{
+			ProfileRow side[2] =
+			{
+				{ desc.radius, halfHeight, { 1.0f, 0.0f }, 0.0f },
+				{ desc.radius, -halfHeight, { 1.0f, 0.0f }, 1.0f }
+			};
+			Revolve(writer, indexWriter, 0, 2, segments, [&](uint32_t row) { return side[row]; });
+			Disc(writer, indexWriter, 2 * (segments + 1), segments, desc.radius, halfHeight, true);
+			Disc(writer, indexWriter, 3 * (segments + 1), segments, desc.radius, -halfHeight, false);
+			break;
+		}
+		case PrimitiveType::Cone:
+		{
+			float slant = sqrtf(desc.height * desc.height + desc.radius * desc.radius);
+			float nr = slant > 0.0f ? desc.height / slant : 1.0f;
+			float ny = slant > 0.0f ? desc.radius / slant : 0.0f;
+			ProfileRow side[2] =
+			{
+				{ 0.0f, halfHeight, { nr, ny }, 0.0f },
+				{ desc.radius, -halfHeight, { nr, ny }, 1.0f }
+			};
+			Revolve(writer, indexWriter, 0, 2, segments, [&](uint32_t row) { return side[row]; });
+			Disc(writer, indexWriter, 2 * (segments + 1), segments, desc.radius, -halfHeight, false);
+			break;
+		}
+		case PrimitiveType::Torus:
+			Revolve(writer, indexWriter, 0, rings + 1, segments, [&](uint32_t row) { return TorusRow(desc, row, rings); });
+			break;
+		case PrimitiveType::Capsule:
+		{
+			uint32_t hemisphereRows = GetCapsuleRows(desc);
+			Revolve(writer, indexWriter, 0, 2 * hemisphereRows, segments, [&](uint32_t row) { return CapsuleRow(desc, row, hemisphereRows); });
+			break;
+		}
+		default:
+			assert(false && "Unknown primitive type");
+			break;
+		}
+
+		assert(indexWriter.GetCount() == size.indexCount && "Generated index count differs from GetSize");
+		return size;
+	}
+
+	PrimitiveSize MeshGenerator::GetOffsets(const PrimitiveDesc* descs, uint32_t count, PrimitiveSize* offsets)
+	{
+		PrimitiveSize total;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			offsets[i] = total;
+
+			PrimitiveSize size = GetSize(descs[i]);
+			total.vertexCount += size.vertexCount;
+			total.indexCount += size.indexCount;
+		}
+
+		return total;
+	}
+
+	void MeshGenerator::GenerateBatch(const PrimitiveDesc* descs, uint32_t count, const PrimitiveSize* offsets, const VertexLayout& layout, void* vertices, uint32_t vertexCapacity, uint32_t* indices, uint32_t indexCapacity, bool multithreaded)
+	{
+		auto generate = [&](uint32_t first, uint32_t last)
+		{
+			for (uint32_t i = first; i < last; ++i)
+			{
+				const PrimitiveSize& offset = offsets[i];
+				assert(offset.vertexCount <= vertexCapacity && (!indices || offset.indexCount <= indexCapacity) && "Primitive offset past the end of the buffers");
+
+				uint8_t* primitiveVertices = static_cast<uint8_t*>(vertices) + static_cast<size_t>(offset.vertexCount) * layout.GetStride();
+				uint32_t* primitiveIndices = indices ? indices + offset.indexCount : nullptr;
+				Generate(descs[i], layout, primitiveVertices, vertexCapacity - offset.vertexCount, primitiveIndices, indices ? indexCapacity - offset.indexCount : 0, offset.vertexCount);
+			}
+		};
+
+		if (multithreaded && JobSystem::GetThreadCount() > 1)
+			JobSystem::ParallelFor(0, count, s_batchGrainSize, generate);
+		else
+			generate(0, count);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "VertexLayout.h"
+#include "Math/Types.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	enum class PrimitiveType : uint8_t
+	{
+		Cube,
+		Plane,     // one quad in the xz plane facing +y
+		Grid,      // segments x rings quads in the xz plane facing +y
+		UVSphere,
+		IcoSphere,
+		Cylinder,
+		Cone,      // apex at +y
+		Torus,     // around the y axis
+		Capsule
+	};
+
+	struct PrimitiveDesc
+	{
+		PrimitiveType type = PrimitiveType::Cube;
+		Vector center;                                        // added to every position
+		Vector halfExtents = Vector(0.5f, 0.5f, 0.5f, 0.0f);  // cube, x and z of plane and grid
+		float radius = 0.5f;      // spheres, cylinder, cone, capsule, from the axis to the tube center for the torus
+		float tubeRadius = 0.25f; // torus
+		float height = 1.0f;      // cylinder, cone, straight part of the capsule
+		uint32_t segments = 32;   // around the y axis, around the ring for the torus, along x for the grid
+		uint32_t rings = 16;      // pole to pole for sphere and capsule, around the tube for the torus, along z for the grid
+		uint32_t subdivisions = 3;// icosphere: every face of the icosahedron split in 4^subdivisions triangles
+		float texCoordScale[2] = { 1.0f, 1.0f };
+	};
+
+	struct PrimitiveSize
+	{
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+	};
+
+	/// <summary>
+	/// Procedural primitives written straight into caller provided buffers in any VertexLayout, nothing is
+	/// allocated: GetSize first, then Generate into buffers of that size. Position, normal, tangent and texcoord
+	/// are generated, colors are white. Triangles are ordered like Utils::BasicMesh: cross(p1 - p0, p2 - p0)
+	/// points out of the shape, clockwise seen from outside in the left handed view, and v grows downwards.
+	///
+	/// UV sphere, capsule, cylinder, cone and torus are surfaces of revolution around y with a duplicated seam
+	/// column, pole rows keep one vertex per column for the texcoords. The icosphere shares every vertex: the
+	/// lattice points of the subdivided faces are numbered corners first, then edges, then face interiors, so
+	/// faces sharing an edge find its vertices without an edge map. Its texcoords are spherical, with a seam and
+	/// pinched poles.
+	/// </summary>
+	class MeshGenerator
+	{
+	public:
+		static PrimitiveSize GetSize(const PrimitiveDesc& desc);
+
+		/// <summary>
+		/// Writes vertexCount vertices of layout.GetStride() bytes and indexCount indices, baseVertex is added to
+		/// every index. indices can be nullptr to only write the vertices. Returns the size written.
+		/// </summary>
+		static PrimitiveSize Generate(const PrimitiveDesc& desc, const VertexLayout& layout, void* vertices, uint32_t vertexCapacity, uint32_t* indices, uint32_t indexCapacity, uint32_t baseVertex = 0);
+
+		// fills the first vertex and first index of every primitive packed in shared buffers, returns the totals
+		static PrimitiveSize GetOffsets(const PrimitiveDesc* descs, uint32_t count, PrimitiveSize* offsets);
+
+		// every primitive into the shared buffers at the offsets of GetOffsets, indices relative to the buffer start.
+		// Split over the job system
+		static void GenerateBatch(const PrimitiveDesc* descs, uint32_t count, const PrimitiveSize* offsets, const VertexLayout& layout, void* vertices, uint32_t vertexCapacity, uint32_t* indices, uint32_t indexCapacity, bool multithreaded = true);
+
+	private:
+		MeshGenerator() = default;
+	};
+}
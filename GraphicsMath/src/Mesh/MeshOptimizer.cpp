@@ -0,0 +1,574 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+namespace GM
+{
+	namespace
+	{
+		// Forsyth's tuning: the last 3 vertices score the same so the next triangle doesn't always reuse the same edge
+		constexpr uint32_t s_forsythCacheSize = 32;
+		constexpr uint32_t s_forsythMaxValence = 64;
+		constexpr float s_forsythLastTriangleScore = 0.75f;
+		constexpr float s_forsythValenceBoostScale = 2.0f;
+
+		constexpr size_t s_fetchLineSize = 64;
+
+		// triangles of every vertex, triangles[offsets[v], offsets[v + 1]). A triangle is listed once per corner
+		struct Adjacency
+		{
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> counts;
+			std::vector<uint32_t> triangles;
+		};
+
+		void BuildAdjacency(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, Adjacency& adjacency)
+		{
+			adjacency.offsets.assign(vertexCount + 1, 0);
+			adjacency.counts.assign(vertexCount, 0);
+			adjacency.triangles.resize(indexCount);
+
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				assert(indices[i] < vertexCount && "Index out of range");
+				++adjacency.counts[indices[i]];
+			}
+
+			for (uint32_t v = 0; v < vertexCount; ++v)
+				adjacency.offsets[v + 1] = adjacency.offsets[v] + adjacency.counts[v];
+
+			std::vector<uint32_t> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+			for (uint32_t i = 0; i < indexCount; ++i)
+				adjacency.triangles[cursors[indices[i]]++] = i / 3;
+		}
+
+		// the input is copied when the output overwrites it
+		const uint32_t* GetSource(const uint32_t* indices, uint32_t indexCount, const uint32_t* destination, std::vector<uint32_t>& copy)
+		{
+			if (indices != destination)
+				return indices;
+
+			copy.assign(indices, indices + indexCount);
+			return copy.data();
+		}
+
+		// FIFO post transform cache: a vertex is cached while fewer than cacheSize vertices were transformed after it
+		class CacheSimulator
+		{
+		public:
+			CacheSimulator(uint32_t vertexCount, uint32_t cacheSize)
+				: m_timestamps(vertexCount, 0), m_time(cacheSize + 1), m_cacheSize(cacheSize)
+			{
+			}
+
+			// returns the number of vertices transformed
+			uint32_t Triangle(const uint32_t* triangle)
+			{
+				return Vertex(triangle[0]) + Vertex(triangle[1]) + Vertex(triangle[2]);
+			}
+
+			uint32_t Vertex(uint32_t v)
+			{
+				if (m_time - m_timestamps[v] <= m_cacheSize)
+					return 0;
+
+				m_timestamps[v] = m_time++;
+				return 1;
+			}
+
+			void Flush()
+			{
+				m_time += m_cacheSize + 1;
+			}
+
+		private:
+			std::vector<uint32_t> m_timestamps;
+			uint32_t m_time;
+			uint32_t m_cacheSize;
+		};
+
+		// next fanning vertex after a dead end: the most recent vertex with triangles left, else the first in index order
+		uint32_t SkipDeadEnd(std::vector<uint32_t>& deadEnds, const std::vector<uint32_t>& live, uint32_t& cursor)
+		{
+			while (!deadEnds.empty())
+			{
+				uint32_t v = deadEnds.back();
+				deadEnds.pop_back();
+				if (live[v] > 0)
+					return v;
+			}
+
+			for (; cursor < live.size(); ++cursor)
+			{
+				if (live[cursor] > 0)
+					return cursor;
+			}
+
+			return MeshOptimizer::InvalidIndex;
+		}
+
+		struct ForsythScores
+		{
+			float cachePosition[s_forsythCacheSize];
+			float valence[s_forsythMaxValence + 1];
+		};
+
+		const ForsythScores& GetForsythScores()
+		{
+			static const ForsythScores scores = []()
+			{
+				ForsythScores result;
+				for (uint32_t i = 0; i < s_forsythCacheSize; ++i)
+				{
+					if (i < 3)
+						result.cachePosition[i] = s_forsythLastTriangleScore;
+					else
+						result.cachePosition[i] = powf(1.0f - static_cast<float>(i - 3) / (s_forsythCacheSize - 3), 1.5f);
+				}
+
+				result.valence[0] = 0.0f;
+				for (uint32_t i = 1; i <= s_forsythMaxValence; ++i)
+					result.valence[i] = s_forsythValenceBoostScale / sqrtf(static_cast<float>(i));
+
+				return result;
+			}();
+
+			return scores;
+		}
+
+		// cachePosition >= s_forsythCacheSize: not in the cache
+		float GetForsythScore(const ForsythScores& scores, uint32_t cachePosition, uint32_t live)
+		{
+			if (live == 0)
+				return -1.0f;
+
+			float score = scores.valence[std::min(live, s_forsythMaxValence)];
+			if (cachePosition < s_forsythCacheSize)
+				score += scores.cachePosition[cachePosition];
+
+			return score;
+		}
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* destination, uint32_t cacheSize, std::vector<uint32_t>* clusters)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+		assert(cacheSize >= 3 && "Vertex cache can't hold a triangle");
+
+		if (clusters)
+			clusters->clear();
+
+		if (indexCount == 0)
+			return;
+
+		std::vector<uint32_t> copy;
+		indices = GetSource(indices, indexCount, destination, copy);
+
+		Adjacency adjacency;
+		BuildAdjacency(indices, indexCount, vertexCount, adjacency);
+
+		std::vector<uint32_t>& live = adjacency.counts;
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		std::vector<uint8_t> emitted(indexCount / 3, 0);
+
+		// every emitted vertex is pushed, the ones pushed by the last fan are the candidates for the next one
+		std::vector<uint32_t> deadEnds;
+		deadEnds.reserve(indexCount);
+
+		uint32_t time = cacheSize + 1;
+		uint32_t cursor = 0;
+		uint32_t* output = destination;
+
+		if (clusters)
+			clusters->push_back(0);
+
+		uint32_t fan = SkipDeadEnd(deadEnds, live, cursor);
+		while (fan != InvalidIndex)
+		{
+			size_t candidatesBegin = deadEnds.size();
+
+			for (uint32_t i = adjacency.offsets[fan]; i < adjacency.offsets[fan + 1]; ++i)
+			{
+				uint32_t triangle = adjacency.triangles[i];
+				if (emitted[triangle])
+					continue;
+
+				emitted[triangle] = 1;
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					uint32_t v = indices[triangle * 3 + corner];
+					*output++ = v;
+					deadEnds.push_back(v);
+					--live[v];
+
+					if (time - timestamps[v] > cacheSize)
+						timestamps[v] = time++;
+				}
+			}
+
+			// the candidate still in the cache after its remaining fan would be emitted, the oldest one first
+			uint32_t next = InvalidIndex;
+			int64_t bestPriority = -1;
+			for (size_t i = candidatesBegin; i < deadEnds.size(); ++i)
+			{
+				uint32_t v = deadEnds[i];
+				if (live[v] == 0)
+					continue;
+
+				int64_t priority = 0;
+				if (time - timestamps[v] + 2 * static_cast<int64_t>(live[v]) <= cacheSize)
+					priority = time - timestamps[v];
+
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = v;
+				}
+			}
+
+			if (next == InvalidIndex)
+			{
+				next = SkipDeadEnd(deadEnds, live, cursor);
+				if (clusters && next != InvalidIndex)
+					clusters->push_back(static_cast<uint32_t>(output - destination) / 3);
+			}
+
+			fan = next;
+		}
+
+		assert(output == destination + indexCount && "Not every triangle was emitted");
+	}
+
+	void MeshOptimizer::OptimizeVertexCacheForsyth(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* destination)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+
+		uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		std::vector<uint32_t> copy;
+		indices = GetSource(indices, indexCount, destination, copy);
+
+		// live triangles of v are triangles[offsets[v], offsets[v] + live[v]), emitted ones are swapped out
+		Adjacency adjacency;
+		BuildAdjacency(indices, indexCount, vertexCount, adjacency);
+		std::vector<uint32_t>& live = adjacency.counts;
+
+		const ForsythScores& scores = GetForsythScores();
+		std::vector<float> vertexScores(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			vertexScores[v] = GetForsythScore(scores, s_forsythCacheSize, live[v]);
+
+		std::vector<uint8_t> emitted(triangleCount, 0);
+
+		// 3 more entries for the vertices pushed out by the last triangle, their scores drop too
+		uint32_t cache[s_forsythCacheSize + 3];
+		uint32_t newCache[s_forsythCacheSize + 3];
+		uint32_t cacheCount = 0;
+
+		uint32_t current = 0;
+		uint32_t cursor = 0;
+
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			// no live triangle in the cache: the next one in input order
+			if (current == InvalidIndex)
+			{
+				while (emitted[cursor])
+					++cursor;
+
+				current = cursor;
+			}
+
+			const uint32_t* triangle = indices + current * 3;
+			memcpy(destination + t * 3, triangle, 3 * sizeof(uint32_t));
+			emitted[current] = 1;
+
+			uint32_t newCount = 0;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				uint32_t v = triangle[corner];
+				if (std::find(newCache, newCache + newCount, v) == newCache + newCount)
+					newCache[newCount++] = v;
+
+				// swap the triangle out of the live ones of v
+				uint32_t* begin = adjacency.triangles.data() + adjacency.offsets[v];
+				uint32_t* it = std::find(begin, begin + live[v], current);
+				assert(it != begin + live[v] && "Triangle missing from the adjacency");
+				std::swap(*it, begin[--live[v]]);
+			}
+
+			for (uint32_t i = 0; i < cacheCount; ++i)
+			{
+				if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+					newCache[newCount++] = cache[i];
+			}
+
+			for (uint32_t i = 0; i < newCount; ++i)
+				vertexScores[newCache[i]] = GetForsythScore(scores, i, live[newCache[i]]);
+
+			// the best triangle touching the cache, the others kept their scores
+			current = InvalidIndex;
+			float bestScore = -1.0f;
+			for (uint32_t i = 0; i < newCount; ++i)
+			{
+				uint32_t v = newCache[i];
+				const uint32_t* triangles = adjacency.triangles.data() + adjacency.offsets[v];
+				for (uint32_t j = 0; j < live[v]; ++j)
+				{
+					const uint32_t* candidate = indices + triangles[j] * 3;
+					float score = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+					if (score > bestScore)
+					{
+						bestScore = score;
+						current = triangles[j];
+					}
+				}
+			}
+
+			cacheCount = std::min(newCount, s_forsythCacheSize);
+			memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+		}
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(const uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t vertexCount, uint32_t positionStride, uint32_t* destination, float threshold, uint32_t cacheSize)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+		assert(positionStride >= 3 && "Position stride is smaller than a position");
+
+		uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		std::vector<uint32_t> copy;
+		indices = GetSource(indices, indexCount, destination, copy);
+
+		// hard boundaries: triangles missing the cache on every vertex, the order before them doesn't matter
+		std::vector<uint32_t> hardClusters;
+		{
+			CacheSimulator cache(vertexCount, cacheSize);
+			for (uint32_t t = 0; t < triangleCount; ++t)
+			{
+				if (cache.Triangle(indices + t * 3) == 3)
+					hardClusters.push_back(t);
+			}
+		}
+		hardClusters.push_back(triangleCount);
+
+		// soft boundaries: a hard cluster is cut as soon as the part before the cut, drawn with a cold cache,
+		// has an ACMR within threshold of the whole hard cluster's
+		std::vector<uint32_t> clusters;
+		{
+			CacheSimulator cache(vertexCount, cacheSize);
+			for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+			{
+				uint32_t begin = hardClusters[c];
+				uint32_t end = hardClusters[c + 1];
+
+				cache.Flush();
+				uint32_t misses = 0;
+				for (uint32_t t = begin; t < end; ++t)
+					misses += cache.Triangle(indices + t * 3);
+
+				float maxACMR = threshold * misses / (end - begin);
+
+				cache.Flush();
+				uint32_t start = begin;
+				misses = 0;
+				clusters.push_back(begin);
+				for (uint32_t t = begin; t < end; ++t)
+				{
+					misses += cache.Triangle(indices + t * 3);
+					if (t + 1 < end && misses <= maxACMR * (t + 1 - start))
+					{
+						clusters.push_back(t + 1);
+						start = t + 1;
+						misses = 0;
+						cache.Flush();
+					}
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+
+		// center of the mesh: mean of the triangle corners
+		double meshCenter[3] = { 0.0, 0.0, 0.0 };
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			assert(indices[i] < vertexCount && "Index out of range");
+			const float* p = positions + static_cast<size_t>(indices[i]) * positionStride;
+			for (uint32_t k = 0; k < 3; ++k)
+				meshCenter[k] += p[k];
+		}
+
+		for (uint32_t k = 0; k < 3; ++k)
+			meshCenter[k] /= indexCount;
+
+		// clusters facing away from the center are on the outside: drawn first they hide the rest
+		uint32_t clusterCount = static_cast<uint32_t>(clusters.size() - 1);
+		std::vector<float> sortKeys(clusterCount);
+		for (uint32_t c = 0; c < clusterCount; ++c)
+		{
+			float centroid[3] = { 0.0f, 0.0f, 0.0f };
+			float normal[3] = { 0.0f, 0.0f, 0.0f };
+			float areaSum = 0.0f;
+
+			for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+			{
+				const float* p0 = positions + static_cast<size_t>(indices[t * 3 + 0]) * positionStride;
+				const float* p1 = positions + static_cast<size_t>(indices[t * 3 + 1]) * positionStride;
+				const float* p2 = positions + static_cast<size_t>(indices[t * 3 + 2]) * positionStride;
+
+				float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+					normal[k] += n[k];
+				}
+
+				areaSum += area;
+			}
+
+			float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float invArea = areaSum > 0.0f ? 1.0f / areaSum : 0.0f;
+			float invNormalLength = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+
+			float key = 0.0f;
+			for (uint32_t k = 0; k < 3; ++k)
+				key += (centroid[k] * invArea - static_cast<float>(meshCenter[k])) * normal[k] * invNormalLength;
+
+			sortKeys[c] = key;
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		for (uint32_t c = 0; c < clusterCount; ++c)
+			order[c] = c;
+
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		uint32_t* output = destination;
+		for (uint32_t c : order)
+		{
+			uint32_t count = (clusters[c + 1] - clusters[c]) * 3;
+			memcpy(output, indices + clusters[c] * 3, count * sizeof(uint32_t));
+			output += count;
+		}
+	}
+
+	uint32_t MeshOptimizer::GetVertexFetchRemap(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* remap)
+	{
+		std::fill(remap, remap + vertexCount, InvalidIndex);
+
+		uint32_t next = 0;
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			assert(indices[i] < vertexCount && "Index out of range");
+			uint32_t& r = remap[indices[i]];
+			if (r == InvalidIndex)
+				r = next++;
+		}
+
+		return next;
+	}
+
+	void MeshOptimizer::RemapIndices(const uint32_t* indices, uint32_t indexCount, const uint32_t* remap, uint32_t* destination)
+	{
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			assert(remap[indices[i]] != InvalidIndex && "Index to an unmapped vertex");
+			destination[i] = remap[indices[i]];
+		}
+	}
+
+	void MeshOptimizer::RemapVertices(const void* vertices, uint32_t vertexCount, uint32_t stride, const uint32_t* remap, void* destination)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(vertices);
+		uint8_t* dst = static_cast<uint8_t*>(destination);
+
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if (remap[v] != InvalidIndex)
+				memcpy(dst + static_cast<size_t>(remap[v]) * stride, src + static_cast<size_t>(v) * stride, stride);
+		}
+	}
+
+	uint32_t MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride, void* destination)
+	{
+		std::vector<uint32_t> remap(vertexCount);
+		uint32_t count = GetVertexFetchRemap(indices, indexCount, vertexCount, remap.data());
+
+		RemapIndices(indices, indexCount, remap.data(), indices);
+		RemapVertices(vertices, vertexCount, stride, remap.data(), destination);
+		return count;
+	}
+
+	VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+
+		VertexCacheStatistics result;
+		if (indexCount == 0)
+			return result;
+
+		CacheSimulator cache(vertexCount, cacheSize);
+		std::vector<uint8_t> referenced(vertexCount, 0);
+		uint32_t referencedCount = 0;
+
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			assert(indices[i] < vertexCount && "Index out of range");
+			result.vertexTransforms += cache.Vertex(indices[i]);
+
+			referencedCount += referenced[indices[i]] ^ 1;
+			referenced[indices[i]] = 1;
+		}
+
+		result.acmr = static_cast<float>(result.vertexTransforms) / (indexCount / 3);
+		result.atvr = static_cast<float>(result.vertexTransforms) / referencedCount;
+		return result;
+	}
+
+	VertexFetchStatistics MeshOptimizer::AnalyzeVertexFetch(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t stride, uint32_t cacheLines)
+	{
+		assert(cacheLines > 0 && "Vertex fetch cache has no lines");
+
+		VertexFetchStatistics result;
+		if (indexCount == 0)
+			return result;
+
+		std::vector<uint64_t> tags(cacheLines, ~0ull);
+		std::vector<uint8_t> referenced(vertexCount, 0);
+		uint32_t referencedCount = 0;
+
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t v = indices[i];
+			assert(v < vertexCount && "Index out of range");
+
+			referencedCount += referenced[v] ^ 1;
+			referenced[v] = 1;
+
+			uint64_t begin = static_cast<uint64_t>(v) * stride;
+			for (uint64_t line = begin / s_fetchLineSize; line <= (begin + stride - 1) / s_fetchLineSize; ++line)
+			{
+				uint64_t& tag = tags[line % cacheLines];
+				if (tag != line)
+				{
+					tag = line;
+					result.bytesFetched += s_fetchLineSize;
+				}
+			}
+		}
+
+		result.overfetch = static_cast<float>(result.bytesFetched) / (static_cast<float>(referencedCount) * stride);
+		return result;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace GM
+{
+	struct VertexCacheStatistics
+	{
+		uint32_t vertexTransforms = 0; // cache misses
+		float acmr = 0.0f;             // transforms per triangle: 0.5 at best on large regular meshes, 3 at worst
+		float atvr = 0.0f;             // transforms per referenced vertex: 1 at best
+	};
+
+	struct VertexFetchStatistics
+	{
+		uint64_t bytesFetched = 0;     // in whole cache lines
+		float overfetch = 0.0f;        // bytes fetched per byte of referenced vertices: 1 at best
+	};
+
+	/// <summary>
+	/// Reorders triangles and vertices of indexed triangle lists for the GPU, in this order:
+	/// - OptimizeVertexCache (Tipsify, Sander et al. 2007) or OptimizeVertexCacheForsyth (Forsyth 2006) so
+	///   neighbouring triangles reuse transformed vertices. Tipsify runs in linear time and is the one to use at
+	///   import, Forsyth is a few times slower and models an LRU cache, which suits some hardware better.
+	/// - OptimizeOverdraw splits the cache ordered triangles into clusters and draws the clusters facing away
+	///   from the mesh center first, as long as the ACMR doesn't grow past threshold times the input's.
+	/// - OptimizeVertexFetch renumbers the vertices in order of first use, so the vertex fetches walk memory
+	///   forward, and drops the unreferenced ones.
+	/// Indices are in place safe everywhere (destination can be indices). Degenerate triangles are kept.
+	/// </summary>
+	class MeshOptimizer
+	{
+	public:
+		/// <summary>
+		/// Tipsify for a FIFO cache of cacheSize vertices. clusters optionally receives the first triangle of every
+		/// run that started at a dead end, where the cache is cold: OptimizeOverdraw can move them freely.
+		/// </summary>
+		static void OptimizeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* destination, uint32_t cacheSize = 16, std::vector<uint32_t>* clusters = nullptr);
+
+		// greedy by Forsyth's vertex scores for an LRU cache of 32 vertices
+		static void OptimizeVertexCacheForsyth(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* destination);
+
+		/// <summary>
+		/// indices should come from OptimizeVertexCache. positions are the first 3 floats of every vertex,
+		/// positionStride in floats. threshold: the accepted ACMR growth, 1 keeps the cache order as is.
+		/// </summary>
+		static void OptimizeOverdraw(const uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t vertexCount, uint32_t positionStride, uint32_t* destination, float threshold = 1.05f, uint32_t cacheSize = 16);
+
+		/// <summary>
+		/// remap[old vertex] = new vertex in order of first use in indices, InvalidIndex for unreferenced vertices.
+		/// Returns the number of referenced vertices.
+		/// </summary>
+		static uint32_t GetVertexFetchRemap(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t* remap);
+		static void RemapIndices(const uint32_t* indices, uint32_t indexCount, const uint32_t* remap, uint32_t* destination);
+		// destination holds the referenced vertices only and can't overlap vertices. stride in bytes
+		static void RemapVertices(const void* vertices, uint32_t vertexCount, uint32_t stride, const uint32_t* remap, void* destination);
+
+		// GetVertexFetchRemap, then both remaps. Returns the new vertex count
+		static uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, const void* vertices, uint32_t vertexCount, uint32_t stride, void* destination);
+
+		// FIFO cache of cacheSize vertices, like the post transform caches of most GPUs
+		static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16);
+		// direct mapped cache of 64 byte lines, 16 KB by default. stride in bytes
+		static VertexFetchStatistics AnalyzeVertexFetch(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t stride, uint32_t cacheLines = 256);
+
+		static constexpr uint32_t InvalidIndex = ~0u;
+
+	private:
+		MeshOptimizer() = default;
+	};
+}
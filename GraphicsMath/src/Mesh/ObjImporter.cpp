@@ -0,0 +1,441 @@
+#include "ObjImporter.h"
+#include "TextParsing.h"
+#include "VertexConversion.h"
+#include "VertexWelder.h"
+#include "Core/JobSystem.h"
+#include "Core/MappedFile.h"
+
+#include <algorithm>
+#include <functional>
+#include <string.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_chunkGrain = 1024; // in KB of text
+		constexpr uint32_t s_grainSize = 4096;
+
+		// a corner without texcoord or normal
+		constexpr int32_t s_missing = INT32_MIN;
+		constexpr uint32_t s_invalid = ~0u;
+
+		// what a chunk of lines declares. corners holds position, texcoord, normal per triangle corner: positive
+		// indices already 0 based, relative ones as an index into the elements counted so far in the chunk, to be
+		// offset by the elements of the earlier chunks
+		struct ObjChunk
+		{
+			std::vector<float> positions; // 3 per position
+			std::vector<float> texCoords; // 2 per texcoord
+			std::vector<float> normals;   // 3 per normal
+			std::vector<int32_t> corners;
+			std::vector<uint32_t> relativeCorners; // entries of corners given relative
+			bool error = false;
+		};
+
+		struct ObjCorner
+		{
+			int32_t refs[3];
+			uint32_t relative; // bit k: refs[k] is relative
+		};
+
+		bool IsSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		const char* SkipSpaces(const char* p, const char* end)
+		{
+			while (p != end && IsSpace(*p))
+				++p;
+
+			return p;
+		}
+
+		// the floats up to the end of the line or a comment, the ones past maxCount are checked then dropped. -1 when malformed
+		int32_t ReadFloats(const char* p, const char* end, float* values, int32_t maxCount)
+		{
+			int32_t count = 0;
+			for (;;)
+			{
+				p = SkipSpaces(p, end);
+				if (p == end || *p == '#')
+					return count;
+
+				float value;
+				p = ParseFloat(p, end, value);
+				if (!p || (p != end && !IsSpace(*p)))
+					return -1;
+
+				if (count < maxCount)
+					values[count] = value;
+				count++;
+			}
+		}
+
+		void EmitCorner(ObjChunk& chunk, const ObjCorner& corner)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				if (corner.relative & (1u << k))
+					chunk.relativeCorners.push_back(static_cast<uint32_t>(chunk.corners.size()));
+
+				chunk.corners.push_back(corner.refs[k]);
+			}
+		}
+
+		// p after the 'f'
+		bool ParseFace(const char* p, const char* end, ObjChunk& chunk)
+		{
+			int64_t counts[3] =
+			{
+				static_cast<int64_t>(chunk.positions.size() / 3),
+				static_cast<int64_t>(chunk.texCoords.size() / 2),
+				static_cast<int64_t>(chunk.normals.size() / 3)
+			};
+
+			ObjCorner first = {}, previous = {};
+			uint32_t cornerCount = 0;
+			for (;;)
+			{
+				p = SkipSpaces(p, end);
+				if (p == end || *p == '#')
+					break;
+
+				// p, p/t, p//n or p/t/n
+				ObjCorner corner = { { s_missing, s_missing, s_missing }, 0 };
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					if (k > 0)
+					{
+						if (p == end || *p != '/')
+							break;
+
+						if (++p == end || *p == '/' || IsSpace(*p))
+							continue;
+					}
+
+					int32_t index;
+					p = ParseInt(p, end, index);
+					if (!p || index == 0)
+						return false;
+
+					if (index > 0)
+					{
+						corner.refs[k] = index - 1;
+					}
+					else
+					{
+						corner.refs[k] = static_cast<int32_t>(counts[k] + index);
+						corner.relative |= 1u << k;
+					}
+				}
+
+				if (p != end && !IsSpace(*p))
+					return false;
+
+				// fan triangulation
+				if (cornerCount == 0)
+				{
+					first = corner;
+				}
+				else if (cornerCount >= 2)
+				{
+					EmitCorner(chunk, first);
+					EmitCorner(chunk, previous);
+					EmitCorner(chunk, corner);
+				}
+
+				previous = corner;
+				cornerCount++;
+			}
+
+			return cornerCount >= 3;
+		}
+
+		bool ParseLine(const char* p, const char* end, ObjChunk& chunk)
+		{
+			p = SkipSpaces(p, end);
+			if (end - p < 2)
+				return true;
+
+			// v, f or a 2 letter statement followed by a space
+			bool twoLetters = end - p >= 3 && IsSpace(p[2]);
+
+			float values[3];
+			if (p[0] == 'v' && IsSpace(p[1]))
+			{
+				if (ReadFloats(p + 1, end, values, 3) < 3)
+					return false;
+
+				chunk.positions.insert(chunk.positions.end(), values, values + 3);
+			}
+			else if (p[0] == 'v' && p[1] == 't' && twoLetters)
+			{
+				values[1] = 0.0f;
+				if (ReadFloats(p + 2, end, values, 2) < 1)
+					return false;
+
+				chunk.texCoords.insert(chunk.texCoords.end(), values, values + 2);
+			}
+			else if (p[0] == 'v' && p[1] == 'n' && twoLetters)
+			{
+				if (ReadFloats(p + 2, end, values, 3) < 3)
+					return false;
+
+				chunk.normals.insert(chunk.normals.end(), values, values + 3);
+			}
+			else if (p[0] == 'f' && IsSpace(p[1]))
+			{
+				return ParseFace(p + 1, end, chunk);
+			}
+
+			return true;
+		}
+
+		void ParseChunk(const char* p, const char* end, ObjChunk& chunk)
+		{
+			while (p != end)
+			{
+				const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+				if (!lineEnd)
+					lineEnd = end;
+
+				if (!ParseLine(p, lineEnd, chunk))
+				{
+					chunk.error = true;
+					return;
+				}
+
+				p = lineEnd == end ? end : lineEnd + 1;
+			}
+		}
+
+		// chunk i is [starts[i], starts[i + 1]), every chunk starts at the beginning of a line
+		std::vector<size_t> SplitLines(const char* text, size_t size, uint32_t chunkCount)
+		{
+			std::vector<size_t> starts(chunkCount + 1, size);
+			starts[0] = 0;
+			for (uint32_t i = 1; i < chunkCount; ++i)
+			{
+				size_t start = std::max(static_cast<size_t>(static_cast<uint64_t>(size) * i / chunkCount), starts[i - 1]);
+				const char* newline = static_cast<const char*>(memchr(text + start, '\n', size - start));
+				starts[i] = newline ? newline - text + 1 : size;
+			}
+
+			return starts;
+		}
+
+		void ForEachChunk(uint32_t chunkCount, const std::function<void(uint32_t chunk)>& fn)
+		{
+			if (chunkCount == 1)
+				fn(0);
+			else
+				JobSystem::ParallelForChunks(chunkCount, chunkCount, [&](uint32_t chunk, uint32_t, uint32_t) { fn(chunk); });
+		}
+
+		// the elements of every chunk one after the other, the chunk vectors are released
+		std::vector<float> Concatenate(std::vector<ObjChunk>& chunks, std::vector<float> ObjChunk::* elements, const std::vector<uint64_t>& bases, uint32_t size)
+		{
+			if (chunks.size() == 1)
+				return std::move(chunks[0].*elements);
+
+			std::vector<float> result(bases.back() * size);
+			ForEachChunk(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunk)
+			{
+				std::vector<float>& source = chunks[chunk].*elements;
+				std::copy(source.begin(), source.end(), result.begin() + bases[chunk] * size);
+				std::vector<float>().swap(source);
+			});
+
+			return result;
+		}
+	}
+
+	bool ObjImporter::Import(const std::string& filename, ObjMesh& mesh, const ObjImportDesc& desc)
+	{
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			mesh = ObjMesh();
+			return false;
+		}
+
+		return Parse(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), mesh, desc);
+	}
+
+	bool ObjImporter::Parse(const char* text, size_t size, ObjMesh& mesh, const ObjImportDesc& desc)
+	{
+		mesh = ObjMesh();
+		mesh.layout = desc.layout;
+
+		auto fail = [&mesh]()
+		{
+			mesh = ObjMesh();
+			return false;
+		};
+
+		uint32_t chunkCount = 1;
+		if (desc.multithreaded && JobSystem::GetThreadCount() > 1 && size >= desc.parallelThreshold)
+			chunkCount = JobSystem::ComputeChunkCount(static_cast<uint32_t>(std::min<uint64_t>(size >> 10, UINT32_MAX)), s_chunkGrain);
+
+		std::vector<size_t> starts = SplitLines(text, size, chunkCount);
+		std::vector<ObjChunk> chunks(chunkCount);
+		ForEachChunk(chunkCount, [&](uint32_t chunk)
+		{
+			ParseChunk(text + starts[chunk], text + starts[chunk + 1], chunks[chunk]);
+		});
+
+		// elements before every chunk: positions, texcoords, normals and corners
+		std::vector<uint64_t> bases[4];
+		for (std::vector<uint64_t>& base : bases)
+			base.assign(chunkCount + 1, 0);
+
+		for (uint32_t i = 0; i < chunkCount; ++i)
+		{
+			if (chunks[i].error)
+				return fail();
+
+			bases[0][i + 1] = bases[0][i] + chunks[i].positions.size() / 3;
+			bases[1][i + 1] = bases[1][i] + chunks[i].texCoords.size() / 2;
+			bases[2][i + 1] = bases[2][i] + chunks[i].normals.size() / 3;
+			bases[3][i + 1] = bases[3][i] + chunks[i].corners.size() / 3;
+		}
+
+		uint64_t counts[3] = { bases[0].back(), bases[1].back(), bases[2].back() };
+		uint64_t cornerCount = bases[3].back();
+		if (counts[0] > INT32_MAX || counts[1] > INT32_MAX || counts[2] > INT32_MAX || cornerCount > UINT32_MAX)
+			return fail();
+
+		mesh.hasTexCoords = counts[1] > 0;
+		mesh.hasNormals = counts[2] > 0;
+
+		// attributes the layout doesn't use don't split vertices
+		bool useTexCoords = mesh.hasTexCoords && desc.layout.Has(VertexSemantic::TexCoord);
+		bool useNormals = mesh.hasNormals && desc.layout.Has(VertexSemantic::Normal);
+		bool used[3] = { true, useTexCoords, useNormals };
+
+		// resolved index tuples, s_invalid for the ones missing or unused
+		std::vector<uint32_t> tuples(cornerCount * 3);
+		ForEachChunk(chunkCount, [&](uint32_t chunk)
+		{
+			ObjChunk& data = chunks[chunk];
+			for (uint32_t entry : data.relativeCorners)
+				data.corners[entry] += static_cast<int32_t>(bases[entry % 3][chunk]);
+
+			uint32_t* destination = tuples.data() + bases[3][chunk] * 3;
+			for (size_t i = 0; i < data.corners.size(); ++i)
+			{
+				uint32_t k = i % 3;
+				int32_t ref = data.corners[i];
+				if (ref == s_missing && k > 0)
+				{
+					destination[i] = s_invalid;
+					continue;
+				}
+
+				if (ref < 0 || static_cast<uint64_t>(ref) >= counts[k])
+				{
+					data.error = true;
+					break;
+				}
+
+				destination[i] = used[k] ? static_cast<uint32_t>(ref) : s_invalid;
+			}
+
+			std::vector<int32_t>().swap(data.corners);
+			std::vector<uint32_t>().swap(data.relativeCorners);
+		});
+
+		for (const ObjChunk& chunk : chunks)
+		{
+			if (chunk.error)
+				return fail();
+		}
+
+		std::vector<float> positions = Concatenate(chunks, &ObjChunk::positions, bases[0], 3);
+		std::vector<float> texCoords = Concatenate(chunks, &ObjChunk::texCoords, bases[1], 2);
+		std::vector<float> normals = Concatenate(chunks, &ObjChunk::normals, bases[2], 3);
+		chunks.clear();
+
+		if (cornerCount == 0)
+			return true;
+
+		// the tuples welded as 12 byte vertices: the remap is the index buffer
+		VertexLayout tupleLayout;
+		tupleLayout.Add(VertexSemantic::Position, VertexFormat::Float3);
+
+		WeldDesc weldDesc;
+		weldDesc.multithreaded = desc.multithreaded;
+
+		mesh.indices.resize(cornerCount);
+		mesh.vertexCount = VertexWelder::GenerateRemap(tupleLayout, tuples.data(), static_cast<uint32_t>(cornerCount), mesh.indices.data(), weldDesc);
+
+		std::vector<uint32_t> vertexTuples(static_cast<size_t>(mesh.vertexCount) * 3);
+		VertexWelder::CompactVertices(tupleLayout, tuples.data(), static_cast<uint32_t>(cornerCount), mesh.indices.data(), vertexTuples.data());
+		std::vector<uint32_t>().swap(tuples);
+
+		// gathered as floats, then converted to the layout unless it is the float layout already
+		VertexLayout floatLayout;
+		floatLayout.Add(VertexSemantic::Position, VertexFormat::Float3);
+		if (useTexCoords)
+			floatLayout.Add(VertexSemantic::TexCoord, VertexFormat::Float2);
+		if (useNormals)
+			floatLayout.Add(VertexSemantic::Normal, VertexFormat::Float3);
+
+		mesh.vertices.resize(static_cast<size_t>(mesh.vertexCount) * desc.layout.GetStride());
+
+		bool direct = floatLayout == desc.layout;
+		std::vector<float> floatVertices;
+		if (!direct)
+			floatVertices.resize(static_cast<size_t>(mesh.vertexCount) * floatLayout.GetStride() / sizeof(float));
+
+		float* gathered = direct ? reinterpret_cast<float*>(mesh.vertices.data()) : floatVertices.data();
+		uint32_t floatStride = floatLayout.GetStride() / sizeof(float);
+
+		auto gather = [&](uint32_t first, uint32_t last)
+		{
+			for (uint32_t v = first; v < last; ++v)
+			{
+				const uint32_t* tuple = vertexTuples.data() + static_cast<size_t>(v) * 3;
+				float* vertex = gathered + static_cast<size_t>(v) * floatStride;
+
+				memcpy(vertex, positions.data() + static_cast<size_t>(tuple[0]) * 3, 3 * sizeof(float));
+				vertex += 3;
+
+				if (useTexCoords)
+				{
+					if (tuple[1] != s_invalid)
+					{
+						const float* texCoord = texCoords.data() + static_cast<size_t>(tuple[1]) * 2;
+						vertex[0] = texCoord[0];
+						vertex[1] = desc.flipTexCoordV ? 1.0f - texCoord[1] : texCoord[1];
+					}
+					else
+					{
+						vertex[0] = vertex[1] = 0.0f;
+					}
+					vertex += 2;
+				}
+
+				if (useNormals)
+				{
+					if (tuple[2] != s_invalid)
+						memcpy(vertex, normals.data() + static_cast<size_t>(tuple[2]) * 3, 3 * sizeof(float));
+					else
+						vertex[0] = vertex[1] = vertex[2] = 0.0f;
+				}
+			}
+		};
+
+		if (desc.multithreaded && JobSystem::GetThreadCount() > 1)
+			JobSystem::ParallelFor(0, mesh.vertexCount, s_grainSize, gather);
+		else
+			gather(0, mesh.vertexCount);
+
+		if (!direct)
+			ConvertVertices(floatLayout, floatVertices.data(), desc.layout, mesh.vertices.data(), mesh.vertexCount, desc.multithreaded);
+
+		return true;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "VertexLayout.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace GM
+{
+	struct ObjImportDesc
+	{
+		VertexLayout layout = VertexLayout::BasicMesh(true, true); // of the imported vertices
+		bool flipTexCoordV = false; // v = 1 - v: OBJ puts the texture origin bottom left, D3D top left
+		bool multithreaded = true;
+		uint32_t parallelThreshold = 1 << 20; // in bytes, smaller files are parsed on the calling thread
+	};
+
+	struct ObjMesh
+	{
+		VertexLayout layout;
+		std::vector<uint8_t> vertices;
+		uint32_t vertexCount = 0;
+		std::vector<uint32_t> indices; // triangle list
+		bool hasTexCoords = false; // the file has vt
+		bool hasNormals = false;   // the file has vn
+	};
+
+	/// <summary>
+	/// Wavefront OBJ geometry: v, vt and vn, and the faces with 1 based or negative relative indices. Polygons
+	/// are triangulated as fans, every other statement (groups, materials, lines, ...) is skipped.
+	///
+	/// The file is memory mapped and split into line aligned chunks parsed in parallel with a float parser that
+	/// doesn't go through the locale or strtod. Relative indices are resolved once the counts of the earlier
+	/// chunks are known. The v/vt/vn index tuples of the corners are welded bitwise by VertexWelder into the
+	/// vertices, numbered in order of first occurrence, so the result doesn't depend on the thread count. Only
+	/// the attributes the layout uses split vertices, the ones the file doesn't have get the VertexLayout defaults.
+	/// </summary>
+	class ObjImporter
+	{
+	public:
+		// false when the file can't be opened, or on a malformed statement or an index out of range
+		static bool Import(const std::string& filename, ObjMesh& mesh, const ObjImportDesc& desc = ObjImportDesc());
+		// the same from text in memory
+		static bool Parse(const char* text, size_t size, ObjMesh& mesh, const ObjImportDesc& desc = ObjImportDesc());
+
+	private:
+		ObjImporter() = default;
+	};
+}
@@ -0,0 +1,887 @@
+#include "PlyReader.h"
+#include "TextParsing.h"
+#include "VertexConversion.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr size_t s_blockSize = 1 << 20; // bytes read from the file at once
+		constexpr uint32_t s_skip = ~0u;
+
+		enum class ElementKind : uint8_t
+		{
+			Vertices,
+			Faces,
+			Skipped
+		};
+
+		struct PropertyPlan
+		{
+			uint32_t slot = s_skip; // float of the staging vertex the property is decoded to
+			float scale = 1.0f;
+		};
+
+		struct ElementPlan
+		{
+			const PlyElement* element = nullptr;
+			ElementKind kind = ElementKind::Skipped;
+			std::vector<PropertyPlan> properties;
+			uint32_t indexProperty = s_skip; // the list of the face indices
+			uint32_t rowSize = 0;            // binary rows without lists, 0 otherwise
+		};
+
+		// what the decode tasks share
+		struct DecodeContext
+		{
+			PlyFormat format;
+			bool swap; // big endian data on the little endian targets
+			uint64_t vertexCount;
+			VertexLayout stagingLayout; // a Float4 per semantic found in the file and the layout
+			std::vector<float> defaults; // a staging vertex before its properties are decoded
+			VertexLayout layout;
+			bool direct; // the staging layout is the layout, nothing to convert
+		};
+
+		struct Batch
+		{
+			const ElementPlan* plan = nullptr;
+			std::vector<uint8_t> raw;
+			uint32_t rows = 0;
+			uint64_t first = 0;     // row in the file
+			uint64_t firstFace = 0; // face rows, of the one the first triangle comes from
+			std::vector<uint8_t> staging;
+			std::vector<uint8_t> vertices;
+			std::vector<uint32_t> indices;
+			bool error = false;
+		};
+
+		uint32_t GetTypeSize(PlyType type)
+		{
+			switch (type)
+			{
+			case PlyType::Int8: return 1;
+			case PlyType::UInt8: return 1;
+			case PlyType::Int16: return 2;
+			case PlyType::UInt16: return 2;
+			case PlyType::Int32: return 4;
+			case PlyType::UInt32: return 4;
+			case PlyType::Float32: return 4;
+			case PlyType::Float64: return 8;
+			default: break;
+			}
+
+			return 0;
+		}
+
+		bool ParseType(const std::string& name, PlyType& type)
+		{
+			static const std::pair<const char*, PlyType> s_types[] =
+			{
+				{ "char", PlyType::Int8 }, { "int8", PlyType::Int8 },
+				{ "uchar", PlyType::UInt8 }, { "uint8", PlyType::UInt8 },
+				{ "short", PlyType::Int16 }, { "int16", PlyType::Int16 },
+				{ "ushort", PlyType::UInt16 }, { "uint16", PlyType::UInt16 },
+				{ "int", PlyType::Int32 }, { "int32", PlyType::Int32 },
+				{ "uint", PlyType::UInt32 }, { "uint32", PlyType::UInt32 },
+				{ "float", PlyType::Float32 }, { "float32", PlyType::Float32 },
+				{ "double", PlyType::Float64 }, { "float64", PlyType::Float64 }
+			};
+
+			for (const auto& entry : s_types)
+			{
+				if (name == entry.first)
+				{
+					type = entry.second;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		// colors stored as unsigned integers are normalized by the largest value
+		float GetNormalizeScale(PlyType type)
+		{
+			switch (type)
+			{
+			case PlyType::UInt8: return 1.0f / 255.0f;
+			case PlyType::UInt16: return 1.0f / 65535.0f;
+			case PlyType::UInt32: return static_cast<float>(1.0 / 4294967295.0);
+			default: break;
+			}
+
+			return 1.0f;
+		}
+
+		// false for the properties that aren't read
+		bool FindVertexComponent(const std::string& name, VertexSemantic& semantic, uint32_t& component)
+		{
+			struct Entry
+			{
+				const char* name;
+				VertexSemantic semantic;
+				uint32_t component;
+			};
+
+			static const Entry s_entries[] =
+			{
+				{ "x", VertexSemantic::Position, 0 }, { "y", VertexSemantic::Position, 1 }, { "z", VertexSemantic::Position, 2 },
+				{ "nx", VertexSemantic::Normal, 0 }, { "ny", VertexSemantic::Normal, 1 }, { "nz", VertexSemantic::Normal, 2 },
+				{ "u", VertexSemantic::TexCoord, 0 }, { "v", VertexSemantic::TexCoord, 1 },
+				{ "s", VertexSemantic::TexCoord, 0 }, { "t", VertexSemantic::TexCoord, 1 },
+				{ "texture_u", VertexSemantic::TexCoord, 0 }, { "texture_v", VertexSemantic::TexCoord, 1 },
+				{ "texture_s", VertexSemantic::TexCoord, 0 }, { "texture_t", VertexSemantic::TexCoord, 1 },
+				{ "red", VertexSemantic::Color, 0 }, { "green", VertexSemantic::Color, 1 },
+				{ "blue", VertexSemantic::Color, 2 }, { "alpha", VertexSemantic::Color, 3 }
+			};
+
+			for (const Entry& entry : s_entries)
+			{
+				if (name == entry.name)
+				{
+					semantic = entry.semantic;
+					component = entry.component;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		template<typename T>
+		double LoadAs(const uint8_t* bytes)
+		{
+			T value;
+			memcpy(&value, bytes, sizeof(T));
+			return static_cast<double>(value);
+		}
+
+		double LoadValue(PlyType type, const uint8_t* p, bool swap)
+		{
+			uint8_t bytes[8];
+			uint32_t size = GetTypeSize(type);
+			if (swap)
+			{
+				for (uint32_t i = 0; i < size; ++i)
+					bytes[i] = p[size - 1 - i];
+				p = bytes;
+			}
+
+			switch (type)
+			{
+			case PlyType::Int8: return LoadAs<int8_t>(p);
+			case PlyType::UInt8: return LoadAs<uint8_t>(p);
+			case PlyType::Int16: return LoadAs<int16_t>(p);
+			case PlyType::UInt16: return LoadAs<uint16_t>(p);
+			case PlyType::Int32: return LoadAs<int32_t>(p);
+			case PlyType::UInt32: return LoadAs<uint32_t>(p);
+			case PlyType::Float32: return LoadAs<float>(p);
+			case PlyType::Float64: return LoadAs<double>(p);
+			default: break;
+			}
+
+			return 0.0;
+		}
+
+		bool IsSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		const char* SkipSpaces(const char* p, const char* end)
+		{
+			while (p != end && IsSpace(*p))
+				++p;
+
+			return p;
+		}
+
+		// the next number of an ascii row, nullptr when there is none or it isn't followed by a space
+		const char* NextFloat(const char* p, const char* end, float& value)
+		{
+			p = ParseFloat(SkipSpaces(p, end), end, value);
+			return p && (p == end || IsSpace(*p)) ? p : nullptr;
+		}
+
+		const char* NextInt(const char* p, const char* end, int32_t& value)
+		{
+			p = ParseInt(SkipSpaces(p, end), end, value);
+			return p && (p == end || IsSpace(*p)) ? p : nullptr;
+		}
+
+		// [p, end) of the next non blank line, p is moved past it. False when there is none
+		bool NextLine(const char*& p, const char* end, const char*& line, const char*& lineEnd)
+		{
+			while (p != end)
+			{
+				const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+				line = p;
+				lineEnd = newline ? newline : end;
+				p = newline ? newline + 1 : end;
+
+				if (SkipSpaces(line, lineEnd) != lineEnd)
+					return true;
+			}
+
+			return false;
+		}
+
+		/// <summary>
+		/// File data read in blocks. The bytes from the read position stay contiguous, the buffer grows to hold
+		/// the largest batch cut from it.
+		/// </summary>
+		class PlyStream
+		{
+		public:
+			explicit PlyStream(std::istream& in)
+				: m_in(in), m_buffer(s_blockSize)
+			{
+			}
+
+			// at least count bytes from the read position, false when the file ends before
+			bool Ensure(size_t count)
+			{
+				while (m_end - m_begin < count)
+				{
+					if (m_eof)
+						return false;
+
+					if (m_begin > 0)
+					{
+						memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+						m_end -= m_begin;
+						m_begin = 0;
+					}
+
+					if (m_buffer.size() < count)
+						m_buffer.resize(std::max(count, m_buffer.size() * 2));
+
+					m_in.read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+					size_t read = static_cast<size_t>(m_in.gcount());
+					m_end += read;
+					m_eof = read == 0 || !m_in;
+				}
+
+				return true;
+			}
+
+			// reads more, false at the end of the file
+			bool Grow()
+			{
+				return Ensure(GetAvailable() + 1);
+			}
+
+			const char* GetData() const { return m_buffer.data() + m_begin; }
+			size_t GetAvailable() const { return m_end - m_begin; }
+			void Consume(size_t count) { m_begin += count; }
+
+		private:
+			std::istream& m_in;
+			std::vector<char> m_buffer;
+			size_t m_begin = 0;
+			size_t m_end = 0;
+			bool m_eof = false;
+		};
+
+		// the bytes of the next rows of an element, at most maxRows. False on truncated data
+		bool CutRows(PlyStream& stream, const ElementPlan& plan, PlyFormat format, bool swap, uint32_t maxRows, size_t& bytes, uint32_t& rows)
+		{
+			bytes = 0;
+			rows = 0;
+
+			if (format == PlyFormat::Ascii)
+			{
+				while (rows < maxRows)
+				{
+					const char* data = stream.GetData();
+					size_t available = stream.GetAvailable();
+					const char* newline = static_cast<const char*>(memchr(data + bytes, '\n', available - bytes));
+					size_t lineEnd, next;
+					if (newline)
+					{
+						lineEnd = newline - data;
+						next = lineEnd + 1;
+					}
+					else if (stream.Grow())
+					{
+						continue;
+					}
+					else if (bytes < available)
+					{
+						// the last line without a newline
+						lineEnd = next = available;
+					}
+					else
+					{
+						return false;
+					}
+
+					if (SkipSpaces(data + bytes, data + lineEnd) != data + lineEnd)
+						rows++;
+					bytes = next;
+				}
+
+				return true;
+			}
+
+			if (plan.rowSize > 0)
+			{
+				rows = maxRows;
+				bytes = static_cast<size_t>(maxRows) * plan.rowSize;
+				return stream.Ensure(bytes);
+			}
+
+			const std::vector<PlyProperty>& properties = plan.element->properties;
+			for (; rows < maxRows; ++rows)
+			{
+				for (const PlyProperty& property : properties)
+				{
+					if (!property.list)
+					{
+						bytes += GetTypeSize(property.type);
+						continue;
+					}
+
+					uint32_t countSize = GetTypeSize(property.countType);
+					if (!stream.Ensure(bytes + countSize))
+						return false;
+
+					double count = LoadValue(property.countType, reinterpret_cast<const uint8_t*>(stream.GetData() + bytes), swap);
+					if (count < 0.0)
+						return false;
+
+					bytes += countSize + static_cast<size_t>(count) * GetTypeSize(property.type);
+				}
+			}
+
+			return stream.Ensure(bytes);
+		}
+
+		void DecodeVertices(const DecodeContext& context, Batch& batch)
+		{
+			const ElementPlan& plan = *batch.plan;
+			const std::vector<PlyProperty>& properties = plan.element->properties;
+			uint32_t stagingFloats = static_cast<uint32_t>(context.defaults.size());
+
+			std::vector<uint8_t>& stagingBytes = context.direct ? batch.vertices : batch.staging;
+			stagingBytes.resize(static_cast<size_t>(batch.rows) * stagingFloats * sizeof(float));
+			float* staging = reinterpret_cast<float*>(stagingBytes.data());
+
+			if (context.format == PlyFormat::Ascii)
+			{
+				const char* p = reinterpret_cast<const char*>(batch.raw.data());
+				const char* end = p + batch.raw.size();
+				for (uint32_t row = 0; row < batch.rows; ++row)
+				{
+					float* vertex = staging + static_cast<size_t>(row) * stagingFloats;
+					std::copy(context.defaults.begin(), context.defaults.end(), vertex);
+
+					const char* line;
+					const char* lineEnd;
+					if (!NextLine(p, end, line, lineEnd))
+						line = nullptr;
+					for (size_t i = 0; i < properties.size() && line; ++i)
+					{
+						float value;
+						if (properties[i].list)
+						{
+							int32_t count;
+							line = NextInt(line, lineEnd, count);
+							for (int32_t item = 0; item < count && line; ++item)
+								line = NextFloat(line, lineEnd, value);
+							continue;
+						}
+
+						line = NextFloat(line, lineEnd, value);
+						if (line && plan.properties[i].slot != s_skip)
+							vertex[plan.properties[i].slot] = value * plan.properties[i].scale;
+					}
+
+					if (!line)
+					{
+						batch.error = true;
+						return;
+					}
+				}
+			}
+			else
+			{
+				const uint8_t* p = batch.raw.data();
+				for (uint32_t row = 0; row < batch.rows; ++row)
+				{
+					float* vertex = staging + static_cast<size_t>(row) * stagingFloats;
+					std::copy(context.defaults.begin(), context.defaults.end(), vertex);
+
+					for (size_t i = 0; i < properties.size(); ++i)
+					{
+						if (properties[i].list)
+						{
+							double count = LoadValue(properties[i].countType, p, context.swap);
+							p += GetTypeSize(properties[i].countType) + static_cast<size_t>(count) * GetTypeSize(properties[i].type);
+							continue;
+						}
+
+						if (plan.properties[i].slot != s_skip)
+							vertex[plan.properties[i].slot] = static_cast<float>(LoadValue(properties[i].type, p, context.swap)) * plan.properties[i].scale;
+						p += GetTypeSize(properties[i].type);
+					}
+				}
+			}
+
+			if (!context.direct)
+			{
+				batch.vertices.resize(static_cast<size_t>(batch.rows) * context.layout.GetStride());
+				ConvertVertices(context.stagingLayout, staging, context.layout, batch.vertices.data(), batch.rows, false);
+			}
+		}
+
+		// a face index, false when out of range
+		bool EmitIndex(const DecodeContext& context, double index, uint32_t corner, uint32_t& first, uint32_t& previous, std::vector<uint32_t>& indices)
+		{
+			if (index < 0.0 || index >= static_cast<double>(context.vertexCount))
+				return false;
+
+			uint32_t v = static_cast<uint32_t>(index);
+			if (corner == 0)
+			{
+				first = v;
+			}
+			else if (corner >= 2)
+			{
+				indices.push_back(first);
+				indices.push_back(previous);
+				indices.push_back(v);
+			}
+
+			previous = v;
+			return true;
+		}
+
+		void DecodeFaces(const DecodeContext& context, Batch& batch)
+		{
+			const ElementPlan& plan = *batch.plan;
+			const std::vector<PlyProperty>& properties = plan.element->properties;
+			batch.indices.clear();
+			batch.firstFace = batch.first;
+
+			uint32_t first = 0, previous = 0;
+			if (context.format == PlyFormat::Ascii)
+			{
+				const char* p = reinterpret_cast<const char*>(batch.raw.data());
+				const char* end = p + batch.raw.size();
+				for (uint32_t row = 0; row < batch.rows; ++row)
+				{
+					const char* line;
+					const char* lineEnd;
+					if (!NextLine(p, end, line, lineEnd))
+						line = nullptr;
+					for (size_t i = 0; i < properties.size() && line; ++i)
+					{
+						float value;
+						if (!properties[i].list)
+						{
+							line = NextFloat(line, lineEnd, value);
+							continue;
+						}
+
+						int32_t count;
+						line = NextInt(line, lineEnd, count);
+						for (int32_t item = 0; item < count && line; ++item)
+						{
+							if (i != plan.indexProperty)
+							{
+								line = NextFloat(line, lineEnd, value);
+								continue;
+							}
+
+							int32_t index;
+							line = NextInt(line, lineEnd, index);
+							if (line && !EmitIndex(context, index, item, first, previous, batch.indices))
+								line = nullptr;
+						}
+					}
+
+					if (!line)
+					{
+						batch.error = true;
+						return;
+					}
+
+					// faces with less than 3 vertices emit no triangle
+					if (batch.indices.empty())
+						batch.firstFace = batch.first + row + 1;
+				}
+			}
+			else
+			{
+				const uint8_t* p = batch.raw.data();
+				for (uint32_t row = 0; row < batch.rows; ++row)
+				{
+					for (size_t i = 0; i < properties.size(); ++i)
+					{
+						uint32_t size = GetTypeSize(properties[i].type);
+						if (!properties[i].list)
+						{
+							p += size;
+							continue;
+						}
+
+						uint32_t count = static_cast<uint32_t>(LoadValue(properties[i].countType, p, context.swap));
+						p += GetTypeSize(properties[i].countType);
+						if (i != plan.indexProperty)
+						{
+							p += static_cast<size_t>(count) * size;
+							continue;
+						}
+
+						for (uint32_t item = 0; item < count; ++item, p += size)
+						{
+							if (!EmitIndex(context, LoadValue(properties[i].type, p, context.swap), item, first, previous, batch.indices))
+							{
+								batch.error = true;
+								return;
+							}
+						}
+					}
+
+					if (batch.indices.empty())
+						batch.firstFace = batch.first + row + 1;
+				}
+			}
+		}
+
+		bool ReadHeader(std::istream& in, PlyHeader& header)
+		{
+			std::string line;
+			if (!std::getline(in, line) || line.compare(0, 3, "ply") != 0 || line.find_first_not_of(" \t\r", 3) != std::string::npos)
+				return false;
+
+			bool hasFormat = false;
+			while (std::getline(in, line))
+			{
+				std::istringstream tokens(line);
+				std::string keyword;
+				tokens >> keyword;
+
+				if (keyword == "end_header")
+					return hasFormat;
+
+				if (keyword.empty() || keyword == "comment" || keyword == "obj_info")
+					continue;
+
+				if (keyword == "format")
+				{
+					std::string format, version;
+					tokens >> format >> version;
+					if (version != "1.0")
+						return false;
+
+					if (format == "ascii")
+						header.format = PlyFormat::Ascii;
+					else if (format == "binary_little_endian")
+						header.format = PlyFormat::BinaryLittleEndian;
+					else if (format == "binary_big_endian")
+						header.format = PlyFormat::BinaryBigEndian;
+					else
+						return false;
+
+					hasFormat = true;
+				}
+				else if (keyword == "element")
+				{
+					PlyElement element;
+					if (!(tokens >> element.name >> element.count))
+						return false;
+
+					if (element.name == "vertex")
+						header.vertexCount = element.count;
+					else if (element.name == "face")
+						header.faceCount = element.count;
+
+					header.elements.push_back(element);
+				}
+				else if (keyword == "property")
+				{
+					if (header.elements.empty())
+						return false;
+
+					PlyProperty property;
+					std::string type;
+					tokens >> type;
+					if (type == "list")
+					{
+						std::string countType;
+						tokens >> countType >> type;
+						property.list = true;
+						if (!ParseType(countType, property.countType) || property.countType == PlyType::Float32 || property.countType == PlyType::Float64)
+							return false;
+					}
+
+					if (!ParseType(type, property.type) || !(tokens >> property.name))
+						return false;
+
+					header.elements.back().properties.push_back(property);
+				}
+				else
+				{
+					return false;
+				}
+			}
+
+			return false;
+		}
+	}
+
+	bool PlyReader::Open(const std::string& filename)
+	{
+		Close();
+
+		m_file.open(filename, std::ios::in | std::ios::binary);
+		if (!m_file)
+			return false;
+
+		if (!ReadHeader(m_file, m_header))
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void PlyReader::Close()
+	{
+		m_file.close();
+		m_file.clear();
+		m_header = PlyHeader();
+	}
+
+	const PlyHeader& PlyReader::GetHeader() const
+	{
+		return m_header;
+	}
+
+	bool PlyReader::Read(const std::function<void(const PlyVertexBatch&)>& onVertices, const std::function<void(const PlyTriangleBatch&)>& onTriangles, const PlyReadDesc& desc)
+	{
+		if (!m_file.is_open())
+			return false;
+
+		// faces of more vertices than 32 bit indices can address can't be read
+		if (onTriangles && m_header.faceCount > 0 && m_header.vertexCount > (1ull << 32))
+			return false;
+
+		DecodeContext context;
+		context.format = m_header.format;
+		context.swap = m_header.format == PlyFormat::BinaryBigEndian;
+		context.vertexCount = m_header.vertexCount;
+		context.layout = desc.layout;
+
+		std::vector<ElementPlan> plans(m_header.elements.size());
+		for (size_t e = 0; e < m_header.elements.size(); ++e)
+		{
+			const PlyElement& element = m_header.elements[e];
+			ElementPlan& plan = plans[e];
+			plan.element = &element;
+			plan.properties.resize(element.properties.size());
+
+			bool hasList = false;
+			for (size_t i = 0; i < element.properties.size(); ++i)
+			{
+				const PlyProperty& property = element.properties[i];
+				hasList |= property.list;
+				plan.rowSize += GetTypeSize(property.type);
+
+				if (element.name == "face" && property.list && (property.name == "vertex_indices" || property.name == "vertex_index"))
+					plan.indexProperty = static_cast<uint32_t>(i);
+			}
+
+			if (hasList || context.format == PlyFormat::Ascii)
+				plan.rowSize = 0;
+
+			if (element.name == "vertex" && onVertices)
+				plan.kind = ElementKind::Vertices;
+			else if (element.name == "face" && onTriangles && plan.indexProperty != s_skip)
+				plan.kind = ElementKind::Faces;
+
+			if (plan.kind != ElementKind::Vertices)
+				continue;
+
+			// a Float4 per semantic both in the file and the layout, in the order of the semantics
+			uint32_t stagingIndex[static_cast<uint32_t>(VertexSemantic::Count)];
+			for (uint32_t s = 0; s < static_cast<uint32_t>(VertexSemantic::Count); ++s)
+			{
+				stagingIndex[s] = s_skip;
+
+				VertexSemantic semantic = static_cast<VertexSemantic>(s);
+				bool found = false;
+				for (const PlyProperty& property : element.properties)
+				{
+					VertexSemantic propertySemantic;
+					uint32_t component;
+					found |= !property.list && FindVertexComponent(property.name, propertySemantic, component) && propertySemantic == semantic;
+				}
+
+				if (!found || !desc.layout.Has(semantic))
+					continue;
+
+				stagingIndex[s] = context.stagingLayout.GetAttributeCount();
+				context.stagingLayout.Add(semantic, VertexFormat::Float4);
+
+				float w = semantic == VertexSemantic::Position || semantic == VertexSemantic::Color ? 1.0f : 0.0f;
+				context.defaults.insert(context.defaults.end(), { 0.0f, 0.0f, 0.0f, w });
+			}
+
+			for (size_t i = 0; i < element.properties.size(); ++i)
+			{
+				VertexSemantic semantic;
+				uint32_t component;
+				const PlyProperty& property = element.properties[i];
+				if (property.list || !FindVertexComponent(property.name, semantic, component) || stagingIndex[static_cast<uint32_t>(semantic)] == s_skip)
+					continue;
+
+				plan.properties[i].slot = stagingIndex[static_cast<uint32_t>(semantic)] * 4 + component;
+				if (semantic == VertexSemantic::Color)
+					plan.properties[i].scale = GetNormalizeScale(property.type);
+			}
+		}
+
+		context.direct = context.stagingLayout == desc.layout;
+
+		bool parallel = desc.multithreaded && JobSystem::GetThreadCount() > 1;
+		uint32_t slotCount = 1;
+		if (parallel)
+			slotCount = desc.maxBatchesInFlight > 0 ? desc.maxBatchesInFlight : 2 * JobSystem::GetThreadCount();
+
+		// the groups go first on the way out, waiting for the tasks still decoding into the batches
+		std::vector<Batch> batches(slotCount);
+		std::unique_ptr<TaskGroup[]> groups(new TaskGroup[slotCount]);
+		uint64_t issued = 0;
+		uint64_t delivered = 0;
+
+		auto deliver = [&]()
+		{
+			uint32_t slot = static_cast<uint32_t>(delivered++ % slotCount);
+			groups[slot].Wait();
+
+			const Batch& batch = batches[slot];
+			if (batch.error)
+				return false;
+
+			if (batch.plan->kind == ElementKind::Vertices)
+				onVertices({ batch.vertices.data(), batch.rows, batch.first });
+			else
+				onTriangles({ batch.indices.data(), static_cast<uint32_t>(batch.indices.size()), batch.firstFace });
+
+			return true;
+		};
+
+		PlyStream stream(m_file);
+		uint32_t batchSize = std::max(desc.batchSize, 1u);
+		bool ok = true;
+		for (size_t e = 0; e < plans.size() && ok; ++e)
+		{
+			const ElementPlan& plan = plans[e];
+			uint64_t first = 0;
+			while (first < plan.element->count)
+			{
+				if (plan.kind != ElementKind::Skipped && issued - delivered == slotCount && !deliver())
+				{
+					ok = false;
+					break;
+				}
+
+				size_t bytes;
+				uint32_t rows;
+				uint32_t maxRows = static_cast<uint32_t>(std::min<uint64_t>(plan.element->count - first, batchSize));
+				if (!CutRows(stream, plan, context.format, context.swap, maxRows, bytes, rows))
+				{
+					ok = false;
+					break;
+				}
+
+				if (plan.kind != ElementKind::Skipped)
+				{
+					uint32_t slot = static_cast<uint32_t>(issued++ % slotCount);
+					Batch& batch = batches[slot];
+					batch.plan = &plan;
+					batch.raw.assign(stream.GetData(), stream.GetData() + bytes);
+					batch.rows = rows;
+					batch.first = first;
+					batch.error = false;
+
+					auto decode = [&context, &batch]()
+					{
+						if (batch.plan->kind == ElementKind::Vertices)
+							DecodeVertices(context, batch);
+						else
+							DecodeFaces(context, batch);
+					};
+
+					if (parallel)
+						groups[slot].Run(decode);
+					else
+						decode();
+				}
+
+				stream.Consume(bytes);
+				first += rows;
+			}
+		}
+
+		while (ok && delivered < issued)
+			ok = deliver();
+
+		for (uint32_t slot = 0; slot < slotCount; ++slot)
+			groups[slot].Wait();
+
+		return ok;
+	}
+
+	bool PlyReader::Load(const std::string& filename, std::vector<Vector>& positions, std::vector<uint32_t>* indices, bool multithreaded)
+	{
+		static_assert(sizeof(Vector) == 4 * sizeof(float), "Vector isn't 4 packed floats");
+
+		positions.clear();
+		if (indices)
+			indices->clear();
+
+		PlyReader reader;
+		if (!reader.Open(filename))
+			return false;
+
+		PlyReadDesc desc;
+		desc.multithreaded = multithreaded;
+
+		positions.resize(static_cast<size_t>(reader.GetHeader().vertexCount), Vector(0.0f, 0.0f, 0.0f, 1.0f));
+		auto onVertices = [&positions](const PlyVertexBatch& batch)
+		{
+			memcpy(positions.data() + batch.first, batch.vertices, static_cast<size_t>(batch.count) * sizeof(Vector));
+		};
+
+		std::function<void(const PlyTriangleBatch&)> onTriangles;
+		if (indices)
+		{
+			onTriangles = [indices](const PlyTriangleBatch& batch)
+			{
+				indices->insert(indices->end(), batch.indices, batch.indices + batch.indexCount);
+			};
+		}
+
+		if (!reader.Read(onVertices, onTriangles, desc))
+		{
+			positions.clear();
+			if (indices)
+				indices->clear();
+			return false;
+		}
+
+		return true;
+	}
+}
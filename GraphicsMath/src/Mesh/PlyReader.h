@@ -0,0 +1,114 @@
+#pragma once
+
+#include "VertexLayout.h"
+#include "Math/Types.h"
+
+#include <fstream>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace GM
+{
+	enum class PlyFormat : uint8_t
+	{
+		Ascii,
+		BinaryLittleEndian,
+		BinaryBigEndian
+	};
+
+	enum class PlyType : uint8_t
+	{
+		Int8,
+		UInt8,
+		Int16,
+		UInt16,
+		Int32,
+		UInt32,
+		Float32,
+		Float64
+	};
+
+	struct PlyProperty
+	{
+		std::string name;
+		PlyType type = PlyType::Float32; // of the items for lists
+		bool list = false;
+		PlyType countType = PlyType::UInt8;
+	};
+
+	struct PlyElement
+	{
+		std::string name;
+		uint64_t count = 0;
+		std::vector<PlyProperty> properties;
+	};
+
+	struct PlyHeader
+	{
+		PlyFormat format = PlyFormat::Ascii;
+		std::vector<PlyElement> elements;
+		uint64_t vertexCount = 0;
+		uint64_t faceCount = 0;
+	};
+
+	struct PlyReadDesc
+	{
+		VertexLayout layout = VertexLayout().Add(VertexSemantic::Position, VertexFormat::Float4); // of the vertex batches, a Vector per vertex by default
+		uint32_t batchSize = 65536;      // vertices or faces decoded together
+		uint32_t maxBatchesInFlight = 0; // 0: 2 per thread. Memory stays around batchSize * row size * this
+		bool multithreaded = true;
+	};
+
+	struct PlyVertexBatch
+	{
+		const void* vertices; // in the layout of the PlyReadDesc
+		uint32_t count;
+		uint64_t first; // index of the first vertex in the file
+	};
+
+	struct PlyTriangleBatch
+	{
+		const uint32_t* indices; // triangle list, polygons triangulated as fans
+		uint32_t indexCount;
+		uint64_t firstFace; // index in the file of the face the first triangle comes from
+	};
+
+	/// <summary>
+	/// Streaming reader of PLY point clouds and meshes, ascii, binary little endian and binary big endian.
+	/// The vertex element's x y z, nx ny nz, u v (s t, texture_u texture_v) and red green blue alpha properties
+	/// map to the semantics of the layout, unsigned integer colors are normalized. Faces are read from their
+	/// vertex_indices (or vertex_index) list, other elements and properties are skipped.
+	///
+	/// Read is a bounded pipeline: the calling thread reads the file into batches of rows, workers decode
+	/// and convert them, and the calling thread hands the results to the callbacks in file order. At most
+	/// maxBatchesInFlight batches exist at once, so files of any size are processed in constant memory.
+	/// Ascii rows are expected one per line.
+	/// </summary>
+	class PlyReader
+	{
+	public:
+		PlyReader() = default;
+
+		// opens the file and reads the header. False when the file can't be opened or the header isn't valid PLY
+		bool Open(const std::string& filename);
+		void Close();
+
+		const PlyHeader& GetHeader() const;
+
+		/// <summary>
+		/// Streams the data after the header once, in file order, on the calling thread. Either callback can be
+		/// empty to skip its element. The batches are only valid during the callback. False on truncated or
+		/// malformed data or a face index out of range, after the batches before the error were delivered.
+		/// </summary>
+		bool Read(const std::function<void(const PlyVertexBatch&)>& onVertices, const std::function<void(const PlyTriangleBatch&)>& onTriangles, const PlyReadDesc& desc = PlyReadDesc());
+
+		// the whole file: positions with w = 1 and optionally the triangles
+		static bool Load(const std::string& filename, std::vector<Vector>& positions, std::vector<uint32_t>* indices = nullptr, bool multithreaded = true);
+
+	private:
+		std::ifstream m_file;
+		PlyHeader m_header;
+	};
+}
@@ -0,0 +1,411 @@
+#include "TangentFrames.h"
+#include "VertexConversion.h"
+#include "VertexWelder.h"
+#include "Core/JobSystem.h"
+#include "Math/Functions.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <vector>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_grainSize = 4096;
+
+		struct Float2
+		{
+			float x, y;
+		};
+
+		struct Float3
+		{
+			float x, y, z;
+		};
+
+		Float3 operator+(const Float3& a, const Float3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+		Float3 operator-(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+		Float3 operator*(const Float3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+
+		float Dot(const Float3& a, const Float3& b)
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		Float3 Cross(const Float3& a, const Float3& b)
+		{
+			return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		}
+
+		// zero vectors stay zero
+		Float3 Normalize(const Float3& v)
+		{
+			float lengthSq = Dot(v, v);
+			return lengthSq > 0.0f ? v * (1.0f / sqrtf(lengthSq)) : Float3{ 0.0f, 0.0f, 0.0f };
+		}
+
+		float Angle(const Float3& a, const Float3& b)
+		{
+			return acosf(std::min(std::max(Dot(Normalize(a), Normalize(b)), -1.0f), 1.0f));
+		}
+
+		// any unit vector perpendicular to n
+		Float3 Perpendicular(const Float3& n)
+		{
+			Float3 axis = fabsf(n.x) < 0.9f ? Float3{ 1.0f, 0.0f, 0.0f } : Float3{ 0.0f, 1.0f, 0.0f };
+			return Normalize(Cross(n, axis));
+		}
+
+		bool IsParallel(const TangentFrameDesc& desc, uint32_t count)
+		{
+			return desc.multithreaded && JobSystem::GetThreadCount() > 1 && count >= desc.parallelThreshold;
+		}
+
+		void ParallelChunks(uint32_t count, bool parallel, const std::function<void(uint32_t first, uint32_t last)>& fn)
+		{
+			uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(count, s_grainSize) : 1;
+			JobSystem::ParallelForChunks(count, chunkCount, [&](uint32_t, uint32_t first, uint32_t last) { fn(first, last); });
+		}
+
+		// one attribute of the layout alone, at its offset in the full stride
+		VertexLayout GetAttributeLayout(const VertexLayout& layout, VertexSemantic semantic)
+		{
+			const VertexAttribute* attribute = layout.Find(semantic);
+			assert(attribute && "Vertex layout is missing an attribute the tangent frames need");
+
+			VertexLayout result;
+			result.Add(semantic, attribute->format, attribute->offset).SetStride(layout.GetStride());
+			return result;
+		}
+
+		// T: Float2 or Float3 matching format
+		template<typename T>
+		std::vector<T> ReadAttribute(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, VertexSemantic semantic, VertexFormat format, bool parallel)
+		{
+			std::vector<T> values(vertexCount);
+			ConvertVertices(GetAttributeLayout(layout, semantic), vertices, VertexLayout().Add(semantic, format), values.data(), vertexCount, parallel);
+			return values;
+		}
+
+		void WriteAttribute(const VertexLayout& layout, void* vertices, uint32_t vertexCount, VertexSemantic semantic, VertexFormat format, const void* values, bool parallel)
+		{
+			ConvertVertices(VertexLayout().Add(semantic, format), values, GetAttributeLayout(layout, semantic), vertices, vertexCount, parallel);
+		}
+
+		// normals of an octahedral layout read through their 2 components
+		std::vector<Float3> ReadNormals(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, bool octahedral, bool parallel)
+		{
+			if (!octahedral)
+				return ReadAttribute<Float3>(layout, vertices, vertexCount, VertexSemantic::Normal, VertexFormat::Float3, parallel);
+
+			std::vector<Float2> oct = ReadAttribute<Float2>(layout, vertices, vertexCount, VertexSemantic::Normal, VertexFormat::Float2, parallel);
+			std::vector<Float3> normals(vertexCount);
+			TangentFrames::DecodeOctahedral(&oct[0].x, vertexCount, &normals[0].x, 3);
+			return normals;
+		}
+
+		// corners[offsets[id], offsets[id + 1]) are the corners of the vertices with that id, in index order
+		struct CornerAdjacency
+		{
+			std::vector<uint32_t> ids; // per vertex
+			uint32_t idCount = 0;
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> corners;
+		};
+
+		// ids must be filled, a counting sort of the corners by id
+		void BuildCorners(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, CornerAdjacency& adjacency)
+		{
+			adjacency.offsets.assign(static_cast<size_t>(adjacency.idCount) + 1, 0);
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				assert(indices[i] < vertexCount && "Index out of range");
+				++adjacency.offsets[adjacency.ids[indices[i]] + 1];
+			}
+
+			for (uint32_t id = 0; id < adjacency.idCount; ++id)
+				adjacency.offsets[id + 1] += adjacency.offsets[id];
+
+			std::vector<uint32_t> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+			adjacency.corners.resize(indexCount);
+			for (uint32_t i = 0; i < indexCount; ++i)
+				adjacency.corners[cursors[adjacency.ids[indices[i]]]++] = i;
+		}
+
+		// every vertex its own id
+		void BuildVertexCorners(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, CornerAdjacency& adjacency)
+		{
+			adjacency.ids.resize(vertexCount);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+				adjacency.ids[v] = v;
+
+			adjacency.idCount = vertexCount;
+			BuildCorners(indices, indexCount, vertexCount, adjacency);
+		}
+
+		// vertices with the same bits in the attributes of weldLayout share an id
+		void BuildWeldedCorners(const VertexLayout& weldLayout, const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, bool parallel, CornerAdjacency& adjacency)
+		{
+			WeldDesc weldDesc;
+			weldDesc.multithreaded = parallel;
+			weldDesc.parallelThreshold = 0;
+
+			adjacency.ids.resize(vertexCount);
+			adjacency.idCount = VertexWelder::GenerateRemap(weldLayout, vertices, vertexCount, adjacency.ids.data(), weldDesc);
+			BuildCorners(indices, indexCount, vertexCount, adjacency);
+		}
+	}
+
+	void TangentFrames::GenerateNormals(const VertexLayout& layout, void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const TangentFrameDesc& desc)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+		assert((!desc.octahedral || GetFormatComponentCount(layout.Find(VertexSemantic::Normal)->format) == 2) && "Octahedral normals need a 2 component format");
+
+		if (vertexCount == 0)
+			return;
+
+		bool parallel = IsParallel(desc, std::max(vertexCount, indexCount / 3));
+		std::vector<Float3> positions = ReadAttribute<Float3>(layout, vertices, vertexCount, VertexSemantic::Position, VertexFormat::Float3, parallel);
+
+		// per face: unit normal, and the weight of every corner times the normal
+		uint32_t triangleCount = indexCount / 3;
+		std::vector<Float3> faceNormals(triangleCount);
+		std::vector<Float3> cornerTerms(indexCount);
+		ParallelChunks(triangleCount, parallel, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t t = first; t < last; ++t)
+				{
+					const uint32_t* triangle = indices + t * 3;
+					const Float3& p0 = positions[triangle[0]];
+					const Float3& p1 = positions[triangle[1]];
+					const Float3& p2 = positions[triangle[2]];
+
+					// twice the area long
+					Float3 normal = Cross(p1 - p0, p2 - p0);
+					Float3 unit = Normalize(normal);
+					faceNormals[t] = unit;
+
+					if (desc.weighting == NormalWeighting::Area)
+					{
+						cornerTerms[t * 3 + 0] = cornerTerms[t * 3 + 1] = cornerTerms[t * 3 + 2] = normal;
+					}
+					else
+					{
+						cornerTerms[t * 3 + 0] = unit * Angle(p1 - p0, p2 - p0);
+						cornerTerms[t * 3 + 1] = unit * Angle(p2 - p1, p0 - p1);
+						cornerTerms[t * 3 + 2] = unit * Angle(p0 - p2, p1 - p2);
+					}
+				}
+			});
+
+		CornerAdjacency vertexCorners;
+		BuildVertexCorners(indices, indexCount, vertexCount, vertexCorners);
+
+		CornerAdjacency positionCorners;
+		BuildWeldedCorners(GetAttributeLayout(layout, VertexSemantic::Position), vertices, vertexCount, indices, indexCount, parallel, positionCorners);
+
+		bool creases = desc.creaseAngle < 180.0f;
+		float minCos = cosf(ToRadians(desc.creaseAngle));
+
+		std::vector<Float3> normals(vertexCount);
+		ParallelChunks(vertexCount, parallel, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t v = first; v < last; ++v)
+				{
+					// the direction of the vertex's own faces, the fallback for vertices with only degenerate faces
+					Float3 own = { 0.0f, 0.0f, 0.0f };
+					for (uint32_t i = vertexCorners.offsets[v]; i < vertexCorners.offsets[v + 1]; ++i)
+						own = own + faceNormals[vertexCorners.corners[i] / 3];
+
+					own = Normalize(own);
+
+					uint32_t id = positionCorners.ids[v];
+					Float3 sum = { 0.0f, 0.0f, 0.0f };
+					for (uint32_t i = positionCorners.offsets[id]; i < positionCorners.offsets[id + 1]; ++i)
+					{
+						uint32_t corner = positionCorners.corners[i];
+						if (!creases || Dot(faceNormals[corner / 3], own) >= minCos)
+							sum = sum + cornerTerms[corner];
+					}
+
+					Float3 normal = Normalize(sum);
+					if (Dot(normal, normal) == 0.0f)
+						normal = Dot(own, own) > 0.0f ? own : Float3{ 0.0f, 1.0f, 0.0f };
+
+					normals[v] = normal;
+				}
+			});
+
+		if (desc.octahedral)
+		{
+			std::vector<float> oct(static_cast<size_t>(vertexCount) * 2);
+			EncodeOctahedral(&normals[0].x, vertexCount, 3, oct.data());
+			WriteAttribute(layout, vertices, vertexCount, VertexSemantic::Normal, VertexFormat::Float2, oct.data(), parallel);
+		}
+		else
+		{
+			WriteAttribute(layout, vertices, vertexCount, VertexSemantic::Normal, VertexFormat::Float3, normals.data(), parallel);
+		}
+	}
+
+	void TangentFrames::GenerateTangents(const VertexLayout& layout, void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const TangentFrameDesc& desc)
+	{
+		assert(indexCount % 3 == 0 && "Index count isn't a multiple of 3");
+		assert(layout.Has(VertexSemantic::Tangent) && "Vertex layout has no tangents");
+
+		if (vertexCount == 0)
+			return;
+
+		bool parallel = IsParallel(desc, std::max(vertexCount, indexCount / 3));
+		std::vector<Float3> positions = ReadAttribute<Float3>(layout, vertices, vertexCount, VertexSemantic::Position, VertexFormat::Float3, parallel);
+		std::vector<Float3> normals = ReadNormals(layout, vertices, vertexCount, desc.octahedral, parallel);
+
+		std::vector<Float2> texCoords = ReadAttribute<Float2>(layout, vertices, vertexCount, VertexSemantic::TexCoord, VertexFormat::Float2, parallel);
+
+		// MikkTSpace's face tangent: the direction of increasing u, and whether the texcoords are mirrored
+		uint32_t triangleCount = indexCount / 3;
+		std::vector<Float3> faceTangents(triangleCount);
+		std::vector<uint8_t> preserving(triangleCount);
+		ParallelChunks(triangleCount, parallel, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t t = first; t < last; ++t)
+				{
+					const uint32_t* triangle = indices + t * 3;
+					Float3 d1 = positions[triangle[1]] - positions[triangle[0]];
+					Float3 d2 = positions[triangle[2]] - positions[triangle[0]];
+					Float2 t21 = { texCoords[triangle[1]].x - texCoords[triangle[0]].x, texCoords[triangle[1]].y - texCoords[triangle[0]].y };
+					Float2 t31 = { texCoords[triangle[2]].x - texCoords[triangle[0]].x, texCoords[triangle[2]].y - texCoords[triangle[0]].y };
+
+					// the u gradient scaled by the signed texcoord area, flipped back for mirrored faces
+					float signedArea = t21.x * t31.y - t21.y * t31.x;
+					preserving[t] = signedArea > 0.0f;
+					faceTangents[t] = Normalize(d1 * t31.y - d2 * t21.y) * (preserving[t] ? 1.0f : -1.0f);
+				}
+			});
+
+		// MikkTSpace shares the tangent space of vertices with the same position, normal and texcoord
+		VertexLayout weldLayout;
+		for (VertexSemantic semantic : { VertexSemantic::Position, VertexSemantic::Normal, VertexSemantic::TexCoord })
+		{
+			const VertexAttribute* attribute = layout.Find(semantic);
+			assert(attribute && "Vertex layout is missing an attribute the tangents need");
+			weldLayout.Add(semantic, attribute->format, attribute->offset);
+		}
+		weldLayout.SetStride(layout.GetStride());
+
+		CornerAdjacency adjacency;
+		BuildWeldedCorners(weldLayout, vertices, vertexCount, indices, indexCount, parallel, adjacency);
+
+		// per welded vertex, then copied to every vertex of it
+		uint32_t idCount = adjacency.idCount;
+		std::vector<float> idTangents(static_cast<size_t>(idCount) * 4);
+		std::vector<uint32_t> idVertex(idCount);
+		for (uint32_t v = vertexCount; v-- > 0;)
+			idVertex[adjacency.ids[v]] = v;
+
+		ParallelChunks(idCount, parallel, [&](uint32_t first, uint32_t last)
+			{
+				for (uint32_t id = first; id < last; ++id)
+				{
+					const Float3& n = normals[idVertex[id]];
+
+					// the two orientations apart, weighted by the corner angle in the plane of the normal
+					Float3 sums[2] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+					float weights[2] = { 0.0f, 0.0f };
+					for (uint32_t i = adjacency.offsets[id]; i < adjacency.offsets[id + 1]; ++i)
+					{
+						uint32_t corner = adjacency.corners[i];
+						uint32_t t = corner / 3;
+						const uint32_t* triangle = indices + t * 3;
+						const Float3& p = positions[triangle[corner % 3]];
+						Float3 e1 = positions[triangle[(corner + 2) % 3]] - p;
+						Float3 e2 = positions[triangle[(corner + 1) % 3]] - p;
+						e1 = e1 - n * Dot(n, e1);
+						e2 = e2 - n * Dot(n, e2);
+
+						Float3 tangent = Normalize(faceTangents[t] - n * Dot(n, faceTangents[t]));
+						float angle = Angle(e1, e2);
+						sums[preserving[t]] = sums[preserving[t]] + tangent * angle;
+						weights[preserving[t]] += angle;
+					}
+
+					uint32_t side = weights[1] >= weights[0] ? 1 : 0;
+					Float3 tangent = Normalize(sums[side]);
+					if (Dot(tangent, tangent) == 0.0f)
+						tangent = Perpendicular(n);
+
+					float* out = idTangents.data() + static_cast<size_t>(id) * 4;
+					out[0] = tangent.x;
+					out[1] = tangent.y;
+					out[2] = tangent.z;
+					out[3] = side ? 1.0f : -1.0f;
+				}
+			});
+
+		std::vector<float> tangents(static_cast<size_t>(vertexCount) * 4);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			std::copy_n(idTangents.data() + static_cast<size_t>(adjacency.ids[v]) * 4, 4, tangents.data() + static_cast<size_t>(v) * 4);
+
+		// xyz to octahedral xy, z zero, the sign stays in w
+		if (desc.octahedral)
+		{
+			std::vector<float> oct(static_cast<size_t>(vertexCount) * 2);
+			EncodeOctahedral(tangents.data(), vertexCount, 4, oct.data());
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				tangents[v * 4 + 0] = oct[v * 2 + 0];
+				tangents[v * 4 + 1] = oct[v * 2 + 1];
+				tangents[v * 4 + 2] = 0.0f;
+			}
+		}
+
+		WriteAttribute(layout, vertices, vertexCount, VertexSemantic::Tangent, VertexFormat::Float4, tangents.data(), parallel);
+	}
+
+	void TangentFrames::EncodeOctahedral(const float* vectors, uint32_t count, uint32_t stride, float* octahedral)
+	{
+		for (uint32_t i = 0; i < count; ++i, vectors += stride, octahedral += 2)
+		{
+			float x = vectors[0];
+			float y = vectors[1];
+			float z = vectors[2];
+
+			// onto the octahedron |x| + |y| + |z| = 1, the lower half folded over the diagonals
+			float invL1 = 1.0f / std::max(fabsf(x) + fabsf(y) + fabsf(z), 1e-20f);
+			x *= invL1;
+			y *= invL1;
+			if (z < 0.0f)
+			{
+				float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = foldedX;
+				y = foldedY;
+			}
+
+			octahedral[0] = x;
+			octahedral[1] = y;
+		}
+	}
+
+	void TangentFrames::DecodeOctahedral(const float* octahedral, uint32_t count, float* vectors, uint32_t stride)
+	{
+		for (uint32_t i = 0; i < count; ++i, octahedral += 2, vectors += stride)
+		{
+			float x = octahedral[0];
+			float y = octahedral[1];
+			float z = 1.0f - fabsf(x) - fabsf(y);
+
+			// unfold the lower half
+			float t = std::max(-z, 0.0f);
+			x += x >= 0.0f ? -t : t;
+			y += y >= 0.0f ? -t : t;
+
+			Float3 v = Normalize({ x, y, z });
+			vectors[0] = v.x;
+			vectors[1] = v.y;
+			vectors[2] = v.z;
+		}
+	}
+}
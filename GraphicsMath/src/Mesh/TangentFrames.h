@@ -0,0 +1,57 @@
+#pragma once
+
+#include "VertexLayout.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	enum class NormalWeighting : uint8_t
+	{
+		Area,  // large faces dominate, cheapest
+		Angle  // by the corner angle, independent of how the surface is triangulated
+	};
+
+	struct TangentFrameDesc
+	{
+		NormalWeighting weighting = NormalWeighting::Angle;
+		float creaseAngle = 180.0f; // in degrees, faces further apart than this from a vertex's own faces don't smooth into it
+		bool octahedral = false;    // write octahedral xy in [-1, 1], normals need a 2 component format. Tangents keep the sign in w
+		bool multithreaded = true;
+		uint32_t parallelThreshold = 16384; // fewer vertices are processed on the calling thread
+	};
+
+	/// <summary>
+	/// Normals and tangents of indexed triangle lists, read from and written to vertices of any VertexLayout.
+	/// Faces and vertices are processed in parallel ranges without locks or atomics: the face terms are
+	/// computed per triangle range into their own slots, then every vertex gathers the terms of its corners
+	/// through a corner adjacency, so the results don't depend on the thread count.
+	///
+	/// Normals smooth over every face around the same position (matched bitwise), vertices split for texcoords
+	/// don't show a seam. With a creaseAngle below 180 a vertex only takes the faces within creaseAngle of the
+	/// average of its own faces: vertices already split on hard edges keep them, and on unindexed input every
+	/// corner gets its crease aware normal, weld afterwards (VertexWelder) to get the indexed mesh.
+	///
+	/// Tangents follow MikkTSpace: per face tangent from the texcoord gradients, projected on the vertex normal,
+	/// weighted by the projected corner angle, gathered over the vertices with the same position, normal and
+	/// texcoord, and w = 1 when the texcoords keep the orientation, -1 when mirrored (bitangent = cross(normal,
+	/// tangent) * w). MikkTSpace also splits vertices whose faces mix orientations, here the side with the larger
+	/// weight wins: texcoord seams usually split such vertices already.
+	/// </summary>
+	class TangentFrames
+	{
+	public:
+		// reads the positions, writes the normals
+		static void GenerateNormals(const VertexLayout& layout, void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const TangentFrameDesc& desc = TangentFrameDesc());
+
+		// reads positions, normals and texcoords, writes the tangents. With desc.octahedral the normals are read as octahedral too
+		static void GenerateTangents(const VertexLayout& layout, void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const TangentFrameDesc& desc = TangentFrameDesc());
+
+		// unit vector from and to octahedral coordinates in [-1, 1]^2 (Cigolle et al. 2014), 2 floats per vector
+		static void EncodeOctahedral(const float* vectors, uint32_t count, uint32_t stride, float* octahedral);
+		static void DecodeOctahedral(const float* octahedral, uint32_t count, float* vectors, uint32_t stride);
+
+	private:
+		TangentFrames() = default;
+	};
+}
@@ -0,0 +1,118 @@
+#include "TextParsing.h"
+
+#include <math.h>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr double s_powersOf10[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		bool IsDigit(char c)
+		{
+			return static_cast<unsigned char>(c - '0') < 10;
+		}
+	}
+
+	const char* ParseFloat(const char* p, const char* end, float& value)
+	{
+		bool negative = false;
+		if (p != end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		uint64_t mantissa = 0;
+		int32_t exponent = 0;
+		uint32_t digits = 0;
+		bool any = false;
+
+		for (; p != end && IsDigit(*p); ++p)
+		{
+			any = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+			}
+			else
+			{
+				exponent++;
+			}
+		}
+
+		if (p != end && *p == '.')
+		{
+			for (++p; p != end && IsDigit(*p); ++p)
+			{
+				any = true;
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					digits += mantissa != 0;
+					exponent--;
+				}
+			}
+		}
+
+		if (!any)
+			return nullptr;
+
+		if (p != end && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			bool negativeExponent = false;
+			if (p != end && (*p == '-' || *p == '+'))
+				negativeExponent = *p++ == '-';
+
+			if (p == end || !IsDigit(*p))
+				return nullptr;
+
+			int32_t e = 0;
+			for (; p != end && IsDigit(*p); ++p)
+			{
+				if (e < 100000)
+					e = e * 10 + (*p - '0');
+			}
+
+			exponent += negativeExponent ? -e : e;
+		}
+
+		double result = static_cast<double>(mantissa);
+		if (mantissa != 0 && exponent != 0)
+		{
+			if (exponent > 0 && exponent <= 22)
+				result *= s_powersOf10[exponent];
+			else if (exponent < 0 && exponent >= -22)
+				result /= s_powersOf10[-exponent];
+			else
+				result *= pow(10.0, exponent);
+		}
+
+		value = static_cast<float>(negative ? -result : result);
+		return p;
+	}
+
+	const char* ParseInt(const char* p, const char* end, int32_t& value)
+	{
+		bool negative = false;
+		if (p != end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		if (p == end || !IsDigit(*p))
+			return nullptr;
+
+		int64_t result = 0;
+		for (; p != end && IsDigit(*p); ++p)
+		{
+			result = result * 10 + (*p - '0');
+			if (result > INT32_MAX)
+				return nullptr;
+		}
+
+		value = static_cast<int32_t>(negative ? -result : result);
+		return p;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace GM
+{
+	// Locale independent number parsing for the text mesh formats. Both read the number starting at p and return the
+	// end of it, or nullptr when there is none: the caller checks what follows.
+
+	/// <summary>
+	/// [+-]digits[.digits][(e|E)[+-]digits]. The first 19 significant digits are accumulated exactly in an
+	/// integer, then scaled by an exact power of 10 up to 1e22: a single rounding in double, well within float
+	/// precision, without going through strtod.
+	/// </summary>
+	const char* ParseFloat(const char* p, const char* end, float& value);
+
+	// [+-]digits, nullptr as well when the value doesn't fit an int32_t
+	const char* ParseInt(const char* p, const char* end, int32_t& value);
+}
@@ -0,0 +1,463 @@
+#include "VertexConversion.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <immintrin.h>
+#include <string.h>
+#include <type_traits>
+
+// MSVC has no __F16C__, /arch:AVX2 implies F16C there. GCC and Clang define it with -mf16c, which -mavx2 doesn't enable
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define GM_F16C
+#endif
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_grainSize = 16384;
+
+		// vertices converted attribute by attribute, small enough for the source vertices to stay in L1
+		constexpr uint32_t s_blockSize = 256;
+
+		struct AttributeCopy
+		{
+			const uint8_t* src; // nullptr when no source stream has the semantic
+			uint32_t srcStride;
+			VertexFormat srcFormat;
+			uint8_t* dst;
+			uint32_t dstStride;
+			VertexFormat dstFormat;
+			__m128 srcMask;     // lanes of the components stored in the source
+			__m128 defaults;
+		};
+
+		__m128 GetDefaults(VertexSemantic semantic)
+		{
+			bool oneW = semantic == VertexSemantic::Position || semantic == VertexSemantic::Tangent || semantic == VertexSemantic::Color;
+			return _mm_set_ps(oneW ? 1.0f : 0.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		__m128 GetComponentMask(VertexFormat format)
+		{
+			uint32_t count = GetFormatComponentCount(format);
+			return _mm_castsi128_ps(_mm_set_epi32(count > 3 ? -1 : 0, count > 2 ? -1 : 0, count > 1 ? -1 : 0, -1));
+		}
+
+		__m128i LoadInt32(const uint8_t* p)
+		{
+			int32_t i;
+			memcpy(&i, p, sizeof(i));
+			return _mm_cvtsi32_si128(i);
+		}
+
+		void StoreInt32(uint8_t* p, __m128i v)
+		{
+			int32_t i = _mm_cvtsi128_si32(v);
+			memcpy(p, &i, sizeof(i));
+		}
+
+		// 4 halfs in the low 64 bits
+		__m128 HalfToFloat(__m128i packed)
+		{
+#ifdef GM_F16C
+			return _mm_cvtph_ps(packed);
+#else
+			__m128i h = _mm_unpacklo_epi16(packed, _mm_setzero_si128());
+
+			// move exponent and mantissa in place and rebias by multiplying with 2^112, which also normalizes the
+			// denormals. Inf and NaN get the full exponent back (Giesen, "Half to float done quic")
+			__m128i expMantissa = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+			__m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMantissa), 16);
+			__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMantissa, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+			__m128i infNaN = _mm_cmpgt_epi32(expMantissa, _mm_set1_epi32(0x7bff));
+			__m128 infNaNExponent = _mm_and_ps(_mm_castsi128_ps(infNaN), _mm_castsi128_ps(_mm_set1_epi32(255 << 23)));
+			return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infNaNExponent));
+#endif
+		}
+
+		// halfs in the low 16 bits of the lanes, the high bits are the sign extension so _mm_packs_epi32 keeps them
+		__m128i FloatToHalf(__m128 f)
+		{
+#ifdef GM_F16C
+			__m128i h = _mm_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT);
+			return _mm_srai_epi32(_mm_unpacklo_epi16(h, h), 16);
+#else
+			// round to nearest even with the rounding bias of the float bits (Giesen, "float_to_half_fast3_rtne"),
+			// results below the smallest normal half rounded by adding a magic number, too large ones become inf
+			__m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(INT32_MIN)));
+			__m128 absF = _mm_xor_ps(f, sign);
+			__m128i absBits = _mm_castps_si128(absF);
+
+			__m128i regular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), absBits);
+			__m128i nanBit = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absF, absF)), _mm_set1_epi32(0x200));
+			__m128i infNaN = _mm_or_si128(nanBit, _mm_set1_epi32(0x7c00));
+
+			__m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+			__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absF, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+			__m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), absBits);
+
+			__m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+			__m128i rounded = _mm_sub_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(0xfff - ((127 - 15) << 23))), mantissaOdd);
+			__m128i normal = _mm_srli_epi32(rounded, 13);
+
+			__m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+			__m128i h = _mm_or_si128(_mm_and_si128(regular, finite), _mm_andnot_si128(regular, infNaN));
+			return _mm_or_si128(h, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+#endif
+		}
+
+		__m128 Clamp(__m128 v, float lo, float hi)
+		{
+			return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(lo)), _mm_set1_ps(hi));
+		}
+
+		// calls fn with the format as a compile time constant, so the loops over vertices are compiled per format
+		template<typename Fn>
+		void DispatchFormat(VertexFormat format, const Fn& fn)
+		{
+			switch (format)
+			{
+			case VertexFormat::Float1: fn(std::integral_constant<VertexFormat, VertexFormat::Float1>()); break;
+			case VertexFormat::Float2: fn(std::integral_constant<VertexFormat, VertexFormat::Float2>()); break;
+			case VertexFormat::Float3: fn(std::integral_constant<VertexFormat, VertexFormat::Float3>()); break;
+			case VertexFormat::Float4: fn(std::integral_constant<VertexFormat, VertexFormat::Float4>()); break;
+			case VertexFormat::Half2: fn(std::integral_constant<VertexFormat, VertexFormat::Half2>()); break;
+			case VertexFormat::Half4: fn(std::integral_constant<VertexFormat, VertexFormat::Half4>()); break;
+			case VertexFormat::UNorm8x4: fn(std::integral_constant<VertexFormat, VertexFormat::UNorm8x4>()); break;
+			case VertexFormat::SNorm8x4: fn(std::integral_constant<VertexFormat, VertexFormat::SNorm8x4>()); break;
+			case VertexFormat::UNorm16x2: fn(std::integral_constant<VertexFormat, VertexFormat::UNorm16x2>()); break;
+			case VertexFormat::UNorm16x4: fn(std::integral_constant<VertexFormat, VertexFormat::UNorm16x4>()); break;
+			case VertexFormat::SNorm16x2: fn(std::integral_constant<VertexFormat, VertexFormat::SNorm16x2>()); break;
+			case VertexFormat::SNorm16x4: fn(std::integral_constant<VertexFormat, VertexFormat::SNorm16x4>()); break;
+			default: assert(false && "Unknown vertex format"); break;
+			}
+		}
+
+		constexpr bool IsFloat(VertexFormat format)
+		{
+			return format <= VertexFormat::Float4;
+		}
+
+		constexpr bool IsHalf(VertexFormat format)
+		{
+			return format == VertexFormat::Half2 || format == VertexFormat::Half4;
+		}
+
+		constexpr bool IsUNorm16(VertexFormat format)
+		{
+			return format == VertexFormat::UNorm16x2 || format == VertexFormat::UNorm16x4;
+		}
+
+		constexpr bool IsSNorm16(VertexFormat format)
+		{
+			return format == VertexFormat::SNorm16x2 || format == VertexFormat::SNorm16x4;
+		}
+
+		// 2 components in 4 bytes, the others in 8 except for the 8 bit formats
+		constexpr bool Is16x2(VertexFormat format)
+		{
+			return format == VertexFormat::Half2 || format == VertexFormat::UNorm16x2 || format == VertexFormat::SNorm16x2;
+		}
+
+		// integer lanes before the packs, UNorm16 biased by -32768 to fit the signed saturation of _mm_packs_epi32
+		template<VertexFormat Format>
+		__m128i Quantize(__m128 v)
+		{
+			if constexpr (IsHalf(Format))
+				return FloatToHalf(v);
+			else if constexpr (Format == VertexFormat::UNorm8x4)
+				return _mm_cvtps_epi32(_mm_mul_ps(Clamp(v, 0.0f, 1.0f), _mm_set1_ps(255.0f)));
+			else if constexpr (Format == VertexFormat::SNorm8x4)
+				return _mm_cvtps_epi32(_mm_mul_ps(Clamp(v, -1.0f, 1.0f), _mm_set1_ps(127.0f)));
+			else if constexpr (IsUNorm16(Format))
+				return _mm_sub_epi32(_mm_cvtps_epi32(_mm_mul_ps(Clamp(v, 0.0f, 1.0f), _mm_set1_ps(65535.0f))), _mm_set1_epi32(32768));
+			else
+				return _mm_cvtps_epi32(_mm_mul_ps(Clamp(v, -1.0f, 1.0f), _mm_set1_ps(32767.0f)));
+		}
+
+		// 8 16 bit values: a then b
+		template<VertexFormat Format>
+		__m128i Pack16(__m128i a, __m128i b)
+		{
+			__m128i packed = _mm_packs_epi32(a, b);
+			if constexpr (IsUNorm16(Format))
+				packed = _mm_xor_si128(packed, _mm_set1_epi16(INT16_MIN));
+
+			return packed;
+		}
+
+		// 16 bytes: a, b, c then d
+		template<VertexFormat Format>
+		__m128i Pack8(__m128i a, __m128i b, __m128i c, __m128i d)
+		{
+			__m128i ab = _mm_packs_epi32(a, b);
+			__m128i cd = _mm_packs_epi32(c, d);
+			if constexpr (Format == VertexFormat::UNorm8x4)
+				return _mm_packus_epi16(ab, cd);
+			else
+				return _mm_packs_epi16(ab, cd);
+		}
+
+		// unused lanes are 0
+		template<VertexFormat Format>
+		__m128 Load(const uint8_t* p)
+		{
+			const __m128i zero = _mm_setzero_si128();
+
+			if constexpr (Format == VertexFormat::Float1)
+				return _mm_load_ss(reinterpret_cast<const float*>(p));
+			else if constexpr (Format == VertexFormat::Float2)
+				return _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+			else if constexpr (Format == VertexFormat::Float3)
+				return _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))), _mm_load_ss(reinterpret_cast<const float*>(p) + 2));
+			else if constexpr (Format == VertexFormat::Float4)
+				return _mm_loadu_ps(reinterpret_cast<const float*>(p));
+			else if constexpr (Format == VertexFormat::Half2)
+				return HalfToFloat(LoadInt32(p));
+			else if constexpr (Format == VertexFormat::Half4)
+				return HalfToFloat(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+			else if constexpr (Format == VertexFormat::UNorm8x4)
+			{
+				__m128i i = _mm_unpacklo_epi16(_mm_unpacklo_epi8(LoadInt32(p), zero), zero);
+				return _mm_mul_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(1.0f / 255.0f));
+			}
+			else if constexpr (Format == VertexFormat::SNorm8x4)
+			{
+				// bytes to the top of the lanes, arithmetic shift down to sign extend
+				__m128i i = LoadInt32(p);
+				i = _mm_unpacklo_epi8(i, i);
+				i = _mm_srai_epi32(_mm_unpacklo_epi16(i, i), 24);
+				return _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(1.0f / 127.0f)), _mm_set1_ps(-1.0f));
+			}
+			else
+			{
+				__m128i i = Is16x2(Format) ? LoadInt32(p) : _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+				if constexpr (IsUNorm16(Format))
+					return _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(i, zero)), _mm_set1_ps(1.0f / 65535.0f));
+
+				i = _mm_srai_epi32(_mm_unpacklo_epi16(i, i), 16);
+				return _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(1.0f / 32767.0f)), _mm_set1_ps(-1.0f));
+			}
+		}
+
+		template<VertexFormat Format>
+		void Store(__m128 v, uint8_t* p)
+		{
+			if constexpr (Format == VertexFormat::Float1)
+				_mm_store_ss(reinterpret_cast<float*>(p), v);
+			else if constexpr (Format == VertexFormat::Float2)
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+			else if constexpr (Format == VertexFormat::Float3)
+			{
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+				_mm_store_ss(reinterpret_cast<float*>(p) + 2, _mm_movehl_ps(v, v));
+			}
+			else if constexpr (Format == VertexFormat::Float4)
+				_mm_storeu_ps(reinterpret_cast<float*>(p), v);
+			else if constexpr (Format == VertexFormat::UNorm8x4 || Format == VertexFormat::SNorm8x4)
+			{
+				__m128i i = Quantize<Format>(v);
+				StoreInt32(p, Pack8<Format>(i, i, i, i));
+			}
+			else if constexpr (Is16x2(Format))
+			{
+				__m128i i = Quantize<Format>(v);
+				StoreInt32(p, Pack16<Format>(i, i));
+			}
+			else
+			{
+				__m128i i = Quantize<Format>(v);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(p), Pack16<Format>(i, i));
+			}
+		}
+
+		// the 4 32 bit lanes of v to 4 vertices
+		void Scatter32(__m128i v, uint8_t* p, uint32_t stride)
+		{
+			if (stride == 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+				return;
+			}
+
+			StoreInt32(p, v);
+			StoreInt32(p + stride, _mm_srli_si128(v, 4));
+			StoreInt32(p + 2 * stride, _mm_srli_si128(v, 8));
+			StoreInt32(p + 3 * stride, _mm_srli_si128(v, 12));
+		}
+
+		// the 2 64 bit lanes of v to 2 vertices
+		void Scatter64(__m128i v, uint8_t* p, uint32_t stride)
+		{
+			if (stride == 8)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+				return;
+			}
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(p), v);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(p + stride), _mm_srli_si128(v, 8));
+		}
+
+		// 4 vertices, the integer formats pack all of them into one or two registers
+		template<VertexFormat Format>
+		void Store4(const __m128* v, uint8_t* p, uint32_t stride)
+		{
+			if constexpr (IsFloat(Format))
+			{
+				for (uint32_t i = 0; i < 4; ++i)
+					Store<Format>(v[i], p + i * stride);
+			}
+			else if constexpr (Format == VertexFormat::UNorm8x4 || Format == VertexFormat::SNorm8x4)
+				Scatter32(Pack8<Format>(Quantize<Format>(v[0]), Quantize<Format>(v[1]), Quantize<Format>(v[2]), Quantize<Format>(v[3])), p, stride);
+			else if constexpr (Is16x2(Format))
+			{
+				// xy of two vertices per register
+				__m128i a = Quantize<Format>(_mm_movelh_ps(v[0], v[1]));
+				__m128i b = Quantize<Format>(_mm_movelh_ps(v[2], v[3]));
+				Scatter32(Pack16<Format>(a, b), p, stride);
+			}
+			else
+			{
+				Scatter64(Pack16<Format>(Quantize<Format>(v[0]), Quantize<Format>(v[1])), p, stride);
+				Scatter64(Pack16<Format>(Quantize<Format>(v[2]), Quantize<Format>(v[3])), p + 2 * stride, stride);
+			}
+		}
+
+		template<VertexFormat Format>
+		void LoadBlock(const AttributeCopy& copy, const uint8_t* src, uint32_t count, __m128* values)
+		{
+			for (uint32_t i = 0; i < count; ++i, src += copy.srcStride)
+				values[i] = _mm_or_ps(_mm_and_ps(copy.srcMask, Load<Format>(src)), _mm_andnot_ps(copy.srcMask, copy.defaults));
+		}
+
+		template<VertexFormat Format>
+		void StoreBlock(const __m128* values, uint32_t count, uint8_t* dst, uint32_t stride)
+		{
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				Store4<Format>(values + i, dst + static_cast<size_t>(i) * stride, stride);
+
+			for (; i < count; ++i)
+				Store<Format>(values[i], dst + static_cast<size_t>(i) * stride);
+		}
+
+		// at most s_blockSize vertices
+		void Convert(const AttributeCopy& copy, uint32_t first, uint32_t last)
+		{
+			uint32_t count = last - first;
+			const uint8_t* src = copy.src ? copy.src + static_cast<size_t>(first) * copy.srcStride : nullptr;
+			uint8_t* dst = copy.dst + static_cast<size_t>(first) * copy.dstStride;
+
+			if (src && copy.srcFormat == copy.dstFormat)
+			{
+				uint32_t size = GetFormatSize(copy.srcFormat);
+				for (uint32_t i = 0; i < count; ++i, src += copy.srcStride, dst += copy.dstStride)
+					memcpy(dst, src, size);
+
+				return;
+			}
+
+			__m128 values[s_blockSize];
+			if (src)
+				DispatchFormat(copy.srcFormat, [&](auto format) { LoadBlock<decltype(format)::value>(copy, src, count, values); });
+			else
+				std::fill(values, values + count, copy.defaults);
+
+			DispatchFormat(copy.dstFormat, [&](auto format) { StoreBlock<decltype(format)::value>(values, count, dst, copy.dstStride); });
+		}
+
+		// returns the number of copies written, one per attribute of the destination stream
+		uint32_t GetAttributeCopies(const VertexStream* srcStreams, uint32_t srcStreamCount, const VertexStream& dstStream, AttributeCopy* copies)
+		{
+			const VertexLayout& dstLayout = dstStream.layout;
+			for (uint32_t i = 0; i < dstLayout.GetAttributeCount(); ++i)
+			{
+				const VertexAttribute& dstAttribute = dstLayout.GetAttribute(i);
+
+				AttributeCopy& copy = copies[i];
+				copy.src = nullptr;
+				copy.srcStride = 0;
+				copy.srcFormat = dstAttribute.format;
+				copy.dst = static_cast<uint8_t*>(dstStream.data) + dstAttribute.offset;
+				copy.dstStride = dstLayout.GetStride();
+				copy.dstFormat = dstAttribute.format;
+				copy.defaults = GetDefaults(dstAttribute.semantic);
+				copy.srcMask = _mm_setzero_ps();
+
+				for (uint32_t s = 0; s < srcStreamCount; ++s)
+				{
+					const VertexAttribute* srcAttribute = srcStreams[s].layout.Find(dstAttribute.semantic);
+					if (srcAttribute)
+					{
+						copy.src = static_cast<const uint8_t*>(srcStreams[s].data) + srcAttribute->offset;
+						copy.srcStride = srcStreams[s].layout.GetStride();
+						copy.srcFormat = srcAttribute->format;
+						copy.srcMask = GetComponentMask(srcAttribute->format);
+						break;
+					}
+				}
+			}
+
+			return dstLayout.GetAttributeCount();
+		}
+	}
+
+	void DecodeAttribute(const VertexAttribute& attribute, const void* vertex, float* value)
+	{
+		AttributeCopy copy = {};
+		copy.srcMask = GetComponentMask(attribute.format);
+		copy.defaults = GetDefaults(attribute.semantic);
+
+		__m128 v;
+		const uint8_t* src = static_cast<const uint8_t*>(vertex) + attribute.offset;
+		DispatchFormat(attribute.format, [&](auto format) { LoadBlock<decltype(format)::value>(copy, src, 1, &v); });
+		_mm_storeu_ps(value, v);
+	}
+
+	void EncodeAttribute(const VertexAttribute& attribute, const float* value, void* vertex)
+	{
+		__m128 v = _mm_loadu_ps(value);
+		uint8_t* dst = static_cast<uint8_t*>(vertex) + attribute.offset;
+		DispatchFormat(attribute.format, [&](auto format) { Store<decltype(format)::value>(v, dst); });
+	}
+
+	void ConvertVertices(const VertexLayout& srcLayout, const void* src, const VertexLayout& dstLayout, void* dst, uint32_t vertexCount, bool multithreaded)
+	{
+		if (srcLayout == dstLayout)
+		{
+			memcpy(dst, src, static_cast<size_t>(vertexCount) * srcLayout.GetStride());
+			return;
+		}
+
+		VertexStream srcStream(srcLayout, const_cast<void*>(src));
+		VertexStream dstStream(dstLayout, dst);
+		ConvertVertices(&srcStream, 1, &dstStream, 1, vertexCount, multithreaded);
+	}
+
+	void ConvertVertices(const VertexStream* srcStreams, uint32_t srcStreamCount, const VertexStream* dstStreams, uint32_t dstStreamCount, uint32_t vertexCount, bool multithreaded)
+	{
+		auto convert = [&](uint32_t first, uint32_t last)
+		{
+			for (uint32_t d = 0; d < dstStreamCount; ++d)
+			{
+				AttributeCopy copies[VertexLayout::MaxAttributes];
+				uint32_t copyCount = GetAttributeCopies(srcStreams, srcStreamCount, dstStreams[d], copies);
+
+				for (uint32_t blockFirst = first; blockFirst < last; blockFirst += s_blockSize)
+				{
+					uint32_t blockLast = std::min(blockFirst + s_blockSize, last);
+					for (uint32_t i = 0; i < copyCount; ++i)
+						Convert(copies[i], blockFirst, blockLast);
+				}
+			}
+		};
+
+		if (multithreaded && JobSystem::GetThreadCount() > 1 && vertexCount > s_grainSize)
+			JobSystem::ParallelFor(0, vertexCount, s_grainSize, convert);
+		else
+			convert(0, vertexCount);
+	}
+}
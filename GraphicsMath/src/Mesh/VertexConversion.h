@@ -0,0 +1,39 @@
+#pragma once
+
+#include "VertexLayout.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	// one buffer of vertices. Several streams with different semantics make up deinterleaved vertices
+	struct VertexStream
+	{
+		VertexLayout layout;
+		void* data = nullptr; // only read when used as a source
+
+		VertexStream() = default;
+		VertexStream(const VertexLayout& layout, void* data) : layout(layout), data(data) { }
+	};
+
+	// value is 4 floats, the components the format doesn't have get the defaults of VertexLayout
+	void DecodeAttribute(const VertexAttribute& attribute, const void* vertex, float* value);
+	// value is 4 floats, components past the format are dropped
+	void EncodeAttribute(const VertexAttribute& attribute, const float* value, void* vertex);
+
+	/// <summary>
+	/// Converts vertexCount vertices between layouts, attributes are matched by semantic. Destination attributes
+	/// without a source get the defaults of VertexLayout, source attributes without a destination are dropped.
+	///
+	/// Formats: half floats round to nearest even, normalized formats clamp then round to nearest, UNorm with
+	/// 2^n - 1 steps over [0, 1] and SNorm with 2^(n-1) - 1 steps over [-1, 1] (-128 and -32768 read back as -1),
+	/// the D3D conventions. Every attribute is decoded to 4 floats in an SSE register, vertices are encoded 4 at a
+	/// time so the integer packs fill a whole register before the stores. F16C converts the halfs when compiled
+	/// for it (/arch:AVX2, -mf16c), otherwise they are converted with integer bit operations.
+	/// Same layouts are copied as is. Large counts are split over the job system.
+	/// </summary>
+	void ConvertVertices(const VertexLayout& srcLayout, const void* src, const VertexLayout& dstLayout, void* dst, uint32_t vertexCount, bool multithreaded = true);
+
+	// between interleaved and deinterleaved vertices: each destination attribute is read from the first source stream with its semantic
+	void ConvertVertices(const VertexStream* srcStreams, uint32_t srcStreamCount, const VertexStream* dstStreams, uint32_t dstStreamCount, uint32_t vertexCount, bool multithreaded = true);
+}
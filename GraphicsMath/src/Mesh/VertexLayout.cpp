@@ -0,0 +1,155 @@
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace GM
+{
+	uint32_t GetFormatSize(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float1: return 4;
+		case VertexFormat::Float2: return 8;
+		case VertexFormat::Float3: return 12;
+		case VertexFormat::Float4: return 16;
+		case VertexFormat::Half2: return 4;
+		case VertexFormat::Half4: return 8;
+		case VertexFormat::UNorm8x4: return 4;
+		case VertexFormat::SNorm8x4: return 4;
+		case VertexFormat::UNorm16x2: return 4;
+		case VertexFormat::UNorm16x4: return 8;
+		case VertexFormat::SNorm16x2: return 4;
+		case VertexFormat::SNorm16x4: return 8;
+		default: break;
+		}
+
+		assert(false && "Unknown vertex format");
+		return 0;
+	}
+
+	uint32_t GetFormatComponentCount(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float1: return 1;
+		case VertexFormat::Float2: return 2;
+		case VertexFormat::Float3: return 3;
+		case VertexFormat::Float4: return 4;
+		case VertexFormat::Half2: return 2;
+		case VertexFormat::Half4: return 4;
+		case VertexFormat::UNorm8x4: return 4;
+		case VertexFormat::SNorm8x4: return 4;
+		case VertexFormat::UNorm16x2: return 2;
+		case VertexFormat::UNorm16x4: return 4;
+		case VertexFormat::SNorm16x2: return 2;
+		case VertexFormat::SNorm16x4: return 4;
+		default: break;
+		}
+
+		assert(false && "Unknown vertex format");
+		return 0;
+	}
+
+	VertexLayout::VertexLayout()
+		: m_attributeCount(0), m_stride(0)
+	{
+	}
+
+	VertexLayout& VertexLayout::Add(VertexSemantic semantic, VertexFormat format)
+	{
+		return Add(semantic, format, m_stride);
+	}
+
+	VertexLayout& VertexLayout::Add(VertexSemantic semantic, VertexFormat format, uint32_t offset)
+	{
+		assert(semantic < VertexSemantic::Count && "Invalid vertex semantic");
+		assert(format < VertexFormat::Count && "Invalid vertex format");
+		assert(!Has(semantic) && "Vertex layout already has an attribute with this semantic");
+		assert(m_attributeCount < MaxAttributes && "Too many vertex attributes");
+
+		VertexAttribute& attribute = m_attributes[m_attributeCount++];
+		attribute.semantic = semantic;
+		attribute.format = format;
+		attribute.offset = offset;
+
+		m_stride = std::max(m_stride, offset + GetFormatSize(format));
+		return *this;
+	}
+
+	VertexLayout& VertexLayout::SetStride(uint32_t stride)
+	{
+		for (uint32_t i = 0; i < m_attributeCount; ++i)
+			assert(m_attributes[i].offset + GetFormatSize(m_attributes[i].format) <= stride && "Vertex stride cuts into an attribute");
+
+		m_stride = stride;
+		return *this;
+	}
+
+	const VertexAttribute* VertexLayout::Find(VertexSemantic semantic) const
+	{
+		for (uint32_t i = 0; i < m_attributeCount; ++i)
+		{
+			if (m_attributes[i].semantic == semantic)
+				return &m_attributes[i];
+		}
+
+		return nullptr;
+	}
+
+	bool VertexLayout::Has(VertexSemantic semantic) const
+	{
+		return Find(semantic) != nullptr;
+	}
+
+	uint32_t VertexLayout::GetAttributeCount() const
+	{
+		return m_attributeCount;
+	}
+
+	const VertexAttribute& VertexLayout::GetAttribute(uint32_t index) const
+	{
+		assert(index < m_attributeCount && "Vertex attribute index out of range");
+		return m_attributes[index];
+	}
+
+	uint32_t VertexLayout::GetStride() const
+	{
+		return m_stride;
+	}
+
+	bool VertexLayout::operator==(const VertexLayout& other) const
+	{
+		if (m_attributeCount != other.m_attributeCount || m_stride != other.m_stride)
+			return false;
+
+		for (uint32_t i = 0; i < m_attributeCount; ++i)
+		{
+			const VertexAttribute& a = m_attributes[i];
+			const VertexAttribute& b = other.m_attributes[i];
+			if (a.semantic != b.semantic || a.format != b.format || a.offset != b.offset)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool VertexLayout::operator!=(const VertexLayout& other) const
+	{
+		return !(*this == other);
+	}
+
+	VertexLayout VertexLayout::BasicMesh(bool hasTexCoords, bool hasNormals)
+	{
+		VertexLayout layout;
+		layout.Add(VertexSemantic::Position, VertexFormat::Float3);
+
+		if (hasTexCoords)
+			layout.Add(VertexSemantic::TexCoord, VertexFormat::Float2);
+
+		if (hasNormals)
+			layout.Add(VertexSemantic::Normal, VertexFormat::Float3);
+
+		return layout;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace GM
+{
+	enum class VertexSemantic : uint8_t
+	{
+		Position,
+		Normal,
+		Tangent,  // xyz, bitangent sign in w: bitangent = cross(normal, tangent) * w
+		TexCoord,
+		Color,
+		Count
+	};
+
+	enum class VertexFormat : uint8_t
+	{
+		Float1,
+		Float2,
+		Float3,
+		Float4,
+		Half2,
+		Half4,
+		UNorm8x4,  // [0, 1] in 8 bits per component
+		SNorm8x4,  // [-1, 1] in 8 bits per component
+		UNorm16x2,
+		UNorm16x4,
+		SNorm16x2,
+		SNorm16x4,
+		Count
+	};
+
+	// in bytes
+	uint32_t GetFormatSize(VertexFormat format);
+	uint32_t GetFormatComponentCount(VertexFormat format);
+
+	struct VertexAttribute
+	{
+		VertexSemantic semantic = VertexSemantic::Position;
+		VertexFormat format = VertexFormat::Float3;
+		uint32_t offset = 0; // in bytes from the start of the vertex
+	};
+
+	/// <summary>
+	/// Interleaved vertex description, at most one attribute per semantic. Offsets and stride are in bytes.
+	/// Components a format doesn't have are dropped on write and read back as 0, or as 1 for the w of
+	/// positions, tangents and colors. See VertexConversion.h for the encoding of the formats.
+	/// </summary>
+	class VertexLayout
+	{
+	public:
+		static constexpr uint32_t MaxAttributes = static_cast<uint32_t>(VertexSemantic::Count);
+
+		VertexLayout();
+
+		// appended after the end of the vertex, the stride grows by the format size
+		VertexLayout& Add(VertexSemantic semantic, VertexFormat format);
+		// at a given offset, the stride grows to hold the attribute if needed
+		VertexLayout& Add(VertexSemantic semantic, VertexFormat format, uint32_t offset);
+		// for padding at the end of the vertex, can't cut into an attribute
+		VertexLayout& SetStride(uint32_t stride);
+
+		// nullptr when the layout has no attribute for the semantic
+		const VertexAttribute* Find(VertexSemantic semantic) const;
+		bool Has(VertexSemantic semantic) const;
+
+		uint32_t GetAttributeCount() const;
+		const VertexAttribute& GetAttribute(uint32_t index) const;
+		uint32_t GetStride() const;
+
+		// same attributes in the same order and same stride
+		bool operator==(const VertexLayout& other) const;
+		bool operator!=(const VertexLayout& other) const;
+
+		// position float3, texcoord float2, normal float3: the layouts of Utils::BasicMesh
+		static VertexLayout BasicMesh(bool hasTexCoords, bool hasNormals);
+
+	private:
+		VertexAttribute m_attributes[MaxAttributes];
+		uint32_t m_attributeCount;
+		uint32_t m_stride;
+	};
+}
@@ -0,0 +1,311 @@
+#include "VertexWelder.h"
+#include "MeshOptimizer.h"
+#include "VertexConversion.h"
+#include "Core/JobSystem.h"
+#include "Geometry/SpatialHash.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+namespace GM
+{
+	namespace
+	{
+		constexpr uint32_t s_grainSize = 4096;
+
+		// the vertices are split by the top bits of their hash, equal vertices always land in the same partition
+		constexpr uint32_t s_partitionBits = 8;
+		constexpr uint32_t s_partitionCount = 1u << s_partitionBits;
+
+		constexpr uint32_t s_invalid = ~0u;
+
+		uint32_t NextPowerOfTwo(uint32_t v)
+		{
+			uint32_t res = 1;
+			while (res < v && res < 0x80000000u)
+				res <<= 1;
+
+			return res;
+		}
+
+		bool IsParallel(const WeldDesc& desc, uint32_t vertexCount)
+		{
+			return desc.multithreaded && JobSystem::GetThreadCount() > 1 && vertexCount >= desc.parallelThreshold;
+		}
+
+		// FNV-1a over 32 bit words, every format size is a multiple of 4 bytes. Finished with the murmur3 mix so
+		// the top bits used for the partitions depend on every word
+		uint64_t HashVertex(const VertexLayout& layout, const uint8_t* vertex)
+		{
+			uint64_t h = 14695981039346656037ull;
+			for (uint32_t i = 0; i < layout.GetAttributeCount(); ++i)
+			{
+				const VertexAttribute& attribute = layout.GetAttribute(i);
+				const uint8_t* p = vertex + attribute.offset;
+				for (uint32_t b = 0; b < GetFormatSize(attribute.format); b += 4)
+				{
+					uint32_t word;
+					memcpy(&word, p + b, sizeof(word));
+					h = (h ^ word) * 1099511628211ull;
+				}
+			}
+
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdull;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ull;
+			h ^= h >> 33;
+			return h;
+		}
+
+		bool Equal(const VertexLayout& layout, const uint8_t* a, const uint8_t* b)
+		{
+			for (uint32_t i = 0; i < layout.GetAttributeCount(); ++i)
+			{
+				const VertexAttribute& attribute = layout.GetAttribute(i);
+				if (memcmp(a + attribute.offset, b + attribute.offset, GetFormatSize(attribute.format)) != 0)
+					return false;
+			}
+
+			return true;
+		}
+
+		// representatives[v]: the first vertex equal to v
+		void FindBitwiseRepresentatives(const VertexLayout& layout, const uint8_t* vertices, uint32_t vertexCount, bool parallel, uint32_t* representatives)
+		{
+			uint32_t stride = layout.GetStride();
+			std::vector<uint64_t> hashes(vertexCount);
+
+			uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(vertexCount, s_grainSize) : 1;
+			JobSystem::ParallelForChunks(vertexCount, chunkCount, [&](uint32_t, uint32_t first, uint32_t last)
+				{
+					for (uint32_t v = first; v < last; ++v)
+						hashes[v] = HashVertex(layout, vertices + static_cast<size_t>(v) * stride);
+				});
+
+			// counting sort by partition, in vertex order inside a partition
+			std::vector<uint32_t> partitionStart(s_partitionCount + 1, 0);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+				++partitionStart[(hashes[v] >> (64 - s_partitionBits)) + 1];
+
+			for (uint32_t p = 0; p < s_partitionCount; ++p)
+				partitionStart[p + 1] += partitionStart[p];
+
+			std::vector<uint32_t> sorted(vertexCount);
+			{
+				std::vector<uint32_t> cursors(partitionStart.begin(), partitionStart.end() - 1);
+				for (uint32_t v = 0; v < vertexCount; ++v)
+					sorted[cursors[hashes[v] >> (64 - s_partitionBits)]++] = v;
+			}
+
+			auto weldPartitions = [&](uint32_t firstPartition, uint32_t lastPartition)
+			{
+				std::vector<uint32_t> table;
+				for (uint32_t p = firstPartition; p < lastPartition; ++p)
+				{
+					uint32_t begin = partitionStart[p];
+					uint32_t end = partitionStart[p + 1];
+					if (begin == end)
+						continue;
+
+					// open addressing, at most half full
+					uint32_t mask = NextPowerOfTwo((end - begin) * 2) - 1;
+					table.assign(static_cast<size_t>(mask) + 1, s_invalid);
+
+					for (uint32_t i = begin; i < end; ++i)
+					{
+						uint32_t v = sorted[i];
+						uint64_t h = hashes[v];
+						const uint8_t* vertex = vertices + static_cast<size_t>(v) * stride;
+
+						for (uint32_t slot = static_cast<uint32_t>(h) & mask;; slot = (slot + 1) & mask)
+						{
+							uint32_t u = table[slot];
+							if (u == s_invalid)
+							{
+								table[slot] = v;
+								representatives[v] = v;
+								break;
+							}
+
+							if (hashes[u] == h && Equal(layout, vertices + static_cast<size_t>(u) * stride, vertex))
+							{
+								representatives[v] = u;
+								break;
+							}
+						}
+					}
+				}
+			};
+
+			if (parallel)
+				JobSystem::ParallelFor(0, s_partitionCount, 1, weldPartitions);
+			else
+				weldPartitions(0, s_partitionCount);
+		}
+
+		// the attributes decoded to float4s, in layout order
+		struct DecodedVertices
+		{
+			std::vector<float> values;
+			uint32_t stride;         // in floats
+			uint32_t positionOffset; // in floats
+
+			const float* Get(uint32_t v) const { return values.data() + static_cast<size_t>(v) * stride; }
+		};
+
+		bool Close(const DecodedVertices& decoded, uint32_t a, uint32_t b, float attributeEpsilon)
+		{
+			const float* va = decoded.Get(a);
+			const float* vb = decoded.Get(b);
+			for (uint32_t i = 0; i < decoded.stride; ++i)
+			{
+				if (i - decoded.positionOffset < 4)
+					continue;
+
+				if (fabsf(va[i] - vb[i]) > attributeEpsilon)
+					return false;
+			}
+
+			return true;
+		}
+
+		// representatives[v]: the first earlier vertex close to v that is its own representative, else v
+		void FindEpsilonRepresentatives(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, const WeldDesc& desc, bool parallel, uint32_t* representatives)
+		{
+			const VertexAttribute* position = layout.Find(VertexSemantic::Position);
+			assert(position && "Epsilon welding needs positions");
+
+			VertexLayout decodedLayout;
+			for (uint32_t i = 0; i < layout.GetAttributeCount(); ++i)
+				decodedLayout.Add(layout.GetAttribute(i).semantic, VertexFormat::Float4);
+
+			DecodedVertices decoded;
+			decoded.stride = decodedLayout.GetStride() / sizeof(float);
+			decoded.positionOffset = decodedLayout.Find(VertexSemantic::Position)->offset / sizeof(float);
+			decoded.values.resize(static_cast<size_t>(vertexCount) * decoded.stride);
+			ConvertVertices(layout, vertices, decodedLayout, decoded.values.data(), vertexCount, parallel);
+
+			SpatialHashDesc hashDesc;
+			hashDesc.cellSize = desc.positionEpsilon;
+			hashDesc.multithreaded = parallel;
+			SpatialHash grid(hashDesc);
+			grid.Build(decoded.values.data() + decoded.positionOffset, vertexCount, decoded.stride);
+
+			auto query = [&](uint32_t v, std::vector<uint32_t>& neighbours)
+			{
+				const float* p = decoded.Get(v) + decoded.positionOffset;
+				neighbours.clear();
+				grid.QueryRadius(Vector(p[0], p[1], p[2], 0.0f), desc.positionEpsilon, neighbours);
+				std::sort(neighbours.begin(), neighbours.end());
+			};
+
+			// the first earlier close vertex, in parallel. Most of the time it is a representative and the result
+			std::vector<uint32_t> firstClose(vertexCount);
+			uint32_t chunkCount = parallel ? JobSystem::ComputeChunkCount(vertexCount, s_grainSize) : 1;
+			JobSystem::ParallelForChunks(vertexCount, chunkCount, [&](uint32_t, uint32_t first, uint32_t last)
+				{
+					std::vector<uint32_t> neighbours;
+					for (uint32_t v = first; v < last; ++v)
+					{
+						query(v, neighbours);
+						firstClose[v] = v;
+						for (uint32_t u : neighbours)
+						{
+							if (u >= v)
+								break;
+
+							if (Close(decoded, u, v, desc.attributeEpsilon))
+							{
+								firstClose[v] = u;
+								break;
+							}
+						}
+					}
+				});
+
+			// in order, with a second search when the first close vertex was merged itself
+			std::vector<uint32_t> neighbours;
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				uint32_t u = firstClose[v];
+				if (u == v || representatives[u] == u)
+				{
+					representatives[v] = u;
+					continue;
+				}
+
+				representatives[v] = v;
+				query(v, neighbours);
+				for (uint32_t w : neighbours)
+				{
+					if (w >= v)
+						break;
+
+					if (representatives[w] == w && Close(decoded, w, v, desc.attributeEpsilon))
+					{
+						representatives[v] = w;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t VertexWelder::GenerateRemap(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, uint32_t* remap, const WeldDesc& desc)
+	{
+		assert(desc.positionEpsilon >= 0.0f && desc.attributeEpsilon >= 0.0f && "Negative weld epsilon");
+
+		if (vertexCount == 0)
+			return 0;
+
+		// the representatives are built in remap, they are always earlier vertices so they can be renumbered in place
+		bool parallel = IsParallel(desc, vertexCount);
+		if (desc.positionEpsilon > 0.0f)
+			FindEpsilonRepresentatives(layout, vertices, vertexCount, desc, parallel, remap);
+		else
+			FindBitwiseRepresentatives(layout, static_cast<const uint8_t*>(vertices), vertexCount, parallel, remap);
+
+		uint32_t count = 0;
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			remap[v] = remap[v] == v ? count++ : remap[remap[v]];
+
+		return count;
+	}
+
+	void VertexWelder::CompactVertices(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, const uint32_t* remap, void* destination)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(vertices);
+		uint8_t* dst = static_cast<uint8_t*>(destination);
+		uint32_t stride = layout.GetStride();
+
+		// welded vertices are numbered in order of first occurrence
+		uint32_t next = 0;
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if (remap[v] == next)
+			{
+				memcpy(dst + static_cast<size_t>(next) * stride, src + static_cast<size_t>(v) * stride, stride);
+				++next;
+			}
+		}
+	}
+
+	uint32_t VertexWelder::Weld(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, void* dstVertices, uint32_t* dstIndices, const WeldDesc& desc)
+	{
+		std::vector<uint32_t> remap(vertexCount);
+		uint32_t count = GenerateRemap(layout, vertices, vertexCount, remap.data(), desc);
+
+		CompactVertices(layout, vertices, vertexCount, remap.data(), dstVertices);
+
+		if (indices)
+			MeshOptimizer::RemapIndices(indices, indexCount, remap.data(), dstIndices);
+		else
+			std::copy(remap.begin(), remap.end(), dstIndices);
+
+		return count;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "VertexLayout.h"
+
+#include <stdint.h>
+
+namespace GM
+{
+	struct WeldDesc
+	{
+		float positionEpsilon = 0.0f;  // 0: only vertices with the same bits in every attribute are merged
+		float attributeEpsilon = 0.0f; // with positionEpsilon > 0: largest difference of the other decoded components
+		bool multithreaded = true;
+		uint32_t parallelThreshold = 16384; // fewer vertices are welded on the calling thread
+	};
+
+	/// <summary>
+	/// Merges duplicated vertices of any VertexLayout, the padding between attributes is ignored.
+	///
+	/// Bitwise: every vertex is hashed in parallel, the vertices are partitioned by the top bits of their hash and
+	/// every partition is deduplicated with its own open addressing table, on its own thread.
+	/// Epsilon: the attributes are decoded to floats and the positions put in a SpatialHash with a cell size of
+	/// positionEpsilon. A vertex merges with the first earlier unmerged vertex whose position is within
+	/// positionEpsilon and whose other components are within attributeEpsilon, the same as checking every vertex
+	/// in order against the unmerged ones. The neighbour searches run in parallel.
+	///
+	/// Welded vertices are numbered in order of first occurrence and keep the attributes of that occurrence,
+	/// so the results don't depend on the thread count.
+	/// </summary>
+	class VertexWelder
+	{
+	public:
+		// remap[v] = welded vertex. Returns the welded vertex count
+		static uint32_t GenerateRemap(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, uint32_t* remap, const WeldDesc& desc = WeldDesc());
+
+		// the first occurrence of every welded vertex into destination, which can't overlap vertices
+		static void CompactVertices(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, const uint32_t* remap, void* destination);
+
+		/// <summary>
+		/// GenerateRemap then CompactVertices into dstVertices, which needs room for vertexCount vertices.
+		/// indices nullptr: unindexed input, dstIndices receives vertexCount indices. Otherwise dstIndices receives
+		/// indexCount remapped indices and can be indices. Returns the welded vertex count.
+		/// </summary>
+		static uint32_t Weld(const VertexLayout& layout, const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, void* dstVertices, uint32_t* dstIndices, const WeldDesc& desc = WeldDesc());
+
+	private:
+		VertexWelder() = default;
+	};
+}
@@ -118,6 +118,16 @@ namespace GM
 		return Vec3Rotate(Vector(0.0f, 0.0f, 1.0f, 0.0f), GetOrientation());;
 	}
 
+	Ray Camera::GetRay(float x, float y) const
+	{
+		float tanHalfFov = tanf(ToRadians(m_desc.fov) * 0.5f);
+		float viewX = (2.0f * x / m_desc.width - 1.0f) * tanHalfFov * (m_desc.width / m_desc.height);
+		float viewY = (1.0f - 2.0f * y / m_desc.height) * tanHalfFov;
+
+		Vector dir = Vec3Rotate(Vector(viewX, viewY, 1.0f, 0.0f), GetOrientation());
+		return Ray(Vector(m_desc.position.x, m_desc.position.y, m_desc.position.z, 1.0f), Vec3Normalized(dir));
+	}
+
 	const CameraDesc& Camera::GetDesc() const
 	{
 		return m_desc;
@@ -205,9 +215,9 @@ namespace GM
 			trFarInt.x, trFarInt.y, trFarInt.z,
 		};
 
-		std::array<uint32_t, 72> indices;
+		std::array<uint16_t, 72> indices;
 		for (int i = 0; i < indices.size(); i++)
-			indices[i] = i;
+			indices[i] = static_cast<uint16_t>(i);
 
 		{
 			D3D11_BUFFER_DESC desc = {};
@@ -226,10 +236,10 @@ namespace GM
 		{
 			D3D11_BUFFER_DESC desc = {};
 			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			desc.ByteWidth = (uint32_t)indices.size() * sizeof(uint32_t);
+			desc.ByteWidth = (uint32_t)indices.size() * sizeof(uint16_t);
 			desc.CPUAccessFlags = 0;
 			desc.MiscFlags = 0;
-			desc.StructureByteStride = sizeof(uint32_t);
+			desc.StructureByteStride = sizeof(uint16_t);
 			desc.Usage = D3D11_USAGE_DEFAULT;
 
 			D3D11_SUBRESOURCE_DATA srd = {};
@@ -1,5 +1,6 @@
 #pragma once
 #include "Math/GMMath.h"
+#include "Geometry/Ray.h"
 #include "Core/NativeWindow.h"
 #include <d3d11.h>
 #include <wrl.h>
@@ -43,10 +44,13 @@ namespace GM
 		Vector GetUpDirection() const;
 		Vector GetForwardDirection() const;
 
+		// world space ray through the pixel (x, y), (0, 0) is the top left corner. Direction is normalized.
+		Ray GetRay(float x, float y) const;
+
 		const CameraDesc& GetDesc() const;
 
 		ID3D11Buffer* GetFrustumVB() const;
-		ID3D11Buffer* GetFrustumIB() const;
+		ID3D11Buffer* GetFrustumIB() const; // 16 bit indices
 
 	private:
 		void UpdateViewMatrix();
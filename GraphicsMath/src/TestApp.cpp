@@ -3,6 +3,9 @@
 #include <d3dcompiler.h>
 #include "Utils/TextReader.h"
 #include "Utils/BasicMesh.h"
+#include "Mesh/IndexBuffer.h"
+#include "Mesh/VertexConversion.h"
+#include "Mesh/VertexWelder.h"
 #include "Math/Operators.h"
 #include "Math/Functions.h"
 
@@ -13,6 +16,59 @@ using namespace Microsoft::WRL;
 
 using namespace DirectX;
 
+namespace
+{
+	DXGI_FORMAT GetDXGIFormat(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float1: return DXGI_FORMAT_R32_FLOAT;
+		case VertexFormat::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+		case VertexFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+		case VertexFormat::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		case VertexFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+		case VertexFormat::Half4: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+		case VertexFormat::UNorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+		case VertexFormat::SNorm8x4: return DXGI_FORMAT_R8G8B8A8_SNORM;
+		case VertexFormat::UNorm16x2: return DXGI_FORMAT_R16G16_UNORM;
+		case VertexFormat::UNorm16x4: return DXGI_FORMAT_R16G16B16A16_UNORM;
+		case VertexFormat::SNorm16x2: return DXGI_FORMAT_R16G16_SNORM;
+		case VertexFormat::SNorm16x4: return DXGI_FORMAT_R16G16B16A16_SNORM;
+		default: return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	DXGI_FORMAT GetDXGIFormat(IndexFormat format)
+	{
+		return format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	}
+
+	const char* GetSemanticName(VertexSemantic semantic)
+	{
+		switch (semantic)
+		{
+		case VertexSemantic::Position: return "POSITION";
+		case VertexSemantic::Normal: return "NORMAL";
+		case VertexSemantic::Tangent: return "TANGENT";
+		case VertexSemantic::TexCoord: return "TEXCOORD";
+		case VertexSemantic::Color: return "COLOR";
+		default: return "";
+		}
+	}
+
+	// returns the number of element descs written
+	uint32_t GetInputElementDescs(const VertexLayout& layout, D3D11_INPUT_ELEMENT_DESC* elementDescs)
+	{
+		for (uint32_t i = 0; i < layout.GetAttributeCount(); ++i)
+		{
+			const VertexAttribute& attribute = layout.GetAttribute(i);
+			elementDescs[i] = { GetSemanticName(attribute.semantic), 0, GetDXGIFormat(attribute.format), 0, attribute.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+		}
+
+		return layout.GetAttributeCount();
+	}
+}
+
 
 
 TestApp::TestApp()
@@ -198,10 +254,10 @@ void TestApp::OnRender()
 	// Set Vertex and Index Buffer
 	{
 		const uint32_t offset = 0;
-		const uint32_t stride = 7 * sizeof(float);
+		const uint32_t stride = m_cubeLayout.GetStride();
 		m_context->IASetVertexBuffers(0, 1, m_vb.GetAddressOf(), &stride, &offset);
 
-		m_context->IASetIndexBuffer(m_ib.Get(), DXGI_FORMAT_R32_UINT, 0);
+		m_context->IASetIndexBuffer(m_ib.Get(), GetDXGIFormat(m_cubeIndexFormat), 0);
 	}
 
 	m_context->DrawIndexed(36, 0, 0);
@@ -337,22 +393,27 @@ void TestApp::SetRendererStates()
 
 void TestApp::SetShaders()
 {
+	// the files are read on the I/O threads while the shaders before them compile
+	std::future<Utils::TextFile> basicVSSource = Utils::TextReader::ReadAsync("res/shaders/basic.vs.hlsl");
+	std::future<Utils::TextFile> basicPSSource = Utils::TextReader::ReadAsync("res/shaders/basic.ps.hlsl");
+	std::future<Utils::TextFile> worldGridVSSource = Utils::TextReader::ReadAsync("res/shaders/world_grid.vs.hlsl");
+	std::future<Utils::TextFile> colorVSSource = Utils::TextReader::ReadAsync("res/shaders/color.vs.hlsl");
+	std::future<Utils::TextFile> colorPSSource = Utils::TextReader::ReadAsync("res/shaders/color.ps.hlsl");
+
 	{
 		ComPtr<ID3DBlob> byteCode;
 		ComPtr<ID3DBlob> errorBlob;
-		std::string src = Utils::TextReader::Read("res/shaders/basic.vs.hlsl");
+		Utils::TextFile source = basicVSSource.get();
+		std::string_view src = source.GetText();
 		HR_MSG(D3DCompile(src.data(), src.size(), nullptr, nullptr, nullptr, "main", "vs_4_0",
 			0, 0, &byteCode, &errorBlob), static_cast<const char*>(errorBlob->GetBufferPointer()));
 
 		HR(m_device->CreateVertexShader(byteCode->GetBufferPointer(), byteCode->GetBufferSize(), nullptr, &m_vs));
 
-		D3D11_INPUT_ELEMENT_DESC elementDescs[2] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}
-		};
+		D3D11_INPUT_ELEMENT_DESC elementDescs[VertexLayout::MaxAttributes];
+		uint32_t elementCount = GetInputElementDescs(m_cubeLayout, elementDescs);
 
-		HR(m_device->CreateInputLayout(elementDescs, 2, byteCode->GetBufferPointer(),
+		HR(m_device->CreateInputLayout(elementDescs, elementCount, byteCode->GetBufferPointer(),
 			byteCode->GetBufferSize(), &m_inputLayout));
 	}
 
@@ -360,7 +421,8 @@ void TestApp::SetShaders()
 	{
 		ComPtr<ID3DBlob> byteCode;
 		ComPtr<ID3DBlob> errorBlob;
-		std::string src = Utils::TextReader::Read("res/shaders/basic.ps.hlsl");
+		Utils::TextFile source = basicPSSource.get();
+		std::string_view src = source.GetText();
 		HR_MSG(D3DCompile(src.data(), src.size(), nullptr, nullptr, nullptr, "main", "ps_4_0",
 			0, 0, &byteCode, &errorBlob), static_cast<const char*>(errorBlob->GetBufferPointer()));
 
@@ -372,43 +434,42 @@ void TestApp::SetShaders()
 	{
 		ComPtr<ID3DBlob> byteCode;
 		ComPtr<ID3DBlob> errorBlob;
-		std::string src = Utils::TextReader::Read("res/shaders/world_grid.vs.hlsl");
+		Utils::TextFile source = worldGridVSSource.get();
+		std::string_view src = source.GetText();
 		HR_MSG(D3DCompile(src.data(), src.size(), nullptr, nullptr, nullptr, "main", "vs_4_0",
 			0, 0, &byteCode, &errorBlob), static_cast<const char*>(errorBlob->GetBufferPointer()));
 
 		HR(m_device->CreateVertexShader(byteCode->GetBufferPointer(), byteCode->GetBufferSize(), nullptr, &m_wgVS));
 
-		D3D11_INPUT_ELEMENT_DESC elementDescs[2] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		};
+		D3D11_INPUT_ELEMENT_DESC elementDescs[VertexLayout::MaxAttributes];
+		uint32_t elementCount = GetInputElementDescs(m_positionLayout, elementDescs);
 
-		HR(m_device->CreateInputLayout(elementDescs, 1, byteCode->GetBufferPointer(),
+		HR(m_device->CreateInputLayout(elementDescs, elementCount, byteCode->GetBufferPointer(),
 			byteCode->GetBufferSize(), &m_wgInputLayout));
 	}
 
 	{
 		ComPtr<ID3DBlob> byteCode;
 		ComPtr<ID3DBlob> errorBlob;
-		std::string src = Utils::TextReader::Read("res/shaders/color.vs.hlsl");
+		Utils::TextFile source = colorVSSource.get();
+		std::string_view src = source.GetText();
 		HR_MSG(D3DCompile(src.data(), src.size(), nullptr, nullptr, nullptr, "main", "vs_4_0",
 			0, 0, &byteCode, &errorBlob), static_cast<const char*>(errorBlob->GetBufferPointer()));
 
 		HR(m_device->CreateVertexShader(byteCode->GetBufferPointer(), byteCode->GetBufferSize(), nullptr, &m_colorVS));
 
-		D3D11_INPUT_ELEMENT_DESC elementDescs[2] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		};
+		D3D11_INPUT_ELEMENT_DESC elementDescs[VertexLayout::MaxAttributes];
+		uint32_t elementCount = GetInputElementDescs(m_positionLayout, elementDescs);
 
-		HR(m_device->CreateInputLayout(elementDescs, 1, byteCode->GetBufferPointer(),
+		HR(m_device->CreateInputLayout(elementDescs, elementCount, byteCode->GetBufferPointer(),
 			byteCode->GetBufferSize(), &m_colorInputLayout));
 	}
 
 	{
 		ComPtr<ID3DBlob> byteCode;
 		ComPtr<ID3DBlob> errorBlob;
-		std::string src = Utils::TextReader::Read("res/shaders/color.ps.hlsl");
+		Utils::TextFile source = colorPSSource.get();
+		std::string_view src = source.GetText();
 		HR_MSG(D3DCompile(src.data(), src.size(), nullptr, nullptr, nullptr, "main", "ps_4_0",
 			0, 0, &byteCode, &errorBlob), static_cast<const char*>(errorBlob->GetBufferPointer()));
 
@@ -460,29 +521,38 @@ void TestApp::SetBuffers()
 			 0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 1.0f, 1.0f,
 		};
 
+		// float colors converted to the 8 bit colors of m_cubeLayout
+		VertexLayout srcLayout = VertexLayout().Add(VertexSemantic::Position, VertexFormat::Float3).Add(VertexSemantic::Color, VertexFormat::Float4);
+		const uint32_t vertexCount = (uint32_t)cubeVert.size() * sizeof(float) / srcLayout.GetStride();
+
+		std::vector<uint8_t> vertices(vertexCount * m_cubeLayout.GetStride());
+		ConvertVertices(srcLayout, cubeVert.data(), m_cubeLayout, vertices.data(), vertexCount);
+		m_cubeIndexFormat = SelectIndexFormat(vertexCount);
+
 		D3D11_BUFFER_DESC desc = {};
 		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		desc.ByteWidth = (uint32_t)cubeVert.size() * sizeof(float);
+		desc.ByteWidth = (uint32_t)vertices.size();
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
-		desc.StructureByteStride = 7 * sizeof(float);
+		desc.StructureByteStride = m_cubeLayout.GetStride();
 		desc.Usage = D3D11_USAGE_DEFAULT;
 
 		D3D11_SUBRESOURCE_DATA srd = {};
-		srd.pSysMem = cubeVert.data();
+		srd.pSysMem = vertices.data();
 		HR(m_device->CreateBuffer(&desc, &srd, &m_vb));
 	}
 
 	// cube indices
 	{
 		auto cubeInd = Utils::BasicMesh::CreateCubeIndices();
+		ConvertIndices(cubeInd.data(), (uint32_t)cubeInd.size(), m_cubeIndexFormat, cubeInd.data());
 
 		D3D11_BUFFER_DESC desc = {};
 		desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		desc.ByteWidth = (uint32_t)cubeInd.size() * sizeof(uint32_t);
+		desc.ByteWidth = (uint32_t)cubeInd.size() * GetIndexSize(m_cubeIndexFormat);
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
-		desc.StructureByteStride = sizeof(uint32_t);
+		desc.StructureByteStride = GetIndexSize(m_cubeIndexFormat);
 		desc.Usage = D3D11_USAGE_DEFAULT;
 
 		D3D11_SUBRESOURCE_DATA srd = {};
@@ -497,7 +567,6 @@ void TestApp::SetBuffers()
 		const float depthPerGrid = 1.0f;
 
 		std::vector<float> vert;
-		std::vector<uint32_t> ind;
 		for (int i = 0; i <= max; i++)
 		{
 			vert.emplace_back(-(max / 2) + widthPerGrid * i);
@@ -518,29 +587,34 @@ void TestApp::SetBuffers()
 		}
 
 
-		for (int i = 0; i < vert.size(); i++)
-		{
-			ind.emplace_back(i);
-		}
-		
+		// the border lines share their end points
+		const uint32_t vertexCount = (uint32_t)vert.size() / 3;
+		std::vector<float> welded(vert.size());
+		std::vector<uint32_t> ind(vertexCount);
+		const uint32_t weldedCount = VertexWelder::Weld(m_positionLayout, vert.data(), vertexCount, nullptr, 0, welded.data(), ind.data());
+		welded.resize(weldedCount * 3);
+		m_wgIndexCount = (uint32_t)ind.size();
+		m_wgIndexFormat = SelectIndexFormat(weldedCount);
+		ConvertIndices(ind.data(), m_wgIndexCount, m_wgIndexFormat, ind.data());
+
 		D3D11_BUFFER_DESC desc = {};
 		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		desc.ByteWidth = (uint32_t)vert.size() * sizeof(float);
+		desc.ByteWidth = (uint32_t)welded.size() * sizeof(float);
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
-		desc.StructureByteStride = 3 * sizeof(float);
+		desc.StructureByteStride = m_positionLayout.GetStride();
 		desc.Usage = D3D11_USAGE_DEFAULT;
 
 		D3D11_SUBRESOURCE_DATA srd = {};
-		srd.pSysMem = vert.data();
+		srd.pSysMem = welded.data();
 		HR(m_device->CreateBuffer(&desc, &srd, &m_wgVB));
 
 
 		desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		desc.ByteWidth = (uint32_t)ind.size() * sizeof(uint32_t);
+		desc.ByteWidth = m_wgIndexCount * GetIndexSize(m_wgIndexFormat);
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
-		desc.StructureByteStride = sizeof(uint32_t);
+		desc.StructureByteStride = GetIndexSize(m_wgIndexFormat);
 		desc.Usage = D3D11_USAGE_DEFAULT;
 
 		srd.pSysMem = ind.data();
@@ -646,13 +720,13 @@ void TestApp::DrawWorldGrid()
 	// Set Vertex and Index Buffer
 	{
 		const uint32_t offset = 0;
-		const uint32_t stride = 3 * sizeof(float);
+		const uint32_t stride = m_positionLayout.GetStride();
 		m_context->IASetVertexBuffers(0, 1, m_wgVB.GetAddressOf(), &stride, &offset);
 
-		m_context->IASetIndexBuffer(m_wgIB.Get(), DXGI_FORMAT_R32_UINT, 0);
+		m_context->IASetIndexBuffer(m_wgIB.Get(), GetDXGIFormat(m_wgIndexFormat), 0);
 	}
 
-	m_context->DrawIndexed(80, 0, 0);
+	m_context->DrawIndexed(m_wgIndexCount, 0, 0);
 }
 
 void TestApp::DrawCameraFrustum()
@@ -698,11 +772,11 @@ void TestApp::DrawCameraFrustum()
 	// Set Vertex and Index Buffer
 	{
 		const uint32_t offset = 0;
-		const uint32_t stride = 3 * sizeof(float);
+		const uint32_t stride = m_positionLayout.GetStride();
 		auto vb = m_cameras[!m_activeCamera].GetFrustumVB();
 		m_context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
 
-		m_context->IASetIndexBuffer(m_cameras[!m_activeCamera].GetFrustumIB(), DXGI_FORMAT_R32_UINT, 0);
+		m_context->IASetIndexBuffer(m_cameras[!m_activeCamera].GetFrustumIB(), DXGI_FORMAT_R16_UINT, 0);
 	}
 
 	m_context->DrawIndexed(75, 0, 0);
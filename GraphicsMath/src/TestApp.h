@@ -5,6 +5,8 @@
 #include "Event/ApplicationEvent.h"
 #include "ImGui/ImGuiManager.h"
 #include "Math/Types.h"
+#include "Mesh/IndexBuffer.h"
+#include "Mesh/VertexLayout.h"
 #include "Rendering/Camera.h"
 #include "Utils/FPSCamController.h"
 
@@ -73,6 +75,10 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_colorVSEntCBuf;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_colorPSEntCBuf;
 
+	// the cube is stored with 8 bit colors, the grid and frustum are positions only
+	GM::VertexLayout m_cubeLayout = GM::VertexLayout().Add(GM::VertexSemantic::Position, GM::VertexFormat::Float3).Add(GM::VertexSemantic::Color, GM::VertexFormat::UNorm8x4);
+	GM::VertexLayout m_positionLayout = GM::VertexLayout().Add(GM::VertexSemantic::Position, GM::VertexFormat::Float3);
+
 	std::array<GM::Camera, 2> m_cameras;
 	GM::Utils::FPSCamController m_fpsCamController;
 
@@ -80,6 +86,10 @@ private:
 	GM::Vector m_cubeRot;
 	GM::Vector m_cubeSca = GM::Vector(1.0, 1.0f, 1.0f, 0.0f);
 
+	GM::IndexFormat m_cubeIndexFormat = GM::IndexFormat::UInt32;
+	GM::IndexFormat m_wgIndexFormat = GM::IndexFormat::UInt32;
+	uint32_t m_wgIndexCount = 0;
+
 	int m_activeCamera = 0;
 	bool m_showGrid = false;
 
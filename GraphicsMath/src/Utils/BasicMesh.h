@@ -1,6 +1,7 @@
 #pragma once
-#include <vector>
 #include <array>
+#include <stdint.h>
+#include <vector>
 
 namespace GM::Utils
 {
@@ -8,10 +9,10 @@ namespace GM::Utils
 	{
 	public:
 		static std::vector<float> CreateCubeVertices(bool hasTexCoords, bool hasNormals, float minPos, float maxPos, float texCoordU, float texCoordV);
-		static 	std::vector<float> CreatePlaneVertices(bool hasTexCoords, bool hasNormals, float minPos, float maxPos, float texCoordU, float texCoordV);
+		static std::vector<float> CreatePlaneVertices(bool hasTexCoords, bool hasNormals, float minPos, float maxPos, float texCoordU, float texCoordV);
 
 		static std::array<uint32_t, 36> CreateCubeIndices();
-		std::array<uint32_t, 6> CreatePlaneIndices();
+		static std::array<uint32_t, 6> CreatePlaneIndices();
 
 	private:
 		BasicMesh() = default;
@@ -1,23 +1,66 @@
 #include "TextReader.h"
+#include "Core/IOThreadPool.h"
 
-#include <fstream>
-#include <assert.h>
+#include <memory>
 
 namespace GM::Utils
 {
+	std::string_view TextFile::GetText() const
+	{
+		return m_file.GetView();
+	}
+
+	const std::string& TextFile::GetFilename() const
+	{
+		return m_filename;
+	}
+
 	std::string TextReader::Read(const std::string& filename)
 	{
-		std::string result;
-		std::ifstream in(filename, std::ios::in | std::ios::binary);
+		TextFile file = Map(filename);
+		return std::string(file.GetText());
+	}
+
+	TextFile TextReader::Map(const std::string& filename)
+	{
+		TextFile file;
+		if (!file.m_file.Open(filename))
+			throw Exception(__LINE__, __FILE__, filename, file.m_file.GetError());
 
-		assert(in && "Failed to load text file ");
+		file.m_filename = filename;
+		file.m_file.Prefetch();
+		return file;
+	}
 
-		in.seekg(0, std::ios::end);
-		result.resize(static_cast<uint32_t>(in.tellg()));
-		in.seekg(0, std::ios::beg);
-		in.read(result.data(), result.size());
-		in.close();
+	std::future<TextFile> TextReader::ReadAsync(const std::string& filename)
+	{
+		// packaged_task is move only, std::function needs a copyable task
+		auto task = std::make_shared<std::packaged_task<TextFile()>>([filename]()
+			{
+				TextFile file = Map(filename);
+				file.m_file.Prefetch(0, SIZE_MAX, true);
+				return file;
+			});
 
+		std::future<TextFile> result = task->get_future();
+		IOThreadPool::Submit([task]() { (*task)(); });
 		return result;
 	}
-}
\ No newline at end of file
+
+	TextReader::Exception::Exception(int line, const std::string& file, const std::string& filename, const std::string& error)
+		: GMException(line, file), m_filename(filename), m_error(error)
+	{
+	}
+
+	const char* TextReader::Exception::what() const
+	{
+		std::ostringstream oss;
+		oss << GetType() << '\n'
+			<< "[Text File] " << GetFilename() << '\n'
+			<< "[Error] " << GetError() << '\n'
+			<< GetOriginString();
+
+		m_whatBuffer = oss.str();
+		return m_whatBuffer.c_str();
+	}
+}
@@ -1,15 +1,59 @@
 #pragma once
 
+#include "Core/GMException.h"
+#include "Core/MappedFile.h"
+
+#include <future>
 #include <string>
+#include <string_view>
 
 namespace GM::Utils
 {
+	// a text file mapped read only, the text stays valid as long as the TextFile
+	class TextFile
+	{
+	public:
+		TextFile() = default;
+
+		std::string_view GetText() const;
+		const std::string& GetFilename() const;
+
+	private:
+		friend class TextReader;
+
+		MappedFile m_file;
+		std::string m_filename;
+	};
+
+	/// <summary>
+	/// Text file access. Map and ReadAsync hand out views of the mapped file without copying it, ReadAsync maps
+	/// on an IOThreadPool thread and reads every page in before its future is ready, so the calling thread never
+	/// waits on the disk. Failures throw TextReader::Exception with the OS error, from future::get for ReadAsync.
+	/// </summary>
 	class TextReader
 	{
 	public:
+		// a copy of the file
 		static std::string Read(const std::string& filename);
+		static TextFile Map(const std::string& filename);
+		static std::future<TextFile> ReadAsync(const std::string& filename);
+
+		class Exception : public GMException
+		{
+		public:
+			Exception(int line, const std::string& file, const std::string& filename, const std::string& error);
+			virtual const char* what() const override;
+			virtual const char* GetType() const override { return "TextReader Exception"; }
+
+			const std::string& GetFilename() const { return m_filename; }
+			const std::string& GetError() const { return m_error; }
+
+		private:
+			std::string m_filename;
+			std::string m_error;
+		};
 
 	private:
 		TextReader() = default;
 	};
-}
\ No newline at end of file
+}